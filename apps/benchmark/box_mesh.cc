@@ -0,0 +1,146 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Generate structured box meshes for the scaling benchmarks.
+///
+/// Usage: box_mesh <output.g> <nx> <ny> [<nz>]
+///
+/// The box spans [-1/2, 1/2] in each direction, like the bundled meshes.
+/// Quadrilaterals are written for two dimensions and hexahedra for three.
+////////////////////////////////////////////////////////////////////////////////
+
+// user includes
+#include <exodusII.h>
+
+// system includes
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Check an exodus return code.
+////////////////////////////////////////////////////////////////////////////////
+void check( int status, const char * what )
+{
+  if ( status < 0 ) {
+    std::cerr << "box_mesh: " << what << "() returned " << status << std::endl;
+    std::exit( EXIT_FAILURE );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Main driver.
+////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char ** argv )
+{
+
+  if ( argc < 4 || argc > 5 ) {
+    std::cerr << "Usage: " << argv[0] << " <output.g> <nx> <ny> [<nz>]" 
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string filename = argv[1];
+  int num_dims = argc - 2;
+
+  std::array<long, 3> num_cells = {1, 1, 1};
+  for ( int i=0; i<num_dims; ++i ) {
+    num_cells[i] = std::atol( argv[i+2] );
+    if ( num_cells[i] < 1 ) {
+      std::cerr << "box_mesh: invalid number of cells, " << argv[i+2] 
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  
+  std::array<long, 3> num_verts = {1, 1, 1};
+  for ( int i=0; i<num_dims; ++i ) num_verts[i] = num_cells[i] + 1;
+
+  auto num_nodes = num_verts[0] * num_verts[1] * num_verts[2];
+  auto num_elem = num_cells[0] * num_cells[1] * num_cells[2];
+  
+  //---------------------------------------------------------------------------
+  // the vertex coordinates
+  
+  std::array< std::vector<double>, 3 > coords;
+  for ( int d=0; d<num_dims; ++d ) coords[d].reserve( num_nodes );
+
+  auto vertex_id = [&]( long i, long j, long k ) {
+    // exodus ids start at one
+    return 1 + i + num_verts[0] * ( j + num_verts[1] * k );
+  };
+
+  for ( long k=0; k<num_verts[2]; ++k )
+    for ( long j=0; j<num_verts[1]; ++j )
+      for ( long i=0; i<num_verts[0]; ++i ) {
+        std::array<long, 3> ijk = {i, j, k};
+        for ( int d=0; d<num_dims; ++d )
+          coords[d].emplace_back( 
+            static_cast<double>( ijk[d] ) / num_cells[d] - 0.5
+          );
+      }
+
+  //---------------------------------------------------------------------------
+  // the element connectivity, counter clockwise
+
+  auto nodes_per_elem = num_dims == 3 ? 8 : 4;
+  std::vector<int> conn;
+  conn.reserve( num_elem * nodes_per_elem );
+  
+  for ( long k=0; k<num_cells[2]; ++k )
+    for ( long j=0; j<num_cells[1]; ++j )
+      for ( long i=0; i<num_cells[0]; ++i ) {
+        auto kend = num_dims == 3 ? 2 : 1;
+        for ( long dk=0; dk<kend; ++dk ) {
+          conn.emplace_back( vertex_id( i  , j  , k+dk ) );
+          conn.emplace_back( vertex_id( i+1, j  , k+dk ) );
+          conn.emplace_back( vertex_id( i+1, j+1, k+dk ) );
+          conn.emplace_back( vertex_id( i  , j+1, k+dk ) );
+        }
+      }
+
+  //---------------------------------------------------------------------------
+  // write the file
+
+  int comp_ws = sizeof(double);
+  int io_ws = sizeof(double);
+  auto exoid = ex_create( filename.c_str(), EX_CLOBBER, &comp_ws, &io_ws );
+  check( exoid, "ex_create" );
+
+  check(
+    ex_put_init( 
+      exoid, "box mesh", num_dims, num_nodes, num_elem, 
+      /* blocks */ 1, /* node sets */ 0, /* side sets */ 0
+    ),
+    "ex_put_init"
+  );
+
+  check(
+    ex_put_coord( 
+      exoid, coords[0].data(), coords[1].data(), 
+      num_dims == 3 ? coords[2].data() : nullptr 
+    ),
+    "ex_put_coord"
+  );
+
+  check(
+    ex_put_elem_block( 
+      exoid, 1, num_dims == 3 ? "HEX8" : "QUAD4", num_elem, nodes_per_elem, 0
+    ),
+    "ex_put_elem_block"
+  );
+
+  check( ex_put_elem_conn( exoid, 1, conn.data() ), "ex_put_elem_conn" );
+
+  check( ex_close( exoid ), "ex_close" );
+
+  std::cout << "Wrote " << num_elem << " cells to " << filename << std::endl;
+
+  return EXIT_SUCCESS;
+
+}
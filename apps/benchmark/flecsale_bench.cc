@@ -0,0 +1,467 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Microbenchmarks for the flecsale kernels.
+///
+/// Usage: flecsale_bench [--filter <name>] [--min-time <seconds>]
+///                       [--json <file>] [--baseline <file>]
+///                       [--tolerance <fraction>]
+///
+/// Each kernel is applied to a large batch of randomly generated inputs, and
+/// the best of several repetitions is reported in ns per operation along
+/// with the achieved bandwidth and flop rate.  The flop counts are counted
+/// by hand from the kernels, so they are approximate.  If a baseline is
+/// given, the timings are compared against it, and with a tolerance, any
+/// kernel that got slower by more than that fraction is a failure.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/eos/ideal_gas.h>
+#include <flecsale/eqns/euler_eqns.h>
+#include <flecsale/eqns/flux.h>
+#include <flecsale/eqns/lagrange_eqns.h>
+#include <flecsale/linalg/qr.h>
+
+// system includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// explicitly use some stuff
+using namespace flecsale;
+
+using real_t = config::real_t;
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t num_dims = 3;
+
+using euler_t = eqns::euler_eqns_t<real_t, num_dims>;
+using lagrange_t = eqns::lagrange_eqns_t<real_t, num_dims>;
+using eos_t = eos::ideal_gas_t<real_t>;
+
+//! the number of inputs in a batch, large enough to spill out of cache
+constexpr std::size_t batch_size = 1 << 16;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The measured performance of a kernel.
+///////////////////////////////////////////////////////////////////////////////
+struct result_t {
+  std::string name;
+  double ns_per_op;
+  double gb_per_s;
+  double gflop_per_s;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Keep the compiler from optimizing away the results.
+///////////////////////////////////////////////////////////////////////////////
+volatile real_t sink;
+
+template< typename T >
+void keep( const T & value )
+{
+  sink = sink + static_cast<real_t>( value );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Time a kernel.
+//!
+//! \param [in] name  the kernel name
+//! \param [in] num_ops  the number of operations in one call of the kernel
+//! \param [in] bytes_per_op  the bytes moved by one operation
+//! \param [in] flops_per_op  the floating point operations in one operation
+//! \param [in] min_time  repeat the kernel for at least this many seconds
+//! \param [in] kernel  the kernel to run
+//! \return the best performance over all repetitions
+///////////////////////////////////////////////////////////////////////////////
+template< typename F >
+result_t run(
+  const std::string & name,
+  std::size_t num_ops,
+  double bytes_per_op,
+  double flops_per_op,
+  double min_time,
+  F && kernel
+) {
+
+  // warm up the caches and the branch predictors
+  kernel();
+
+  auto best = std::numeric_limits<double>::max();
+  auto total = 0.;
+  int reps = 0;
+
+  while ( total < min_time || reps < 3 ) {
+    auto start = clock_type::now();
+    kernel();
+    auto end = clock_type::now();
+    auto seconds = std::chrono::duration<double>( end - start ).count();
+    best = std::min( best, seconds );
+    total += seconds;
+    reps++;
+  }
+
+  auto ns_per_op = 1.e9 * best / num_ops;
+  return {
+    name, ns_per_op, bytes_per_op / ns_per_op, flops_per_op / ns_per_op
+  };
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Make a random ideal gas state.
+//!
+//! The velocities span subsonic and supersonic flow, so both the upwind and
+//! the mixed branches of the flux functions get exercised.
+///////////////////////////////////////////////////////////////////////////////
+template< typename G >
+euler_t::state_data_t make_state( G & gen, const eos_t & eos )
+{
+  std::uniform_real_distribution<real_t> dist(-1, 1);
+
+  real_t d = 1 + dist(gen)/2;
+  real_t p = 1 + dist(gen)/2;
+  euler_t::vector_t v;
+  for ( std::size_t i=0; i<num_dims; ++i ) v[i] = 2*dist(gen);
+
+  auto e = eos.compute_internal_energy_dp( d, p );
+  return euler_t::state_data_t{
+    d, v, p, e,
+    eos.compute_temperature_de( d, e ),
+    eos.compute_sound_speed_de( d, e )
+  };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Make a random unit vector.
+///////////////////////////////////////////////////////////////////////////////
+template< typename V, typename G >
+V make_normal( G & gen )
+{
+  std::uniform_real_distribution<real_t> dist(-1, 1);
+  V n;
+  real_t len = 0;
+  for ( std::size_t i=0; i<num_dims; ++i ) {
+    n[i] = dist(gen);
+    len += n[i]*n[i];
+  }
+  for ( std::size_t i=0; i<num_dims; ++i ) n[i] /= std::sqrt(len);
+  return n;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Read the ns per operation of each kernel from a baseline.
+//!
+//! The baseline is a report written with --json.
+///////////////////////////////////////////////////////////////////////////////
+std::vector< std::pair<std::string, double> >
+read_baseline( const std::string & filename )
+{
+  std::ifstream file( filename );
+  if ( !file ) {
+    std::cerr << "Unable to open baseline " << filename << std::endl;
+    std::exit( EXIT_FAILURE );
+  }
+
+  std::vector< std::pair<std::string, double> > baseline;
+
+  // each kernel is on its own line
+  for ( std::string line; std::getline( file, line ); ) {
+    auto name_pos = line.find( "\"name\": \"" );
+    auto ns_pos = line.find( "\"ns_per_op\": " );
+    if ( name_pos == std::string::npos || ns_pos == std::string::npos )
+      continue;
+    name_pos += 9;
+    auto name = line.substr( name_pos, line.find( '"', name_pos ) - name_pos );
+    auto ns = std::strtod( line.c_str() + ns_pos + 13, nullptr );
+    baseline.emplace_back( name, ns );
+  }
+
+  return baseline;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Main driver.
+///////////////////////////////////////////////////////////////////////////////
+int main( int argc, char ** argv )
+{
+
+  //---------------------------------------------------------------------------
+  // parse the arguments
+
+  std::string filter, json_name, baseline_name;
+  double min_time = 0.2;
+  double tolerance = -1;
+
+  for ( int i=1; i<argc; ++i ) {
+    std::string arg = argv[i];
+    auto has_value = i+1 < argc;
+    if ( arg == "--filter" && has_value )
+      filter = argv[++i];
+    else if ( arg == "--min-time" && has_value )
+      min_time = std::atof( argv[++i] );
+    else if ( arg == "--json" && has_value )
+      json_name = argv[++i];
+    else if ( arg == "--baseline" && has_value )
+      baseline_name = argv[++i];
+    else if ( arg == "--tolerance" && has_value )
+      tolerance = std::atof( argv[++i] );
+    else {
+      std::cerr << "Usage: " << argv[0] << " [--filter <name>] "
+                << "[--min-time <seconds>] [--json <file>] "
+                << "[--baseline <file>] [--tolerance <fraction>]"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto selected = [&]( const std::string & name ) {
+    return filter.empty() || name.find( filter ) != std::string::npos;
+  };
+
+  //---------------------------------------------------------------------------
+  // set up the inputs
+
+  std::mt19937 gen(1);
+  eos_t eos( /* gamma */ 1.4, /* cv */ 1.0 );
+
+  using state_t = euler_t::state_data_t;
+  using flux_t = euler_t::flux_data_t;
+  using normal_t = euler_t::vector_t;
+
+  std::vector<state_t> wl, wr;
+  std::vector<normal_t> normals;
+  std::vector<flux_t> fluxes( batch_size );
+  for ( std::size_t i=0; i<batch_size; ++i ) {
+    wl.emplace_back( make_state( gen, eos ) );
+    wr.emplace_back( make_state( gen, eos ) );
+    normals.emplace_back( make_normal<normal_t>( gen ) );
+  }
+
+  constexpr auto state_bytes = sizeof(state_t);
+  constexpr auto flux_bytes = sizeof(flux_t);
+  constexpr auto normal_bytes = sizeof(normal_t);
+  constexpr auto real_bytes = sizeof(real_t);
+
+  std::vector<result_t> results;
+
+  //---------------------------------------------------------------------------
+  // flux functions
+
+  if ( selected( "hlle_flux" ) )
+    results.emplace_back( run(
+      "hlle_flux", batch_size,
+      2*state_bytes + normal_bytes + flux_bytes, 121, min_time,
+      [&]() {
+        for ( std::size_t i=0; i<batch_size; ++i )
+          fluxes[i] = eqns::hlle_flux<euler_t>( wl[i], wr[i], normals[i] );
+        keep( fluxes[batch_size/2][0] );
+      }
+    ) );
+
+  if ( selected( "rusanov_flux" ) )
+    results.emplace_back( run(
+      "rusanov_flux", batch_size,
+      2*state_bytes + normal_bytes + flux_bytes, 112, min_time,
+      [&]() {
+        for ( std::size_t i=0; i<batch_size; ++i )
+          fluxes[i] = eqns::rusanov_flux<euler_t>( wl[i], wr[i], normals[i] );
+        keep( fluxes[batch_size/2][0] );
+      }
+    ) );
+
+  //---------------------------------------------------------------------------
+  // state updates
+
+  if ( selected( "euler_update_state_from_flux" ) ) {
+    // small updates so that the states stay physical over many repetitions
+    std::vector<flux_t> du( batch_size );
+    for ( std::size_t i=0; i<batch_size; ++i ) {
+      auto f = eqns::rusanov_flux<euler_t>( wl[i], wr[i], normals[i] );
+      for ( std::size_t j=0; j<f.size(); ++j ) du[i][j] = 1.e-12 * f[j];
+    }
+    auto w = wl;
+    results.emplace_back( run(
+      "euler_update_state_from_flux", batch_size,
+      2*state_bytes + flux_bytes, 28, min_time,
+      [&]() {
+        for ( std::size_t i=0; i<batch_size; ++i )
+          euler_t::update_state_from_flux( w[i], du[i] );
+        keep( euler_t::density( w[batch_size/2] ) );
+      }
+    ) );
+  }
+
+  if ( selected( "lagrange_compute_update" ) ) {
+    using lagrange_vector_t = lagrange_t::vector_t;
+    using lagrange_flux_t = lagrange_t::flux_data_t;
+    std::vector<lagrange_vector_t> u, force, n;
+    std::vector<lagrange_flux_t> dudt( batch_size );
+    for ( auto & du : dudt ) du = 0;
+    std::uniform_real_distribution<real_t> dist(-1, 1);
+    for ( std::size_t i=0; i<batch_size; ++i ) {
+      lagrange_vector_t ui, fi;
+      for ( std::size_t d=0; d<num_dims; ++d ) {
+        ui[d] = dist(gen);
+        fi[d] = dist(gen);
+      }
+      u.emplace_back( ui );
+      force.emplace_back( fi );
+      n.emplace_back( make_normal<lagrange_vector_t>( gen ) );
+    }
+    results.emplace_back( run(
+      "lagrange_compute_update", batch_size,
+      3*sizeof(lagrange_vector_t) + 2*sizeof(lagrange_flux_t), 15, min_time,
+      [&]() {
+        for ( std::size_t i=0; i<batch_size; ++i )
+          lagrange_t::compute_update( u[i], force[i], n[i], dudt[i] );
+        keep( dudt[batch_size/2][0] );
+      }
+    ) );
+  }
+
+  //---------------------------------------------------------------------------
+  // equation of state
+
+  if ( selected( "ideal_gas" ) ) {
+    std::vector<real_t> d( batch_size ), e( batch_size );
+    std::vector<real_t> p( batch_size ), t( batch_size ), a( batch_size );
+    for ( std::size_t i=0; i<batch_size; ++i ) {
+      d[i] = euler_t::density( wl[i] );
+      e[i] = euler_t::internal_energy( wl[i] );
+    }
+    // the pressure, temperature and sound speed, as in update_state_from_energy
+    results.emplace_back( run(
+      "ideal_gas_update_from_energy", batch_size, 5*real_bytes, 8, min_time,
+      [&]() {
+        eos.compute_state_de( 
+          batch_size, d.data(), e.data(), p.data(), t.data(), a.data() 
+        );
+        keep( p[batch_size/2] + t[batch_size/2] + a[batch_size/2] );
+      }
+    ) );
+  }
+
+  //---------------------------------------------------------------------------
+  // small dense solves, like the nodal solves with symmetry constraints
+
+  for ( std::size_t rows : {3, 5} ) {
+
+    std::ostringstream name;
+    name << "qr_" << rows << "x" << rows;
+    if ( !selected( name.str() ) ) continue;
+
+    // the solver overwrites its inputs, so keep a pristine copy
+    constexpr std::size_t num_systems = 1 << 12;
+    auto mat_size = rows*rows;
+    std::vector<real_t> A0( num_systems * mat_size ), b0( num_systems * rows );
+    std::uniform_real_distribution<real_t> dist(-1, 1);
+    for ( auto & x : A0 ) x = dist(gen);
+    for ( auto & x : b0 ) x = dist(gen);
+    // keep the systems well conditioned
+    for ( std::size_t s=0; s<num_systems; ++s )
+      for ( std::size_t i=0; i<rows; ++i )
+        A0[ s*mat_size + i*rows + i ] += 2*rows;
+
+    std::vector<real_t> A( mat_size ), b( rows );
+
+    auto flops = 4.*rows*rows*rows/3 + rows*rows;
+    results.emplace_back( run(
+      name.str(), num_systems, (mat_size + 2*rows)*real_bytes, flops, min_time,
+      [&]() {
+        for ( std::size_t s=0; s<num_systems; ++s ) {
+          std::copy_n( A0.begin() + s*mat_size, mat_size, A.begin() );
+          std::copy_n( b0.begin() + s*rows, rows, b.begin() );
+          auto A_view = ristra::utils::make_array_view( A, rows, rows );
+          auto b_view = ristra::utils::make_array_view( b );
+          linalg::qr( A_view, b_view );
+        }
+        keep( b[0] );
+      }
+    ) );
+
+  }
+
+  //---------------------------------------------------------------------------
+  // report
+
+  std::vector< std::pair<std::string, double> > baseline;
+  if ( !baseline_name.empty() ) baseline = read_baseline( baseline_name );
+
+  auto find_baseline = [&]( const std::string & name ) {
+    for ( const auto & b : baseline )
+      if ( b.first == name ) return b.second;
+    return 0.;
+  };
+
+  std::cout << std::left << std::setw(32) << "Kernel" << std::right
+            << std::setw(12) << "ns/op"
+            << std::setw(12) << "GB/s"
+            << std::setw(12) << "GFLOP/s";
+  if ( !baseline.empty() ) std::cout << std::setw(12) << "vs base";
+  std::cout << std::endl;
+  std::cout << std::string( baseline.empty() ? 68 : 80, '-' ) << std::endl;
+
+  int num_slower = 0;
+
+  std::cout << std::fixed;
+  for ( const auto & r : results ) {
+    std::cout << std::left << std::setw(32) << r.name << std::right
+              << std::setprecision(2)
+              << std::setw(12) << r.ns_per_op
+              << std::setw(12) << r.gb_per_s
+              << std::setw(12) << r.gflop_per_s;
+    auto base = find_baseline( r.name );
+    if ( base > 0 ) {
+      auto ratio = r.ns_per_op / base;
+      std::cout << std::setw(11) << ratio << "x";
+      if ( tolerance >= 0 && ratio > 1 + tolerance ) {
+        std::cout << "  SLOWER";
+        num_slower++;
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  if ( !json_name.empty() ) {
+    std::ofstream file( json_name );
+    file << "{" << std::endl;
+    file << "  \"real_bytes\": " << real_bytes << "," << std::endl;
+    file << "  \"batch_size\": " << batch_size << "," << std::endl;
+    file << "  \"kernels\": [" << std::endl;
+    for ( std::size_t i=0; i<results.size(); ++i ) {
+      const auto & r = results[i];
+      file << "    { \"name\": \"" << r.name << "\""
+           << ", \"ns_per_op\": " << r.ns_per_op
+           << ", \"gb_per_s\": " << r.gb_per_s
+           << ", \"gflop_per_s\": " << r.gflop_per_s
+           << " }" << ( i+1 < results.size() ? "," : "" ) << std::endl;
+    }
+    file << "  ]" << std::endl;
+    file << "}" << std::endl;
+  }
+
+  if ( num_slower > 0 ) {
+    std::cout << num_slower << " kernels are slower than the baseline."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+}
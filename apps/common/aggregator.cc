@@ -0,0 +1,184 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Funnel the output of many ranks through a few writer ranks.
+////////////////////////////////////////////////////////////////////////////////
+
+// user includes
+#include "aggregator.h"
+
+#include <ristra/assertions/errors.h>
+
+// system includes
+#include <cstdint>
+#include <fstream>
+#include <numeric>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+// Free the group communicator
+///////////////////////////////////////////////////////////////////////////////
+output_aggregator_t::~output_aggregator_t()
+{
+#ifdef FLECSALE_USE_MPI
+  int finalized = 0;
+  MPI_Finalized( &finalized );
+  if ( comm_ != MPI_COMM_NULL && !finalized ) MPI_Comm_free( &comm_ );
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Form the groups
+///////////////////////////////////////////////////////////////////////////////
+void output_aggregator_t::start( std::size_t ranks_per_file )
+{
+
+#ifdef FLECSALE_USE_MPI
+
+  if ( comm_ != MPI_COMM_NULL ) MPI_Comm_free( &comm_ );
+
+  int rank;
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+
+  // the ranks keep their order within a group
+  if ( ranks_per_file == 0 )
+    MPI_Comm_split_type(
+      MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &comm_
+    );
+  else
+    MPI_Comm_split( MPI_COMM_WORLD, rank / ranks_per_file, rank, &comm_ );
+
+  MPI_Comm_rank( comm_, &group_rank_ );
+
+  // number the files by their writers
+  int is_writer = this->is_writer() ? 1 : 0;
+  int file_id = 0, num_files = 0;
+  MPI_Exscan( &is_writer, &file_id, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD );
+  if ( rank == 0 ) file_id = 0;
+  MPI_Bcast( &file_id, 1, MPI_INT, 0, comm_ );
+  MPI_Allreduce( &is_writer, &num_files, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD );
+
+  file_id_ = file_id;
+  num_files_ = num_files;
+
+#endif
+
+  started_ = true;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Collect the slabs of a group on its writer
+///////////////////////////////////////////////////////////////////////////////
+void output_aggregator_t::gather(
+  const std::vector<char> & slab,
+  std::vector< std::vector<char> > & slabs
+) {
+
+  if ( !started_ )
+    throw_runtime_error( "The output aggregator was never started" );
+
+#ifdef FLECSALE_USE_MPI
+
+  int group_size;
+  MPI_Comm_size( comm_, &group_size );
+
+  int count = slab.size();
+  if ( is_writer() ) counts_.resize( group_size );
+  MPI_Gather(
+    &count, 1, MPI_INT, counts_.data(), 1, MPI_INT, 0, comm_
+  );
+
+  if ( is_writer() ) {
+    displacements_.resize( group_size );
+    std::exclusive_scan(
+      counts_.begin(), counts_.end(), displacements_.begin(), 0
+    );
+    buffer_.resize( displacements_.back() + counts_.back() );
+  }
+
+  MPI_Gatherv(
+    slab.data(), count, MPI_CHAR,
+    buffer_.data(), counts_.data(), displacements_.data(), MPI_CHAR,
+    0, comm_
+  );
+
+  if ( !is_writer() ) return;
+
+  // the slab vectors are reused, so their storage is too
+  slabs.resize( group_size );
+  for ( int r=0; r<group_size; ++r )
+    slabs[r].assign(
+      buffer_.begin() + displacements_[r],
+      buffer_.begin() + displacements_[r] + counts_[r]
+    );
+
+#else
+
+  slabs.assign( 1, slab );
+
+#endif
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Write an index that tells where the part of each rank is
+///////////////////////////////////////////////////////////////////////////////
+void output_aggregator_t::write_index(
+  const std::string & filename,
+  const std::function< std::string(std::size_t) > & file_name,
+  std::size_t num_cells,
+  std::size_t num_vertices
+) {
+
+  if ( !started_ )
+    throw_runtime_error( "The output aggregator was never started" );
+
+  std::uint64_t local[] = { file_id_, num_cells, num_vertices };
+  std::vector<std::uint64_t> all;
+  int rank = 0, size = 1;
+
+#ifdef FLECSALE_USE_MPI
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+  MPI_Comm_size( MPI_COMM_WORLD, &size );
+  if ( rank == 0 ) all.resize( 3*size );
+  MPI_Gather(
+    local, 3, MPI_UINT64_T, all.data(), 3, MPI_UINT64_T, 0, MPI_COMM_WORLD
+  );
+#else
+  all.assign( local, local+3 );
+#endif
+
+  if ( rank != 0 ) return;
+
+  std::ofstream file( filename );
+  if ( !file )
+    throw_runtime_error( "Unable to open \"" << filename << "\"" );
+
+  file << "# rank file first_cell num_cells first_vertex num_vertices"
+    << std::endl;
+
+  // the parts are stacked in each file in the order of the ranks
+  std::vector<std::uint64_t> cell_start( num_files_, 0 );
+  std::vector<std::uint64_t> vertex_start( num_files_, 0 );
+
+  for ( int r=0; r<size; ++r ) {
+    auto id = all[3*r];
+    auto nc = all[3*r+1];
+    auto nv = all[3*r+2];
+    file << r << " " << file_name(id) << " "
+      << cell_start[id] << " " << nc << " "
+      << vertex_start[id] << " " << nv << std::endl;
+    cell_start[id] += nc;
+    vertex_start[id] += nv;
+  }
+
+}
+
+} // namespace
+} // namespace
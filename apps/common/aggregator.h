@@ -0,0 +1,125 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Funnel the output of many ranks through a few writer ranks.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+
+// system includes
+#ifdef FLECSALE_USE_MPI
+#include <mpi.h>
+#endif
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Group the ranks so that each group writes a single file.
+//!
+//! The first rank of a group is its writer.  Every rank packs its part of
+//! the output into a slab of bytes, and the writer collects the slabs of
+//! its group, in the order of the ranks.  With thousands of ranks, creating
+//! the files costs more than writing the bytes, so only a few files are
+//! made.
+///////////////////////////////////////////////////////////////////////////////
+class output_aggregator_t {
+
+public:
+
+  //! \brief Constructor.
+  output_aggregator_t() = default;
+
+  //! \brief Destructor.
+  ~output_aggregator_t();
+
+  //! the aggregator owns a communicator, so it is not copyable
+  output_aggregator_t( const output_aggregator_t & ) = delete;
+  output_aggregator_t & operator=( const output_aggregator_t & ) = delete;
+
+  //===========================================================================
+  //! \brief Form the groups.
+  //!
+  //! This is collective over all ranks.
+  //!
+  //! \param [in] ranks_per_file  the ranks in a group, or zero for one group
+  //!                             per node
+  //===========================================================================
+  void start( std::size_t ranks_per_file );
+
+  //! \brief Check if the groups were formed.
+  bool is_started() const { return started_; }
+
+  //! \brief Check if this rank writes the file of its group.
+  bool is_writer() const { return group_rank_ == 0; }
+
+  //! \brief The file written by the group of this rank.
+  std::size_t file_id() const { return file_id_; }
+
+  //! \brief The number of files written.
+  std::size_t num_files() const { return num_files_; }
+
+  //===========================================================================
+  //! \brief Collect the slabs of a group on its writer.
+  //!
+  //! This is collective over the group.
+  //!
+  //! \param [in] slab  the slab of this rank
+  //! \param [out] slabs  the slabs of the group, only filled on the writer
+  //===========================================================================
+  void gather(
+    const std::vector<char> & slab,
+    std::vector< std::vector<char> > & slabs
+  );
+
+  //===========================================================================
+  //! \brief Write an index that tells where the part of each rank is.
+  //!
+  //! This is collective over all ranks, and the first rank writes the file.
+  //! It lists, for each rank, the file its part is in and where its cells
+  //! and vertices start in that file.
+  //!
+  //! \param [in] filename  the name of the index file
+  //! \param [in] file_name  the name of each file, by file id
+  //! \param [in] num_cells,num_vertices  the size of the part of this rank
+  //===========================================================================
+  void write_index(
+    const std::string & filename,
+    const std::function< std::string(std::size_t) > & file_name,
+    std::size_t num_cells,
+    std::size_t num_vertices
+  );
+
+private:
+
+  //! true once the groups are formed
+  bool started_ = false;
+  //! the rank within the group
+  int group_rank_ = 0;
+  //! the file of this group, and the number of files
+  std::size_t file_id_ = 0;
+  std::size_t num_files_ = 1;
+  //! the byte counts of the slabs of a group
+  std::vector<int> counts_, displacements_;
+  //! the slabs of a group, back to back
+  std::vector<char> buffer_;
+
+#ifdef FLECSALE_USE_MPI
+  //! the communicator of the group
+  MPI_Comm comm_ = MPI_COMM_NULL;
+#endif
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,211 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Write output in the background while the solution advances.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <ristra/assertions/errors.h>
+
+// system includes
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A fixed set of staging snapshots written out by a dedicated thread.
+//!
+//! The solver copies the data to write into a free snapshot and hands it
+//! off, which only costs a copy, and the thread formats and writes it while
+//! the solver moves on.  The snapshots are allocated once and reused, so the
+//! staging memory is bounded.  If the writer falls behind, acquire() blocks
+//! until a snapshot is written, which throttles the solver instead of
+//! letting the output pile up.
+//!
+//! Without any snapshots, or before start() is called, everything is written
+//! straight away on the calling thread.
+//!
+//! \tparam T  the snapshot type
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+class async_output__ {
+
+public:
+
+  //! the snapshot type
+  using snapshot_t = T;
+  //! the function that writes a snapshot
+  using writer_t = std::function< void(snapshot_t &) >;
+
+  //! \brief Constructor.
+  async_output__() = default;
+
+  //! \brief Destructor, writes what is left.
+  ~async_output__()
+  {
+    try { stop(); }
+    catch ( const std::exception & e ) {
+      std::cerr << "Output failed: " << e.what() << std::endl;
+    }
+  }
+
+  //! the thread refers back to this object, so it is not copyable
+  async_output__( const async_output__ & ) = delete;
+  async_output__ & operator=( const async_output__ & ) = delete;
+
+  //===========================================================================
+  //! \brief Start the output thread.
+  //! \param [in] num_snapshots  the number of staging snapshots, two for
+  //!                            double buffering, or zero to write
+  //!                            synchronously
+  //! \param [in] writer  the function that writes a snapshot
+  //===========================================================================
+  void start( std::size_t num_snapshots, writer_t writer )
+  {
+    stop();
+    writer_ = std::move(writer);
+    snapshots_.resize( std::max<std::size_t>( num_snapshots, 1 ) );
+    free_.clear();
+    for ( std::size_t i=0; i<snapshots_.size(); ++i ) free_.push_back(i);
+    if ( num_snapshots > 0 ) {
+      done_ = false;
+      thread_ = std::thread( [this](){ run(); } );
+    }
+  }
+
+  //===========================================================================
+  //! \brief Check if the output is written in the background.
+  //===========================================================================
+  bool is_async() const { return thread_.joinable(); }
+
+  //===========================================================================
+  //! \brief Get a free snapshot to fill, waiting for one if necessary.
+  //!
+  //! The snapshot must be handed back with submit() before the next call.
+  //===========================================================================
+  snapshot_t & acquire()
+  {
+    if ( snapshots_.empty() )
+      throw_runtime_error( "The output was never started" );
+    std::unique_lock<std::mutex> lock( mutex_ );
+    written_.wait( lock, [this](){ return !free_.empty() || error_; } );
+    rethrow();
+    current_ = free_.front();
+    free_.pop_front();
+    return snapshots_[current_];
+  }
+
+  //===========================================================================
+  //! \brief Hand off the snapshot from acquire() to be written.
+  //===========================================================================
+  void submit()
+  {
+    // without a thread, write it right away
+    if ( !is_async() ) {
+      writer_( snapshots_[current_] );
+      free_.push_back( current_ );
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock( mutex_ );
+      pending_.push_back( current_ );
+    }
+    submitted_.notify_one();
+  }
+
+  //===========================================================================
+  //! \brief Wait until everything handed off is written.
+  //===========================================================================
+  void flush()
+  {
+    std::unique_lock<std::mutex> lock( mutex_ );
+    written_.wait( lock,
+      [this](){ return free_.size() == snapshots_.size() || error_; } );
+    rethrow();
+  }
+
+  //===========================================================================
+  //! \brief Write everything handed off, and stop the thread.
+  //===========================================================================
+  void stop()
+  {
+    if ( !is_async() ) return;
+    {
+      std::lock_guard<std::mutex> lock( mutex_ );
+      done_ = true;
+    }
+    submitted_.notify_one();
+    thread_.join();
+    std::lock_guard<std::mutex> lock( mutex_ );
+    rethrow();
+  }
+
+private:
+
+  //! \brief Rethrow a failure of the output thread, with the lock held.
+  void rethrow()
+  {
+    if ( !error_ ) return;
+    auto error = error_;
+    error_ = nullptr;
+    std::rethrow_exception( error );
+  }
+
+  //! \brief The output thread, which writes the snapshots in order.
+  void run()
+  {
+    std::unique_lock<std::mutex> lock( mutex_ );
+    while ( true ) {
+      submitted_.wait( lock, [this](){ return !pending_.empty() || done_; } );
+      if ( pending_.empty() ) return;
+      auto i = pending_.front();
+      pending_.pop_front();
+      // the solver keeps running while this one is written
+      lock.unlock();
+      std::exception_ptr error;
+      try { writer_( snapshots_[i] ); }
+      catch (...) { error = std::current_exception(); }
+      lock.lock();
+      if ( error && !error_ ) error_ = error;
+      free_.push_back( i );
+      written_.notify_all();
+    }
+  }
+
+  //! the function that writes a snapshot
+  writer_t writer_;
+  //! the staging snapshots
+  std::vector<snapshot_t> snapshots_;
+  //! the snapshots free to fill, and the ones waiting to be written
+  std::deque<std::size_t> free_, pending_;
+  //! the snapshot being filled
+  std::size_t current_ = 0;
+  //! true once the thread should finish up
+  bool done_ = false;
+  //! the first failure of the output thread
+  std::exception_ptr error_;
+  //! protects everything the thread shares
+  std::mutex mutex_;
+  //! signal a snapshot was handed off, or written
+  std::condition_variable submitted_, written_;
+  //! the output thread
+  std::thread thread_;
+
+};
+
+} // namespace
+} // namespace
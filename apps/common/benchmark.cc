@@ -0,0 +1,136 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Throughput reporting for the benchmark mode of the drivers.
+////////////////////////////////////////////////////////////////////////////////
+
+// user includes
+#include "benchmark.h"
+#include "timers.h"
+
+#include <flecsale-config.h>
+
+// system includes
+#ifdef FLECSALE_USE_MPI
+#include <mpi.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+// Get the name of the benchmark report
+///////////////////////////////////////////////////////////////////////////////
+std::string benchmark_filename()
+{
+  auto name = std::getenv( "FLECSALE_BENCHMARK" );
+  return name ? name : "";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Report the throughput of the main loop
+///////////////////////////////////////////////////////////////////////////////
+void report_throughput(
+  std::ostream & os,
+  const std::string & filename,
+  double num_zones,
+  std::size_t num_steps,
+  double seconds
+) {
+
+  // this is collective, so do it first
+  int num_ranks;
+  auto summary = timer_registry_t::instance().summarize( num_ranks );
+
+  int rank = 0;
+#ifdef FLECSALE_USE_MPI
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+#endif
+  if ( rank != 0 ) return;
+
+  int num_threads = 1;
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#endif
+
+  auto zone_cycles = num_zones * num_steps;
+  auto rate = seconds > 0 ? zone_cycles / seconds : 0;
+  auto rate_per_rank = rate / num_ranks;
+  auto rate_per_thread = rate_per_rank / num_threads;
+
+  //---------------------------------------------------------------------------
+  // print a summary
+
+  auto flags = os.flags();
+  auto precision = os.precision();
+
+  os << std::scientific << std::setprecision(4);
+  os << "Throughput is " << rate << " zone-cycles/s, " 
+     << rate_per_rank << " per rank, "
+     << rate_per_thread << " per thread, over " 
+     << num_ranks << " ranks and " << num_threads << " threads."
+     << std::endl;
+
+  // the tasks are the regions nested directly under a step
+  const std::string prefix = "total/step/";
+  for ( const auto & r : summary ) {
+    if ( r.path.compare( 0, prefix.size(), prefix ) != 0 ) continue;
+    auto name = r.path.substr( prefix.size() );
+    if ( name.find('/') != std::string::npos ) continue;
+    auto task_rate = r.max > 0 ? num_zones * r.calls / r.max : 0;
+    os << "  " << std::left << std::setw(32) << name << std::right
+       << std::setw(14) << task_rate << " zone-cycles/s" << std::endl;
+  }
+
+  os.flags( flags );
+  os.precision( precision );
+
+  //---------------------------------------------------------------------------
+  // write the json report
+
+  if ( filename.empty() ) return;
+
+  std::ofstream file( filename );
+  file << std::setprecision(9);
+  file << "{" << std::endl;
+  file << "  \"zones\": " << num_zones << "," << std::endl;
+  file << "  \"ranks\": " << num_ranks << "," << std::endl;
+  file << "  \"threads\": " << num_threads << "," << std::endl;
+  file << "  \"steps\": " << num_steps << "," << std::endl;
+  file << "  \"seconds\": " << seconds << "," << std::endl;
+  file << "  \"zone_cycles_per_second\": " << rate << "," << std::endl;
+  file << "  \"zone_cycles_per_second_per_rank\": " << rate_per_rank << "," 
+       << std::endl;
+  file << "  \"zone_cycles_per_second_per_thread\": " << rate_per_thread << ","
+       << std::endl;
+  file << "  \"tasks\": {";
+  auto first = true;
+  for ( const auto & r : summary ) {
+    if ( r.path.compare( 0, prefix.size(), prefix ) != 0 ) continue;
+    auto name = r.path.substr( prefix.size() );
+    if ( name.find('/') != std::string::npos ) continue;
+    auto task_rate = r.max > 0 ? num_zones * r.calls / r.max : 0;
+    file << ( first ? "" : "," ) << std::endl
+         << "    \"" << name << "\": { \"calls\": " << r.calls
+         << ", \"seconds\": " << r.max
+         << ", \"zone_cycles_per_second\": " << task_rate << " }";
+    first = false;
+  }
+  file << std::endl << "  }" << std::endl;
+  file << "}" << std::endl;
+
+}
+
+} // namespace
+} // namespace
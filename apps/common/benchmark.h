@@ -0,0 +1,52 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Throughput reporting for the benchmark mode of the drivers.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <iostream>
+#include <string>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Get the name of the benchmark report.
+//!
+//! The benchmark mode is turned on by setting the FLECSALE_BENCHMARK 
+//! environment variable to the name of the json report to write.  Solution
+//! output is skipped in this mode so that it does not pollute the timings.
+//!
+//! \return the name of the report, empty if the benchmark mode is off
+///////////////////////////////////////////////////////////////////////////////
+std::string benchmark_filename();
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Report the throughput of the main loop, in zone-cycles per second.
+//!
+//! The overall rate is reported along with the rate per rank and per thread.
+//! A per-task rate is derived from the slowest rank of each region timed
+//! under "step".  This is collective, so every rank must call it, but only
+//! the first rank prints and writes the json report.
+//!
+//! \param [in] os  the stream to print the summary to
+//! \param [in] filename  the name of the json report, none if empty
+//! \param [in] num_zones  the global number of zones
+//! \param [in] num_steps  the number of steps taken
+//! \param [in] seconds  the wall time of the main loop
+///////////////////////////////////////////////////////////////////////////////
+void report_throughput(
+  std::ostream & os,
+  const std::string & filename,
+  double num_zones,
+  std::size_t num_steps,
+  double seconds
+);
+
+} // namespace
+} // namespace
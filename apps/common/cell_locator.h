@@ -0,0 +1,220 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief A uniform grid for finding the cells a point may be in.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A uniform grid of bins over the bounding boxes of the cells.
+//!
+//! Each bin lists the cells whose boxes overlap it, so the cells a point may
+//! be in are the ones listed in its bin.  The grid is sized to hold about
+//! one cell per bin.  When the cells move, only the cells that changed bins
+//! are moved between bins, which for a mesh that moves a little each step
+//! is a small fraction of them.
+//!
+//! Cells that move past the grid are clamped to its outer bins, and so are
+//! the points, so a lookup stays correct without rebuilding the grid.
+//!
+//! \tparam D  the number of dimensions
+///////////////////////////////////////////////////////////////////////////////
+template< std::size_t D >
+class cell_locator__ {
+
+public:
+
+  //! a point
+  using point_t = std::array<double, D>;
+
+  //! a bounding box
+  struct box_t {
+    point_t lo, hi;
+  };
+
+  //===========================================================================
+  //! \brief Build the grid.
+  //! \param [in] boxes  the bounding boxes of the cells
+  //===========================================================================
+  void build( const std::vector<box_t> & boxes )
+  {
+    auto num_cells = boxes.size();
+
+    // the extent of all the cells
+    lo_.fill( std::numeric_limits<double>::max() );
+    point_t hi;
+    hi.fill( std::numeric_limits<double>::lowest() );
+    for ( const auto & b : boxes )
+      for ( std::size_t d=0; d<D; ++d ) {
+        lo_[d] = std::min( lo_[d], b.lo[d] );
+        hi[d] = std::max( hi[d], b.hi[d] );
+      }
+
+    // pick the bin size for about one cell per bin
+    double volume = 1;
+    std::size_t num_flat = 0;
+    for ( std::size_t d=0; d<D; ++d ) {
+      auto width = num_cells ? hi[d] - lo_[d] : 0;
+      if ( width > 0 ) volume *= width;
+      else num_flat++;
+    }
+    auto size = num_cells && num_flat < D ?
+      std::pow( volume / num_cells, 1. / (D - num_flat) ) : 1;
+
+    std::size_t num_bins = 1;
+    for ( std::size_t d=0; d<D; ++d ) {
+      auto width = num_cells ? hi[d] - lo_[d] : 0;
+      dims_[d] = width > 0 ? 
+        std::max( 1, static_cast<int>( std::ceil( width / size ) ) ) : 1;
+      scale_[d] = width > 0 ? dims_[d] / width : 0;
+      num_bins *= dims_[d];
+    }
+
+    bins_.assign( num_bins, {} );
+    ranges_.resize( num_cells );
+    for ( std::size_t i=0; i<num_cells; ++i ) {
+      ranges_[i] = range( boxes[i] );
+      insert( i, ranges_[i] );
+    }
+  }
+
+  //===========================================================================
+  //! \brief Move the cells that changed bins.
+  //! \param [in] boxes  the new bounding boxes of the cells
+  //! \return the number of cells that were moved
+  //===========================================================================
+  std::size_t update( const std::vector<box_t> & boxes )
+  {
+    auto num_cells = boxes.size();
+    if ( num_cells != ranges_.size() ) {
+      build( boxes );
+      return num_cells;
+    }
+
+    // find the cells that changed bins
+    std::vector<char> moved( num_cells, false );
+    std::vector<range_t> ranges( num_cells );
+    #pragma omp parallel for
+    for ( std::size_t i=0; i<num_cells; ++i ) {
+      ranges[i] = range( boxes[i] );
+      moved[i] = ranges[i] != ranges_[i];
+    }
+
+    std::size_t num_moved = 0;
+    for ( std::size_t i=0; i<num_cells; ++i ) {
+      if ( !moved[i] ) continue;
+      remove( i, ranges_[i] );
+      ranges_[i] = ranges[i];
+      insert( i, ranges_[i] );
+      num_moved++;
+    }
+    return num_moved;
+  }
+
+  //===========================================================================
+  //! \brief Visit the cells a point may be in.
+  //! \param [in] x  the point
+  //! \param [in] f  called with each cell index, and returns true to stop
+  //! \return true if the visit was stopped
+  //===========================================================================
+  template< typename F >
+  bool find( const point_t & x, F && f ) const
+  {
+    if ( bins_.empty() ) return false;
+    std::size_t bin = 0;
+    for ( std::size_t d=D; d-- > 0; )
+      bin = bin * dims_[d] + index( x[d], d );
+    for ( auto i : bins_[bin] )
+      if ( f(i) ) return true;
+    return false;
+  }
+
+private:
+
+  //! the first and last bins of a box, in each dimension
+  using range_t = std::array< std::array<int, 2>, D >;
+
+  //! \brief The bin a coordinate falls in, clamped to the grid.
+  int index( double x, std::size_t d ) const
+  {
+    auto i = static_cast<int>( std::floor( (x - lo_[d]) * scale_[d] ) );
+    return std::min( std::max( i, 0 ), dims_[d] - 1 );
+  }
+
+  //! \brief The bins a box overlaps.
+  range_t range( const box_t & b ) const
+  {
+    range_t r;
+    for ( std::size_t d=0; d<D; ++d )
+      r[d] = { index( b.lo[d], d ), index( b.hi[d], d ) };
+    return r;
+  }
+
+  //! \brief Visit the bins of a range.
+  template< typename F >
+  void for_each_bin( const range_t & r, F && f ) const
+  {
+    std::array<int, D> i;
+    for ( std::size_t d=0; d<D; ++d ) i[d] = r[d][0];
+    while ( true ) {
+      std::size_t bin = 0;
+      for ( std::size_t d=D; d-- > 0; ) bin = bin * dims_[d] + i[d];
+      f( bin );
+      // advance like an odometer
+      std::size_t d = 0;
+      for ( ; d<D; ++d ) {
+        if ( ++i[d] <= r[d][1] ) break;
+        i[d] = r[d][0];
+      }
+      if ( d == D ) return;
+    }
+  }
+
+  //! \brief Add a cell to the bins of a range.
+  void insert( std::size_t cell, const range_t & r )
+  {
+    for_each_bin( r, [&]( auto bin ) { bins_[bin].emplace_back( cell ); } );
+  }
+
+  //! \brief Take a cell out of the bins of a range.
+  void remove( std::size_t cell, const range_t & r )
+  {
+    for_each_bin( r, [&]( auto bin ) {
+      auto & cells = bins_[bin];
+      auto it = std::find( cells.begin(), cells.end(), cell );
+      if ( it == cells.end() ) return;
+      *it = cells.back();
+      cells.pop_back();
+    } );
+  }
+
+  //! the lower corner of the grid
+  point_t lo_;
+  //! the number of bins per unit length, in each dimension
+  point_t scale_;
+  //! the number of bins in each dimension
+  std::array<int, D> dims_;
+  //! the cells overlapping each bin
+  std::vector< std::vector<std::uint32_t> > bins_;
+  //! the bins each cell overlaps
+  std::vector<range_t> ranges_;
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,359 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Binary checkpoint files for restarting the drivers.
+////////////////////////////////////////////////////////////////////////////////
+
+// user includes
+#include "checkpoint.h"
+#include "utils.h"
+
+#include <flecsale-config.h>
+#include <flecsale/utils/compression.h>
+#include <ristra/assertions/errors.h>
+
+// system includes
+#ifdef FLECSALE_USE_MPI
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace apps {
+namespace common {
+
+namespace {
+
+//! identifies a checkpoint file
+constexpr char magic[8] = { 'F', 'L', 'E', 'C', 'S', 'C', 'H', 'K' };
+
+//! the version of the file layout
+constexpr std::uint32_t version = 2;
+
+//! the longest section name, including the terminating null
+constexpr std::size_t name_length = 32;
+
+//! \brief The fixed size header at the start of a file.
+struct file_header_t {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t padding;
+  checkpoint_info_t info;
+  std::uint64_t num_sections;
+  std::uint64_t checksum;
+};
+
+//! \brief The header in front of each section.
+struct section_header_t {
+  char name[name_length];
+  std::uint64_t value_bytes;
+  std::uint64_t count;
+  //! the bytes in the file, which are compressed if fewer than the data
+  std::uint64_t stored_bytes;
+  std::uint64_t checksum;
+};
+
+//! \brief The checksum of a header, leaving out the checksum itself.
+template< typename T >
+std::uint64_t header_checksum( const T & header )
+{
+  return checksum( &header, offsetof(T, checksum) );
+}
+
+//! \brief Make a file header.
+file_header_t make_header( const checkpoint_info_t & info )
+{
+  file_header_t header{};
+  std::copy_n( magic, sizeof(magic), header.magic );
+  header.version = version;
+  header.info = info;
+  return header;
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// Compute a fletcher-64 checksum
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t checksum( const void * data, std::size_t bytes )
+{
+  constexpr std::uint64_t mod = 0xffffffff;
+  // the most words that can be summed before the second sum can overflow
+  constexpr std::size_t block = 92679;
+
+  auto p = static_cast<const unsigned char *>( data );
+  std::uint64_t a = 0, b = 0;
+
+  // the sums over 32 bit words, with the modulo deferred as long as possible
+  auto num_words = bytes / 4;
+  while ( num_words > 0 ) {
+    auto n = std::min( num_words, block );
+    num_words -= n;
+    for ( ; n > 0; --n, p += 4 ) {
+      std::uint32_t w;
+      std::memcpy( &w, p, 4 );
+      a += w;
+      b += a;
+    }
+    a %= mod;
+    b %= mod;
+  }
+
+  // the remaining bytes are zero padded
+  auto rest = bytes % 4;
+  if ( rest ) {
+    std::uint32_t w = 0;
+    std::memcpy( &w, p, rest );
+    a = (a + w) % mod;
+    b = (b + a) % mod;
+  }
+
+  return (b << 32) | a;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Open a checkpoint for writing
+///////////////////////////////////////////////////////////////////////////////
+checkpoint_writer_t::checkpoint_writer_t(
+  const std::string & filename, const checkpoint_info_t & info, bool compress
+) : filename_( filename ), tmp_filename_( filename + ".tmp" ),
+    file_( tmp_filename_, std::ios::binary | std::ios::trunc ), info_( info ),
+    compress_( compress )
+{
+  if ( !file_ )
+    throw_runtime_error( "Unable to open checkpoint \"" << tmp_filename_ << "\"" );
+
+  // the section count and the checksum are filled in on close
+  auto header = make_header( info_ );
+  file_.write( reinterpret_cast<const char *>( &header ), sizeof(header) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Discard an unfinished checkpoint
+///////////////////////////////////////////////////////////////////////////////
+checkpoint_writer_t::~checkpoint_writer_t()
+{
+  if ( file_.is_open() ) {
+    file_.close();
+    std::remove( tmp_filename_.c_str() );
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Write a section of raw bytes
+///////////////////////////////////////////////////////////////////////////////
+void checkpoint_writer_t::write_bytes(
+  const std::string & name,
+  std::size_t value_bytes,
+  std::size_t count,
+  const void * data
+) {
+  if ( name.size() >= name_length )
+    throw_runtime_error( "Checkpoint section name \"" << name << "\" is too long" );
+
+  auto bytes = value_bytes * count;
+
+  section_header_t header{};
+  std::copy( name.begin(), name.end(), header.name );
+  header.value_bytes = value_bytes;
+  header.count = count;
+  header.stored_bytes = bytes;
+  // the checksum is of the data itself, so it also checks the decompression
+  header.checksum = checksum( data, bytes );
+
+  // only keep the compressed data if it is smaller
+  auto stored = static_cast<const char *>( data );
+  if ( compress_ ) {
+    flecsale::utils::compress( data, bytes, value_bytes, buffer_ );
+    if ( buffer_.size() < bytes ) {
+      header.stored_bytes = buffer_.size();
+      stored = buffer_.data();
+    }
+  }
+
+  file_.write( reinterpret_cast<const char *>( &header ), sizeof(header) );
+  file_.write( stored, header.stored_bytes );
+  num_sections_++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Finish the file and move it into place
+///////////////////////////////////////////////////////////////////////////////
+void checkpoint_writer_t::close()
+{
+  if ( !file_.is_open() ) return;
+
+  // fill in the rest of the header
+  auto header = make_header( info_ );
+  header.num_sections = num_sections_;
+  header.checksum = header_checksum( header );
+  file_.seekp( 0 );
+  file_.write( reinterpret_cast<const char *>( &header ), sizeof(header) );
+  file_.close();
+
+  if ( !file_ )
+    throw_runtime_error( "Unable to write checkpoint \"" << tmp_filename_ << "\"" );
+
+  if ( std::rename( tmp_filename_.c_str(), filename_.c_str() ) )
+    throw_runtime_error( "Unable to move checkpoint to \"" << filename_ << "\"" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Open a checkpoint for reading
+///////////////////////////////////////////////////////////////////////////////
+checkpoint_reader_t::checkpoint_reader_t( const std::string & filename ) :
+  filename_( filename ), file_( filename, std::ios::binary )
+{
+  if ( !file_ )
+    throw_runtime_error( "Unable to open checkpoint \"" << filename << "\"" );
+
+  file_header_t header;
+  file_.read( reinterpret_cast<char *>( &header ), sizeof(header) );
+
+  if ( !file_ || !std::equal( magic, magic + sizeof(magic), header.magic ) )
+    throw_runtime_error( "\"" << filename << "\" is not a checkpoint" );
+
+  if ( header.version != version )
+    throw_runtime_error(
+      "Checkpoint \"" << filename << "\" has version " << header.version <<
+      ", expected " << version
+    );
+
+  if ( header.checksum != header_checksum( header ) )
+    throw_runtime_error( "Checkpoint \"" << filename << "\" has a bad header" );
+
+  info_ = header.info;
+  num_sections_ = header.num_sections;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Read a section of raw bytes
+///////////////////////////////////////////////////////////////////////////////
+void checkpoint_reader_t::read_bytes(
+  const std::string & name,
+  std::size_t value_bytes,
+  std::size_t count,
+  void * data
+) {
+  if ( num_sections_ == 0 )
+    throw_runtime_error(
+      "Checkpoint \"" << filename_ << "\" has no section \"" << name << "\""
+    );
+
+  section_header_t header;
+  file_.read( reinterpret_cast<char *>( &header ), sizeof(header) );
+  header.name[name_length-1] = '\0';
+  num_sections_--;
+
+  if ( !file_ || name != header.name )
+    throw_runtime_error(
+      "Checkpoint \"" << filename_ << "\" has section \"" << header.name <<
+      "\" where \"" << name << "\" was expected"
+    );
+
+  if ( header.value_bytes != value_bytes || header.count != count )
+    throw_runtime_error(
+      "Checkpoint \"" << filename_ << "\" section \"" << name << "\" has " <<
+      header.count << " values of " << header.value_bytes << " bytes, " <<
+      "expected " << count << " values of " << value_bytes << " bytes"
+    );
+
+  auto bytes = value_bytes * count;
+  if ( header.stored_bytes == bytes ) {
+    file_.read( static_cast<char *>( data ), bytes );
+  }
+  else if ( header.stored_bytes < bytes ) {
+    buffer_.resize( header.stored_bytes );
+    file_.read( buffer_.data(), buffer_.size() );
+    if ( file_ )
+      flecsale::utils::decompress( 
+        buffer_.data(), buffer_.size(), value_bytes, data, bytes 
+      );
+  }
+  else {
+    throw_runtime_error(
+      "Checkpoint \"" << filename_ << "\" section \"" << name <<
+      "\" is corrupt"
+    );
+  }
+
+  if ( !file_ || header.checksum != checksum( data, bytes ) )
+    throw_runtime_error(
+      "Checkpoint \"" << filename_ << "\" section \"" << name <<
+      "\" is corrupt"
+    );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The name of the checkpoint file of a rank
+///////////////////////////////////////////////////////////////////////////////
+std::string checkpoint_filename(
+  const std::string & prefix, std::size_t rank, std::size_t step
+) {
+  return prefix + "_rank" + zero_padded(rank) + "." + zero_padded(step) +
+    ".chk";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Record that every rank finished writing a checkpoint
+///////////////////////////////////////////////////////////////////////////////
+void commit_checkpoint( const std::string & prefix, std::size_t step )
+{
+  int rank = 0;
+#ifdef FLECSALE_USE_MPI
+  MPI_Barrier( MPI_COMM_WORLD );
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+#endif
+  if ( rank != 0 ) return;
+
+  // move the record into place so it is never seen half written
+  auto filename = prefix + ".chk";
+  {
+    std::ofstream file( filename + ".tmp" );
+    file << step << std::endl;
+  }
+  if ( std::rename( (filename + ".tmp").c_str(), filename.c_str() ) )
+    throw_runtime_error( "Unable to write \"" << filename << "\"" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Find the step to restart from
+///////////////////////////////////////////////////////////////////////////////
+bool restart_step(
+  int argc, char ** argv, const std::string & prefix, std::size_t & step
+) {
+  for ( int i=1; i<argc; ++i ) {
+
+    if ( std::string( argv[i] ) != "--restart" ) continue;
+
+    // an explicit step
+    if ( i+1 < argc && argv[i+1][0] != '-' ) {
+      char * end;
+      step = std::strtoull( argv[i+1], &end, 10 );
+      if ( *end != '\0' )
+        throw_runtime_error( "Bad restart step \"" << argv[i+1] << "\"" );
+      return true;
+    }
+
+    // otherwise the last committed checkpoint
+    auto filename = prefix + ".chk";
+    std::ifstream file( filename );
+    if ( !(file >> step) )
+      throw_runtime_error(
+        "No checkpoint to restart from, \"" << filename << "\" is missing"
+      );
+    return true;
+
+  }
+
+  return false;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,315 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Binary checkpoint files for restarting the drivers.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include "reductions.h"
+
+// system includes
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The solution state that is not stored in fields.
+//!
+//! This is trivially copyable, so it can be returned from a task.
+///////////////////////////////////////////////////////////////////////////////
+struct checkpoint_info_t {
+  //! the number of steps taken
+  std::uint64_t step = 0;
+  //! the solution time
+  double time = 0;
+  //! the size of the last step
+  double time_step = 0;
+  //! a time step limit of this rank that carries over to the next step
+  double local_time_step = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Compute a fletcher-64 checksum.
+//! \param [in] data  the data to check
+//! \param [in] bytes  the number of bytes
+//! \return the checksum
+///////////////////////////////////////////////////////////////////////////////
+std::uint64_t checksum( const void * data, std::size_t bytes );
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Write the checkpoint file of a rank.
+//!
+//! A file holds a header followed by named sections of raw data, and each
+//! section has its own checksum.  The file is written under a temporary
+//! name and only moved into place once it is complete, so an interrupted
+//! write never leaves a truncated checkpoint behind.
+//!
+//! The sections may be compressed without loss, which the reader detects
+//! on its own.
+///////////////////////////////////////////////////////////////////////////////
+class checkpoint_writer_t {
+
+public:
+
+  //! \brief Constructor.
+  //! \param [in] filename  the name of the file
+  //! \param [in] info  the solution state to store in the header
+  //! \param [in] compress  if true, the sections are compressed
+  checkpoint_writer_t(
+    const std::string & filename, 
+    const checkpoint_info_t & info,
+    bool compress = false
+  );
+
+  //! \brief Destructor, a file that was never closed is discarded.
+  ~checkpoint_writer_t();
+
+  //! writers own a file, so they are not copyable
+  checkpoint_writer_t( const checkpoint_writer_t & ) = delete;
+  checkpoint_writer_t & operator=( const checkpoint_writer_t & ) = delete;
+
+  //===========================================================================
+  //! \brief Write a section.
+  //! \param [in] name  the section name
+  //! \param [in] data  the trivially copyable values to write
+  //! \param [in] count  the number of values
+  //===========================================================================
+  template< typename T >
+  void write( const std::string & name, const T * data, std::size_t count )
+  { write_bytes( name, sizeof(T), count, data ); }
+
+  //===========================================================================
+  //! \brief Write a section with the values of a field.
+  //! \param [in] name  the section name
+  //! \param [in] entities  the entities to write the values of
+  //! \param [in] field  the field accessor
+  //===========================================================================
+  template< typename E, typename F >
+  void write_field( const std::string & name, E && entities, F && field )
+  {
+    using value_t = 
+      std::decay_t< decltype( field( *std::begin(entities) ) ) >;
+    std::vector<value_t> values;
+    values.reserve( entities.size() );
+    for ( auto e : entities ) values.emplace_back( field(e) );
+    write( name, values.data(), values.size() );
+  }
+
+  //===========================================================================
+  //! \brief Finish the file and move it into place.
+  //===========================================================================
+  void close();
+
+private:
+
+  //! \brief Write a section of raw bytes.
+  void write_bytes(
+    const std::string & name,
+    std::size_t value_bytes,
+    std::size_t count,
+    const void * data
+  );
+
+  //! the final and the temporary file names
+  std::string filename_, tmp_filename_;
+  //! the open file
+  std::ofstream file_;
+  //! the solution state
+  checkpoint_info_t info_;
+  //! the number of sections written
+  std::uint64_t num_sections_ = 0;
+  //! true if the sections are compressed
+  bool compress_;
+  //! the compressed section
+  std::vector<char> buffer_;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Read the checkpoint file of a rank.
+//!
+//! The sections must be read in the order they were written.  Any mismatch
+//! in the layout or the checksums is an error.
+///////////////////////////////////////////////////////////////////////////////
+class checkpoint_reader_t {
+
+public:
+
+  //! \brief Constructor, reads and checks the header.
+  //! \param [in] filename  the name of the file
+  explicit checkpoint_reader_t( const std::string & filename );
+
+  //! readers own a file, so they are not copyable
+  checkpoint_reader_t( const checkpoint_reader_t & ) = delete;
+  checkpoint_reader_t & operator=( const checkpoint_reader_t & ) = delete;
+
+  //! \brief Access the solution state stored in the header.
+  const checkpoint_info_t & info() const { return info_; }
+
+  //===========================================================================
+  //! \brief Read the next section.
+  //! \param [in] name  the expected section name
+  //! \param [out] data  the values to read into
+  //! \param [in] count  the expected number of values
+  //===========================================================================
+  template< typename T >
+  void read( const std::string & name, T * data, std::size_t count )
+  { read_bytes( name, sizeof(T), count, data ); }
+
+  //===========================================================================
+  //! \brief Read a section into the values of a field.
+  //! \param [in] name  the expected section name
+  //! \param [in] entities  the entities to read the values of
+  //! \param [in,out] field  the field accessor
+  //===========================================================================
+  template< typename E, typename F >
+  void read_field( const std::string & name, E && entities, F && field )
+  {
+    using value_t = 
+      std::decay_t< decltype( field( *std::begin(entities) ) ) >;
+    std::vector<value_t> values( entities.size() );
+    read( name, values.data(), values.size() );
+    auto it = values.begin();
+    for ( auto e : entities ) field(e) = *it++;
+  }
+
+private:
+
+  //! \brief Read a section of raw bytes.
+  void read_bytes(
+    const std::string & name,
+    std::size_t value_bytes,
+    std::size_t count,
+    void * data
+  );
+
+  //! the file name
+  std::string filename_;
+  //! the open file
+  std::ifstream file_;
+  //! the solution state
+  checkpoint_info_t info_;
+  //! the number of sections left to read
+  std::uint64_t num_sections_ = 0;
+  //! the compressed section
+  std::vector<char> buffer_;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The name of the checkpoint file of a rank.
+//! \param [in] prefix  the case prefix
+//! \param [in] rank  the rank
+//! \param [in] step  the step the checkpoint was taken at
+///////////////////////////////////////////////////////////////////////////////
+std::string checkpoint_filename(
+  const std::string & prefix, std::size_t rank, std::size_t step
+);
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Record that every rank finished writing a checkpoint.
+//!
+//! This is collective, so every rank must call it.  The first rank writes
+//! the step to "<prefix>.chk", which is what a restart reads by default.
+//!
+//! \param [in] prefix  the case prefix
+//! \param [in] step  the step the checkpoint was taken at
+///////////////////////////////////////////////////////////////////////////////
+void commit_checkpoint( const std::string & prefix, std::size_t step );
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Find the step to restart from.
+//!
+//! A restart is requested with "--restart [<step>]" on the command line.
+//! Without a step, the last committed checkpoint is used.
+//!
+//! \param [in] argc,argv  the command line arguments
+//! \param [in] prefix  the case prefix
+//! \param [out] step  the step to restart from
+//! \return true if a restart was requested
+///////////////////////////////////////////////////////////////////////////////
+bool restart_step(
+  int argc, char ** argv, const std::string & prefix, std::size_t & step
+);
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Decide when to write checkpoints.
+//!
+//! A checkpoint is due every so many steps, or once enough wall clock time
+//! has passed since the last one.  The clocks of the ranks drift apart, so
+//! the slowest one decides, and the decision is reduced without blocking so
+//! it can overlap with other work.
+///////////////////////////////////////////////////////////////////////////////
+class checkpoint_schedule_t {
+
+public:
+
+  //! the clock used for the wall clock interval
+  using clock_t = std::chrono::steady_clock;
+
+  //! \brief Constructor.
+  //! \param [in] step_interval  the steps between checkpoints, none if zero
+  //! \param [in] wall_interval  the seconds between checkpoints, none if 
+  //!                            zero
+  checkpoint_schedule_t( std::size_t step_interval, double wall_interval ) :
+    step_interval_( step_interval ), wall_interval_( wall_interval ),
+    last_( clock_t::now() )
+  {}
+
+  //===========================================================================
+  //! \brief Start deciding whether a checkpoint is due after a step.
+  //!
+  //! This is collective when there is a wall clock interval.
+  //! \param [in] step  the number of steps taken
+  //===========================================================================
+  void start( std::size_t step )
+  {
+    step_ = step;
+    if ( wall_interval_ <= 0 ) return;
+    auto elapsed = std::chrono::duration<double>( clock_t::now() - last_ );
+    elapsed_.reduce_max( 0, elapsed.count() );
+    elapsed_.start();
+  }
+
+  //===========================================================================
+  //! \brief Finish deciding whether a checkpoint is due.
+  //===========================================================================
+  bool due()
+  {
+    if ( step_interval_ > 0 && step_ % step_interval_ == 0 ) return true;
+    return wall_interval_ > 0 && elapsed_.max(0) >= wall_interval_;
+  }
+
+  //===========================================================================
+  //! \brief Restart the wall clock once a checkpoint is written.
+  //===========================================================================
+  void written() { last_ = clock_t::now(); }
+
+private:
+
+  //! the steps between checkpoints
+  std::size_t step_interval_;
+  //! the seconds between checkpoints
+  double wall_interval_;
+  //! the number of steps taken
+  std::size_t step_ = 0;
+  //! when the last checkpoint was written
+  clock_t::time_point last_;
+  //! the wall time since the last checkpoint, over all ranks
+  reduction_bundle__<double, 0, 0, 1> elapsed_;
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,202 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Evaluate the equation of state for blocks of cells.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+//! \brief The hint of an equation of state that takes no lookup hints.
+struct no_hint_t {};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The states of a block of cells, gathered into contiguous arrays so
+//!        the equation of state can evaluate them in one batch.
+//!
+//! The arrays are small enough to stay in cache between gathering the
+//! states and scattering the results.  When the cells are made of different
+//! materials, the states are grouped by material so each material is still
+//! evaluated in one batch.
+//!
+//! When the states are pushed with lookup hints, the hints are gathered with
+//! them and passed to the equation of state, which updates them in place.
+//!
+//! \tparam T  the real type
+//! \tparam H  the lookup hint of the equation of state
+//! \tparam N  the most states in a block
+///////////////////////////////////////////////////////////////////////////////
+template< typename T, typename H = no_hint_t, std::size_t N = 256 >
+struct eos_block__ {
+
+  //! the most states in a block
+  static constexpr std::size_t capacity = N;
+
+  //! the most materials, which are stored as a byte per state
+  static constexpr std::size_t max_materials =
+    std::numeric_limits<std::uint8_t>::max() + 1;
+
+  //! the number of states in the block
+  std::size_t size = 0;
+
+  //! true if the states are of more than one material
+  bool is_mixed = false;
+
+  //! true if the states were pushed with their hints
+  bool has_hints = false;
+
+  //! the material of each state
+  std::uint8_t material[N];
+
+  //! the lookup hint of each state
+  H hint[N];
+
+  //! the inputs
+  T density[N];
+  T internal_energy[N];
+
+  //! the outputs
+  T pressure[N];
+  T temperature[N];
+  T sound_speed[N];
+
+  //===========================================================================
+  //! \brief Add a state.
+  //! \param [in] d  the density
+  //! \param [in] e  the internal energy
+  //! \param [in] m  the material
+  //===========================================================================
+  void push_back( T d, T e, std::uint8_t m = 0 )
+  {
+    is_mixed = is_mixed || ( size > 0 && m != material[0] );
+    material[size] = m;
+    density[size] = d;
+    internal_energy[size] = e;
+    ++size;
+  }
+
+  //===========================================================================
+  //! \brief Add a state with its lookup hint.
+  //! \param [in] d  the density
+  //! \param [in] e  the internal energy
+  //! \param [in] m  the material
+  //! \param [in] h  the lookup hint
+  //===========================================================================
+  void push_back( T d, T e, std::uint8_t m, const H & h )
+  {
+    hint[size] = h;
+    has_hints = true;
+    push_back( d, e, m );
+  }
+
+  //===========================================================================
+  //! \brief Compute the pressure, temperature and sound speed of the states.
+  //! \param [in] eos  the equation of state
+  //! \param [in] min_sound_speed  the sound speeds are kept above this
+  //===========================================================================
+  template< typename EOS >
+  void compute_state_de( const EOS & eos, T min_sound_speed = 0 )
+  {
+    compute_state_de( eos, size, density, internal_energy, pressure,
+      temperature, sound_speed, hint );
+    clamp_sound_speed( min_sound_speed );
+  }
+
+  //===========================================================================
+  //! \brief Compute the pressure, temperature and sound speed of the states,
+  //!        with the equation of state of their materials.
+  //! \param [in] eos  the equations of state, by material
+  //! \param [in] min_sound_speed  the sound speeds are kept above this
+  //===========================================================================
+  template< typename EOS >
+  void compute_state_de(
+    const std::vector<EOS> & eos, T min_sound_speed = 0
+  ) {
+    if ( size == 0 ) return;
+
+    // the usual case of one material needs no grouping
+    if ( !is_mixed ) {
+      compute_state_de( eos[ material[0] ], min_sound_speed );
+      return;
+    }
+
+    // sort the states by material
+    auto num_materials = eos.size();
+    std::size_t offsets[max_materials+1] = {}, next[max_materials];
+    for ( std::size_t i=0; i<size; ++i ) offsets[ material[i] + 1 ]++;
+    for ( std::size_t m=0; m<num_materials; ++m ) {
+      offsets[m+1] += offsets[m];
+      next[m] = offsets[m];
+    }
+
+    std::size_t order[N];
+    T d[N], e[N], p[N], t[N], a[N];
+    H h[N];
+    for ( std::size_t i=0; i<size; ++i ) {
+      auto j = next[ material[i] ]++;
+      order[j] = i;
+      d[j] = density[i];
+      e[j] = internal_energy[i];
+      if ( has_hints ) h[j] = hint[i];
+    }
+
+    // evaluate each material in one batch
+    for ( std::size_t m=0; m<num_materials; ++m ) {
+      auto begin = offsets[m];
+      auto n = offsets[m+1] - begin;
+      if ( n == 0 ) continue;
+      compute_state_de( eos[m], n, d + begin, e + begin, p + begin, 
+        t + begin, a + begin, h + begin );
+    }
+
+    for ( std::size_t j=0; j<size; ++j ) {
+      auto i = order[j];
+      pressure[i] = p[j];
+      temperature[i] = t[j];
+      sound_speed[i] = a[j];
+      if ( has_hints ) hint[i] = h[j];
+    }
+    clamp_sound_speed( min_sound_speed );
+  }
+
+  //===========================================================================
+  //! \brief Evaluate a batch of states, with their hints if there are any.
+  //===========================================================================
+  template< typename EOS >
+  void compute_state_de(
+    const EOS & eos, std::size_t n, const T * d, const T * e,
+    T * p, T * t, T * a, H * h
+  ) const {
+    if constexpr ( std::is_same_v<H, no_hint_t> )
+      eos.compute_state_de( n, d, e, p, t, a );
+    else
+      eos.compute_state_de( n, d, e, p, t, a, has_hints ? h : nullptr );
+  }
+
+  //===========================================================================
+  //! \brief Keep the sound speeds above a minimum.
+  //! \param [in] min_sound_speed  the minimum, or zero for none
+  //===========================================================================
+  void clamp_sound_speed( T min_sound_speed )
+  {
+    if ( min_sound_speed > 0 )
+      for ( std::size_t i=0; i<size; ++i )
+        sound_speed[i] = std::max( sound_speed[i], min_sound_speed );
+  }
+
+};
+
+} // namespace
+} // namespace
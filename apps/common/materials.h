@@ -0,0 +1,118 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief The materials of the cells, and their equations of state.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <ristra/assertions/errors.h>
+
+// system includes
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The materials of the cells, and their equations of state.
+//!
+//! Material zero uses the default equation of state, and each region that
+//! is given its own equation of state becomes a material of its own.
+//!
+//! When any material takes lookup hints, like a tabular one, a hint is kept
+//! per cell.  The states of a cell change little each step, so the last
+//! lookup of a cell is a good guess for the next one.
+//!
+//! \tparam EOS  the equation of state type
+///////////////////////////////////////////////////////////////////////////////
+template< typename EOS >
+class materials__ {
+
+public:
+
+  //! the lookup hint of a cell
+  using hint_t = typename EOS::hint_t;
+
+  //! the most materials, which are stored as a byte per cell
+  static constexpr std::size_t max_materials =
+    std::numeric_limits<std::uint8_t>::max() + 1;
+
+  //===========================================================================
+  //! \brief Assign the materials to the cells.
+  //! \param [in] m  the mesh
+  //! \param [in] eos  the default equation of state
+  //! \param [in] region_eos  the equations of state of some regions, by
+  //!                         region number
+  //===========================================================================
+  template< typename MESH >
+  void setup(
+    MESH & m, const EOS & eos, const std::map<std::size_t, EOS> & region_eos
+  ) {
+    if ( region_eos.size() + 1 > max_materials )
+      throw_runtime_error( "There are more than " << max_materials <<
+        " materials" );
+
+    eos_.assign( 1, eos );
+    cell_material_.assign( m.num_cells(), 0 );
+
+    auto regions = m.regions();
+    for ( const auto & entry : region_eos ) {
+      if ( entry.first >= regions.size() )
+        throw_runtime_error( "There is no region " << entry.first <<
+          " to give an equation of state" );
+      std::uint8_t material = eos_.size();
+      eos_.emplace_back( entry.second );
+      for ( auto c : regions[ entry.first ] )
+        cell_material_[ c.id() ] = material;
+    }
+
+    auto takes_hints = [](const auto & e) { return e.takes_hints(); };
+    if ( std::any_of( eos_.begin(), eos_.end(), takes_hints ) )
+      cell_hint_.assign( m.num_cells(), hint_t() );
+    else
+      cell_hint_.clear();
+  }
+
+  //! \brief The material of a cell.
+  std::uint8_t material( std::size_t cell ) const
+  { return cell_material_[cell]; }
+
+  //! \brief The equation of state of a cell.
+  const EOS & eos_of( std::size_t cell ) const
+  { return eos_[ cell_material_[cell] ]; }
+
+  //! \brief The equations of state, by material.
+  const std::vector<EOS> & eos() const
+  { return eos_; }
+
+  //! \brief True if the cells keep lookup hints.
+  bool has_hints() const
+  { return !cell_hint_.empty(); }
+
+  //! \brief The lookup hint of a cell, which only speeds up the lookups so
+  //!        it can be updated through a const reference.
+  hint_t & hint( std::size_t cell ) const
+  { return cell_hint_[cell]; }
+
+private:
+
+  //! the equations of state, by material
+  std::vector<EOS> eos_;
+  //! the material of each cell
+  std::vector<std::uint8_t> cell_material_;
+  //! the lookup hint of each cell, if any material takes them
+  mutable std::vector<hint_t> cell_hint_;
+
+};
+
+} // namespace
+} // namespace
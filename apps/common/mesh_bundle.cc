@@ -0,0 +1,374 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Binary bundles of the partitioned mesh that can be mapped into
+///        memory.
+////////////////////////////////////////////////////////////////////////////////
+
+// user includes
+#include "checkpoint.h"
+#include "mesh_bundle.h"
+#include "utils.h"
+
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+
+// system includes
+#ifdef FLECSALE_USE_MPI
+#include <mpi.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace apps {
+namespace common {
+
+namespace {
+
+//! identifies a mesh bundle
+constexpr char magic[8] = { 'F', 'L', 'E', 'C', 'S', 'M', 'S', 'H' };
+
+//! the version of the file layout
+constexpr std::uint32_t version = 1;
+
+//! a value whose bytes tell the byte order of the writer
+constexpr std::uint32_t byte_order = 0x01020304;
+
+//! the alignment of the sections
+constexpr std::size_t alignment = 64;
+
+//! the longest section name, including the terminating null
+constexpr std::size_t name_length = 32;
+
+//! \brief The fixed size header at the start of a file.
+struct file_header_t {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint64_t num_dims;
+  std::uint64_t rank;
+  std::uint64_t num_ranks;
+  std::uint64_t num_sections;
+  std::uint64_t checksum;
+};
+
+//! \brief An entry in the table of sections that follows the header.
+struct section_entry_t {
+  char name[name_length];
+  std::uint64_t value_bytes;
+  std::uint64_t count;
+  //! where the data starts, from the start of the file
+  std::uint64_t offset;
+  std::uint64_t checksum;
+};
+
+//! \brief The checksum of the header and the table, leaving out the header
+//!        checksum itself.
+std::uint64_t header_checksum(
+  const file_header_t & header, const section_entry_t * table
+) {
+  auto sum = checksum( &header, offsetof(file_header_t, checksum) );
+  return sum ^ checksum( table, header.num_sections * sizeof(section_entry_t) );
+}
+
+//! \brief Round up to the alignment.
+std::size_t aligned( std::size_t offset )
+{
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+//! \brief The size and modification time of a file, or zeros if there is
+//!        no such file.
+std::pair<std::uint64_t, std::int64_t> file_stamp( const std::string & filename )
+{
+  struct stat info;
+  if ( stat( filename.c_str(), &info ) ) return { 0, 0 };
+  return { info.st_size, info.st_mtime };
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// Add a section of raw bytes
+///////////////////////////////////////////////////////////////////////////////
+void mesh_bundle_writer_t::add_bytes(
+  const std::string & name,
+  std::size_t value_bytes,
+  std::size_t count,
+  const void * data
+) {
+  if ( name.size() >= name_length )
+    throw_runtime_error( "Mesh bundle section name \"" << name <<
+      "\" is too long" );
+  for ( const auto & section : sections_ )
+    if ( section.name == name )
+      throw_runtime_error( "Mesh bundle section \"" << name <<
+        "\" was already added" );
+
+  auto bytes = value_bytes * count;
+  auto p = static_cast<const char *>( data );
+  sections_.push_back( { name, value_bytes, count, {p, p + bytes} } );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Write the bundle
+///////////////////////////////////////////////////////////////////////////////
+void mesh_bundle_writer_t::write( const std::string & filename ) const
+{
+  auto num_sections = sections_.size();
+
+  // lay out the sections after the header and the table
+  std::vector<section_entry_t> table( num_sections );
+  auto offset = aligned(
+    sizeof(file_header_t) + num_sections * sizeof(section_entry_t)
+  );
+  for ( std::size_t i=0; i<num_sections; ++i ) {
+    const auto & section = sections_[i];
+    auto & entry = table[i];
+    std::strncpy( entry.name, section.name.c_str(), name_length-1 );
+    entry.value_bytes = section.value_bytes;
+    entry.count = section.count;
+    entry.offset = offset;
+    entry.checksum = checksum( section.data.data(), section.data.size() );
+    offset = aligned( offset + section.data.size() );
+  }
+
+  file_header_t header{};
+  std::copy_n( magic, sizeof(magic), header.magic );
+  header.version = version;
+  header.byte_order = byte_order;
+  header.num_dims = num_dims_;
+  header.rank = rank_;
+  header.num_ranks = num_ranks_;
+  header.num_sections = num_sections;
+  header.checksum = header_checksum( header, table.data() );
+
+  // write under a temporary name, and move it into place once complete
+  auto tmp_filename = filename + ".tmp";
+  {
+    std::ofstream file( tmp_filename, std::ios::binary | std::ios::trunc );
+    if ( !file )
+      throw_runtime_error( "Unable to open mesh bundle \"" << tmp_filename <<
+        "\"" );
+
+    const char zeros[alignment] = {};
+    auto pad = [&]( std::size_t written ) {
+      file.write( zeros, aligned(written) - written );
+    };
+
+    file.write( reinterpret_cast<const char *>(&header), sizeof(header) );
+    file.write( reinterpret_cast<const char *>(table.data()),
+      num_sections * sizeof(section_entry_t) );
+    pad( sizeof(file_header_t) + num_sections * sizeof(section_entry_t) );
+    for ( const auto & section : sections_ ) {
+      file.write( section.data.data(), section.data.size() );
+      pad( section.data.size() );
+    }
+
+    if ( !file )
+      throw_runtime_error( "Unable to write mesh bundle \"" << tmp_filename <<
+        "\"" );
+  }
+
+  if ( std::rename( tmp_filename.c_str(), filename.c_str() ) )
+    throw_runtime_error( "Unable to write mesh bundle \"" << filename << "\"" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Map a bundle
+///////////////////////////////////////////////////////////////////////////////
+mesh_bundle_t::mesh_bundle_t( const std::string & filename, bool verify ) :
+  filename_( filename )
+{
+  auto fd = open( filename.c_str(), O_RDONLY );
+  if ( fd < 0 )
+    throw_runtime_error( "Unable to open mesh bundle \"" << filename << "\"" );
+
+  struct stat info;
+  if ( fstat( fd, &info ) ||
+       static_cast<std::size_t>(info.st_size) < sizeof(file_header_t) )
+  {
+    close( fd );
+    throw_runtime_error( "Mesh bundle \"" << filename << "\" is truncated" );
+  }
+
+  bytes_ = info.st_size;
+  map_ = mmap( nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if ( map_ == MAP_FAILED ) {
+    map_ = nullptr;
+    throw_runtime_error( "Unable to map mesh bundle \"" << filename << "\"" );
+  }
+
+  // unmap if anything below is wrong, since the destructor will not run
+  auto fail = [&]( const std::string & what ) {
+    munmap( map_, bytes_ );
+    map_ = nullptr;
+    throw_runtime_error( "Mesh bundle \"" << filename << "\" " << what );
+  };
+
+  auto begin = static_cast<const char *>( map_ );
+  const auto & header = *reinterpret_cast<const file_header_t *>( begin );
+
+  if ( !std::equal( magic, magic + sizeof(magic), header.magic ) )
+    fail( "is not a mesh bundle" );
+  if ( header.byte_order != byte_order )
+    fail( "was written with a different byte order" );
+  if ( header.version != version )
+    fail( "has version " + std::to_string(header.version) +
+      ", expected " + std::to_string(version) );
+
+  auto table_bytes = header.num_sections * sizeof(section_entry_t);
+  if ( header.num_sections > bytes_ / sizeof(section_entry_t) ||
+       sizeof(file_header_t) + table_bytes > bytes_ )
+    fail( "is truncated" );
+  auto table = reinterpret_cast<const section_entry_t *>(
+    begin + sizeof(file_header_t)
+  );
+  if ( header.checksum != header_checksum( header, table ) )
+    fail( "has a corrupt header" );
+
+  for ( std::size_t i=0; i<header.num_sections; ++i ) {
+    const auto & entry = table[i];
+    if ( entry.offset % alignment || entry.offset > bytes_ ||
+         entry.count * entry.value_bytes > bytes_ - entry.offset )
+      fail( "is truncated" );
+    if ( verify &&
+         entry.checksum != checksum( begin + entry.offset,
+           entry.count * entry.value_bytes ) )
+      fail( std::string("has a corrupt section \"") + entry.name + "\"" );
+  }
+
+  table_ = table;
+  num_sections_ = header.num_sections;
+  num_dims_ = header.num_dims;
+  rank_ = header.rank;
+  num_ranks_ = header.num_ranks;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Unmap a bundle
+///////////////////////////////////////////////////////////////////////////////
+mesh_bundle_t::~mesh_bundle_t()
+{
+  if ( map_ ) munmap( map_, bytes_ );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Find a section in the table
+///////////////////////////////////////////////////////////////////////////////
+const void * mesh_bundle_t::find( const std::string & name ) const
+{
+  auto table = static_cast<const section_entry_t *>( table_ );
+  for ( std::size_t i=0; i<num_sections_; ++i )
+    if ( name == table[i].name ) return &table[i];
+  return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Access the raw bytes of a section
+///////////////////////////////////////////////////////////////////////////////
+const void * mesh_bundle_t::get_bytes(
+  const std::string & name, std::size_t value_bytes, std::size_t & count
+) const {
+  auto entry = static_cast<const section_entry_t *>( find( name ) );
+  if ( !entry )
+    throw_runtime_error( "Mesh bundle \"" << filename_ <<
+      "\" has no section \"" << name << "\"" );
+  if ( entry->value_bytes != value_bytes )
+    throw_runtime_error( "Mesh bundle section \"" << name << "\" has " <<
+      entry->value_bytes << " byte values, expected " << value_bytes );
+  count = entry->count;
+  return static_cast<const char *>( map_ ) + entry->offset;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The name of the mesh bundle of a rank
+///////////////////////////////////////////////////////////////////////////////
+std::string mesh_bundle_filename( const std::string & prefix, std::size_t rank )
+{
+  return prefix + "_rank" + zero_padded(rank) + ".bundle";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Record that every rank finished writing its bundle
+///////////////////////////////////////////////////////////////////////////////
+void commit_mesh_bundle(
+  const std::string & prefix,
+  const std::string & mesh_filename,
+  std::size_t num_ranks
+) {
+  int rank = 0;
+#ifdef FLECSALE_USE_MPI
+  MPI_Barrier( MPI_COMM_WORLD );
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+#endif
+  if ( rank != 0 ) return;
+
+  // move the record into place so it is never seen half written
+  auto stamp = file_stamp( mesh_filename );
+  auto filename = prefix + ".bundle";
+  {
+    std::ofstream file( filename + ".tmp" );
+    file << version << " " << num_ranks << " " << stamp.first << " "
+      << stamp.second << std::endl << mesh_filename << std::endl;
+  }
+  if ( std::rename( (filename + ".tmp").c_str(), filename.c_str() ) )
+    throw_runtime_error( "Unable to write \"" << filename << "\"" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Check if the bundles can stand in for a mesh file
+///////////////////////////////////////////////////////////////////////////////
+bool is_mesh_bundle_current(
+  const std::string & prefix,
+  const std::string & mesh_filename,
+  std::size_t num_ranks
+) {
+  std::ifstream file( prefix + ".bundle" );
+  std::uint32_t bundle_version;
+  std::size_t bundle_ranks;
+  std::uint64_t size;
+  std::int64_t mtime;
+  std::string source;
+  file >> bundle_version >> bundle_ranks >> size >> mtime;
+  file.ignore();
+  std::getline( file, source );
+  if ( !file ) return false;
+
+  auto stamp = file_stamp( mesh_filename );
+  return bundle_version == version && bundle_ranks == num_ranks &&
+    source == mesh_filename && stamp.first == size && stamp.second == mtime;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Find out if mesh bundles were requested
+///////////////////////////////////////////////////////////////////////////////
+bool mesh_bundle_requested(
+  int argc, char ** argv, std::string & prefix, std::string & mesh_filename
+) {
+  bool requested = false;
+  for ( int i=1; i<argc; ++i ) {
+    std::string arg( argv[i] );
+    if ( arg == "-m" && i+1 < argc )
+      mesh_filename = argv[i+1];
+    else if ( arg == "--write-mesh-bundle" ) {
+      requested = true;
+      if ( i+1 < argc && argv[i+1][0] != '-' ) prefix = argv[++i];
+    }
+  }
+  return requested;
+}
+
+} // namespace
+} // namespace
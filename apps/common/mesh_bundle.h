@@ -0,0 +1,394 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Binary bundles of the partitioned mesh that can be mapped into
+///        memory.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Build the mesh bundle of a rank.
+//!
+//! A bundle holds the local mesh of one rank, as it is after partitioning
+//! and ghosting, in named sections of raw arrays.  The file starts with a
+//! header and a table of the sections, and each section starts on a 64 byte
+//! boundary, so a mapped bundle can be used in place without copying or
+//! parsing anything.
+///////////////////////////////////////////////////////////////////////////////
+class mesh_bundle_writer_t {
+
+public:
+
+  //! \brief Constructor.
+  //! \param [in] num_dims  the number of dimensions of the mesh
+  //! \param [in] rank  the rank the bundle is for
+  //! \param [in] num_ranks  the number of ranks the mesh is partitioned for
+  mesh_bundle_writer_t(
+    std::size_t num_dims, std::size_t rank, std::size_t num_ranks
+  ) : num_dims_( num_dims ), rank_( rank ), num_ranks_( num_ranks )
+  {}
+
+  //===========================================================================
+  //! \brief Add a section.
+  //! \param [in] name  the section name
+  //! \param [in] values  the trivially copyable values to store
+  //===========================================================================
+  template< typename T >
+  void add( const std::string & name, const std::vector<T> & values )
+  { add_bytes( name, sizeof(T), values.size(), values.data() ); }
+
+  //===========================================================================
+  //! \brief Write the bundle.
+  //!
+  //! The file is written under a temporary name and moved into place once
+  //! it is complete.
+  //!
+  //! \param [in] filename  the name of the file
+  //===========================================================================
+  void write( const std::string & filename ) const;
+
+private:
+
+  //! \brief Add a section of raw bytes.
+  void add_bytes(
+    const std::string & name,
+    std::size_t value_bytes,
+    std::size_t count,
+    const void * data
+  );
+
+  //! \brief A section waiting to be written.
+  struct section_t {
+    std::string name;
+    std::size_t value_bytes;
+    std::size_t count;
+    std::vector<char> data;
+  };
+
+  //! the number of dimensions
+  std::size_t num_dims_;
+  //! the rank, and the number of ranks
+  std::size_t rank_, num_ranks_;
+  //! the sections
+  std::vector<section_t> sections_;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The values of a section of a mapped bundle.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+struct mesh_bundle_section__ {
+  //! the first value
+  const T * data = nullptr;
+  //! the number of values
+  std::size_t size = 0;
+
+  const T * begin() const { return data; }
+  const T * end() const { return data + size; }
+  const T & operator[]( std::size_t i ) const { return data[i]; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A mesh bundle mapped into memory.
+//!
+//! The header and the table of sections are checked when the bundle is
+//! opened.  The checksums of the sections can be checked too, which reads
+//! the whole file, so by default only the pages that are used are read.
+///////////////////////////////////////////////////////////////////////////////
+class mesh_bundle_t {
+
+public:
+
+  //! \brief Constructor, maps the bundle.
+  //! \param [in] filename  the name of the file
+  //! \param [in] verify  if true, the checksums of all sections are checked
+  explicit mesh_bundle_t( const std::string & filename, bool verify = false );
+
+  //! \brief Destructor, unmaps the bundle.
+  ~mesh_bundle_t();
+
+  //! bundles own a mapping, so they are not copyable
+  mesh_bundle_t( const mesh_bundle_t & ) = delete;
+  mesh_bundle_t & operator=( const mesh_bundle_t & ) = delete;
+
+  //! \brief The number of dimensions of the mesh.
+  std::size_t num_dimensions() const { return num_dims_; }
+
+  //! \brief The rank the bundle is for.
+  std::size_t rank() const { return rank_; }
+
+  //! \brief The number of ranks the mesh is partitioned for.
+  std::size_t num_ranks() const { return num_ranks_; }
+
+  //! \brief Check if there is a section.
+  bool has( const std::string & name ) const
+  { return find( name ) != nullptr; }
+
+  //===========================================================================
+  //! \brief Access a section.
+  //! \param [in] name  the section name
+  //! \return the values, which point into the mapped file
+  //===========================================================================
+  template< typename T >
+  mesh_bundle_section__<T> get( const std::string & name ) const
+  {
+    mesh_bundle_section__<T> section;
+    std::size_t count;
+    section.data = static_cast<const T *>(
+      get_bytes( name, sizeof(T), count )
+    );
+    section.size = count;
+    return section;
+  }
+
+private:
+
+  //! \brief Find a section in the table, or return null.
+  const void * find( const std::string & name ) const;
+
+  //! \brief Access the raw bytes of a section.
+  const void * get_bytes(
+    const std::string & name, std::size_t value_bytes, std::size_t & count
+  ) const;
+
+  //! the file name
+  std::string filename_;
+  //! the mapping, and its size
+  void * map_ = nullptr;
+  std::size_t bytes_ = 0;
+  //! the table of sections
+  const void * table_ = nullptr;
+  //! the number of sections
+  std::size_t num_sections_ = 0;
+  //! the number of dimensions
+  std::size_t num_dims_ = 0;
+  //! the rank, and the number of ranks
+  std::size_t rank_ = 0, num_ranks_ = 0;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Add the sections that describe the local mesh to a bundle.
+//!
+//! The coordinates of all the local vertices are stored interleaved, and
+//! the cell to vertex connectivity, and the cell to face and face to vertex
+//! connectivity in 3d, as offsets and local ids.  Each cell also gets the
+//! number of its region.
+//!
+//! \param [in,out] bundle  the bundle to add to
+//! \param [in] m  the mesh
+///////////////////////////////////////////////////////////////////////////////
+template< typename MESH >
+void add_mesh_sections( mesh_bundle_writer_t & bundle, MESH & m )
+{
+  constexpr auto num_dims = MESH::num_dimensions;
+
+  std::vector<double> coordinates;
+  coordinates.reserve( m.num_vertices() * num_dims );
+  for ( auto v : m.vertices() ) {
+    const auto & x = v->coordinates();
+    for ( std::size_t d=0; d<num_dims; ++d ) coordinates.emplace_back( x[d] );
+  }
+  bundle.add( "coordinates", coordinates );
+
+  // connectivity, as offsets into a list of local ids
+  auto add_connectivity = [&]( const std::string & name, auto && from,
+    auto && to )
+  {
+    std::vector<std::uint64_t> offsets( 1, 0 ), ids;
+    for ( auto e : from ) {
+      for ( auto x : to(e) ) ids.emplace_back( x.id() );
+      offsets.emplace_back( ids.size() );
+    }
+    bundle.add( name + "_offsets", offsets );
+    bundle.add( name, ids );
+  };
+
+  add_connectivity( "cell_vertices", m.cells(),
+    [&]( auto c ) { return m.vertices(c); } );
+  if constexpr ( num_dims == 3 ) {
+    add_connectivity( "cell_faces", m.cells(),
+      [&]( auto c ) { return m.faces(c); } );
+    add_connectivity( "face_vertices", m.faces(),
+      [&]( auto f ) { return m.vertices(f); } );
+  }
+
+  // the region tags
+  std::vector<std::uint32_t> regions( m.num_cells(), 0 );
+  auto region_cells = m.regions();
+  for ( std::size_t r=0; r<region_cells.size(); ++r )
+    for ( auto c : region_cells[r] ) regions[ c.id() ] = r;
+  bundle.add( "cell_regions", regions );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Check that a mapped bundle still describes the local mesh.
+//!
+//! The vertex coordinates and the cell to vertex connectivity are compared
+//! value by value, and the other sections by size.
+//!
+//! \param [in] bundle  the mapped bundle
+//! \param [in] m  the mesh
+//! \return an empty string if the bundle matches, otherwise what differs
+///////////////////////////////////////////////////////////////////////////////
+template< typename MESH >
+std::string compare_mesh_sections( const mesh_bundle_t & bundle, MESH & m )
+{
+  constexpr auto num_dims = MESH::num_dimensions;
+
+  if ( bundle.num_dimensions() != num_dims )
+    return "the number of dimensions";
+
+  auto coordinates = bundle.get<double>( "coordinates" );
+  if ( coordinates.size != m.num_vertices() * num_dims )
+    return "the number of vertices";
+  std::size_t i = 0;
+  for ( auto v : m.vertices() ) {
+    const auto & x = v->coordinates();
+    for ( std::size_t d=0; d<num_dims; ++d, ++i )
+      if ( coordinates[i] != x[d] ) return "the vertex coordinates";
+  }
+
+  auto offsets = bundle.get<std::uint64_t>( "cell_vertices_offsets" );
+  auto ids = bundle.get<std::uint64_t>( "cell_vertices" );
+  if ( offsets.size != m.num_cells() + 1 ) return "the number of cells";
+  std::size_t c = 0;
+  for ( auto cell : m.cells() ) {
+    auto j = offsets[c++];
+    for ( auto v : m.vertices(cell) )
+      if ( j >= offsets[c] || ids[j++] != v.id() )
+        return "the cell vertices";
+    if ( j != offsets[c] ) return "the cell vertices";
+  }
+
+  if ( bundle.get<std::uint32_t>( "cell_regions" ).size != m.num_cells() )
+    return "the cell regions";
+  if ( bundle.get<std::uint64_t>( "cell_global_ids" ).size != m.num_cells() )
+    return "the cell partition";
+  if ( bundle.get<std::uint64_t>( "vertex_global_ids" ).size != 
+       m.num_vertices() )
+    return "the vertex partition";
+
+  return {};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Add the sections that describe how a kind of entity is split
+//!        between the ranks.
+//!
+//! The exclusive, shared and ghost entities are stored as local ids, each
+//! local entity gets its global id, and each ghost the rank that owns it.
+//!
+//! \param [in,out] bundle  the bundle to add to
+//! \param [in] name  the kind of entity, which prefixes the section names
+//! \param [in] num_entities  the number of local entities
+//! \param [in] exclusive,shared,ghost  the entities of each kind
+//! \param [in] global_id  maps a local id to a global id
+//! \param [in] owner  maps a global id to the rank that owns it
+///////////////////////////////////////////////////////////////////////////////
+template<
+  typename EXCLUSIVE, typename SHARED, typename GHOST,
+  typename GLOBAL_ID, typename OWNER
+>
+void add_partition_sections(
+  mesh_bundle_writer_t & bundle,
+  const std::string & name,
+  std::size_t num_entities,
+  EXCLUSIVE && exclusive,
+  SHARED && shared,
+  GHOST && ghost,
+  GLOBAL_ID && global_id,
+  OWNER && owner
+) {
+  auto local_ids = [&]( auto && entities ) {
+    std::vector<std::uint64_t> ids;
+    for ( auto e : entities ) ids.emplace_back( e.id() );
+    return ids;
+  };
+  auto ghost_ids = local_ids( ghost );
+
+  std::vector<std::uint64_t> global_ids( num_entities );
+  for ( std::size_t i=0; i<num_entities; ++i ) global_ids[i] = global_id(i);
+
+  std::vector<std::uint32_t> owners;
+  owners.reserve( ghost_ids.size() );
+  for ( auto i : ghost_ids ) owners.emplace_back( owner( global_ids[i] ) );
+
+  bundle.add( name + "_global_ids", global_ids );
+  bundle.add( name + "_exclusive", local_ids( exclusive ) );
+  bundle.add( name + "_shared", local_ids( shared ) );
+  bundle.add( name + "_ghost", ghost_ids );
+  bundle.add( name + "_ghost_owners", owners );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The name of the mesh bundle of a rank.
+//! \param [in] prefix  the bundle prefix
+//! \param [in] rank  the rank
+///////////////////////////////////////////////////////////////////////////////
+std::string mesh_bundle_filename( const std::string & prefix, std::size_t rank );
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Record that every rank finished writing its bundle.
+//!
+//! This is collective, so every rank must call it.  The first rank writes
+//! "<prefix>.bundle", which names the mesh file the bundles were made from
+//! along with its size and modification time, and the number of ranks.
+//!
+//! \param [in] prefix  the bundle prefix
+//! \param [in] mesh_filename  the mesh file the bundles were made from
+//! \param [in] num_ranks  the number of ranks
+///////////////////////////////////////////////////////////////////////////////
+void commit_mesh_bundle(
+  const std::string & prefix,
+  const std::string & mesh_filename,
+  std::size_t num_ranks
+);
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Check if the bundles can stand in for a mesh file.
+//!
+//! They can if they were committed for the same mesh file, unchanged since,
+//! and the same number of ranks.
+//!
+//! \param [in] prefix  the bundle prefix
+//! \param [in] mesh_filename  the mesh file
+//! \param [in] num_ranks  the number of ranks
+///////////////////////////////////////////////////////////////////////////////
+bool is_mesh_bundle_current(
+  const std::string & prefix,
+  const std::string & mesh_filename,
+  std::size_t num_ranks
+);
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Find out if mesh bundles were requested.
+//!
+//! Bundles are requested with "--write-mesh-bundle [<prefix>]" on the
+//! command line, and the mesh file is the one given with "-m".
+//!
+//! \param [in] argc,argv  the command line arguments
+//! \param [in,out] prefix  the bundle prefix, which is left alone unless
+//!                         one is given
+//! \param [out] mesh_filename  the mesh file
+//! \return true if bundles were requested
+///////////////////////////////////////////////////////////////////////////////
+bool mesh_bundle_requested(
+  int argc, char ** argv, std::string & prefix, std::string & mesh_filename
+);
+
+} // namespace
+} // namespace
@@ -0,0 +1,186 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief The solution output shared by the drivers.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include "aggregator.h"
+#include "async_output.h"
+
+// system includes
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Output that is aggregated on a few ranks and written in the
+//!        background.
+//!
+//! Every rank takes a snapshot of its part of the mesh and sends it to the
+//! writer of its group.  The writer merges the snapshots of the group and
+//! hands them to its output thread, so a dump only costs the ranks a copy
+//! and a gather.
+//!
+//! \tparam WRITER  the file writer, like flecsale::io::exodus_writer__
+///////////////////////////////////////////////////////////////////////////////
+template< typename WRITER >
+class aggregated_output__ {
+
+public:
+
+  //! the file writer type
+  using writer_t = WRITER;
+  //! the part of the mesh of a rank
+  using piece_t = typename writer_t::piece_t;
+  //! the data of a time step
+  using snapshot_t = typename writer_t::snapshot_t;
+
+  //! \brief Constructor.
+  aggregated_output__() = default;
+
+  //! \brief Destructor, the output thread is stopped before the file is
+  //!        closed.
+  ~aggregated_output__() { close(); }
+
+  //===========================================================================
+  //! \brief Check if the output was opened.
+  //===========================================================================
+  bool is_open() const { return aggregator_.is_started(); }
+
+  //===========================================================================
+  //! \brief Pick the fields to write.
+  //! \see writer_t::select
+  //===========================================================================
+  template< typename... ARGS >
+  void select( ARGS &&... args )
+  { writer_.select( std::forward<ARGS>(args)... ); }
+
+  //===========================================================================
+  //! \brief Compress the files.
+  //! \see writer_t::set_compression
+  //===========================================================================
+  template< typename... ARGS >
+  void set_compression( ARGS &&... args )
+  { writer_.set_compression( std::forward<ARGS>(args)... ); }
+
+  //===========================================================================
+  //! \brief Create the files.
+  //!
+  //! This is collective over all ranks.
+  //!
+  //! \param [in] m  the mesh
+  //! \param [in] ranks_per_file  the ranks writing to the same file, or zero
+  //!                             for one file per node
+  //! \param [in] num_buffers  the snapshots staged for the output thread,
+  //!                          or zero to write synchronously
+  //! \param [in] file_name  the name of each file, by file id
+  //! \param [in] index_name  the name of the index file
+  //! \param [in] is_written  tells if a cell id is written by this rank
+  //! \param [in] cell_id,vertex_id  map local ids to global ids
+  //===========================================================================
+  template< typename M, typename P, typename C, typename V >
+  void open(
+    M & m,
+    std::size_t ranks_per_file,
+    std::size_t num_buffers,
+    const std::function< std::string(std::size_t) > & file_name,
+    const std::string & index_name,
+    P && is_written,
+    C && cell_id,
+    V && vertex_id
+  ) {
+    aggregator_.start( ranks_per_file );
+
+    // send the piece of this rank to its writer
+    auto piece = writer_.make_piece( m, is_written, cell_id, vertex_id );
+    slab_.clear();
+    piece.pack( slab_ );
+    aggregator_.gather( slab_, slabs_ );
+
+    aggregator_.write_index(
+      index_name, file_name, piece.num_cells(), piece.num_vertices()
+    );
+
+    if ( !aggregator_.is_writer() ) return;
+
+    std::vector<piece_t> pieces( slabs_.size() );
+    for ( std::size_t i=0; i<pieces.size(); ++i ) {
+      const char * pos = slabs_[i].data();
+      pieces[i].unpack( pos );
+    }
+    writer_.open( file_name( aggregator_.file_id() ), pieces );
+
+    staging_.start(
+      num_buffers, [this]( auto & snapshot ){ writer_.write( snapshot ); }
+    );
+  }
+
+  //===========================================================================
+  //! \brief Append a time step.
+  //!
+  //! This is collective over the ranks of a file.
+  //!
+  //! \param [in] m  the mesh
+  //! \param [in] time  the solution time
+  //! \param [in] fields  the fields passed to select()
+  //===========================================================================
+  template< typename M, typename... FIELDS >
+  void write( M & m, double time, const FIELDS &... fields )
+  {
+    writer_.snapshot( m, time, snapshot_, fields... );
+    slab_.clear();
+    snapshot_.pack( slab_ );
+    aggregator_.gather( slab_, slabs_ );
+
+    if ( !aggregator_.is_writer() ) return;
+
+    snapshots_.resize( slabs_.size() );
+    for ( std::size_t i=0; i<snapshots_.size(); ++i ) {
+      const char * pos = slabs_[i].data();
+      snapshots_[i].unpack( pos );
+    }
+
+    // the merged snapshot is written in the background
+    auto & merged = staging_.acquire();
+    writer_.merge( snapshots_, merged );
+    staging_.submit();
+  }
+
+  //===========================================================================
+  //! \brief Finish writing and close the file.
+  //===========================================================================
+  void close()
+  {
+    staging_.stop();
+    writer_.close();
+  }
+
+private:
+
+  //! the file writer
+  writer_t writer_;
+  //! the groups of ranks that write the same file
+  output_aggregator_t aggregator_;
+  //! the snapshots waiting on the output thread
+  async_output__<snapshot_t> staging_;
+  //! the snapshot of this rank, and the ones of the group
+  snapshot_t snapshot_;
+  std::vector<snapshot_t> snapshots_;
+  //! the packed data of this rank, and the ones of the group
+  std::vector<char> slab_;
+  std::vector< std::vector<char> > slabs_;
+
+};
+
+} // namespace
+} // namespace
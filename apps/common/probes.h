@@ -0,0 +1,570 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Sample the solution at a few points every step.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include "cell_locator.h"
+
+#include <flecsale-config.h>
+#include <flecsale/io/io_exodus.h>
+#include <ristra/assertions/errors.h>
+
+// system includes
+#ifdef FLECSALE_USE_MPI
+#include <mpi.h>
+#endif
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A named group of sample points.
+//! \tparam D  the number of dimensions
+///////////////////////////////////////////////////////////////////////////////
+template< std::size_t D >
+struct probe__ {
+  //! the name of the probe
+  std::string name;
+  //! the points sampled
+  std::vector< std::array<double, D> > points;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Parse a list of probes.
+//!
+//! The probes are separated by semicolons, and each is one of
+//! - "point <x>", a single point;
+//! - "line <x0> <x1> <n>", n points evenly spaced from x0 to x1;
+//! - "plane <x0> <u> <v> <nu> <nv>", a grid of nu by nv points spanning the
+//!   parallelogram with corner x0 and sides u and v;
+//! where every position or side is given as D numbers.
+//!
+//! \tparam D  the number of dimensions
+//! \param [in] str  the list of probes
+///////////////////////////////////////////////////////////////////////////////
+template< std::size_t D >
+auto parse_probes( const std::string & str )
+{
+  using point_t = std::array<double, D>;
+
+  std::vector< probe__<D> > probes;
+  std::stringstream list( str );
+  std::string entry;
+
+  while ( std::getline( list, entry, ';' ) ) {
+
+    std::stringstream is( entry );
+    std::string kind;
+    if ( !( is >> kind ) ) continue;
+
+    auto read_point = [&]() {
+      point_t x;
+      for ( auto & xi : x ) is >> xi;
+      return x;
+    };
+    auto read_count = [&]() {
+      long long n = 0;
+      is >> n;
+      if ( n < 1 ) is.setstate( std::ios::failbit );
+      return static_cast<std::size_t>( n );
+    };
+    // the point a fraction of the way along a side
+    auto along = []( const point_t & x, const point_t & u, std::size_t i,
+      std::size_t n )
+    {
+      auto t = n > 1 ? static_cast<double>(i) / (n-1) : 0.;
+      point_t y;
+      for ( std::size_t d=0; d<D; ++d ) y[d] = x[d] + t*u[d];
+      return y;
+    };
+
+    probe__<D> probe;
+    probe.name = kind + std::to_string( probes.size() );
+
+    if ( kind == "point" ) {
+      probe.points.emplace_back( read_point() );
+    }
+    else if ( kind == "line" ) {
+      auto x0 = read_point();
+      auto x1 = read_point();
+      auto n = read_count();
+      point_t u;
+      for ( std::size_t d=0; d<D; ++d ) u[d] = x1[d] - x0[d];
+      for ( std::size_t i=0; is && i<n; ++i )
+        probe.points.emplace_back( along( x0, u, i, n ) );
+    }
+    else if ( kind == "plane" ) {
+      auto x0 = read_point();
+      auto u = read_point();
+      auto v = read_point();
+      auto nu = read_count();
+      auto nv = read_count();
+      for ( std::size_t j=0; is && j<nv; ++j )
+        for ( std::size_t i=0; i<nu; ++i )
+          probe.points.emplace_back( along( along( x0, v, j, nv ), u, i, nu ) );
+    }
+    else {
+      is.setstate( std::ios::failbit );
+    }
+
+    std::string rest;
+    if ( !is || ( is >> rest ) )
+      throw_runtime_error( "Bad probe \"" << entry << "\"" );
+
+    probes.emplace_back( std::move(probe) );
+  }
+
+  return probes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Probes that append the values of selected fields to a time
+//!        history file.
+//!
+//! Each point is located in the owned cell that holds it, using a uniform
+//! grid over the cells of the rank, and takes the value of that cell.  A
+//! vertex field takes the mean of the values at the vertices of the cell.
+//! When the mesh moves, the grid is updated and the points are found again
+//! before each sample, starting from the cell they were last in.
+//!
+//! The first rank writes one line per point and step to a CSV file, with
+//! the positions of the points listed in its header.  A point outside the
+//! mesh is written as "nan".
+//!
+//! \tparam MESH  the mesh type
+///////////////////////////////////////////////////////////////////////////////
+template< typename MESH >
+class probes__ {
+
+public:
+
+  //! the mesh type
+  using mesh_t = MESH;
+  //! the number of dimensions
+  static constexpr std::size_t num_dims = mesh_t::num_dimensions;
+  //! the cell locator type
+  using locator_t = cell_locator__<num_dims>;
+  //! a point
+  using point_t = typename locator_t::point_t;
+
+  //===========================================================================
+  //! \brief Check if the probes were set up.
+  //===========================================================================
+  bool is_open() const { return is_open_; }
+
+  //===========================================================================
+  //! \brief Locate the probes and create the file.
+  //!
+  //! This is collective over all ranks.
+  //!
+  //! \param [in] m  the mesh
+  //! \param [in] owned  the cells owned by this rank
+  //! \param [in] spec  the probes, as described in parse_probes()
+  //! \param [in] selection  the names of the fields to sample
+  //! \param [in] moving  if true, the points are located again before each
+  //!                     sample
+  //! \param [in] filename  the name of the time history file
+  //! \param [in] fields  the fields that can be sampled
+  //===========================================================================
+  template< typename C, typename... FIELDS >
+  void open(
+    mesh_t & m,
+    C && owned,
+    const std::string & spec,
+    const std::vector<std::string> & selection,
+    bool moving,
+    const std::string & filename,
+    const FIELDS &... fields
+  ) {
+    close();
+
+    moving_ = moving;
+    selection_ = selection;
+    columns_.clear();
+    ( add_columns( fields ), ... );
+
+    for ( const auto & selected : selection_ ) {
+      auto found = false;
+      ( (found = found || selected == fields.name), ... );
+      if ( !found )
+        throw_runtime_error( "Unknown probe field \"" << selected << "\"" );
+    }
+
+    // the points
+    auto probes = parse_probes<num_dims>( spec );
+    points_.clear();
+    for ( const auto & p : probes )
+      points_.insert( points_.end(), p.points.begin(), p.points.end() );
+
+    // index the cells
+    cells_.clear();
+    for ( auto c : owned ) cells_.emplace_back( c.id() );
+    make_boxes( m );
+    locator_.build( boxes_ );
+
+    owners_.assign( points_.size(), -1 );
+    locate( m );
+
+    is_open_ = true;
+
+    if ( rank() != 0 ) return;
+
+    file_.open( filename );
+    if ( !file_ )
+      throw_runtime_error( "Unable to open \"" << filename << "\"" );
+    file_ << std::setprecision( std::numeric_limits<double>::max_digits10 );
+
+    std::cout << "Opening probe output: " << filename << std::endl;
+
+    // the positions of the points, then the columns
+    const char * axes[] = { "x", "y", "z" };
+    file_ << "# probe point";
+    for ( std::size_t d=0; d<num_dims; ++d ) file_ << " " << axes[d];
+    file_ << std::endl;
+    std::size_t point = 0;
+    for ( const auto & p : probes )
+      for ( const auto & x : p.points ) {
+        file_ << "# " << p.name << " " << point++;
+        for ( auto xi : x ) file_ << " " << xi;
+        file_ << std::endl;
+      }
+    file_ << "step,time,point";
+    for ( const auto & c : columns_ ) file_ << "," << c;
+    file_ << std::endl;
+  }
+
+  //===========================================================================
+  //! \brief Append the values at the probes.
+  //!
+  //! This is collective over all ranks.
+  //!
+  //! \param [in] m  the mesh
+  //! \param [in] step  the step number
+  //! \param [in] time  the solution time
+  //! \param [in] fields  the fields passed to open()
+  //===========================================================================
+  template< typename... FIELDS >
+  void sample(
+    mesh_t & m, std::size_t step, double time, const FIELDS &... fields
+  ) {
+    if ( !is_open_ )
+      throw_runtime_error( "The probes were never opened" );
+
+    if ( moving_ ) {
+      make_boxes( m );
+      locator_.update( boxes_ );
+      locate( m );
+    }
+
+    // the values of the points found here, then the number of ranks that
+    // found each point, which is more than one on a shared face
+    auto num_points = points_.size();
+    auto num_columns = columns_.size();
+    values_.assign( (num_columns + 1) * num_points, 0 );
+    auto counts = values_.data() + num_columns * num_points;
+    for ( std::size_t i=0; i<num_points; ++i )
+      counts[i] = owners_[i] >= 0 ? 1 : 0;
+
+    [[maybe_unused]] std::size_t column = 0;
+    ( gather( m, fields, column ), ... );
+
+#ifdef FLECSALE_USE_MPI
+    totals_.resize( values_.size() );
+    MPI_Reduce(
+      values_.data(), totals_.data(), values_.size(), MPI_DOUBLE, MPI_SUM,
+      0, MPI_COMM_WORLD
+    );
+    std::swap( values_, totals_ );
+    counts = values_.data() + num_columns * num_points;
+#endif
+
+    if ( rank() != 0 ) return;
+
+    for ( std::size_t i=0; i<num_points; ++i ) {
+      file_ << step << "," << time << "," << i;
+      for ( std::size_t j=0; j<num_columns; ++j ) {
+        file_ << ",";
+        if ( counts[i] > 0 ) file_ << values_[ j*num_points + i ] / counts[i];
+        else file_ << "nan";
+      }
+      file_ << "\n";
+    }
+    // flush, so the history can be looked at while the run goes on
+    file_.flush();
+  }
+
+  //===========================================================================
+  //! \brief Close the file.
+  //===========================================================================
+  void close()
+  {
+    if ( file_.is_open() ) file_.close();
+    is_open_ = false;
+  }
+
+private:
+
+  //! \brief The rank of this process.
+  static int rank()
+  {
+    int rank = 0;
+#ifdef FLECSALE_USE_MPI
+    MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+#endif
+    return rank;
+  }
+
+  //! \brief Check if a field was selected.
+  bool is_selected( const char * name ) const
+  {
+    for ( const auto & s : selection_ ) if ( s == name ) return true;
+    return false;
+  }
+
+  //! \brief The number of columns a field is written as.
+  template< typename F >
+  static constexpr std::size_t num_components()
+  {
+    using value_t = std::decay_t<
+      decltype( std::declval<const F &>()(
+        std::declval<typename mesh_t::counter_t>()
+      ) )
+    >;
+    if constexpr ( std::is_arithmetic<value_t>::value ) return 1;
+    else return num_dims;
+  }
+
+  //! \brief Add the columns of a field, if it was selected.
+  template< typename F >
+  void add_columns( const flecsale::io::output_field__<F> & f )
+  {
+    if ( !is_selected( f.name ) ) return;
+    constexpr auto ncomp = num_components<F>();
+    if ( ncomp == 1 ) {
+      columns_.emplace_back( f.name );
+      return;
+    }
+    const char * ext[] = { "_x", "_y", "_z" };
+    for ( std::size_t i=0; i<ncomp; ++i )
+      columns_.emplace_back( std::string( f.name ) + ext[i] );
+  }
+
+  //! \brief Sample a field at the points found here, if it was selected.
+  template< typename F >
+  void gather(
+    mesh_t & m, const flecsale::io::output_field__<F> & f, std::size_t & column
+  ) {
+    if ( !is_selected( f.name ) ) return;
+
+    constexpr auto ncomp = num_components<F>();
+    const auto & field = f.field;
+    const auto & cs = m.cells();
+    auto num_points = points_.size();
+    auto values = values_.data() + column * num_points;
+
+    auto add = [&]( auto i, auto id, double weight ) {
+      const auto & value = field( id );
+      if constexpr ( ncomp == 1 )
+        values[i] += weight * value;
+      else
+        for ( std::size_t d=0; d<ncomp; ++d )
+          values[i + d*num_points] += weight * value[d];
+    };
+
+    for ( std::size_t i=0; i<num_points; ++i ) {
+      if ( owners_[i] < 0 ) continue;
+      auto c = cells_[ owners_[i] ];
+      if ( f.location == flecsale::io::field_location_t::cells ) {
+        add( i, c, 1 );
+        continue;
+      }
+      auto vs = m.vertices( cs[c] );
+      for ( auto v : vs ) add( i, v.id(), 1. / vs.size() );
+    }
+
+    column += ncomp;
+  }
+
+  //! \brief The position of a vertex.
+  template< typename V >
+  static point_t position( V && v )
+  {
+    const auto & coords = v->coordinates();
+    point_t x;
+    for ( std::size_t d=0; d<num_dims; ++d ) x[d] = coords[d];
+    return x;
+  }
+
+  //! \brief Compute the bounding boxes of the cells.
+  void make_boxes( mesh_t & m )
+  {
+    const auto & cs = m.cells();
+    auto num_cells = cells_.size();
+    boxes_.resize( num_cells );
+    #pragma omp parallel for
+    for ( std::size_t i=0; i<num_cells; ++i ) {
+      auto & b = boxes_[i];
+      b.lo.fill( std::numeric_limits<double>::max() );
+      b.hi.fill( std::numeric_limits<double>::lowest() );
+      for ( auto v : m.vertices( cs[ cells_[i] ] ) ) {
+        auto x = position( v );
+        for ( std::size_t d=0; d<num_dims; ++d ) {
+          b.lo[d] = std::min( b.lo[d], x[d] );
+          b.hi[d] = std::max( b.hi[d], x[d] );
+        }
+      }
+    }
+  }
+
+  //! \brief Check if a point is in a cell.
+  //!
+  //! The cell is split into triangles in 2d, or tetrahedra in 3d, that fan
+  //! out from the average of its vertices, which holds for any cell that is
+  //! star shaped about that point.  The average is computed from the 
+  //! current coordinates, since a moving mesh does not keep the cell 
+  //! centroids up to date.
+  bool contains( mesh_t & m, std::size_t i, const point_t & x ) const
+  {
+    const auto & b = boxes_[i];
+    for ( std::size_t d=0; d<num_dims; ++d )
+      if ( x[d] < b.lo[d] || x[d] > b.hi[d] ) return false;
+
+    const auto & cs = m.cells();
+    auto c = cs[ cells_[i] ];
+    point_t xc{};
+    {
+      auto vs = m.vertices( c );
+      auto n = vs.size();
+      for ( auto v : vs ) {
+        auto y = position( v );
+        for ( std::size_t d=0; d<num_dims; ++d ) xc[d] += y[d] / n;
+      }
+    }
+
+    if constexpr ( num_dims == 2 ) {
+      auto vs = m.vertices( c );
+      auto n = vs.size();
+      for ( std::size_t j=0; j<n; ++j )
+        if ( in_simplex( x, { xc, position( vs[j] ), position( vs[(j+1)%n] ) } ) )
+          return true;
+    }
+    else {
+      for ( auto f : m.faces( c ) ) {
+        auto vs = m.vertices( f );
+        auto n = vs.size();
+        point_t xf{};
+        for ( auto v : vs ) {
+          auto y = position( v );
+          for ( std::size_t d=0; d<num_dims; ++d ) xf[d] += y[d] / n;
+        }
+        for ( std::size_t j=0; j<n; ++j )
+          if ( in_simplex( x,
+            { xc, xf, position( vs[j] ), position( vs[(j+1)%n] ) } ) )
+            return true;
+      }
+    }
+    return false;
+  }
+
+  //! \brief Check if a point is in a triangle or a tetrahedron.
+  static bool in_simplex(
+    const point_t & x, const std::array< point_t, num_dims+1 > & s
+  ) {
+    // solve for the barycentric coordinates by cramer's rule
+    std::array< point_t, num_dims > a;
+    point_t r;
+    for ( std::size_t d=0; d<num_dims; ++d ) {
+      for ( std::size_t k=0; k<num_dims; ++k ) a[k][d] = s[k+1][d] - s[0][d];
+      r[d] = x[d] - s[0][d];
+    }
+    auto det = determinant( a );
+    if ( det == 0 ) return false;
+    // allow for round off on the shared sides
+    constexpr double tol = 1.e-12;
+    double sum = 0;
+    for ( std::size_t k=0; k<num_dims; ++k ) {
+      auto ak = a;
+      ak[k] = r;
+      auto l = determinant( ak ) / det;
+      if ( l < -tol ) return false;
+      sum += l;
+    }
+    return sum <= 1 + tol;
+  }
+
+  //! \brief The determinant of a matrix given by columns.
+  static double determinant( const std::array< point_t, num_dims > & a )
+  {
+    if constexpr ( num_dims == 2 )
+      return a[0][0]*a[1][1] - a[0][1]*a[1][0];
+    else
+      return
+        a[0][0] * ( a[1][1]*a[2][2] - a[1][2]*a[2][1] ) -
+        a[1][0] * ( a[0][1]*a[2][2] - a[0][2]*a[2][1] ) +
+        a[2][0] * ( a[0][1]*a[1][2] - a[0][2]*a[1][1] );
+  }
+
+  //! \brief Find the cells the points are in, trying their last cell first.
+  void locate( mesh_t & m )
+  {
+    auto num_points = points_.size();
+    #pragma omp parallel for
+    for ( std::size_t i=0; i<num_points; ++i ) {
+      const auto & x = points_[i];
+      auto & owner = owners_[i];
+      if ( owner >= 0 && contains( m, owner, x ) ) continue;
+      owner = -1;
+      locator_.find( x, [&]( auto j ) {
+        if ( !contains( m, j, x ) ) return false;
+        owner = j;
+        return true;
+      } );
+    }
+  }
+
+  //! true once the probes are set up
+  bool is_open_ = false;
+  //! true if the points are located before each sample
+  bool moving_ = false;
+  //! the names of the fields to sample
+  std::vector<std::string> selection_;
+  //! the names of the columns written
+  std::vector<std::string> columns_;
+  //! the points
+  std::vector<point_t> points_;
+  //! the index of the cell each point is in, or -1 if not on this rank
+  std::vector<long long> owners_;
+  //! the local ids of the owned cells
+  std::vector<std::size_t> cells_;
+  //! the bounding boxes of the owned cells
+  std::vector<typename locator_t::box_t> boxes_;
+  //! the grid over the cells
+  locator_t locator_;
+  //! the sampled values, and their sums over the ranks
+  std::vector<double> values_, totals_;
+  //! the time history file, only open on the first rank
+  std::ofstream file_;
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,290 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Global reductions that can be overlapped with other work.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+
+// system includes
+#include <mpi.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <type_traits>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Map a value type to its mpi datatype.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+MPI_Datatype mpi_datatype();
+
+template<>
+inline MPI_Datatype mpi_datatype<float>() { return MPI_FLOAT; }
+
+template<>
+inline MPI_Datatype mpi_datatype<double>() { return MPI_DOUBLE; }
+
+template<>
+inline MPI_Datatype mpi_datatype<int>() { return MPI_INT; }
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Free an mpi object when mpi is finalized.
+//!
+//! MPI_Finalize deletes the attributes of MPI_COMM_SELF first, while mpi can
+//! still be used, so the object is attached to it and freed by the delete
+//! callback of the attribute.
+//!
+//! \param [in] handle  the object
+//! \param [in] free  the function that frees it, like MPI_Type_free
+///////////////////////////////////////////////////////////////////////////////
+template< typename H >
+void free_at_finalize( H handle, int (*free)( H * ) )
+{
+  struct entry_t {
+    H handle;
+    int (*free)( H * );
+  };
+
+  auto delete_entry = []( MPI_Comm, int keyval, void * value, void * ) {
+    auto entry = static_cast<entry_t *>( value );
+    entry->free( &entry->handle );
+    delete entry;
+    MPI_Comm_free_keyval( &keyval );
+    return MPI_SUCCESS;
+  };
+
+  int keyval;
+  MPI_Comm_create_keyval( 
+    MPI_COMM_NULL_COPY_FN, delete_entry, &keyval, nullptr 
+  );
+  MPI_Comm_set_attr( MPI_COMM_SELF, keyval, new entry_t{ handle, free } );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A bundle of values that are reduced over all ranks with a single
+//!        non-blocking collective.
+//!
+//! The values are split into three segments whose local contributions are
+//! combined with a minimum, a sum, and a maximum respectively.  Under the
+//! mpi runtime, start() posts an MPI_Iallreduce and the result is only
+//! waited on when it is first accessed, so any work issued in between
+//! overlaps with the communication.  Under the legion runtime, every shard
+//! still runs its own driver, so start() reduces over all of them right
+//! away with a blocking MPI_Allreduce, like the context does for the
+//! futures of a task.
+//!
+//! \tparam T     the value type
+//! \tparam NMIN  the number of values to take the minimum of
+//! \tparam NSUM  the number of values to sum
+//! \tparam NMAX  the number of values to take the maximum of
+///////////////////////////////////////////////////////////////////////////////
+template<
+  typename T, std::size_t NMIN, std::size_t NSUM = 0, std::size_t NMAX = 0
+>
+class reduction_bundle__ {
+
+  static_assert( std::is_arithmetic<T>::value, "must be arithmetic" );
+
+public:
+
+  //! the total number of reduced values
+  static constexpr std::size_t size = NMIN + NSUM + NMAX;
+
+  //! \brief Constructor.
+  reduction_bundle__() { reset(); }
+
+  //! \brief Destructor.  Any reduction in flight is completed first.
+  ~reduction_bundle__() { wait(); }
+
+  //! the bundle owns a pending request, so it is not copyable
+  reduction_bundle__( const reduction_bundle__ & ) = delete;
+  reduction_bundle__ & operator=( const reduction_bundle__ & ) = delete;
+
+  //===========================================================================
+  //! \brief Reset the local contributions to the identity of each operation.
+  //===========================================================================
+  void reset()
+  {
+    std::fill_n( local_.begin(), NMIN, std::numeric_limits<T>::max() );
+    std::fill_n( local_.begin() + NMIN, NSUM, T(0) );
+    std::fill_n(
+      local_.begin() + NMIN + NSUM, NMAX, std::numeric_limits<T>::lowest()
+    );
+  }
+
+  //===========================================================================
+  //! \brief Add a local contribution to one of the values.
+  //! \param [in] i  the index of the value within its segment
+  //! \param [in] value  the local contribution
+  //===========================================================================
+  void reduce_min( std::size_t i, T value )
+  { local_[i] = std::min( local_[i], value ); }
+
+  void reduce_sum( std::size_t i, T value )
+  { local_[NMIN + i] += value; }
+
+  void reduce_max( std::size_t i, T value )
+  {
+    auto & v = local_[NMIN + NSUM + i];
+    v = std::max( v, value );
+  }
+
+  //===========================================================================
+  //! \brief Start reducing the local contributions over all ranks.
+  //!
+  //! The local contributions are reset afterwards, so the bundle can collect
+  //! the next set while this one is in flight.
+  //===========================================================================
+  void start()
+  {
+    // only one reduction can be in flight at a time
+    wait();
+
+    send_ = local_;
+    reset();
+
+#ifdef FLECSALE_USE_MPI
+    auto ret = MPI_Iallreduce(
+      send_.data(), global_.data(), 1, datatype(), op(), MPI_COMM_WORLD,
+      &request_
+    );
+    if ( ret != MPI_SUCCESS )
+      throw_runtime_error( "MPI_Iallreduce failed with error " << ret );
+    pending_ = true;
+#else
+    auto ret = MPI_Allreduce(
+      send_.data(), global_.data(), 1, datatype(), op(), MPI_COMM_WORLD
+    );
+    if ( ret != MPI_SUCCESS )
+      throw_runtime_error( "MPI_Allreduce failed with error " << ret );
+#endif
+  }
+
+  //===========================================================================
+  //! \brief Check whether the last reduction has finished, without blocking.
+  //===========================================================================
+  bool ready()
+  {
+#ifdef FLECSALE_USE_MPI
+    if ( pending_ ) {
+      int done = 0;
+      MPI_Test( &request_, &done, MPI_STATUS_IGNORE );
+      pending_ = !done;
+    }
+#endif
+    return !pending_;
+  }
+
+  //===========================================================================
+  //! \brief Block until the last reduction has finished.
+  //===========================================================================
+  void wait()
+  {
+#ifdef FLECSALE_USE_MPI
+    if ( pending_ ) {
+      MPI_Wait( &request_, MPI_STATUS_IGNORE );
+      pending_ = false;
+    }
+#endif
+  }
+
+  //===========================================================================
+  //! \brief Access the global result of the last reduction.
+  //!
+  //! These wait for the reduction to finish, so call them as late as
+  //! possible.
+  //! \param [in] i  the index of the value within its segment
+  //===========================================================================
+  T min( std::size_t i )
+  {
+    wait();
+    return global_[i];
+  }
+
+  T sum( std::size_t i )
+  {
+    wait();
+    return global_[NMIN + i];
+  }
+
+  T max( std::size_t i )
+  {
+    wait();
+    return global_[NMIN + NSUM + i];
+  }
+
+private:
+
+  //! the storage type for the values
+  using values_t = std::array<T, size>;
+
+  //===========================================================================
+  //! \brief Combine the values segment by segment.
+  //===========================================================================
+  static void combine( void * in, void * inout, int * len, MPI_Datatype * )
+  {
+    auto a = static_cast<const T *>( in );
+    auto b = static_cast<T *>( inout );
+    for ( int n=0; n<*len; ++n, a+=size, b+=size ) {
+      std::size_t i = 0;
+      for ( ; i<NMIN; ++i )             b[i] = std::min( a[i], b[i] );
+      for ( ; i<NMIN+NSUM; ++i )        b[i] += a[i];
+      for ( ; i<size; ++i )             b[i] = std::max( a[i], b[i] );
+    }
+  }
+
+  //! \brief The datatype holding the whole bundle, created once per type 
+  //!        and freed when mpi is finalized.
+  static MPI_Datatype datatype()
+  {
+    static MPI_Datatype type = []() {
+      MPI_Datatype t;
+      MPI_Type_contiguous( size, mpi_datatype<T>(), &t );
+      MPI_Type_commit( &t );
+      free_at_finalize( t, &MPI_Type_free );
+      return t;
+    }();
+    return type;
+  }
+
+  //! \brief The combined reduction operator, created once per type and 
+  //!        freed when mpi is finalized.
+  static MPI_Op op()
+  {
+    static MPI_Op o = []() {
+      MPI_Op tmp;
+      MPI_Op_create( &combine, /* commutative */ 1, &tmp );
+      free_at_finalize( tmp, &MPI_Op_free );
+      return tmp;
+    }();
+    return o;
+  }
+
+  //! the request for the reduction in flight
+  MPI_Request request_ = MPI_REQUEST_NULL;
+
+  //! true if a reduction is in flight
+  bool pending_ = false;
+
+  //! the local contributions being collected
+  values_t local_;
+  //! the local contributions being reduced
+  values_t send_;
+  //! the result of the last reduction
+  values_t global_;
+
+};
+
+} // namespace
+} // namespace
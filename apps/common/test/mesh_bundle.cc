@@ -0,0 +1,211 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the mesh bundles.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// user includes
+#include "../mesh_bundle.h"
+
+
+// explicitly use some stuff
+using std::vector;
+
+using namespace apps::common;
+
+//! \brief An entity that only has an id.
+struct entity_t {
+  std::size_t i;
+  std::size_t id() const { return i; }
+};
+
+//! \brief Flip a byte of a file.
+void corrupt( const std::string & filename, std::size_t offset )
+{
+  std::fstream file( filename, std::ios::binary | std::ios::in | 
+    std::ios::out );
+  file.seekg( offset );
+  char c;
+  file.get( c );
+  file.seekp( offset );
+  file.put( ~c );
+}
+
+//! \brief Write a bundle with sections of each kind.
+void write_bundle( const std::string & filename )
+{
+  mesh_bundle_writer_t bundle( 2, 1, 3 );
+  bundle.add( "coordinates", vector<double>{ 0, 0, 1, 0, 1, 1, 0, 1 } );
+  bundle.add( "cell_vertices_offsets", vector<std::uint64_t>{ 0, 4 } );
+  bundle.add( "cell_vertices", vector<std::uint64_t>{ 0, 1, 2, 3 } );
+  bundle.add( "cell_regions", vector<std::uint32_t>{ 7 } );
+  bundle.add( "empty", vector<char>{} );
+
+  // three vertices, one owned by another rank
+  vector<entity_t> exclusive{ {0}, {2} }, shared{ {1} }, ghost{ {3} };
+  add_partition_sections( bundle, "vertex", 4, exclusive, shared, ghost,
+    []( auto i ) { return 10 + i; },
+    []( auto id ) { return id == 13 ? 2 : 1; }
+  );
+
+  bundle.write( filename );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that a bundle maps back to what was written
+///////////////////////////////////////////////////////////////////////////////
+TEST(mesh_bundle, round_trip) {
+
+  auto filename = mesh_bundle_filename( "test_round_trip", 1 );
+  ASSERT_EQ( "test_round_trip_rank000001.bundle", filename );
+  write_bundle( filename );
+
+  mesh_bundle_t bundle( filename, /* verify */ true );
+  ASSERT_EQ( 2, bundle.num_dimensions() );
+  ASSERT_EQ( 1, bundle.rank() );
+  ASSERT_EQ( 3, bundle.num_ranks() );
+
+  auto check = [&]( const std::string & name, const auto & expected ) {
+    using value_t = typename std::decay_t<decltype(expected)>::value_type;
+    ASSERT_TRUE( bundle.has( name ) ) << name;
+    auto section = bundle.get<value_t>( name );
+    ASSERT_EQ( expected.size(), section.size ) << name;
+    // the sections can be used in place, so they must be aligned
+    ASSERT_EQ( 0, reinterpret_cast<std::uintptr_t>(section.data) % 64 )
+      << name;
+    ASSERT_TRUE( std::equal( section.begin(), section.end(), 
+      expected.begin() ) ) << name;
+  };
+
+  check( "coordinates", vector<double>{ 0, 0, 1, 0, 1, 1, 0, 1 } );
+  check( "cell_vertices_offsets", vector<std::uint64_t>{ 0, 4 } );
+  check( "cell_vertices", vector<std::uint64_t>{ 0, 1, 2, 3 } );
+  check( "cell_regions", vector<std::uint32_t>{ 7 } );
+  check( "empty", vector<char>{} );
+  check( "vertex_global_ids", vector<std::uint64_t>{ 10, 11, 12, 13 } );
+  check( "vertex_exclusive", vector<std::uint64_t>{ 0, 2 } );
+  check( "vertex_shared", vector<std::uint64_t>{ 1 } );
+  check( "vertex_ghost", vector<std::uint64_t>{ 3 } );
+  check( "vertex_ghost_owners", vector<std::uint32_t>{ 2 } );
+
+  // missing sections and the wrong value types are errors
+  ASSERT_FALSE( bundle.has( "cell_faces" ) );
+  ASSERT_THROW( bundle.get<double>( "cell_faces" ), std::runtime_error );
+  ASSERT_THROW( bundle.get<float>( "coordinates" ), std::runtime_error );
+
+  // the writer rejects bad names
+  mesh_bundle_writer_t writer( 2, 0, 1 );
+  writer.add( "a", vector<int>{ 1 } );
+  ASSERT_THROW( writer.add( "a", vector<int>{ 2 } ), std::runtime_error );
+  ASSERT_THROW( writer.add( std::string( 40, 'x' ), vector<int>{ 1 } ), 
+    std::runtime_error );
+
+  std::remove( filename.c_str() );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the checksums catch every corrupt section
+///////////////////////////////////////////////////////////////////////////////
+TEST(mesh_bundle, checksums) {
+
+  std::string filename = "test_checksums.bundle";
+  write_bundle( filename );
+
+  // find where each section starts in the file, from where the sections
+  // are mapped relative to the coordinates, which are found by value
+  vector<std::pair<std::string, std::size_t>> offsets;
+  {
+    mesh_bundle_t bundle( filename );
+    auto coordinates = bundle.get<double>( "coordinates" );
+    auto begin = reinterpret_cast<const char *>( coordinates.data );
+    auto end = reinterpret_cast<const char *>( coordinates.end() );
+
+    std::ifstream file( filename, std::ios::binary );
+    vector<char> bytes( ( std::istreambuf_iterator<char>(file) ), 
+      std::istreambuf_iterator<char>() );
+    auto it = std::search( bytes.begin(), bytes.end(), begin, end );
+    ASSERT_NE( bytes.end(), it );
+    std::size_t first = it - bytes.begin();
+    ASSERT_EQ( 0, first % 64 );
+
+    auto offset_of = [&]( const void * p ) {
+      return first + ( static_cast<const char *>(p) - begin );
+    };
+    offsets.emplace_back( "coordinates", first );
+    for ( auto name : { "cell_vertices_offsets", "cell_vertices", 
+      "vertex_global_ids", "vertex_exclusive", "vertex_shared", 
+      "vertex_ghost" } )
+      offsets.emplace_back( name, 
+        offset_of( bundle.get<std::uint64_t>( name ).data ) );
+    for ( auto name : { "cell_regions", "vertex_ghost_owners" } )
+      offsets.emplace_back( name, 
+        offset_of( bundle.get<std::uint32_t>( name ).data ) );
+  }
+
+  for ( const auto & section : offsets ) {
+    write_bundle( filename );
+    corrupt( filename, section.second );
+    // the layout is still fine, so only verifying finds the damage
+    ASSERT_NO_THROW( mesh_bundle_t{ filename } ) << section.first;
+    ASSERT_THROW( mesh_bundle_t( filename, true ), std::runtime_error )
+      << section.first;
+  }
+
+  // a corrupt header or table is always caught
+  for ( std::size_t offset : { 0, 8, 12, 16, 48, 60, 80 } ) {
+    write_bundle( filename );
+    corrupt( filename, offset );
+    ASSERT_THROW( mesh_bundle_t{ filename }, std::runtime_error ) << offset;
+  }
+
+  // as is a truncated file
+  {
+    std::ofstream file( filename, std::ios::binary | std::ios::trunc );
+    file << "FLECS";
+  }
+  ASSERT_THROW( mesh_bundle_t{ filename }, std::runtime_error );
+
+  std::remove( filename.c_str() );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that a committed bundle is only current for its mesh
+///////////////////////////////////////////////////////////////////////////////
+TEST(mesh_bundle, current) {
+
+  std::string prefix = "test_current", mesh_filename = "test_current.g";
+  { std::ofstream mesh( mesh_filename ); mesh << "mesh"; }
+
+  ASSERT_FALSE( is_mesh_bundle_current( prefix, mesh_filename, 1 ) );
+  commit_mesh_bundle( prefix, mesh_filename, 1 );
+  ASSERT_TRUE( is_mesh_bundle_current( prefix, mesh_filename, 1 ) );
+  ASSERT_FALSE( is_mesh_bundle_current( prefix, mesh_filename, 2 ) );
+  ASSERT_FALSE( is_mesh_bundle_current( prefix, "other.g", 1 ) );
+
+  // a changed mesh needs new bundles
+  { std::ofstream mesh( mesh_filename, std::ios::app ); mesh << "more"; }
+  ASSERT_FALSE( is_mesh_bundle_current( prefix, mesh_filename, 1 ) );
+
+  std::remove( ( prefix + ".bundle" ).c_str() );
+  std::remove( mesh_filename.c_str() );
+
+} // TEST
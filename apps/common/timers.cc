@@ -0,0 +1,230 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Lightweight hierarchical timers for the drivers.
+////////////////////////////////////////////////////////////////////////////////
+
+// user includes
+#include "timers.h"
+
+#include <flecsale-config.h>
+
+// system includes
+#ifdef FLECSALE_USE_MPI
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+// Enter a region nested in the current one
+///////////////////////////////////////////////////////////////////////////////
+std::size_t timer_registry_t::push( const char * name )
+{
+  // look for an existing child with this name
+  for ( auto child : regions_[current_].children )
+    if ( regions_[child].name == name )
+      return current_ = child;
+
+  // otherwise add a new one
+  auto id = regions_.size();
+  region_t r;
+  r.name = name;
+  r.parent = current_;
+  r.depth = regions_[current_].depth + 1;
+  regions_.emplace_back( std::move(r) );
+  regions_[current_].children.emplace_back( id );
+  return current_ = id;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reduce the timings of each region over all ranks
+///////////////////////////////////////////////////////////////////////////////
+std::vector<timer_registry_t::summary_t> 
+timer_registry_t::summarize( int & num_ranks ) const
+{
+
+  //---------------------------------------------------------------------------
+  // list the regions depth first, identified by their full path
+
+  std::vector<std::size_t> order;
+  std::vector<std::string> paths( regions_.size() );
+
+  std::vector<std::size_t> stack = { 0 };
+  while ( !stack.empty() ) {
+    auto id = stack.back();
+    stack.pop_back();
+    order.emplace_back( id );
+    const auto & r = regions_[id];
+    paths[id] = id ? paths[r.parent] + "/" + r.name : r.name;
+    for ( auto it = r.children.rbegin(); it != r.children.rend(); ++it )
+      stack.emplace_back( *it );
+  }
+
+  // the root has no time of its own, so use the sum of its children
+  auto root_seconds = 0.;
+  for ( auto child : regions_[0].children )
+    root_seconds += regions_[child].seconds;
+
+  //---------------------------------------------------------------------------
+  // the regions are reported in the order of the first rank, ranks that
+  // never entered one contribute zero
+
+  num_ranks = 1;
+  std::vector<std::string> names;
+  for ( auto id : order ) names.emplace_back( paths[id] );
+
+#ifdef FLECSALE_USE_MPI
+  MPI_Comm_size( MPI_COMM_WORLD, &num_ranks );
+
+  std::string packed;
+  for ( const auto & n : names ) packed += n + '\n';
+  unsigned long len = packed.size();
+  MPI_Bcast( &len, 1, MPI_UNSIGNED_LONG, 0, MPI_COMM_WORLD );
+  packed.resize( len );
+  MPI_Bcast( &packed[0], len, MPI_CHAR, 0, MPI_COMM_WORLD );
+
+  names.clear();
+  std::istringstream is( packed );
+  for ( std::string n; std::getline( is, n ); ) names.emplace_back( n );
+#endif
+
+  auto num_regions = names.size();
+  std::vector<double> local_seconds( num_regions, 0 );
+  std::vector<std::size_t> calls( num_regions, 0 );
+
+  for ( std::size_t i=0; i<num_regions; ++i ) {
+    auto it = std::find( paths.begin(), paths.end(), names[i] );
+    if ( it == paths.end() ) continue;
+    auto id = std::distance( paths.begin(), it );
+    local_seconds[i] = id ? regions_[id].seconds : root_seconds;
+    calls[i] = regions_[id].calls;
+  }
+
+  auto min_seconds = local_seconds;
+  auto max_seconds = local_seconds;
+  auto avg_seconds = local_seconds;
+
+#ifdef FLECSALE_USE_MPI
+  MPI_Allreduce(
+    local_seconds.data(), min_seconds.data(), num_regions, MPI_DOUBLE,
+    MPI_MIN, MPI_COMM_WORLD
+  );
+  MPI_Allreduce(
+    local_seconds.data(), max_seconds.data(), num_regions, MPI_DOUBLE,
+    MPI_MAX, MPI_COMM_WORLD
+  );
+  MPI_Allreduce(
+    local_seconds.data(), avg_seconds.data(), num_regions, MPI_DOUBLE,
+    MPI_SUM, MPI_COMM_WORLD
+  );
+#endif
+
+  std::vector<summary_t> summary( num_regions );
+  for ( std::size_t i=0; i<num_regions; ++i )
+    summary[i] = { 
+      names[i], calls[i], min_seconds[i], avg_seconds[i] / num_ranks,
+      max_seconds[i]
+    };
+
+  return summary;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Print the min/avg/max over all ranks and write a json report
+///////////////////////////////////////////////////////////////////////////////
+void timer_registry_t::report(
+  std::ostream & os, const std::string & filename
+) const
+{
+
+  int num_ranks;
+  auto summary = summarize( num_ranks );
+
+  int rank = 0;
+#ifdef FLECSALE_USE_MPI
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+#endif
+  if ( rank != 0 ) return;
+
+  //---------------------------------------------------------------------------
+  // print a table
+
+  std::size_t name_width = 0;
+  for ( const auto & r : summary ) {
+    const auto & n = r.path;
+    auto depth = std::count( n.begin(), n.end(), '/' );
+    auto base = n.substr( n.find_last_of('/') + 1 );
+    name_width = std::max<std::size_t>( name_width, 2*depth + base.size() );
+  }
+
+  auto flags = os.flags();
+  auto precision = os.precision();
+
+  os << "Timers over " << num_ranks << " ranks, in seconds:" << std::endl;
+  os << std::left << std::setw( name_width ) << "Region" << std::right
+     << std::setw(10) << "Calls"
+     << std::setw(12) << "Min"
+     << std::setw(12) << "Avg"
+     << std::setw(12) << "Max"
+     << std::setw(10) << "Max/Avg"
+     << std::endl;
+  os << std::string( name_width + 56, '-' ) << std::endl;
+
+  os << std::fixed;
+  for ( const auto & r : summary ) {
+    const auto & n = r.path;
+    auto depth = std::count( n.begin(), n.end(), '/' );
+    auto base = n.substr( n.find_last_of('/') + 1 );
+    auto imbalance = r.avg > 0 ? r.max / r.avg : 1;
+    os << std::left << std::setw( name_width )
+       << std::string( 2*depth, ' ' ) + base << std::right
+       << std::setw(10) << r.calls
+       << std::setprecision(4)
+       << std::setw(12) << r.min
+       << std::setw(12) << r.avg
+       << std::setw(12) << r.max
+       << std::setprecision(2)
+       << std::setw(10) << imbalance
+       << std::endl;
+  }
+
+  os.flags( flags );
+  os.precision( precision );
+
+  //---------------------------------------------------------------------------
+  // write the json report
+
+  if ( filename.empty() ) return;
+
+  std::ofstream file( filename );
+  file << std::setprecision(9);
+  file << "{" << std::endl;
+  file << "  \"num_ranks\": " << num_ranks << "," << std::endl;
+  file << "  \"regions\": [" << std::endl;
+  for ( std::size_t i=0; i<summary.size(); ++i ) {
+    const auto & r = summary[i];
+    file << "    { \"path\": \"" << r.path << "\""
+         << ", \"calls\": " << r.calls
+         << ", \"min\": " << r.min
+         << ", \"avg\": " << r.avg
+         << ", \"max\": " << r.max
+         << " }" << ( i+1 < summary.size() ? "," : "" ) << std::endl;
+  }
+  file << "  ]" << std::endl;
+  file << "}" << std::endl;
+
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,208 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Lightweight hierarchical timers for the drivers.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A registry of named, nested timing regions.
+//!
+//! Regions are identified by their name and the region they are nested in,
+//! so the same name can show up under different parents.  The registry is
+//! meant to be used from the driver thread only.
+///////////////////////////////////////////////////////////////////////////////
+class timer_registry_t {
+
+public:
+
+  //! the clock used for timing
+  using clock_t = std::chrono::steady_clock;
+
+  //! \brief The accumulated timings of a region.
+  struct region_t {
+    //! the region name
+    std::string name;
+    //! the index of the enclosing region
+    std::size_t parent;
+    //! the nesting depth, the root is at zero
+    std::size_t depth;
+    //! the indices of the nested regions
+    std::vector<std::size_t> children;
+    //! the number of times the region was entered
+    std::size_t calls = 0;
+    //! the total time spent in the region, in seconds
+    double seconds = 0;
+  };
+
+  //! \brief The timings of a region over all ranks.
+  struct summary_t {
+    //! the full path of the region, i.e. "total/step/name"
+    std::string path;
+    //! the number of times the first rank entered the region
+    std::size_t calls;
+    //! the min/avg/max time spent in the region, in seconds
+    double min, avg, max;
+  };
+
+  //===========================================================================
+  //! \brief Access the registry.
+  //===========================================================================
+  static timer_registry_t & instance()
+  {
+    static timer_registry_t registry;
+    return registry;
+  }
+
+  //===========================================================================
+  //! \brief Turn timing on or off.  Nothing is recorded while disabled.
+  //===========================================================================
+  void enable( bool on = true ) { enabled_ = on; }
+  bool enabled() const { return enabled_; }
+
+  //===========================================================================
+  //! \brief Enter a region nested in the current one.
+  //! \return the index of the region
+  //===========================================================================
+  std::size_t push( const char * name );
+
+  //===========================================================================
+  //! \brief Leave the current region, adding the elapsed time.
+  //===========================================================================
+  void pop( double seconds )
+  {
+    auto & r = regions_[current_];
+    r.calls++;
+    r.seconds += seconds;
+    current_ = r.parent;
+  }
+
+  //===========================================================================
+  //! \brief Access the recorded regions.  The first one is the root.
+  //===========================================================================
+  const std::vector<region_t> & regions() const { return regions_; }
+
+  //===========================================================================
+  //! \brief Reduce the timings of each region over all ranks.
+  //!
+  //! This is collective, so every rank must call it.  The regions are listed
+  //! depth first in the order of the first rank, and ranks that never 
+  //! entered one contribute zero.
+  //!
+  //! \param [out] num_ranks  the number of ranks
+  //! \return the summary of each region
+  //===========================================================================
+  std::vector<summary_t> summarize( int & num_ranks ) const;
+
+  //===========================================================================
+  //! \brief Print the min/avg/max over all ranks and write a json report.
+  //!
+  //! This is collective, so every rank must call it.  Only the first rank
+  //! prints and writes the file.
+  //!
+  //! \param [in] os  the stream to print the table to
+  //! \param [in] filename  the name of the json file, none if empty
+  //===========================================================================
+  void report( std::ostream & os, const std::string & filename ) const;
+
+  //===========================================================================
+  //! \brief Clear all recorded regions.
+  //===========================================================================
+  void clear()
+  {
+    regions_.resize(1);
+    regions_[0].children.clear();
+    current_ = 0;
+  }
+
+private:
+
+  //! \brief Constructor, only the root region exists to begin with.
+  timer_registry_t() : regions_(1)
+  {
+    regions_[0].name = "total";
+    regions_[0].parent = 0;
+    regions_[0].depth = 0;
+  }
+
+  //! true if timing is on
+  bool enabled_ = false;
+  //! the index of the current region
+  std::size_t current_ = 0;
+  //! the recorded regions
+  std::vector<region_t> regions_;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Time a region for the lifetime of this object.
+//!
+//! When the registry is disabled, this only costs a branch.
+///////////////////////////////////////////////////////////////////////////////
+class scoped_timer_t {
+
+public:
+
+  //! \brief Constructor.
+  //! \param [in] name  the name of the region
+  explicit scoped_timer_t( const char * name )
+  {
+    auto & registry = timer_registry_t::instance();
+    if ( registry.enabled() ) {
+      registry.push( name );
+      active_ = true;
+      start_ = timer_registry_t::clock_t::now();
+    }
+  }
+
+  //! \brief Destructor, stops the timer.
+  ~scoped_timer_t()
+  {
+    if ( active_ ) {
+      auto end = timer_registry_t::clock_t::now();
+      timer_registry_t::instance().pop(
+        std::chrono::duration<double>( end - start_ ).count()
+      );
+    }
+  }
+
+  //! timers are tied to a scope
+  scoped_timer_t( const scoped_timer_t & ) = delete;
+  scoped_timer_t & operator=( const scoped_timer_t & ) = delete;
+
+private:
+
+  //! true if the region was entered
+  bool active_ = false;
+  //! when the region was entered
+  timer_registry_t::clock_t::time_point start_;
+
+};
+
+} // namespace
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Execute a task inside a timed region named after the task.
+//!
+//! Under the mpi runtime tasks run to completion, so this measures the task
+//! itself.  Under legion it only measures the launch.
+///////////////////////////////////////////////////////////////////////////////
+#define timed_execute_task( task, nspace, launch, ...)                         \
+  [&]() {                                                                      \
+    apps::common::scoped_timer_t timer_( #task );                              \
+    return flecsi_execute_task( task, nspace, launch, ##__VA_ARGS__ );         \
+  }()
@@ -8,8 +8,17 @@
 ////////////////////////////////////////////////////////////////////////////////
 #pragma once
 
+// user includes
+#include <flecsale/utils/compression.h>
+#include <ristra/assertions/errors.h>
+
 // system includes
+#include <cstdlib>
+#include <iomanip>
+#include <map>
 #include <sstream>
+#include <string>
+#include <vector>
 
 namespace apps {
 namespace common {
@@ -26,5 +35,50 @@ static auto zero_padded(
   return ss.str();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Split a list of names separated by commas or spaces
+///////////////////////////////////////////////////////////////////////////////
+static auto split_names( const std::string & str )
+{
+  std::vector<std::string> names;
+  std::string name;
+  for ( auto c : str ) {
+    if ( c == ',' || c == ' ' ) {
+      if ( !name.empty() ) names.emplace_back( std::move(name) );
+      name.clear();
+    }
+    else 
+      name.push_back( c );
+  }
+  if ( !name.empty() ) names.emplace_back( std::move(name) );
+  return names;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Parse a list of error tolerances, by field name
+//!
+//! Each entry is "<name>=abs:<value>" or "<name>=rel:<value>", separated by
+//! commas or spaces.  A field can be given both.
+///////////////////////////////////////////////////////////////////////////////
+inline auto parse_tolerances( const std::string & str )
+{
+  std::map< std::string, flecsale::utils::tolerance_t > tolerances;
+  for ( const auto & entry : split_names( str ) ) {
+    auto eq = entry.find( '=' );
+    auto colon = entry.find( ':', eq );
+    auto kind = eq == std::string::npos || colon == std::string::npos ? 
+      std::string() : entry.substr( eq+1, colon-eq-1 );
+    char * end = nullptr;
+    auto value = kind.empty() ? 0 :
+      std::strtod( entry.c_str() + colon + 1, &end );
+    if ( !end || *end != '\0' || value <= 0 || 
+        ( kind != "abs" && kind != "rel" ) )
+      throw_runtime_error( "Bad output tolerance \"" << entry << "\"" );
+    auto & tolerance = tolerances[ entry.substr( 0, eq ) ];
+    ( kind == "abs" ? tolerance.absolute : tolerance.relative ) = value;
+  }
+  return tolerances;
+}
+
 } // namespace
 } // namespace
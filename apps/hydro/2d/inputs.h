@@ -37,6 +37,8 @@ public:
 
   //! the eos type
   using eos_t = apps::hydro::eos_t;
+  //! the type of the equations of state of regions
+  using eos_map_t = apps::hydro::eos_map_t;
 
   //! a dimensioned array type helper
   template< typename T>
@@ -58,6 +60,47 @@ public:
   //! \brief output frequency
   static size_t output_freq;
 
+  //! \brief the output snapshots staged for the background writer, the 
+  //!   output is written synchronously if zero
+  static size_t output_buffers;
+
+  //! \brief the ranks that write to the same output file, one file per node
+  //!   if zero
+  static size_t output_ranks_per_file;
+
+  //! \brief the names of the fields to output, separated by commas
+  static std::string output_fields;
+
+  //! \brief the deflate level of the output files, from 1 to 9, or zero to
+  //!   leave them uncompressed
+  static int output_compression;
+
+  //! \brief the error allowed when writing fields, as a list of 
+  //!   "<field>=abs:<value>" or "<field>=rel:<value>"; fields not listed are
+  //!   written exactly
+  static std::string output_tolerances;
+
+  //! \brief the steps and the wall clock seconds between checkpoints, none
+  //!   if zero
+  //! \{
+  static size_t checkpoint_freq;
+  static real_t checkpoint_interval;
+  //! \}
+
+  //! \brief compress the checkpoints, without loss
+  static bool checkpoint_compression;
+
+  //! \brief the probes, separated by semicolons, each a "point <x>", a 
+  //!   "line <x0> <x1> <n>" or a "plane <x0> <u> <v> <nu> <nv>"
+  static std::string probes;
+
+  //! \brief the names of the fields to sample at the probes, separated by
+  //!   commas
+  static std::string probe_fields;
+
+  //! \brief the steps between probe samples
+  static size_t probe_freq;
+
   //! \brief the CFL and final solution time
   //! \{
   static real_t CFL;
@@ -65,9 +108,30 @@ public:
   static size_t max_steps;
   //! \}
 
+  //! \brief how the fluxes are applied to the cells
+  static update_mode_t update_mode;
+
+  //! \brief if true, the next time step is computed during the update 
+  //!   instead of in a separate sweep over the cells
+  static bool fused_time_step;
+
+  //! \brief if true, time the tasks and report them at the end
+  static bool report_timers;
+
+  //! \brief the number of times a step with a negative density or internal
+  //!   energy is retried, and the factor its step size is cut back by
+  //! \{
+  static size_t max_retries;
+  static real_t retry_time_step_factor;
+  //! \}
+
   //! \brief the equation of state
   static eos_t eos;
 
+  //! \brief the equations of state of some regions, which are otherwise
+  //!        made of the equation of state above
+  static eos_map_t region_eos;
+
   //! \brief this is a lambda function to set the initial conditions
   static ics_function_t ics;
 
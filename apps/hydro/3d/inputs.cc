@@ -23,6 +23,7 @@ using real_t = inputs_t::real_t;
 using vector_t = inputs_t::vector_t;
 using string = std::string;
 using eos_t = inputs_t::eos_t;
+using eos_map_t = inputs_t::eos_map_t;
 
 //=============================================================================
 // These constants are not part of the input class, they are globally scoped
@@ -50,17 +51,67 @@ string inputs_t::postfix = "dat";
 // output frequency
 size_t inputs_t::output_freq = 100;
 
+// the number of output snapshots written in the background, two double
+// buffers them, and zero writes them synchronously
+size_t inputs_t::output_buffers = 2;
+
+// the ranks that write to the same output file, where zero makes one file
+// per node
+size_t inputs_t::output_ranks_per_file = 0;
+
+// the fields to output; any of density, velocity, internal_energy,
+// pressure, temperature, sound_speed
+string inputs_t::output_fields = "density,velocity,pressure";
+
+// the deflate level of the output files, where zero leaves them uncompressed
+int inputs_t::output_compression = 0;
+
+// the error allowed in each output field, like "density=abs:1e-8" or
+// "pressure=rel:1e-6"; the fields not listed are written exactly
+string inputs_t::output_tolerances = "";
+
+// checkpoint frequency, in steps and in wall clock seconds
+size_t inputs_t::checkpoint_freq = 0;
+real_t inputs_t::checkpoint_interval = 0;
+
+// compress the checkpoints, without loss
+bool inputs_t::checkpoint_compression = false;
+
+// the points where the solution is sampled every probe_freq steps, like
+// "point 0.5 0.5 0.5"; none if empty
+string inputs_t::probes = "";
+string inputs_t::probe_fields = "density,pressure";
+size_t inputs_t::probe_freq = 1;
+
 // the CFL and final solution time
 real_t inputs_t::CFL = 1.0/3.0;
 real_t inputs_t::final_time = 1.0;
 size_t inputs_t::max_steps = 1e6;
 
+// how the fluxes are applied to the cells; the fused mode scatters them
+// straight to the cells instead of storing them per face
+update_mode_t inputs_t::update_mode = update_mode_t::two_pass;
+
+// compute the next time step while updating the cells
+bool inputs_t::fused_time_step = false;
+
+// time the tasks and report them at the end
+bool inputs_t::report_timers = true;
+
+// retry rejected steps with a smaller step size, before giving up
+size_t inputs_t::max_retries = 3;
+real_t inputs_t::retry_time_step_factor = 0.5;
+
 // the equation of state
 eos_t inputs_t::eos = 
   flecsale::eos::ideal_gas_t<real_t>( 
     /* gamma */ gamma, /* cv */ 1.0 
   ); 
 
+// the equations of state of some regions, by region number, e.g.
+//   { { 1, flecsale::eos::stiffened_gas_t<real_t>( 4.4, 1.0, 6.e8 ) } }
+eos_map_t inputs_t::region_eos = {};
+
 // this is a lambda function to set the initial conditions
 inputs_t::ics_function_t inputs_t::ics = 
   [g=gamma]( const vector_t & x, const real_t & )
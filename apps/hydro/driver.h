@@ -11,6 +11,10 @@
 // hydro includes
 #include "tasks.h"
 #include "types.h"
+#include "../common/benchmark.h"
+#include "../common/checkpoint.h"
+#include "../common/reductions.h"
+#include "../common/timers.h"
 
 // user includes
 #include <ristra/utils/time_utils.h>
@@ -110,15 +114,60 @@ int driver(int argc, char** argv)
   auto & context = flecsi::execution::context_t::instance();
   auto rank = context.color();
 
+  // in the benchmark mode, only the timings are written
+  auto benchmark_filename = apps::common::benchmark_filename();
+  auto is_benchmark = !benchmark_filename.empty();
+
+  // time the tasks if requested
+  auto & timers = apps::common::timer_registry_t::instance();
+  timers.enable( inputs_t::report_timers || is_benchmark );
+
+  // the update mode can be switched from the command line
+  update_mode_from_args( argc, argv, inputs_t::update_mode );
+
   //===========================================================================
   // Mesh Setup
   //===========================================================================
 
   // get the client handle 
   auto mesh = flecsi_get_client_handle(mesh_t, meshes, mesh0);
- 
+
   // cout << mesh;
-  
+
+  // the mesh never moves, so flatten its connectivity and geometry once
+  timed_execute_task( build_geometry_cache, apps::hydro, single, mesh );
+
+  // write the partitioned mesh as bundles that can be mapped straight into 
+  // memory, which only needs doing once per mesh and number of ranks, so 
+  // bundles that are still current are only checked against the mesh
+  std::string bundle_prefix = inputs_t::prefix, mesh_filename;
+  if ( apps::common::mesh_bundle_requested( 
+    argc, argv, bundle_prefix, mesh_filename 
+  ) ) {
+    auto bundle_char = flecsi_sp::utils::to_char_array( bundle_prefix );
+    if ( apps::common::is_mesh_bundle_current( 
+      bundle_prefix, mesh_filename, context.colors()
+    ) ) {
+      timed_execute_task( 
+        check_mesh_bundle, apps::hydro, single, mesh, bundle_char 
+      );
+      if ( rank == 0 )
+        cout << "The mesh bundles \"" << bundle_prefix 
+             << "_rank*.bundle\" are current." << endl;
+    }
+    else {
+      timed_execute_task( 
+        write_mesh_bundle, apps::hydro, single, mesh, bundle_char 
+      );
+      apps::common::commit_mesh_bundle( 
+        bundle_prefix, mesh_filename, context.colors()
+      );
+      if ( rank == 0 )
+        cout << "Wrote the mesh bundles \"" << bundle_prefix 
+             << "_rank*.bundle\"." << endl;
+    }
+  }
+
   //===========================================================================
   // Some typedefs
   //===========================================================================
@@ -156,19 +205,54 @@ int driver(int argc, char** argv)
   real_t soln_time{0};  
   size_t time_cnt{0}; 
 
-  // now call the main task to set the ics.  Here we set primitive/physical 
-  // quanties
-  flecsi_execute_task( 
-    initial_conditions, 
-    apps::hydro,
-    single, 
-    mesh, 
-    inputs_t::ics,
-    inputs_t::eos,
-    soln_time,
-    d, v, e, p, T, a
+  auto prefix_char = flecsi_sp::utils::to_char_array( inputs_t::prefix );
+ 	auto postfix_char =  flecsi_sp::utils::to_char_array( "exo" );
+  auto output_fields_char = 
+    flecsi_sp::utils::to_char_array( inputs_t::output_fields );
+  auto output_tolerances_char = 
+    flecsi_sp::utils::to_char_array( inputs_t::output_tolerances );
+  auto probes_char = flecsi_sp::utils::to_char_array( inputs_t::probes );
+  auto probe_fields_char = 
+    flecsi_sp::utils::to_char_array( inputs_t::probe_fields );
+
+  // assign the materials before any state is computed
+  timed_execute_task( 
+    setup_materials, apps::hydro, single, mesh, inputs_t::eos, 
+    inputs_t::region_eos
+  );
+
+  // resume from a checkpoint if requested, which replaces the ics
+  size_t restart_step{0};
+  auto is_restart = apps::common::restart_step( 
+    argc, argv, inputs_t::prefix, restart_step
   );
 
+  if ( is_restart ) {
+    auto local_future_info = timed_execute_task( 
+      read_checkpoint, apps::hydro, single, mesh, prefix_char, restart_step,
+      d, v, e, p, T, a
+    );
+    auto info = local_future_info.get();
+    soln_time = info.time;
+    time_cnt = info.step;
+    if ( rank == 0 )
+      cout << "Restarting from step " << time_cnt << " at time " 
+           << soln_time << "." << endl;
+  }
+  else {
+    // now call the main task to set the ics.  Here we set primitive/physical 
+    // quanties
+    timed_execute_task( 
+      initial_conditions, 
+      apps::hydro,
+      single, 
+      mesh, 
+      inputs_t::ics,
+      soln_time,
+      d, v, e, p, T, a
+    );
+  }
+
   #ifdef HAVE_CATALYST
     auto insitu = io::catalyst::adaptor_t(catalyst_scripts);
     std::cout << "Catalyst on!" << std::endl;
@@ -178,13 +262,10 @@ int driver(int argc, char** argv)
   // Pre-processing
   //===========================================================================
   
-  auto prefix_char = flecsi_sp::utils::to_char_array( inputs_t::prefix );
- 	auto postfix_char =  flecsi_sp::utils::to_char_array( "exo" );
-
-  // now output the solution
-  auto has_output = (inputs_t::output_freq > 0);
-  if (has_output) {
-    flecsi_execute_task(
+  // now output the solution, a restart already has it
+  auto has_output = (inputs_t::output_freq > 0 && !is_benchmark);
+  if (has_output && !is_restart) {
+    timed_execute_task(
       output,
  			apps::hydro,
  			single,
@@ -193,54 +274,193 @@ int driver(int argc, char** argv)
  			postfix_char,
 			time_cnt,
       soln_time,
+ 			inputs_t::output_buffers,
+ 			inputs_t::output_ranks_per_file,
+ 			output_fields_char,
+ 			inputs_t::output_compression,
+ 			output_tolerances_char,
  			d, v, e, p, T, a
     );
   }
 
+  // sample the probes, which a restart already has too
+  auto has_probes = 
+    (!inputs_t::probes.empty() && inputs_t::probe_freq > 0 && !is_benchmark);
+  if (has_probes && !is_restart) {
+    timed_execute_task(
+      sample_probes, apps::hydro, single, mesh, prefix_char, time_cnt, 
+      soln_time, probes_char, probe_fields_char, d, v, e, p, T, a
+    );
+  }
+
 
   // dump connectivity
   auto name = flecsi_sp::utils::to_char_array( inputs_t::prefix+".txt" );
-  auto f = flecsi_execute_task(print, apps::hydro, single, mesh, name);
-  f.wait();
+  if ( !is_benchmark ) {
+    auto f = timed_execute_task(print, apps::hydro, single, mesh, name);
+    f.wait();
+  }
 
   // start a clock
   auto tstart = ristra::utils::get_wall_time();
 
+  // the global time step and the smallest density or internal energy are 
+  // reduced without blocking, and only waited on right before they are
+  // needed
+  apps::common::reduction_bundle__<real_t, 2> step_reduction;
+
+  // decides when to write checkpoints
+  apps::common::checkpoint_schedule_t checkpoints( 
+    inputs_t::checkpoint_freq, inputs_t::checkpoint_interval
+  );
+
+  // the last step size
+  real_t time_step{0};
+
+  // a restart picks up the step count where it left off
+  auto first_step = time_cnt;
+
   //===========================================================================
   // Residual Evaluation
   //===========================================================================
 
   for ( 
-    size_t num_steps = 0;
+    size_t num_steps = first_step;
     (num_steps < inputs_t::max_steps && soln_time < inputs_t::final_time); 
     ++num_steps 
   ) {   
 
+    apps::common::scoped_timer_t step_timer( "step" );
+
     //-------------------------------------------------------------------------
-    // compute the time step
+    // start the time step reduction
+
+    // in the fused mode, the reduction was already started by the last
+    // update, otherwise the time step needs its own sweep over the cells
+    if ( !inputs_t::fused_time_step || num_steps == first_step ) {
+      auto local_future_time_step = timed_execute_task( 
+        evaluate_time_step, apps::hydro, single, mesh, d, v, e, p, T, a,
+        inputs_t::CFL, inputs_t::final_time - soln_time
+      );
+      step_reduction.reduce_min( 0, local_future_time_step.get() );
+      step_reduction.start();
+    }
 
-    // we dont need the time step yet
-    auto local_future_time_step = flecsi_execute_task( 
-      evaluate_time_step, apps::hydro, single, mesh, d, v, e, p, T, a,
-      inputs_t::CFL, inputs_t::final_time - soln_time
-    );
+    // save the state in case the step is rejected
+    if ( inputs_t::max_retries > 0 )
+      timed_execute_task( save_state, apps::hydro, single, mesh, 
+          d, v, e, p, T, a );
 
     //-------------------------------------------------------------------------
-    // try a timestep
-
-    // compute the fluxes
-    flecsi_execute_task( evaluate_fluxes, apps::hydro, single, mesh,
-        d, v, e, p, T, a, F );
- 
-    // now we need it
-    auto time_step =
-      flecsi::execution::context_t::instance().reduce_min(local_future_time_step);
-
-    // Loop over each cell, scattering the fluxes to the cell
-    flecsi_execute_task( 
-      apply_update, apps::hydro, single, mesh, inputs_t::eos,
-      time_step, F, d, v, e, p, T, a
-    );
+    // try a timestep, cutting it back and trying again if it fails
+
+    auto mode = mode_t::normal;
+    size_t num_retries = 0;
+
+    // wait for the reduction, only call this when the time step is needed.
+    // A retry uses the rejected time step instead, cut back.
+    auto get_time_step = [&]() {
+      if ( mode == mode_t::retry ) 
+        return time_step * inputs_t::retry_time_step_factor;
+      apps::common::scoped_timer_t timer( "reduce_time_step" );
+      return std::min( 
+        step_reduction.min(0), inputs_t::final_time - soln_time
+      );
+    };
+
+    do {
+
+      update_result_t result;
+
+      if ( inputs_t::update_mode == update_mode_t::fused ) {
+
+        // compute the fluxes and apply them one face color at a time
+        time_step = get_time_step();
+        auto local_future_result = timed_execute_task( 
+          evaluate_fluxes_and_update, apps::hydro, single, mesh, 
+          time_step, inputs_t::CFL, inputs_t::fused_time_step,
+          d, v, e, p, T, a
+        );
+        result = local_future_result.get();
+
+      }
+      else {
+
+        // compute the fluxes, starting with the faces that do not need ghost
+        // data.  Only the second pass waits on the ghost copy, which Legion 
+        // can run alongside the first one.  The MPI runtime still copies the
+        // ghosts, blocking, when the second pass is launched, so nothing 
+        // overlaps there.  The fluxes do not depend on the time step, so the
+        // reduction overlaps with them.  A retry restores the state they were
+        // computed from, so they are still good.
+        if ( mode == mode_t::normal ) {
+          timed_execute_task( evaluate_fluxes_interior, apps::hydro, single, 
+              mesh, d, v, e, p, T, a, F );
+          timed_execute_task( evaluate_fluxes_boundary, apps::hydro, single,
+              mesh, d, v, e, p, T, a, F );
+        }
+
+        // Loop over each cell, scattering the fluxes to the cell.  Again, 
+        // the cells that need ghost fluxes go last.
+        time_step = get_time_step();
+        auto local_future_interior_result = timed_execute_task( 
+          apply_update_interior, apps::hydro, single, mesh,
+          time_step, inputs_t::CFL, inputs_t::fused_time_step, 
+          F, d, v, e, p, T, a
+        );
+        auto local_future_boundary_result = timed_execute_task( 
+          apply_update_boundary, apps::hydro, single, mesh,
+          time_step, inputs_t::CFL, inputs_t::fused_time_step, 
+          F, d, v, e, p, T, a
+        );
+        result = local_future_interior_result.get();
+        result.combine( local_future_boundary_result.get() );
+
+      }
+
+      // the error check and the next time step share a single reduction
+      step_reduction.reduce_min( 1, result.min_value );
+      if ( inputs_t::fused_time_step ) 
+        step_reduction.reduce_min( 0, result.time_step );
+      step_reduction.start();
+
+      // every rank has to agree on whether the step is accepted
+      auto error = [&]() {
+        apps::common::scoped_timer_t timer( "check_update" );
+        return update_result_t::error( step_reduction.min(1) );
+      }();
+
+      if ( error == solution_error_t::ok ) {
+        mode = mode_t::normal;
+        continue;
+      }
+
+      if ( result.error() != solution_error_t::ok )
+        cerr << "Rank " << rank << ": cell " << result.worst_cell 
+             << " has a density or internal energy of " << result.min_value
+             << " with a step size of " << time_step << endl;
+
+      if ( num_retries < inputs_t::max_retries ) {
+        timed_execute_task( restore_state, apps::hydro, single, mesh, 
+            d, v, e, p, T, a );
+        num_retries++;
+        mode = mode_t::retry;
+        if ( rank == 0 )
+          cout << "Step rejected, retry " << num_retries << " of " 
+               << inputs_t::max_retries << " with a smaller step size." 
+               << endl;
+      }
+      else {
+        mode = mode_t::quit;
+      }
+
+    } while ( mode == mode_t::retry );
+
+    if ( mode == mode_t::quit )
+      throw_runtime_error( 
+        "Negative density or internal energy encountered after " <<
+        num_retries << " retries!" 
+      );
 
     //-------------------------------------------------------------------------
     // Post-process
@@ -249,6 +469,9 @@ int driver(int argc, char** argv)
     soln_time += time_step;
     time_cnt++;
 
+    // decide whether to write a checkpoint while the output is written
+    checkpoints.start( time_cnt );
+
     // output the time step
     if ( rank == 0 ) {
       cout << std::string(80, '=') << endl;
@@ -281,7 +504,7 @@ int driver(int argc, char** argv)
         )  
       ) 
     {
-      flecsi_execute_task(
+      timed_execute_task(
         output,
 	 			apps::hydro,
  				single,
@@ -290,10 +513,38 @@ int driver(int argc, char** argv)
  				postfix_char,
  				time_cnt,
         soln_time,
+ 				inputs_t::output_buffers,
+ 				inputs_t::output_ranks_per_file,
+ 				output_fields_char,
+ 				inputs_t::output_compression,
+ 				output_tolerances_char,
  				d, v, e, p, T, a
       );
     }
 
+    // sample the probes
+    if ( has_probes && time_cnt % inputs_t::probe_freq == 0 ) {
+      timed_execute_task(
+        sample_probes, apps::hydro, single, mesh, prefix_char, time_cnt, 
+        soln_time, probes_char, probe_fields_char, d, v, e, p, T, a
+      );
+    }
+
+    // write a checkpoint
+    if ( checkpoints.due() ) {
+      apps::common::checkpoint_info_t info;
+      info.step = time_cnt;
+      info.time = soln_time;
+      info.time_step = time_step;
+      auto f = timed_execute_task( 
+        write_checkpoint, apps::hydro, single, mesh, prefix_char, info,
+        inputs_t::checkpoint_compression,
+        d, v, e, p, T, a
+      );
+      f.wait();
+      apps::common::commit_checkpoint( inputs_t::prefix, time_cnt );
+      checkpoints.written();
+    }
 
   }
 
@@ -315,6 +566,27 @@ int driver(int argc, char** argv)
 
   }
 
+  // wait for the output written in the background
+  if ( has_output )
+    timed_execute_task( finish_output, apps::hydro, single );
+
+  if ( timers.enabled() )
+    timers.report( std::cout, inputs_t::prefix + "_timers.json" );
+
+  // the throughput is measured in zone-cycles per second, counting only the
+  // steps taken by this run
+  if ( is_benchmark ) {
+    auto local_future_num_cells = 
+      flecsi_execute_task( count_owned_cells, apps::hydro, single, mesh );
+    apps::common::reduction_bundle__<double, 0, 1> num_cells;
+    num_cells.reduce_sum( 0, local_future_num_cells.get() );
+    num_cells.start();
+    apps::common::report_throughput( 
+      std::cout, benchmark_filename, num_cells.sum(0), time_cnt - first_step, 
+      tdelta
+    );
+  }
+
 
   // success if you reached here
   return 0;
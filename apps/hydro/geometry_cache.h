@@ -0,0 +1,393 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief A flat cache of the face/cell topology and geometry used by the
+///        eulerian hydro solver.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// hydro includes
+#include "types.h"
+
+// system includes
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace apps {
+namespace hydro {
+
+//! the index used to flag entities that are not stored in the cache
+constexpr counter_t invalid_index = static_cast<counter_t>(-1);
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief A structure-of-arrays copy of the mesh connectivity and geometry.
+//!
+//! The eulerian mesh never moves, so everything the hot loops need from the
+//! mesh entities is extracted once and stored in contiguous arrays.  Faces
+//! are ordered as
+//!   - [0, num_local_faces) :  owned faces between two owned cells,
+//!   - [num_local_faces, num_interior_faces) :  owned faces between an owned
+//!     cell and a ghost cell,
+//!   - [num_interior_faces, num_owned_faces) : owned boundary faces,
+//!   - [num_owned_faces, num_faces) : non-owned faces that are only needed
+//!     for the geometry of the owned cells.
+//!
+//! Cells are ordered so that the first num_local_cells only have owned faces,
+//! and their faces are stored in a compressed-row list with a sign that is
+//! negative when the cell is on the left of the face.
+//!
+//! This ordering lets the tasks be split into a pass that needs no ghost data
+//! and a pass over the entities that are adjacent to ghosts.
+//!
+//! All the faces are also colored so that no two faces of the same color
+//! touch the same owned cell.  This allows fluxes to be scattered directly
+//! to the cells in parallel, one color at a time.  The faces of each cell
+//! are listed in the order of their colors, so gathering the face fluxes of
+//! a cell in list order adds them up in the same order as scattering them
+//! color by color.
+////////////////////////////////////////////////////////////////////////////////
+class geometry_cache_t {
+
+public:
+
+  //! the number of dimensions
+  static constexpr auto num_dimensions = mesh_t::num_dimensions;
+
+  //============================================================================
+  //! \brief Build the cache from the mesh.
+  //! \param [in] mesh  The mesh to extract the connectivity from.
+  //============================================================================
+  template< typename MESH >
+  void build( MESH & mesh )
+  {
+    clear();
+
+    // a map from mesh face ids to cache face ids
+    std::vector<counter_t> local_face( mesh.num_faces(), invalid_index );
+
+    // a function to add a face to the cache
+    auto add_face = [&]( const auto & f ) {
+      const auto & cells = mesh.cells(f);
+      local_face[ f.id() ] = face_id_.size();
+      face_id_.emplace_back( f.id() );
+      face_left_.emplace_back( cells[0].id() );
+      face_right_.emplace_back(
+        cells.size() == 2 ? cells[1].id() : cells[0].id()
+      );
+      const auto & n = f->normal();
+      for ( int d=0; d<num_dimensions; ++d )
+        face_normal_[d].emplace_back( n[d] );
+      face_area_.emplace_back( f->area() );
+    };
+
+    // a map from mesh cell ids to cache cell ids
+    std::vector<counter_t> local_cell( mesh.num_cells(), invalid_index );
+    const auto & cell_list = mesh.cells( flecsi::owned );
+    for ( auto c : cell_list ) local_cell[ c.id() ] = 0;
+
+    auto is_local = [&]( const auto & f ) {
+      const auto & cells = mesh.cells(f);
+      return 
+        cells.size() == 2 && 
+        local_cell[ cells[0].id() ] != invalid_index && 
+        local_cell[ cells[1].id() ] != invalid_index;
+    };
+
+    // owned faces come first, interior ones then boundary ones
+    const auto & face_list = mesh.faces( flecsi::owned );
+
+    for ( auto f : face_list )
+      if ( is_local( f ) ) add_face( f );
+    num_local_faces_ = face_id_.size();
+
+    for ( auto f : face_list )
+      if ( mesh.cells(f).size() == 2 && !is_local( f ) ) add_face( f );
+    num_interior_faces_ = face_id_.size();
+
+    for ( auto f : face_list )
+      if ( mesh.cells(f).size() != 2 ) add_face( f );
+    num_owned_faces_ = face_id_.size();
+
+    // now the cells, appending any faces that were not owned
+    cell_face_offsets_.emplace_back( 0 );
+
+    auto add_cell = [&]( const auto & c ) {
+
+      local_cell[ c.id() ] = cell_id_.size();
+      cell_id_.emplace_back( c.id() );
+      cell_volume_.emplace_back( c->volume() );
+
+      for ( auto f : mesh.faces(c) ) {
+        if ( local_face[ f.id() ] == invalid_index ) add_face( f );
+        cell_faces_.emplace_back( local_face[ f.id() ] );
+        auto is_left = ( mesh.cells(f)[0].id() == c.id() );
+        cell_face_sign_.emplace_back( is_left ? -1 : 1 );
+      }
+
+      cell_face_offsets_.emplace_back( cell_faces_.size() );
+
+    };
+
+    // the cells with only owned faces go first
+    auto has_owned_faces = [&]( const auto & c ) {
+      for ( auto f : mesh.faces(c) ) 
+        if ( local_face[ f.id() ] == invalid_index ) return false;
+      return true;
+    };
+
+    std::vector<bool> is_first( mesh.num_cells(), false );
+    for ( auto c : cell_list ) is_first[ c.id() ] = has_owned_faces( c );
+
+    for ( auto c : cell_list ) 
+      if ( is_first[ c.id() ] ) add_cell( c );
+    num_local_cells_ = cell_id_.size();
+
+    for ( auto c : cell_list ) 
+      if ( !is_first[ c.id() ] ) add_cell( c );
+
+    // map the face neighbors to cache cell indices
+    auto nfaces = num_faces();
+    face_left_cell_.reserve( nfaces );
+    face_right_cell_.reserve( nfaces );
+    for ( counter_t i=0; i<nfaces; ++i ) {
+      face_left_cell_.emplace_back( local_cell[ face_left_[i] ] );
+      face_right_cell_.emplace_back( 
+        face_right_[i] == face_left_[i] ? 
+          invalid_index : local_cell[ face_right_[i] ]
+      );
+    }
+
+    build_coloring();
+
+  }
+
+  //============================================================================
+  //! \brief Clear all the storage.
+  //============================================================================
+  void clear()
+  {
+    num_local_faces_ = 0;
+    num_interior_faces_ = 0;
+    num_owned_faces_ = 0;
+    num_local_cells_ = 0;
+    face_id_.clear();
+    face_left_.clear();
+    face_right_.clear();
+    for ( auto & n : face_normal_ ) n.clear();
+    face_area_.clear();
+    cell_id_.clear();
+    cell_volume_.clear();
+    cell_face_offsets_.clear();
+    cell_faces_.clear();
+    cell_face_sign_.clear();
+    face_left_cell_.clear();
+    face_right_cell_.clear();
+    color_offsets_.clear();
+    color_faces_.clear();
+  }
+
+  //============================================================================
+  // Face accessors
+  //============================================================================
+
+  //! \brief the total number of faces stored
+  counter_t num_faces() const { return face_id_.size(); }
+  //! \brief the number of owned faces with two owned neighbors
+  counter_t num_local_faces() const { return num_local_faces_; }
+  //! \brief the number of owned faces with two neighbors
+  counter_t num_interior_faces() const { return num_interior_faces_; }
+  //! \brief the number of owned faces
+  counter_t num_owned_faces() const { return num_owned_faces_; }
+
+  //! \brief the mesh id of face \e i
+  counter_t face_id( counter_t i ) const { return face_id_[i]; }
+  //! \brief the mesh id of the cell on the left of face \e i
+  counter_t face_left( counter_t i ) const { return face_left_[i]; }
+  //! \brief the mesh id of the cell on the right of face \e i
+  //! \remark For boundary faces, this is the left cell.
+  counter_t face_right( counter_t i ) const { return face_right_[i]; }
+  //! \brief the area of face \e i
+  real_t face_area( counter_t i ) const { return face_area_[i]; }
+  //! \brief the unit normal of face \e i
+  vector_t face_normal( counter_t i ) const
+  {
+    vector_t n;
+    for ( int d=0; d<num_dimensions; ++d ) n[d] = face_normal_[d][i];
+    return n;
+  }
+
+  //! \brief raw access to the face data
+  //! \{
+  const counter_t * face_id_data() const { return face_id_.data(); }
+  const counter_t * face_left_data() const { return face_left_.data(); }
+  const counter_t * face_right_data() const { return face_right_.data(); }
+  const real_t * face_area_data() const { return face_area_.data(); }
+  const real_t * face_normal_data( int d ) const
+  { return face_normal_[d].data(); }
+  //! \}
+
+  //============================================================================
+  // Cell accessors
+  //============================================================================
+
+  //! \brief the number of owned cells
+  counter_t num_cells() const { return cell_id_.size(); }
+  //! \brief the number of owned cells whose faces are all owned
+  counter_t num_local_cells() const { return num_local_cells_; }
+
+  //! \brief the mesh id of cell \e i
+  counter_t cell_id( counter_t i ) const { return cell_id_[i]; }
+  //! \brief the volume of cell \e i
+  real_t cell_volume( counter_t i ) const { return cell_volume_[i]; }
+
+  //! \brief the range of entries in the cell-to-face list for cell \e i
+  //! \{
+  counter_t cell_faces_begin( counter_t i ) const
+  { return cell_face_offsets_[i]; }
+  counter_t cell_faces_end( counter_t i ) const
+  { return cell_face_offsets_[i+1]; }
+  //! \}
+
+  //! \brief the cache face index of entry \e j of the cell-to-face list
+  counter_t cell_face( counter_t j ) const { return cell_faces_[j]; }
+  //! \brief the sign of entry \e j of the cell-to-face list
+  real_t cell_face_sign( counter_t j ) const { return cell_face_sign_[j]; }
+
+  //! \brief the cache index of the cell on the left/right of face \e i
+  //! \remark This is invalid_index when the cell is not owned, or when there
+  //!         is no cell on the right.
+  //! \{
+  counter_t face_left_cell( counter_t i ) const { return face_left_cell_[i]; }
+  counter_t face_right_cell( counter_t i ) const
+  { return face_right_cell_[i]; }
+  //! \}
+
+  //============================================================================
+  // Coloring accessors
+  //============================================================================
+
+  //! \brief the number of face colors
+  counter_t num_colors() const { return color_offsets_.size() - 1; }
+
+  //! \brief the range of entries in the color-to-face list for color \e c
+  //! \{
+  counter_t color_begin( counter_t c ) const { return color_offsets_[c]; }
+  counter_t color_end( counter_t c ) const { return color_offsets_[c+1]; }
+  //! \}
+
+  //! \brief the cache face index of entry \e k of the color-to-face list
+  counter_t color_face( counter_t k ) const { return color_faces_[k]; }
+
+private:
+
+  //============================================================================
+  //! \brief Greedily color the faces.
+  //!
+  //! Faces are visited in cache order and given the lowest color not already
+  //! used by another face of a neighboring owned cell.  The result only
+  //! depends on the mesh, so the scatter order is reproducible.
+  //============================================================================
+  void build_coloring()
+  {
+    auto nfaces = num_faces();
+    std::vector<counter_t> face_color( nfaces, invalid_index );
+    std::vector<bool> used;
+    counter_t ncolors = 0;
+
+    // mark the colors used by the faces of an owned cell
+    auto mark_used = [&]( counter_t c ) {
+      if ( c == invalid_index ) return;
+      for ( auto j=cell_faces_begin(c); j<cell_faces_end(c); ++j ) {
+        auto color = face_color[ cell_faces_[j] ];
+        if ( color != invalid_index ) used[color] = true;
+      }
+    };
+
+    for ( counter_t i=0; i<nfaces; ++i ) {
+      used.assign( ncolors+1, false );
+      mark_used( face_left_cell_[i] );
+      mark_used( face_right_cell_[i] );
+      counter_t color = 0;
+      while ( used[color] ) ++color;
+      face_color[i] = color;
+      ncolors = std::max( ncolors, color+1 );
+    }
+
+    // bucket the faces by color, keeping the cache order within a color
+    color_offsets_.assign( ncolors+1, 0 );
+    for ( auto color : face_color ) color_offsets_[color+1]++;
+    for ( counter_t c=0; c<ncolors; ++c ) 
+      color_offsets_[c+1] += color_offsets_[c];
+
+    color_faces_.resize( nfaces );
+    auto pos = color_offsets_;
+    for ( counter_t i=0; i<nfaces; ++i ) 
+      color_faces_[ pos[ face_color[i] ]++ ] = i;
+
+    // list the faces of each cell by color, the faces of a cell all have
+    // different colors
+    std::vector< std::pair<counter_t, real_t> > sorted;
+    for ( counter_t c=0; c<num_cells(); ++c ) {
+      auto jbegin = cell_faces_begin(c);
+      auto jend = cell_faces_end(c);
+      sorted.clear();
+      for ( auto j=jbegin; j<jend; ++j )
+        sorted.emplace_back( cell_faces_[j], cell_face_sign_[j] );
+      std::sort( 
+        sorted.begin(), sorted.end(),
+        [&]( const auto & a, const auto & b ) 
+        { return face_color[a.first] < face_color[b.first]; }
+      );
+      for ( auto j=jbegin; j<jend; ++j ) {
+        cell_faces_[j] = sorted[j-jbegin].first;
+        cell_face_sign_[j] = sorted[j-jbegin].second;
+      }
+    }
+  }
+
+  //============================================================================
+  // Private data
+  //============================================================================
+
+  //! the face partition sizes
+  counter_t num_local_faces_ = 0;
+  counter_t num_interior_faces_ = 0;
+  counter_t num_owned_faces_ = 0;
+
+  //! the cell partition size
+  counter_t num_local_cells_ = 0;
+
+  //! the face data
+  std::vector<counter_t> face_id_;
+  std::vector<counter_t> face_left_;
+  std::vector<counter_t> face_right_;
+  std::array< std::vector<real_t>, num_dimensions > face_normal_;
+  std::vector<real_t> face_area_;
+
+  //! the cell data
+  std::vector<counter_t> cell_id_;
+  std::vector<real_t> cell_volume_;
+
+  //! the cell-to-face list
+  std::vector<counter_t> cell_face_offsets_;
+  std::vector<counter_t> cell_faces_;
+  std::vector<real_t> cell_face_sign_;
+
+  //! the face-to-owned-cell map
+  std::vector<counter_t> face_left_cell_;
+  std::vector<counter_t> face_right_cell_;
+
+  //! the color-to-face list
+  std::vector<counter_t> color_offsets_;
+  std::vector<counter_t> color_faces_;
+
+};
+
+} // namespace hydro
+} // namespace apps
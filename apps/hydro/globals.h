@@ -0,0 +1,55 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Define the global data for the hydro solver.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// user includes
+#include "geometry_cache.h"
+#include "types.h"
+#include "../common/materials.h"
+#include "../common/output.h"
+#include "../common/probes.h"
+
+#include <flecsale/io/io_exodus.h>
+
+// system includes
+#include <tuple>
+#include <vector>
+
+
+namespace apps {
+namespace hydro {
+
+namespace globals {
+
+// the flattened mesh connectivity and geometry
+geometry_cache_t geometry;
+
+// the per-cell flux accumulators used by the fused update
+std::vector<flux_data_t> cell_delta_u;
+
+// the cell states at the start of the step, restored if it is rejected
+std::vector< std::tuple<real_t, vector_t, real_t, real_t, real_t, real_t> >
+  saved_state;
+
+// the solution output, which stays open for the whole run
+apps::common::aggregated_output__< flecsale::io::exodus_writer__<mesh_t> >
+  solution_output;
+
+// the probes, which sample the solution at a few points every so often
+apps::common::probes__<mesh_t> probes;
+
+// the material of each cell, and the equation of state of each material
+apps::common::materials__<eos_t> materials;
+
+
+} // namespace
+
+} // namespace
+} // namespace
@@ -10,7 +10,11 @@
 #pragma once
 
 // hydro includes
+#include "globals.h"
 #include "types.h"
+#include "../common/checkpoint.h"
+#include "../common/eos_block.h"
+#include "../common/mesh_bundle.h"
 
 // flecsi includes
 #include <flecsale/io/io_exodus.h>
@@ -19,7 +23,12 @@
 #include <ristra/utils/string_utils.h>
 
 // system includes
+#include <array>
 #include <iomanip>
+#include <map>
+#include <limits>
+#include <tuple>
+#include <vector>
 
 namespace apps {
 namespace hydro {
@@ -34,7 +43,6 @@ namespace hydro {
 void initial_conditions( 
   client_handle_r__<mesh_t>  mesh,
   inputs_t::ics_function_t ics, 
-  eos_t eos,
   real_t soln_time,
   dense_handle_w__<real_t> d,
   dense_handle_w__<vector_t> v,
@@ -50,12 +58,221 @@ void initial_conditions(
     std::tie( d(c), v(c), p(c) ) = ics( c->centroid(), soln_time );
     eqns_t::update_state_from_pressure( 
       pack( c, d, v, p, e, T, a ),
-      eos
+      globals::materials.eos_of( c.id() )
     );
   }
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Assign the materials to the cells.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] eos  the default equation of state
+//! \param [in] region_eos  the equations of state of some regions
+////////////////////////////////////////////////////////////////////////////////
+void setup_materials( 
+  client_handle_r__<mesh_t>  mesh,
+  eos_t eos,
+  eos_map_t region_eos
+) {
+  globals::materials.setup( mesh, eos, region_eos );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Build the flattened connectivity and geometry used by the solver.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void build_geometry_cache( 
+  client_handle_r__<mesh_t>  mesh
+) {
+  globals::geometry.build( mesh );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the inverse of the time step allowed by a single cell.
+//!
+//! \param [in] i  the cache index of the cell
+//! \param [in] u  the cell state
+//! \return the largest wave speed over length scale of the cell faces
+////////////////////////////////////////////////////////////////////////////////
+template< typename U >
+real_t evaluate_cell_time_step_inverse( counter_t i, U && u )
+{
+  const auto & geom = globals::geometry;
+  auto vol = geom.cell_volume(i);
+
+  real_t dt_inv(0);
+
+  // loop over each face
+  auto jend = geom.cell_faces_end(i);
+  for ( auto j = geom.cell_faces_begin(i); j < jend; ++j ) {
+    auto f = geom.cell_face(j);
+    // estimate the length scale normal to the face
+    auto delta_x = vol / geom.face_area(f);
+    // compute the inverse of the time scale
+    auto dti = 
+      eqns_t::fastest_wavespeed( u, geom.face_normal(f) ) / delta_x;
+    // check for the maximum value
+    dt_inv = std::max( dti, dt_inv );
+  } // edge
+
+  return dt_inv;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Convert the maximum inverse time scale into a time step.
+//!
+//! \param [in] dt_inv  the maximum inverse time scale
+//! \param [in] CFL  the CFL number
+//! \return the time step size
+////////////////////////////////////////////////////////////////////////////////
+real_t time_step_from_inverse( real_t dt_inv, real_t CFL )
+{
+  if ( dt_inv <= 0 ) 
+    throw_runtime_error( "infinite delta t" );
+
+  real_t time_step = 1 / dt_inv;
+  time_step *= CFL;
+  return time_step;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The value a cell state is checked against for positivity.
+//!
+//! \param [in] u  the cell state
+//! \return the smaller of the density and internal energy, or the lowest 
+//!         possible value if either is nan
+////////////////////////////////////////////////////////////////////////////////
+template< typename U >
+real_t positivity_value( U && u )
+{
+  auto d = eqns_t::density(u);
+  auto e = eqns_t::internal_energy(u);
+  return ( d == d && e == e ) ? 
+    std::min( d, e ) : std::numeric_limits<real_t>::lowest();
+}
+
+//! the cell states gathered for the equation of state
+using eos_block_t = apps::common::eos_block__<real_t, eos_t::hint_t>;
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Add a cell state to a block for the equation of state.
+//!
+//! \param [in,out] block  the block
+//! \param [in] cell  the mesh id of the cell
+//! \param [in] u  the cell state
+////////////////////////////////////////////////////////////////////////////////
+template< typename U >
+void push_eos_state( eos_block_t & block, counter_t cell, U && u )
+{
+  const auto & materials = globals::materials;
+  if ( materials.has_hints() )
+    block.push_back( 
+      eqns_t::density(u), eqns_t::internal_energy(u),
+      materials.material( cell ), materials.hint( cell )
+    );
+  else
+    block.push_back( 
+      eqns_t::density(u), eqns_t::internal_energy(u),
+      materials.material( cell )
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Store the equation of state results of a block of cells, and check 
+//!        their updated states.
+//!
+//! \param [in] begin,end  the range of cache cells in the block
+//! \param [in] block  the block, with the equation of state evaluated
+//! \param [in] next_time_step  if true, also compute the next time step
+//! \param [in,out] dt_inv  the largest inverse time scale
+//! \param [in,out] min_value  the smallest positivity value
+////////////////////////////////////////////////////////////////////////////////
+template< 
+  typename D, typename V, typename E, typename P, typename TT, typename A
+>
+void finish_eos_block( 
+  counter_t begin, 
+  counter_t end, 
+  const eos_block_t & block,
+  bool next_time_step,
+  real_t & dt_inv,
+  real_t & min_value,
+  D & d, V & v, E & e, P & p, TT & T, A & a
+) {
+  const auto & geom = globals::geometry;
+  const auto & materials = globals::materials;
+
+  for ( auto cit = begin; cit < end; ++cit ) {
+
+    auto j = cit - begin;
+    auto c = geom.cell_id(cit);
+    auto u = pack(c, d, v, p, e, T, a);
+    if ( block.has_hints ) materials.hint( c ) = block.hint[j];
+    eqns_t::pressure(u) = block.pressure[j];
+    eqns_t::temperature(u) = block.temperature[j];
+    eqns_t::sound_speed(u) = block.sound_speed[j];
+
+    // check the solution quantities, the driver decides what to do
+    min_value = std::min( positivity_value( u ), min_value );
+
+    // the state is already at hand, so get the next time step while here
+    if ( next_time_step )
+      dt_inv = std::max( evaluate_cell_time_step_inverse( cit, u ), dt_inv );
+
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Build the result of updating a range of cells.
+//!
+//! The cells only record their smallest positivity value, so the update 
+//! loops stay free of branches that can throw.  Only when that value is bad
+//! are the cells searched again for the offending one.
+//!
+//! \param [in] begin,end  the range of cache cells
+//! \param [in] dt_inv  the maximum inverse time scale of the cells
+//! \param [in] min_value  the smallest positivity value of the cells
+//! \param [in] next_time_step  if true, set the next time step
+//! \param [in] CFL  the CFL number
+//! \return the update result
+////////////////////////////////////////////////////////////////////////////////
+template< 
+  typename D, typename V, typename E, typename P, typename TT, typename A
+>
+update_result_t make_update_result( 
+  counter_t begin, 
+  counter_t end, 
+  real_t dt_inv, 
+  real_t min_value,
+  bool next_time_step,
+  real_t CFL,
+  D & d, V & v, E & e, P & p, TT & T, A & a
+) {
+
+  const auto & geom = globals::geometry;
+
+  update_result_t result;
+  result.min_value = min_value;
+
+  if ( result.error() != solution_error_t::ok ) {
+    for ( counter_t cit = begin; cit < end; ++cit ) {
+      auto c = geom.cell_id(cit);
+      if ( positivity_value( pack(c, d, v, p, e, T, a) ) == min_value ) {
+        result.worst_cell = c;
+        break;
+      }
+    }
+  }
+  else if ( next_time_step && end > begin ) {
+    result.time_step = time_step_from_inverse( dt_inv, CFL );
+  }
+
+  return result;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief The main task to compute the time step size.
@@ -66,42 +283,35 @@ void initial_conditions(
 ////////////////////////////////////////////////////////////////////////////////
 real_t evaluate_time_step(
   client_handle_r__<mesh_t> mesh,
-  dense_handle_r__<real_t> d,
-  dense_handle_r__<vector_t> v,
-  dense_handle_r__<real_t> e,
-  dense_handle_r__<real_t> p,
-  dense_handle_r__<real_t> T,
-  dense_handle_r__<real_t> a,
+  dense_handle_interior_r__<real_t> d,
+  dense_handle_interior_r__<vector_t> v,
+  dense_handle_interior_r__<real_t> e,
+  dense_handle_interior_r__<real_t> p,
+  dense_handle_interior_r__<real_t> T,
+  dense_handle_interior_r__<real_t> a,
   real_t CFL,
   real_t max_dt
 ) {
  
+  const auto & geom = globals::geometry;
+  auto num_cells = geom.num_cells();
+
   // Loop over each cell, computing the minimum time step,
   // which is also the maximum 1/dt
   real_t dt_inv(0);
 
-  for ( auto c : mesh.cells( flecsi::owned ) ) {
+  #pragma omp parallel for reduction(max:dt_inv)
+  for ( counter_t i = 0; i < num_cells; ++i ) {
 
     // get the solution state
-    auto u = pack( c, d, v, p, e, T, a );
-
-    // loop over each face
-    for ( auto f : mesh.faces(c) ) {
-      // estimate the length scale normal to the face
-      auto delta_x = c->volume() / f->area();
-      // compute the inverse of the time scale
-      auto dti = eqns_t::fastest_wavespeed( u, f->normal() ) / delta_x;
-      // check for the maximum value
-      dt_inv = std::max( dti, dt_inv );
-    } // edge
+    auto u = pack( geom.cell_id(i), d, v, p, e, T, a );
 
-  } // cell
+    // check for the maximum value
+    dt_inv = std::max( evaluate_cell_time_step_inverse( i, u ), dt_inv );
 
-  if ( dt_inv <= 0 ) 
-    throw_runtime_error( "infinite delta t" );
+  } // cell
 
-  real_t time_step = 1 / dt_inv;
-  time_step *= CFL;
+  auto time_step = time_step_from_inverse( dt_inv, CFL );
 
   // access the computed time step and make sure its not too large
   time_step = std::min( time_step, max_dt );
@@ -110,52 +320,150 @@ real_t evaluate_time_step(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to evaluate fluxes at each face.
+//! \brief Evaluate the fluxes of up to a simd width of faces with two 
+//!        neighbors.
+//!
+//! Every face with two neighbors goes through this batch kernel, however 
+//! the faces are grouped, so a face flux is the same in either update mode.
+//! The unused lanes repeat the last face.
+//!
+//! \param [in] faces  the cache faces
+//! \param [in] num_faces  the number of faces, at most the simd width
+//! \param [in] d,v,e,p,a  the cell state
+//! \return the face fluxes, scaled by the face areas
+////////////////////////////////////////////////////////////////////////////////
+template< typename D, typename V, typename E, typename P, typename A >
+std::array< flux_data_t, simd_t::width > evaluate_flux_batch( 
+  const counter_t * faces, counter_t num_faces,
+  D & d, V & v, E & e, P & p, A & a
+) {
+
+  const auto & geom = globals::geometry;
+  constexpr counter_t width = simd_t::width;
+
+  // gather the face data
+  counter_t left[width], right[width];
+  real_t normal[mesh_t::num_dimensions][width], area[width];
+  for ( counter_t l=0; l<width; ++l ) {
+    auto fit = faces[ std::min( l, num_faces-1 ) ];
+    left[l] = geom.face_left(fit);
+    right[l] = geom.face_right(fit);
+    for ( int i=0; i<mesh_t::num_dimensions; ++i )
+      normal[i][l] = geom.face_normal_data(i)[fit];
+    area[l] = geom.face_area(fit);
+  }
+
+  // get the left and right states
+  auto w_left = gather_batch( left, d, v, p, e, a );
+  auto w_right = gather_batch( right, d, v, p, e, a );
+
+  batch_vector_t n;
+  for ( int i=0; i<mesh_t::num_dimensions; ++i )
+    n[i] = simd_t::load( normal[i] );
+    
+  // compute the face fluxes
+  auto f = flux_function_batch<eqns_t>( w_left, w_right, n );
+
+  // scale the flux by the face area
+  auto area_batch = simd_t::load( area );
+  std::array< flux_data_t, width > flux;
+  real_t tmp[width];
+  for ( int i=0; i<f.size(); ++i ) {
+    ( f[i] * area_batch ).store( tmp );
+    for ( counter_t l=0; l<width; ++l ) flux[l][i] = tmp[l];
+  }
+
+  return flux;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the fluxes for a range of faces with two neighbors.
+//!
+//! \param [in] begin,end  the range of cache faces
+//! \param [in] d,v,e,p,T,a  the cell state
+//! \param [out] flux  the face fluxes
+////////////////////////////////////////////////////////////////////////////////
+template< 
+  typename D, typename V, typename E, typename P, typename TT, typename A,
+  typename F
+>
+void evaluate_interior_fluxes( 
+  counter_t begin, counter_t end, 
+  D & d, V & v, E & e, P & p, TT & T, A & a, F & flux 
+) {
+
+  const auto & geom = globals::geometry;
+
+  // faces in batches of simd width, the last one may be partial
+  constexpr counter_t width = simd_t::width;
+  auto num_batches = (end - begin + width - 1) / width;
+
+  #pragma omp parallel for
+  for ( counter_t b = 0; b < num_batches; ++b )
+  {
+
+    auto fit = begin + b * width;
+    auto num_faces = std::min<counter_t>( width, end - fit );
+
+    counter_t faces[width];
+    for ( counter_t l=0; l<num_faces; ++l ) faces[l] = fit + l;
+
+    auto f = evaluate_flux_batch( faces, num_faces, d, v, e, p, a );
+    for ( counter_t l=0; l<num_faces; ++l )
+      flux( geom.face_id(fit+l) ) = f[l];
+
+  } // for
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The main task to evaluate fluxes at the faces that do not need 
+//!        ghost data.
+//!
+//! The state is accessed without ghosts, so launching this task does not 
+//! wait on the ghost copy.  Whether the copy actually runs alongside it is 
+//! up to the runtime: Legion defers it, the MPI runtime does it, blocking, 
+//! when the boundary task is launched.
 //!
 //! \param [in,out] mesh the mesh object
 //! \return 0 for success
 ////////////////////////////////////////////////////////////////////////////////
-void evaluate_fluxes( 
+void evaluate_fluxes_interior( 
   client_handle_r__<mesh_t> mesh,
-  dense_handle_r__<real_t> d,
-  dense_handle_r__<vector_t> v,
-  dense_handle_r__<real_t> e,
-  dense_handle_r__<real_t> p,
-  dense_handle_r__<real_t> T,
-  dense_handle_r__<real_t> a,
-  dense_handle_w__<flux_data_t> flux
+  dense_handle_interior_r__<real_t> d,
+  dense_handle_interior_r__<vector_t> v,
+  dense_handle_interior_r__<real_t> e,
+  dense_handle_interior_r__<real_t> p,
+  dense_handle_interior_r__<real_t> T,
+  dense_handle_interior_r__<real_t> a,
+  dense_handle_interior_w__<flux_data_t> flux
 ) {
 
-  const auto & face_list = mesh.faces( flecsi::owned );
-  auto num_faces = face_list.size();
+  const auto & geom = globals::geometry;
+  auto num_interior = geom.num_interior_faces();
+  auto num_faces = geom.num_owned_faces();
+
+  //----------------------------------------------------------------------------
+  // faces between owned cells
+  evaluate_interior_fluxes( 
+    0, geom.num_local_faces(), d, v, e, p, T, a, flux
+  );
 
+  //----------------------------------------------------------------------------
+  // boundary faces
   #pragma omp parallel for
-  for ( counter_t fit = 0; fit < num_faces; ++fit )
+  for ( counter_t fit = num_interior; fit < num_faces; ++fit )
   {
 
-    const auto & f = face_list[fit];
-    
-    // get the cell neighbors
-    const auto & cells = mesh.cells(f);
-    auto num_cells = cells.size();
-
     // get the left state
-    auto w_left = pack( cells[0], d, v, p, e, T, a );
+    auto w_left = pack( geom.face_left(fit), d, v, p, e, T, a );
     
     // compute the face flux
-    //
-    // interior cell
-    if ( num_cells == 2 ) {
-      auto w_right = pack( cells[1], d, v, p, e, T, a );
-      flux(f) = flux_function<eqns_t>( w_left, w_right, f->normal() );
-    } 
-    // boundary cell
-    else {
-      flux(f) = boundary_flux<eqns_t>( w_left, f->normal() );
-    }
+    auto & flux_f = flux( geom.face_id(fit) );
+    flux_f = boundary_flux<eqns_t>( w_left, geom.face_normal(fit) );
    
     // scale the flux by the face area
-    flux(f) *= f->area();
+    flux_f *= geom.face_area(fit);
 
   } // for
   //----------------------------------------------------------------------------
@@ -163,28 +471,192 @@ void evaluate_fluxes(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief Perform a reduction to get the time step
+//! \brief The main task to evaluate fluxes at the faces that need ghost data.
+//!
+//! \param [in,out] mesh the mesh object
+//! \return 0 for success
+////////////////////////////////////////////////////////////////////////////////
+void evaluate_fluxes_boundary( 
+  client_handle_r__<mesh_t> mesh,
+  dense_handle_r__<real_t> d,
+  dense_handle_r__<vector_t> v,
+  dense_handle_r__<real_t> e,
+  dense_handle_r__<real_t> p,
+  dense_handle_r__<real_t> T,
+  dense_handle_r__<real_t> a,
+  dense_handle_interior_w__<flux_data_t> flux
+) {
+
+  const auto & geom = globals::geometry;
+
+  // faces between an owned and a ghost cell
+  evaluate_interior_fluxes( 
+    geom.num_local_faces(), geom.num_interior_faces(), d, v, e, p, T, a, flux
+  );
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Update the solution in a range of cells.
+//!
+//! \param [in] begin,end  the range of cache cells
+//! \param [in] next_time_step  if true, also compute the next time step from
+//!                             the updated state
+//! \param [in] CFL  the CFL number
+//! \return the update result
 ////////////////////////////////////////////////////////////////////////////////
-void gather_time_step(
-  future_handle__<real_t> local_time_step,
-  global_handle_w__<real_t> time_step
+template< 
+  typename F, typename D, typename V, typename E, typename P, typename TT,
+  typename A
+>
+update_result_t update_cells( 
+  counter_t begin, 
+  counter_t end, 
+  real_t delta_t,
+  bool next_time_step,
+  real_t CFL,
+  F & flux, D & d, V & v, E & e, P & p, TT & T, A & a
 ) {
 
-  auto dt = flecsi::execution::context_t::instance().reduce_min(local_time_step);
-  time_step = 0.;
+  const auto & geom = globals::geometry;
+  const auto & materials = globals::materials;
+
+  real_t dt_inv(0);
+  real_t min_value = std::numeric_limits<real_t>::max();
+
+  #pragma omp parallel for reduction(max:dt_inv) reduction(min:min_value)
+  for ( counter_t bit = begin; bit < end; bit += eos_block_t::capacity )
+  {
+
+    auto bend = std::min<counter_t>( bit + eos_block_t::capacity, end );
+    eos_block_t block;
+
+    for ( auto cit = bit; cit < bend; ++cit ) {
+
+      // initialize the update
+      flux_data_t delta_u( 0 );
+
+      // loop over each connected edge, adding the contribution to this cell
+      auto jend = geom.cell_faces_end(cit);
+      for ( auto j = geom.cell_faces_begin(cit); j < jend; ++j ) {
+        auto f = geom.cell_face(j);
+        if ( geom.cell_face_sign(j) < 0 )
+          delta_u -= flux( geom.face_id(f) );
+        else
+          delta_u += flux( geom.face_id(f) );
+      } // edge
+
+      // now compute the final update
+      delta_u *= delta_t/geom.cell_volume(cit);
+
+      // apply the update
+      auto c = geom.cell_id(cit);
+      auto u = pack(c, d, v, p, e, T, a);
+      eqns_t::update_state_from_flux( u, delta_u );
+      push_eos_state( block, c, u );
+
+    } // cell
+
+    // update the rest of the quantities for the whole block at once
+    block.compute_state_de( materials.eos() );
+    finish_eos_block( 
+      bit, bend, block, next_time_step, dt_inv, min_value, d, v, e, p, T, a
+    );
+
+  } // block
+
+  return make_update_result( 
+    begin, end, dt_inv, min_value, next_time_step, CFL, d, v, e, p, T, a
+  );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to update the solution in each cell.
+//! \brief The main task to update the solution in the cells that do not need
+//!        ghost fluxes.
 //!
 //! \param [in,out] mesh the mesh object
-//! \return 0 for success
+//! \param [in] next_time_step  if true, also compute the next time step from
+//!                             the updated state
+//! \return the update result, with the next local time step size if requested
 ////////////////////////////////////////////////////////////////////////////////
-void apply_update( 
+update_result_t apply_update_interior( 
+  client_handle_r__<mesh_t> mesh,
+  real_t delta_t,
+  real_t CFL,
+  bool next_time_step,
+  dense_handle_interior_r__<flux_data_t> flux,
+  dense_handle_interior_rw__<real_t> d,
+  dense_handle_interior_rw__<vector_t> v,
+  dense_handle_interior_rw__<real_t> e,
+  dense_handle_interior_rw__<real_t> p,
+  dense_handle_interior_rw__<real_t> T,
+  dense_handle_interior_rw__<real_t> a
+) {
+
+  const auto & geom = globals::geometry;
+
+  return update_cells( 
+    0, geom.num_local_cells(), delta_t, next_time_step, CFL,
+    flux, d, v, e, p, T, a
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The main task to update the solution in the cells that need 
+//!        ghost fluxes.
+//!
+//! Only the fluxes are accessed with ghosts, so the cell state is not 
+//! exchanged again.
+//!
+//! \param [in,out] mesh the mesh object
+//! \param [in] next_time_step  if true, also compute the next time step from
+//!                             the updated state
+//! \return the update result, with the next local time step size if requested
+////////////////////////////////////////////////////////////////////////////////
+update_result_t apply_update_boundary( 
   client_handle_r__<mesh_t> mesh,
-  eos_t eos,
   real_t delta_t,
+  real_t CFL,
+  bool next_time_step,
   dense_handle_r__<flux_data_t> flux,
+  dense_handle_interior_rw__<real_t> d,
+  dense_handle_interior_rw__<vector_t> v,
+  dense_handle_interior_rw__<real_t> e,
+  dense_handle_interior_rw__<real_t> p,
+  dense_handle_interior_rw__<real_t> T,
+  dense_handle_interior_rw__<real_t> a
+) {
+
+  const auto & geom = globals::geometry;
+
+  return update_cells( 
+    geom.num_local_cells(), geom.num_cells(), delta_t, next_time_step, CFL,
+    flux, d, v, e, p, T, a
+  );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the face fluxes and scatter them straight to the cells.
+//!
+//! This fuses evaluate_fluxes and apply_update.  The faces are processed one
+//! color at a time, so no two faces in flight touch the same owned cell, and
+//! the fluxes are accumulated per cell instead of being stored per face.
+//! Faces that are not owned are recomputed from the ghost states.  The
+//! fluxes come from the same kernels as the two-pass mode, and each cell
+//! adds up its faces in the same order, so both modes give the same answer
+//! bit for bit.
+//!
+//! \param [in,out] mesh the mesh object
+//! \param [in] next_time_step  if true, also compute the next time step from
+//!                             the updated state
+//! \return the update result, with the next local time step size if requested
+////////////////////////////////////////////////////////////////////////////////
+update_result_t evaluate_fluxes_and_update( 
+  client_handle_r__<mesh_t> mesh,
+  real_t delta_t,
+  real_t CFL,
+  bool next_time_step,
   dense_handle_rw__<real_t> d,
   dense_handle_rw__<vector_t> v,
   dense_handle_rw__<real_t> e,
@@ -193,55 +665,159 @@ void apply_update(
   dense_handle_rw__<real_t> a
 ) {
 
-  //----------------------------------------------------------------------------
-  // Loop over each cell, scattering the fluxes to the cell
+  const auto & geom = globals::geometry;
+  auto num_cells = geom.num_cells();
+  auto num_colors = geom.num_colors();
+  const auto & materials = globals::materials;
 
+  auto & delta_u = globals::cell_delta_u;
+  delta_u.assign( num_cells, flux_data_t(0) );
 
-  //auto delta_t = static_cast<real_t>( time_step );
+  //----------------------------------------------------------------------------
+  // Loop over each color, scattering the face fluxes to the cells
+  constexpr counter_t width = simd_t::width;
 
-  const auto & cell_list = mesh.cells( flecsi::owned );
-  auto num_cells = cell_list.size();
+  // add the contribution of a face to its owned neighbors
+  auto scatter = [&]( counter_t fit, const flux_data_t & flux_f ) {
+    auto left_cell = geom.face_left_cell(fit);
+    auto right_cell = geom.face_right_cell(fit);
+    if ( left_cell != invalid_index ) delta_u[left_cell] -= flux_f;
+    if ( right_cell != invalid_index ) delta_u[right_cell] += flux_f;
+  };
 
-  #pragma omp parallel for
-  for ( counter_t cit = 0; cit < num_cells; ++cit )
+  for ( counter_t color = 0; color < num_colors; ++color )
   {
 
-    const auto & c = cell_list[cit];
+    auto kbegin = geom.color_begin(color);
+    auto kend = geom.color_end(color);
+    auto num_batches = (kend - kbegin + width - 1) / width;
 
-    // initialize the update
-    flux_data_t delta_u( 0 );
+    #pragma omp parallel for
+    for ( counter_t b = 0; b < num_batches; ++b )
+    {
 
-    // loop over each connected edge
-    for ( auto f : mesh.faces(c) ) {
-      
-      // get the cell neighbors
-      auto neigh = mesh.cells(f);
-      auto num_neigh = neigh.size();
+      auto kbatch = kbegin + b * width;
+      auto kbatch_end = std::min<counter_t>( kbatch + width, kend );
 
-      // add the contribution to this cell only
-      if ( neigh[0] == c )
-        delta_u -= flux(f);
-      else
-        delta_u += flux(f);
+      // boundary faces are done right away, the others are batched
+      counter_t faces[width];
+      counter_t num_faces = 0;
 
-    } // edge
+      for ( auto k = kbatch; k < kbatch_end; ++k ) {
+        auto fit = geom.color_face(k);
+        auto left = geom.face_left(fit);
+        if ( geom.face_right(fit) != left ) {
+          faces[num_faces++] = fit;
+          continue;
+        }
+        auto w_left = pack( left, d, v, p, e, T, a );
+        auto flux_f = boundary_flux<eqns_t>( w_left, geom.face_normal(fit) );
+        flux_f *= geom.face_area(fit);
+        scatter( fit, flux_f );
+      }
 
-    // now compute the final update
-    delta_u *= delta_t/c->volume();
+      if ( num_faces == 0 ) continue;
 
-    // apply the update
-    auto u = pack(c, d, v, p, e, T, a);
-    eqns_t::update_state_from_flux( u, delta_u );
+      auto f = evaluate_flux_batch( faces, num_faces, d, v, e, p, a );
+      for ( counter_t l=0; l<num_faces; ++l ) scatter( faces[l], f[l] );
 
-    // update the rest of the quantities
-    eqns_t::update_state_from_energy( u, eos );
+    } // face
 
-    // check the solution quantities
-    if ( eqns_t::internal_energy(u) < 0 || eqns_t::density(u) < 0 ) 
-      throw_runtime_error( "Negative density or internal energy encountered!" );
+  } // color
+  
+  //----------------------------------------------------------------------------
+  // Loop over each cell, applying the accumulated update
 
-  } // for
+  real_t dt_inv(0);
+  real_t min_value = std::numeric_limits<real_t>::max();
+
+  #pragma omp parallel for reduction(max:dt_inv) reduction(min:min_value)
+  for ( counter_t bit = 0; bit < num_cells; bit += eos_block_t::capacity )
+  {
+
+    auto bend = std::min<counter_t>( bit + eos_block_t::capacity, num_cells );
+    eos_block_t block;
+
+    for ( auto cit = bit; cit < bend; ++cit ) {
+
+      // now compute the final update
+      auto & delta_u_c = delta_u[cit];
+      delta_u_c *= delta_t/geom.cell_volume(cit);
+
+      // apply the update
+      auto c = geom.cell_id(cit);
+      auto u = pack(c, d, v, p, e, T, a);
+      eqns_t::update_state_from_flux( u, delta_u_c );
+      push_eos_state( block, c, u );
+
+    } // cell
+
+    // update the rest of the quantities for the whole block at once
+    block.compute_state_de( materials.eos() );
+    finish_eos_block( 
+      bit, bend, block, next_time_step, dt_inv, min_value, d, v, e, p, T, a
+    );
+
+  } // block
   //----------------------------------------------------------------------------
+
+  return make_update_result( 
+    0, num_cells, dt_inv, min_value, next_time_step, CFL, d, v, e, p, T, a
+  );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Save the cell states, so a rejected step can be undone.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void save_state( 
+  client_handle_r__<mesh_t> mesh,
+  dense_handle_interior_r__<real_t> d,
+  dense_handle_interior_r__<vector_t> v,
+  dense_handle_interior_r__<real_t> e,
+  dense_handle_interior_r__<real_t> p,
+  dense_handle_interior_r__<real_t> T,
+  dense_handle_interior_r__<real_t> a
+) {
+
+  const auto & geom = globals::geometry;
+  auto num_cells = geom.num_cells();
+
+  auto & saved = globals::saved_state;
+  saved.resize( num_cells );
+
+  #pragma omp parallel for
+  for ( counter_t i = 0; i < num_cells; ++i )
+    saved[i] = pack( geom.cell_id(i), d, v, p, e, T, a );
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Restore the cell states saved at the start of the step.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void restore_state( 
+  client_handle_r__<mesh_t> mesh,
+  dense_handle_interior_w__<real_t> d,
+  dense_handle_interior_w__<vector_t> v,
+  dense_handle_interior_w__<real_t> e,
+  dense_handle_interior_w__<real_t> p,
+  dense_handle_interior_w__<real_t> T,
+  dense_handle_interior_w__<real_t> a
+) {
+
+  const auto & geom = globals::geometry;
+  auto num_cells = geom.num_cells();
+
+  const auto & saved = globals::saved_state;
+
+  #pragma omp parallel for
+  for ( counter_t i = 0; i < num_cells; ++i )
+    pack( geom.cell_id(i), d, v, p, e, T, a ) = saved[i];
+
 }
 
 
@@ -254,6 +830,11 @@ void output(
 	char_array_t postfix,
 	size_t iteration,
 	real_t time,
+  size_t output_buffers,
+  size_t ranks_per_file,
+  char_array_t output_fields,
+  int output_compression,
+  char_array_t output_tolerances,
   dense_handle_r__<real_t> d,
   dense_handle_r__<vector_t> v,
   dense_handle_r__<real_t> e,
@@ -265,17 +846,288 @@ void output(
  
   // get the context
   auto & context = flecsi::execution::context_t::instance();
+
+  // the fields that can be written, of which only the selected ones are
+  using flecsale::io::cell_field;
+  using flecsale::io::vertex_field;
+  auto fields = std::make_tuple(
+    cell_field( "density", d ),
+    cell_field( "velocity", v ),
+    cell_field( "internal_energy", e ),
+    cell_field( "pressure", p ),
+    cell_field( "temperature", T ),
+    cell_field( "sound_speed", a )
+  );
+
+  // the files are created on the first output, and named after that 
+  // iteration so a restarted run never overwrites the earlier output
+  auto & writer = globals::solution_output;
+  if ( !writer.is_open() ) {
+
+    auto selection = apps::common::split_names( output_fields.str() );
+    writer.set_compression( 
+      output_compression, 
+      apps::common::parse_tolerances( output_tolerances.str() )
+    );
+    // the mesh does not move, so only the fields are appended
+    std::apply( 
+      [&]( const auto &... f ) { writer.select( false, selection, f... ); },
+      fields
+    );
+
+    // the ranks only write the cells they own, and their global ids tie 
+    // the parts of the files together
+    std::vector<bool> is_owned( mesh.num_cells(), false );
+    for ( auto c : mesh.cells( flecsi::owned ) ) is_owned[c.id()] = true;
+    const auto & cell_ids = 
+      context.index_map( mesh_t::index_spaces_t::cells );
+    const auto & vertex_ids = 
+      context.index_map( mesh_t::index_spaces_t::vertices );
+
+    auto suffix = "." + apps::common::zero_padded(iteration);
+    auto file_name = [&]( size_t id ) {
+      return prefix.str() + "_part" + apps::common::zero_padded(id) + 
+        suffix + "." + postfix.str();
+    };
+
+    writer.open( 
+      mesh, ranks_per_file, output_buffers, file_name, 
+      prefix.str() + suffix + ".index",
+      [&]( auto c ) { return is_owned[c]; },
+      [&]( auto c ) { return cell_ids.at(c); },
+      [&]( auto v ) { return vertex_ids.at(v); }
+    );
+
+  }
+
+  // the writers append the solution in the background while it advances
+  std::apply( 
+    [&]( const auto &... f ) { writer.write( mesh, time, f... ); },
+    fields
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Finish writing the output and close it.
+////////////////////////////////////////////////////////////////////////////////
+void finish_output()
+{
+  globals::solution_output.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Append the solution at the probes to their time history.
+////////////////////////////////////////////////////////////////////////////////
+void sample_probes( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix,
+  size_t iteration,
+  real_t time,
+  char_array_t probes,
+  char_array_t probe_fields,
+  dense_handle_r__<real_t> d,
+  dense_handle_r__<vector_t> v,
+  dense_handle_r__<real_t> e,
+  dense_handle_r__<real_t> p,
+  dense_handle_r__<real_t> T,
+  dense_handle_r__<real_t> a
+) {
+  // the fields that can be sampled
+  using flecsale::io::cell_field;
+  using flecsale::io::vertex_field;
+  auto fields = std::make_tuple(
+    cell_field( "density", d ),
+    cell_field( "velocity", v ),
+    cell_field( "internal_energy", e ),
+    cell_field( "pressure", p ),
+    cell_field( "temperature", T ),
+    cell_field( "sound_speed", a )
+  );
+
+  // the probes are located on the first sample, and the history is named 
+  // after that iteration like the output is
+  auto & history = globals::probes;
+  if ( !history.is_open() ) {
+    auto selection = apps::common::split_names( probe_fields.str() );
+    auto filename = prefix.str() + "_probes." + 
+      apps::common::zero_padded(iteration) + ".csv";
+    // the mesh does not move, so the probes are only found once
+    std::apply( 
+      [&]( const auto &... f ) { 
+        history.open( 
+          mesh, mesh.cells( flecsi::owned ), probes.str(), selection, 
+          false, filename, f... 
+        );
+      },
+      fields
+    );
+  }
+
+  std::apply( 
+    [&]( const auto &... f ) { history.sample( mesh, iteration, time, f... ); },
+    fields
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Write the checkpoint of this rank.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] prefix  the case prefix
+//! \param [in] info  the solution state that is not stored in fields
+////////////////////////////////////////////////////////////////////////////////
+void write_checkpoint( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix,
+  apps::common::checkpoint_info_t info,
+  bool compress,
+  dense_handle_interior_r__<real_t> d,
+  dense_handle_interior_r__<vector_t> v,
+  dense_handle_interior_r__<real_t> e,
+  dense_handle_interior_r__<real_t> p,
+  dense_handle_interior_r__<real_t> T,
+  dense_handle_interior_r__<real_t> a
+) {
+
+  auto & context = flecsi::execution::context_t::instance();
   auto rank = context.color();
 
-  // figure out this ranks file name
-  auto output_filename = 
-    prefix.str() + "_rank" + apps::common::zero_padded(rank) +
-    "." + apps::common::zero_padded(iteration) + "." + postfix.str();
+  apps::common::checkpoint_writer_t file( 
+    apps::common::checkpoint_filename( prefix.str(), rank, info.step ), info,
+    compress
+  );
+
+  // the ghost values are refreshed from their owners after a restart
+  auto cs = mesh.cells( flecsi::owned );
+  file.write_field( "density", cs, d );
+  file.write_field( "velocity", cs, v );
+  file.write_field( "internal_energy", cs, e );
+  file.write_field( "pressure", cs, p );
+  file.write_field( "temperature", cs, T );
+  file.write_field( "sound_speed", cs, a );
+
+  file.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Read the checkpoint of this rank.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] prefix  the case prefix
+//! \param [in] step  the step the checkpoint was taken at
+//! \return the solution state that is not stored in fields
+////////////////////////////////////////////////////////////////////////////////
+apps::common::checkpoint_info_t read_checkpoint( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix,
+  size_t step,
+  dense_handle_interior_w__<real_t> d,
+  dense_handle_interior_w__<vector_t> v,
+  dense_handle_interior_w__<real_t> e,
+  dense_handle_interior_w__<real_t> p,
+  dense_handle_interior_w__<real_t> T,
+  dense_handle_interior_w__<real_t> a
+) {
+
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  apps::common::checkpoint_reader_t file( 
+    apps::common::checkpoint_filename( prefix.str(), rank, step )
+  );
+
+  auto cs = mesh.cells( flecsi::owned );
+  file.read_field( "density", cs, d );
+  file.read_field( "velocity", cs, v );
+  file.read_field( "internal_energy", cs, e );
+  file.read_field( "pressure", cs, p );
+  file.read_field( "temperature", cs, T );
+  file.read_field( "sound_speed", cs, a );
+
+  return file.info();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Write the mesh bundle of this rank.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] prefix  the bundle prefix
+////////////////////////////////////////////////////////////////////////////////
+void write_mesh_bundle( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix
+) {
+
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
 
-  // now outut the mesh
-  flecsale::io::io_exodus__<mesh_t>::write(
-    output_filename, mesh, iteration, time, &d //, v, e, p, T, a
+  apps::common::mesh_bundle_writer_t bundle( 
+    mesh_t::num_dimensions, rank, context.colors()
   );
+  apps::common::add_mesh_sections( bundle, mesh );
+
+  // the partition, with the owners of the ghosts from the coloring
+  auto add_partition = [&]( 
+    const std::string & name, auto index_space, auto && exclusive, 
+    auto && shared, auto && ghost, std::size_t num_entities 
+  ) {
+    const auto & ids = context.index_map( index_space );
+    std::map<std::size_t, std::size_t> owners;
+    for ( const auto & entity : context.coloring( index_space ).ghost )
+      owners[ entity.id ] = entity.rank;
+    apps::common::add_partition_sections( 
+      bundle, name, num_entities, exclusive, shared, ghost,
+      [&]( auto i ) { return ids.at(i); },
+      [&]( auto id ) { return owners.at(id); }
+    );
+  };
+  add_partition( 
+    "cell", mesh_t::index_spaces_t::cells, mesh.cells( flecsi::exclusive ),
+    mesh.cells( flecsi::shared ), mesh.cells( flecsi::ghost ),
+    mesh.num_cells()
+  );
+  add_partition( 
+    "vertex", mesh_t::index_spaces_t::vertices, 
+    mesh.vertices( flecsi::exclusive ), mesh.vertices( flecsi::shared ), 
+    mesh.vertices( flecsi::ghost ), mesh.num_vertices()
+  );
+
+  bundle.write( apps::common::mesh_bundle_filename( prefix.str(), rank ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Check that the mesh bundle of this rank matches the mesh.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] prefix  the bundle prefix
+////////////////////////////////////////////////////////////////////////////////
+void check_mesh_bundle( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix
+) {
+
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  auto filename = apps::common::mesh_bundle_filename( prefix.str(), rank );
+  apps::common::mesh_bundle_t bundle( filename, /* verify */ true );
+  if ( bundle.rank() != rank || bundle.num_ranks() != context.colors() )
+    throw_runtime_error( "Mesh bundle \"" << filename << 
+      "\" is for another rank" );
+
+  auto differs = apps::common::compare_mesh_sections( bundle, mesh );
+  if ( !differs.empty() )
+    throw_runtime_error( "Mesh bundle \"" << filename << 
+      "\" does not match the mesh in " << differs );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Count the cells owned by this rank.
+////////////////////////////////////////////////////////////////////////////////
+counter_t count_owned_cells( 
+  client_handle_r__<mesh_t> mesh
+) {
+  return mesh.cells( flecsi::owned ).size();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -314,11 +1166,24 @@ void print(
 ////////////////////////////////////////////////////////////////////////////////
 
 flecsi_register_task(initial_conditions, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(setup_materials, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(build_geometry_cache, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(evaluate_time_step, apps::hydro, loc, single|flecsi::leaf);
-flecsi_register_task(gather_time_step, apps::hydro, loc, single|flecsi::leaf);
-flecsi_register_task(evaluate_fluxes, apps::hydro, loc, single|flecsi::leaf);
-flecsi_register_task(apply_update, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(evaluate_fluxes_interior, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(evaluate_fluxes_boundary, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(apply_update_interior, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(apply_update_boundary, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(evaluate_fluxes_and_update, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(save_state, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(restore_state, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(output, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(finish_output, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(sample_probes, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(write_checkpoint, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(read_checkpoint, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(write_mesh_bundle, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(check_mesh_bundle, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(count_owned_cells, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(print, apps::hydro, loc, single|flecsi::leaf);
 
 } // namespace hydro
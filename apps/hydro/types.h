@@ -13,17 +13,27 @@
 #include <flecsale-config.h>
 #include <flecsale/eqns/euler_eqns.h>
 #include <flecsale/eqns/flux.h>
+#include <flecsale/eos/eos_variant.h>
 #include <flecsale/eos/ideal_gas.h>
+#include <flecsale/eos/stiffened_gas.h>
+#include <flecsale/eos/tabular_eos.h>
+#include <flecsale/utils/simd.h>
 #include <ristra/math/general.h>
 
 #include <flecsi-sp/utils/char_array.h>
 #include <flecsi-sp/utils/types.h>
 #include <flecsi-sp/burton/burton_mesh.h>
 
+#include <flecsi/data/dense_accessor.h>
 #include <flecsi/data/global_accessor.h>
 
 #include "../common/utils.h"
 
+// system includes
+#include <algorithm>
+#include <map>
+#include <limits>
+
 namespace apps {
 namespace hydro {
 
@@ -33,12 +43,26 @@ using real_t = mesh_t::real_t;
 using vector_t = mesh_t::vector_t;
 using counter_t = mesh_t::counter_t;
 
-using eos_t = flecsale::eos::ideal_gas_t<real_t>;
+//! \brief the equations of state a material can have
+using eos_t = flecsale::eos::eos_variant__<
+  real_t,
+  flecsale::eos::ideal_gas_t,
+  flecsale::eos::stiffened_gas_t,
+  flecsale::eos::tabular_eos_t
+>;
+
+//! \brief a map for the equations of state of regions, by region number
+using eos_map_t = std::map< std::size_t, eos_t >;
 
 using eqns_t = typename flecsale::eqns::euler_eqns_t<real_t, mesh_t::num_dimensions>;
 
 using flux_data_t = eqns_t::flux_data_t;
 
+// the simd types used by the batched kernels
+using simd_t = flecsale::utils::simd_t<real_t>;
+using batch_state_t = eqns_t::batch_state__<simd_t>;
+using batch_vector_t = eqns_t::batch_vector__<simd_t>;
+
 
 // explicitly use some other stuff
 using std::cout;
@@ -56,6 +80,21 @@ using dense_handle_rw__ = flecsi_sp::utils::dense_handle_rw__<T>;
 template<typename T>
 using dense_handle_r__ = flecsi_sp::utils::dense_handle_r__<T>;
 
+// the access permission types that leave out the ghost entities.  Launching 
+// a task with these does not wait on a ghost update, though only a runtime
+// that defers the update, like Legion, runs it alongside the task.
+template<typename T>
+using dense_handle_interior_w__ = 
+  flecsi::dense_accessor__<T, flecsi::wo, flecsi::wo, flecsi::na>;
+
+template<typename T>
+using dense_handle_interior_rw__ = 
+  flecsi::dense_accessor__<T, flecsi::rw, flecsi::rw, flecsi::na>;
+
+template<typename T>
+using dense_handle_interior_r__ = 
+  flecsi::dense_accessor__<T, flecsi::ro, flecsi::ro, flecsi::na>;
+
 template<typename T>
 using global_handle_w__ = flecsi::global_accessor__<T, flecsi::wo>;
 
@@ -92,6 +131,71 @@ enum class mode_t
   normal, retry, restart, quit
 };
 
+//! \brief The local outcome of updating a set of cells.
+struct update_result_t
+{
+  //! the next time step size, if it was requested
+  real_t time_step = std::numeric_limits<real_t>::max();
+  //! the smallest density or internal energy encountered, nan counts as
+  //! the lowest value possible
+  real_t min_value = std::numeric_limits<real_t>::max();
+  //! the id of the cell where the smallest value was encountered
+  counter_t worst_cell = 0;
+
+  //! \brief Combine with the result of another set of cells.
+  void combine( const update_result_t & other )
+  {
+    time_step = std::min( time_step, other.time_step );
+    if ( other.min_value < min_value ) {
+      min_value = other.min_value;
+      worst_cell = other.worst_cell;
+    }
+  }
+
+  //! \brief Classify a smallest value.
+  static solution_error_t error( real_t value )
+  { return value > 0 ? solution_error_t::ok : solution_error_t::unphysical; }
+
+  //! \brief Classify this result.
+  solution_error_t error() const { return error( min_value ); }
+};
+
+//! \brief a class to distinguish between the different ways the fluxes
+//!   are applied to the cells.
+enum class update_mode_t 
+{
+  //! store the face fluxes, then gather them to the cells
+  two_pass, 
+  //! scatter the fluxes straight to the cells, one face color at a time
+  fused
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Override the update mode from the command line.
+//!
+//! The mode is selected with "--update-mode <two_pass|fused>", so both modes
+//! can be run on the same case and their outputs compared.
+//!
+//! \param [in] argc,argv  the command line arguments
+//! \param [in,out] mode  the update mode, only changed if one is given
+////////////////////////////////////////////////////////////////////////////////
+inline void update_mode_from_args( 
+  int argc, char ** argv, update_mode_t & mode 
+) {
+  for ( int i=1; i<argc; ++i ) {
+    if ( std::string( argv[i] ) != "--update-mode" ) continue;
+    if ( i+1 == argc )
+      throw_runtime_error( "No mode given with \"--update-mode\"" );
+    std::string name( argv[i+1] );
+    if ( name == "two_pass" ) 
+      mode = update_mode_t::two_pass;
+    else if ( name == "fused" ) 
+      mode = update_mode_t::fused;
+    else
+      throw_runtime_error( "Unknown update mode \"" << name << "\"" );
+  }
+}
+
 //! a trivially copyable character array
 using char_array_t = flecsi_sp::utils::char_array_t;
 
@@ -109,6 +213,18 @@ auto flux_function( UL && left_state, UR && right_state, V && norm )
         std::forward<V>(norm) ); 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief alias the batched flux function
+//! Change the called function to alter the flux evaluation.  This should
+//! match flux_function.
+////////////////////////////////////////////////////////////////////////////////
+template< typename E, typename S, typename V >
+auto flux_function_batch( const S & left_state, const S & right_state, 
+  const V & norm )
+{ 
+  return flecsale::eqns::hlle_flux_batch<E>( left_state, right_state, norm ); 
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief alias the boundary flux function
 //! Change the called function to alter the flux evaluation.
@@ -131,5 +247,34 @@ decltype(auto) pack( T && loc, ARGS&&... args )
     std::forward_as_tuple( std::forward<ARGS>(args)(std::forward<T>(loc))... ); 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Gather the state of several cells into simd lanes.
+//! \param [in] ids  The ids of the cells, one per lane.
+//! \param [in] d,v,p,e,a  The density, velocity, pressure, internal energy
+//!                         and sound speed.
+//! \return the batch state
+////////////////////////////////////////////////////////////////////////////////
+template< typename D, typename V, typename P, typename E, typename A >
+batch_state_t gather_batch( 
+  const counter_t * ids, D && d, V && v, P && p, E && e, A && a 
+) {
+  constexpr auto width = simd_t::width;
+  real_t tmp[width];
+  
+  auto gather = [&]( auto && f ) {
+    for ( counter_t l=0; l<width; ++l ) tmp[l] = f( ids[l] );
+    return simd_t::load( tmp );
+  };
+
+  batch_state_t w;
+  w.density = gather( [&](auto c) { return d(c); } );
+  for ( int i=0; i<mesh_t::num_dimensions; ++i )
+    w.velocity[i] = gather( [&](auto c) { return v(c)[i]; } );
+  w.pressure = gather( [&](auto c) { return p(c); } );
+  w.internal_energy = gather( [&](auto c) { return e(c); } );
+  w.sound_speed = gather( [&](auto c) { return a(c); } );
+  return w;
+}
+
 } // namespace hydro
 } // namespace apps
@@ -11,12 +11,17 @@
 #include "globals.h"
 #include "tasks.h"
 #include "types.h"
+#include "../common/benchmark.h"
+#include "../common/checkpoint.h"
+#include "../common/reductions.h"
+#include "../common/timers.h"
 
 // user includes
 #include <ristra/utils/time_utils.h>
 
 
 // system includes
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -126,7 +131,7 @@ flecsi_register_field(
   node_velocity,
   mesh_t::vector_t,
   dense,
-  1,
+  2,
   mesh_t::index_spaces_t::vertices
 );
 
@@ -175,6 +180,14 @@ int driver(int argc, char** argv)
   auto & context = flecsi::execution::context_t::instance();
   auto rank = context.color();
 
+  // in the benchmark mode, only the timings are written
+  auto benchmark_filename = apps::common::benchmark_filename();
+  auto is_benchmark = !benchmark_filename.empty();
+
+  // time the tasks if requested
+  auto & timers = apps::common::timer_registry_t::instance();
+  timers.enable( inputs_t::report_timers || is_benchmark );
+
   //===========================================================================
   // Mesh Setup
   //===========================================================================
@@ -183,13 +196,68 @@ int driver(int argc, char** argv)
   auto mesh = flecsi_get_client_handle(mesh_t, meshes, mesh0);
  
   // check the mesh
-  flecsi_execute_task( 
+  timed_execute_task( 
     validate_mesh, 
     apps::hydro,
     single, 
     mesh
   );
 
+  // write the partitioned mesh as bundles that can be mapped straight into 
+  // memory, which only needs doing once per mesh and number of ranks, so 
+  // bundles that are still current are only checked against the mesh
+  std::string bundle_prefix = inputs_t::prefix, mesh_filename;
+  if ( apps::common::mesh_bundle_requested( 
+    argc, argv, bundle_prefix, mesh_filename 
+  ) ) {
+    auto bundle_char = flecsi_sp::utils::to_char_array( bundle_prefix );
+    if ( apps::common::is_mesh_bundle_current( 
+      bundle_prefix, mesh_filename, context.colors()
+    ) ) {
+      timed_execute_task( 
+        check_mesh_bundle, apps::hydro, single, mesh, bundle_char 
+      );
+      if ( rank == 0 )
+        cout << "The mesh bundles \"" << bundle_prefix 
+             << "_rank*.bundle\" are current." << endl;
+    }
+    else {
+      timed_execute_task( 
+        write_mesh_bundle, apps::hydro, single, mesh, bundle_char 
+      );
+      apps::common::commit_mesh_bundle( 
+        bundle_prefix, mesh_filename, context.colors()
+      );
+      if ( rank == 0 )
+        cout << "Wrote the mesh bundles \"" << bundle_prefix 
+             << "_rank*.bundle\"." << endl;
+    }
+  }
+
+  // split the vertices by whether they need ghost data
+  timed_execute_task( 
+    build_vertex_partition, 
+    apps::hydro,
+    single, 
+    mesh
+  );
+
+  // flatten the corner connectivity for the threaded loops
+  timed_execute_task( 
+    build_corner_connectivity, 
+    apps::hydro,
+    single, 
+    mesh
+  );
+
+  // extract the geometry the solver uses, which is then updated as it moves
+  timed_execute_task( 
+    build_geometry_cache, 
+    apps::hydro,
+    single, 
+    mesh
+  );
+
   
   //===========================================================================
   // Some typedefs
@@ -228,6 +296,7 @@ int driver(int argc, char** argv)
   // node state
   auto xn = flecsi_get_handle(mesh, hydro, node_coordinates, vector_t, dense, 0);
   auto un = flecsi_get_handle(mesh, hydro, node_velocity, vector_t, dense, 0);
+  auto un0 = flecsi_get_handle(mesh, hydro, node_velocity, vector_t, dense, 1);
 
   // solver state
   auto dUdt = flecsi_get_handle(mesh, hydro, cell_residual, flux_data_t, dense, 0);
@@ -245,7 +314,7 @@ int driver(int argc, char** argv)
   {
     auto bc_type = bc_pair.first.get();
     auto bc_function = bc_pair.second; 
-    flecsi_execute_task(
+    timed_execute_task(
         install_boundary,
         apps::hydro,
         single,
@@ -259,32 +328,73 @@ int driver(int argc, char** argv)
   //===========================================================================
   // Initial conditions
   //===========================================================================
-  
-  // now call the main task to set the ics.  Here we set primitive/physical 
-  // quanties
-  flecsi_execute_task( 
-    initial_conditions, 
-    apps::hydro,
-    single, 
-    mesh, 
-    inputs_t::ics,
-    inputs_t::eos,
-    soln_time,
-    Vc, Mc, uc, pc, dc, ec, Tc, ac
+
+  auto prefix_char = flecsi_sp::utils::to_char_array( inputs_t::prefix );
+ 	auto postfix_char =  flecsi_sp::utils::to_char_array( "exo" );
+  auto output_fields_char = 
+    flecsi_sp::utils::to_char_array( inputs_t::output_fields );
+  auto output_tolerances_char = 
+    flecsi_sp::utils::to_char_array( inputs_t::output_tolerances );
+  auto probes_char = flecsi_sp::utils::to_char_array( inputs_t::probes );
+  auto probe_fields_char = 
+    flecsi_sp::utils::to_char_array( inputs_t::probe_fields );
+
+	// the initial time step
+	auto time_step = inputs_t::initial_time_step;
+
+  // the local accoustic time step limit, when it is computed during the 
+  // update
+  real_t local_accoustic_time_step{0};
+
+  // assign the materials before any state is computed
+  timed_execute_task( 
+    setup_materials, apps::hydro, single, mesh, inputs_t::eos, 
+    inputs_t::region_eos
   );
 
+  // resume from a checkpoint if requested, which replaces the ics
+  size_t restart_step{0};
+  auto is_restart = apps::common::restart_step( 
+    argc, argv, inputs_t::prefix, restart_step
+  );
+
+  if ( is_restart ) {
+    auto local_future_info = timed_execute_task( 
+      read_checkpoint, apps::hydro, single, mesh, prefix_char, restart_step,
+      Vc, Mc, uc, pc, dc, ec, Tc, ac, uc0, ec0, xn
+    );
+    auto info = local_future_info.get();
+    soln_time = info.time;
+    time_cnt = info.step;
+    time_step = info.time_step;
+    local_accoustic_time_step = info.local_time_step;
+    if ( rank == 0 )
+      cout << "Restarting from step " << time_cnt << " at time " 
+           << soln_time << "." << endl;
+  }
+  else {
+    // now call the main task to set the ics.  Here we set primitive/physical 
+    // quanties
+    timed_execute_task( 
+      initial_conditions, 
+      apps::hydro,
+      single, 
+      mesh, 
+      inputs_t::ics,
+      soln_time,
+      Vc, Mc, uc, pc, dc, ec, Tc, ac
+    );
+  }
+
 
   //===========================================================================
   // Pre-processing
   //===========================================================================
 
-  auto prefix_char = flecsi_sp::utils::to_char_array( inputs_t::prefix );
- 	auto postfix_char =  flecsi_sp::utils::to_char_array( "exo" );
-
-  // now output the solution
-  auto has_output = (inputs_t::output_freq > 0);
-  if (has_output) {
-    flecsi_execute_task(
+  // now output the solution, a restart already has it
+  auto has_output = (inputs_t::output_freq > 0 && !is_benchmark);
+  if (has_output && !is_restart) {
+    timed_execute_task(
       output,
  			apps::hydro,
  			single,
@@ -293,7 +403,22 @@ int driver(int argc, char** argv)
  			postfix_char,
 			time_cnt,
       soln_time,
- 			dc, uc, ec, pc, Tc, ac
+ 			inputs_t::output_buffers,
+ 			inputs_t::output_ranks_per_file,
+ 			output_fields_char,
+ 			inputs_t::output_compression,
+ 			output_tolerances_char,
+ 			dc, uc, ec, pc, Tc, ac, un
+    );
+  }
+
+  // sample the probes, which a restart already has too
+  auto has_probes = 
+    (!inputs_t::probes.empty() && inputs_t::probe_freq > 0 && !is_benchmark);
+  if (has_probes && !is_restart) {
+    timed_execute_task(
+      sample_probes, apps::hydro, single, mesh, prefix_char, time_cnt, 
+      soln_time, probes_char, probe_fields_char, dc, uc, ec, pc, Tc, ac, un
     );
   }
 
@@ -301,84 +426,146 @@ int driver(int argc, char** argv)
 
   // dump connectivity
   auto name = flecsi_sp::utils::to_char_array( inputs_t::prefix+".txt" );
-  auto f = flecsi_execute_task(print, apps::hydro, single, mesh, name);
-  f.wait();
+  if ( !is_benchmark ) {
+    auto f = timed_execute_task(print, apps::hydro, single, mesh, name);
+    f.wait();
+  }
 
   // start a clock
   auto tstart = ristra::utils::get_wall_time();
 
-	// the initial time step
-	auto time_step = inputs_t::initial_time_step;
+  // all the time step limits are reduced together with one collective
+  apps::common::reduction_bundle__<real_t, 1> time_step_reduction;
+
+  // decides when to write checkpoints
+  apps::common::checkpoint_schedule_t checkpoints( 
+    inputs_t::checkpoint_freq, inputs_t::checkpoint_interval
+  );
 
   //===========================================================================
   // Residual Evaluation
   //===========================================================================
 
-  for (
-    size_t num_steps = 0;
-    (num_steps < inputs_t::max_steps && soln_time < inputs_t::final_time); 
-    ++num_steps 
-  ) {   
-
-    //--------------------------------------------------------------------------
-    // Begin Time step
-    //--------------------------------------------------------------------------
-
-    // Save solution at n=0
-    flecsi_execute_task( save_coordinates, apps::hydro, single, mesh, xn );
-    flecsi_execute_task( save_solution, apps::hydro, single, mesh, uc, ec, uc0, ec0 );
+  // true if the time step limits in flight were computed in the fused mode
+  bool fused_time_step_limits{false};
 
+  // evaluate the forces at n=0 and start reducing the time step limits.  The
+  // nodal velocity at n=0 goes to its own buffer, so this can run before 
+  // the last step is output, and the reduction overlaps with the output.
+  auto evaluate_forces = [&]( size_t step ) {
 
-    //--------------------------------------------------------------------------
-    // Predictor step : Evaluate Forces at n=0
-    //--------------------------------------------------------------------------
-
-    // estimate the nodal velocity at n=0
-    flecsi_execute_task(
-			 estimate_nodal_state,
+    // estimate the nodal velocity at n=0, the vertices that need ghost data
+    // go last.  Only that pass waits on the ghost copy, which Legion can run
+    // alongside the first one.  The MPI runtime still copies the ghosts, 
+    // blocking, when the second pass is launched.
+    timed_execute_task(
+			 estimate_nodal_state_interior,
 			 apps::hydro,
        single,
-			 mesh, uc, un
+			 mesh, uc, un0
+		);
+    timed_execute_task(
+			 estimate_nodal_state_boundary,
+			 apps::hydro,
+       single,
+			 mesh, uc, un0
 		);
 
     // compute the nodal velocity at n=0
-    flecsi_execute_task( 
-      evaluate_nodal_state,
+    timed_execute_task( 
+      evaluate_nodal_state_interior,
       apps::hydro,
       single,
       mesh,
       soln_time,
       Vc, Mc, uc, pc, dc, ec, Tc, ac,
-      un, npc, Fpc
+      un0, npc, Fpc
+    );
+    timed_execute_task( 
+      evaluate_nodal_state_boundary,
+      apps::hydro,
+      single,
+      mesh,
+      soln_time,
+      Vc, Mc, uc, pc, dc, ec, Tc, ac,
+      un0, npc, Fpc
     );
 
     // compute the fluxes
-    flecsi_execute_task(
+    auto local_volume_time_step_future = timed_execute_task(
 			 evaluate_residual,
 		 	 apps::hydro,
 			 single,
 			 mesh,
-			 un, npc, Fpc, dUdt
+			 inputs_t::CFL,
+			 un0, npc, Fpc, dUdt
      );
 
+    // in the fused mode, the limits were computed along with the last state
+    // update and the residual, otherwise they need their own sweep
+    fused_time_step_limits = ( inputs_t::fused_time_step && step > 0 );
+    if ( fused_time_step_limits ) {
+      time_step_reduction.reduce_min( 0, local_accoustic_time_step );
+      time_step_reduction.reduce_min( 
+        0, local_volume_time_step_future.get()
+      );
+    }
+    else {
+      auto local_time_step_future = timed_execute_task(
+        evaluate_time_step,
+        apps::hydro,
+        single,
+        mesh,
+        inputs_t::CFL,
+        time_step,
+        ac, dUdt
+      );
+      time_step_reduction.reduce_min( 0, local_time_step_future.get() );
+    }
+    time_step_reduction.start();
+
+  };
+
+  // the first step has nothing to overlap with
+  if ( time_cnt < inputs_t::max_steps && soln_time < inputs_t::final_time )
+    evaluate_forces( time_cnt );
+
+  // a restart picks up the step count where it left off
+  auto first_step = time_cnt;
+
+  for (
+    size_t num_steps = first_step;
+    (num_steps < inputs_t::max_steps && soln_time < inputs_t::final_time); 
+    ++num_steps 
+  ) {   
+
+    apps::common::scoped_timer_t step_timer( "step" );
+
+    //--------------------------------------------------------------------------
+    // Begin Time step
+    //--------------------------------------------------------------------------
+
+    // the state at n moves to the other buffers, where it stays untouched
+    // for the rest of the step, and the updates are written over the old one
+    std::swap( uc, uc0 );
+    std::swap( ec, ec0 );
+
     //--------------------------------------------------------------------------
     // Time step evaluation
     //--------------------------------------------------------------------------
 
-    // compute the time step
-    auto local_time_step_future = flecsi_execute_task(
-			evaluate_time_step,
-	 		apps::hydro,
-	 		single,
-			mesh,
-			inputs_t::CFL,
-			time_step,
-			ac, dUdt
- 		);
-    
-    // now we need it
-    time_step =
-      flecsi::execution::context_t::instance().reduce_min(local_time_step_future);
+    // the forces at n=0 were already evaluated, and now the time step is 
+    // needed
+    {
+      apps::common::scoped_timer_t timer( "reduce_time_step" );
+      if ( fused_time_step_limits )
+        // the growth limit is already global
+        time_step = std::min(
+          time_step_reduction.min(0), inputs_t::CFL.growth * time_step
+        );
+      else
+        time_step = time_step_reduction.min(0);
+    }
     time_step = std::min( time_step, inputs_t::final_time - soln_time );       
 
 		if ( rank == 0 ) {
@@ -406,33 +593,36 @@ int driver(int argc, char** argv)
 		//--------------------------------------------------------------------------
 
     // move the mesh to n+1/2
-    flecsi_execute_task(
+    timed_execute_task(
 			 move_mesh, 
  			 apps::hydro,
        single,
 			 mesh, 
-			 un,
-			 0.5*time_step
+			 un0,
+			 xn,
+			 0.5*time_step,
+			 true
      );
 
 	 	// update solution to n+1/2
-    flecsi_execute_task(
+    timed_execute_task(
 			 apply_update, 
  			 apps::hydro,
        single,
 			 mesh, 
 			 0.5*time_step,
 			 dUdt,
+       uc0, ec0,
        Vc, Mc, uc, pc, dc, ec, Tc, ac
      );
 
     // Update derived solution quantities
-    flecsi_execute_task( 
+    timed_execute_task( 
       update_state_from_energy,
 			apps::hydro,
 			single,
 			mesh,
-			inputs_t::eos,
+			inputs_t::CFL,
 			Vc, Mc, uc, pc, dc, ec, Tc, ac 
 		);
 
@@ -441,8 +631,17 @@ int driver(int argc, char** argv)
     //--------------------------------------------------------------------------
 
     // compute the nodal velocity at n=1/2
-    flecsi_execute_task( 
-      evaluate_nodal_state,
+    timed_execute_task( 
+      evaluate_nodal_state_interior,
+      apps::hydro,
+      single,
+      mesh,
+      soln_time,
+      Vc, Mc, uc, pc, dc, ec, Tc, ac,
+      un, npc, Fpc
+    );
+    timed_execute_task( 
+      evaluate_nodal_state_boundary,
       apps::hydro,
       single,
       mesh,
@@ -452,11 +651,12 @@ int driver(int argc, char** argv)
     );
 
     // compute the fluxes
-    flecsi_execute_task(
+    timed_execute_task(
 			 evaluate_residual,
 		 	 apps::hydro,
 			 single,
 			 mesh,
+			 inputs_t::CFL,
 			 un, npc, Fpc, dUdt
      );
 
@@ -464,57 +664,60 @@ int driver(int argc, char** argv)
     // Move to n+1
     //--------------------------------------------------------------------------
 
-	  // restore the solution to n=0
-    flecsi_execute_task(
-			restore_coordinates,
- 			apps::hydro,
- 			single,
- 			mesh,
-			xn
- 		);
+    // the corrector starts back from the coordinates at n, and moves with
+    // the nodal velocity at n+1/2
+    constexpr bool save_coordinates = false;
+    auto & step_velocity = un;
 
-    flecsi_execute_task(
-	 		restore_solution,
- 			apps::hydro,
- 			single,
- 			mesh,
- 			uc0, uc, ec0, ec
- 		);
+#else
+
+    // there is no predictor to set aside the coordinates at n, and the mesh 
+    // moves with the nodal velocity at n
+    constexpr bool save_coordinates = true;
+    auto & step_velocity = un0;
 
 #endif // USE_FIRST_ORDER_TIME_STEPPING
 
 
     // move the mesh to n+1
-    flecsi_execute_task(
+    timed_execute_task(
 			 move_mesh, 
  			 apps::hydro,
        single,
 			 mesh, 
-			 un,
-			 time_step
+			 step_velocity,
+			 xn,
+			 time_step,
+			 save_coordinates
      );
     
 	 	// update solution to n+1/2
-    flecsi_execute_task(
+    timed_execute_task(
 			 apply_update, 
  			 apps::hydro,
        single,
 			 mesh, 
 			 time_step,
 			 dUdt,
+       uc0, ec0,
        Vc, Mc, uc, pc, dc, ec, Tc, ac
      );
 
     // Update derived solution quantities
-    flecsi_execute_task( 
+    auto local_accoustic_time_step_future = timed_execute_task( 
       update_state_from_energy,
 			apps::hydro,
 			single,
 			mesh,
-			inputs_t::eos,
+			inputs_t::CFL,
 			Vc, Mc, uc, pc, dc, ec, Tc, ac 
 		);
 
+    // the accoustic limit for the next step is a by-product of the update,
+    // it is reduced along with the volume limit next step
+    if ( inputs_t::fused_time_step )
+      local_accoustic_time_step = local_accoustic_time_step_future.get();
+
 
     //--------------------------------------------------------------------------
     // End Time step
@@ -523,6 +726,14 @@ int driver(int argc, char** argv)
     // update time
     soln_time += time_step;
     time_cnt++;
+
+    // decide whether to write a checkpoint while the output is written
+    checkpoints.start( time_cnt );
+
+    // the forces for the next step only need the state at n+1, so evaluate
+    // them now and reduce the time step while the output is written
+    if ( num_steps+1 < inputs_t::max_steps && soln_time < inputs_t::final_time )
+      evaluate_forces( num_steps+1 );
   
     // now output the solution
     if ( has_output && 
@@ -532,7 +743,7 @@ int driver(int argc, char** argv)
         )  
       ) 
     {
-      flecsi_execute_task(
+      timed_execute_task(
         output,
 	 			apps::hydro,
  				single,
@@ -541,12 +752,53 @@ int driver(int argc, char** argv)
  				postfix_char,
  				time_cnt,
         soln_time,
- 				dc, uc, ec, pc, Tc, ac
+ 				inputs_t::output_buffers,
+ 				inputs_t::output_ranks_per_file,
+ 				output_fields_char,
+ 				inputs_t::output_compression,
+ 				output_tolerances_char,
+ 				dc, uc, ec, pc, Tc, ac, un
+      );
+    }
+
+    // sample the probes
+    if ( has_probes && time_cnt % inputs_t::probe_freq == 0 ) {
+      timed_execute_task(
+        sample_probes, apps::hydro, single, mesh, prefix_char, time_cnt, 
+        soln_time, probes_char, probe_fields_char, dc, uc, ec, pc, Tc, ac, un
       );
     }
 
+    // write a checkpoint
+    if ( checkpoints.due() ) {
+      apps::common::checkpoint_info_t info;
+      info.step = time_cnt;
+      info.time = soln_time;
+      info.time_step = time_step;
+      info.local_time_step = local_accoustic_time_step;
+      auto f = timed_execute_task( 
+        write_checkpoint, apps::hydro, single, mesh, prefix_char, info,
+        inputs_t::checkpoint_compression,
+        Vc, Mc, uc, pc, dc, ec, Tc, ac, uc0, ec0, xn
+      );
+      f.wait();
+      apps::common::commit_checkpoint( inputs_t::prefix, time_cnt );
+      checkpoints.written();
+    }
+
   } // for
 
+  // the geometry the solver kept must match the full geometry of the moved
+  // mesh, which the regression tests check
+  real_t geometry_tolerance = 1.e-12;
+  if ( check_geometry_requested( argc, argv, geometry_tolerance ) ) {
+    timed_execute_task( 
+      check_geometry_cache, apps::hydro, single, mesh, geometry_tolerance
+    ).wait();
+    if ( rank == 0 )
+      cout << "The cached geometry matches the mesh." << endl;
+  }
+
   //===========================================================================
   // Post-process
   //===========================================================================
@@ -565,6 +817,27 @@ int driver(int argc, char** argv)
 
   }
 
+  // wait for the output written in the background
+  if ( has_output )
+    timed_execute_task( finish_output, apps::hydro, single );
+
+  if ( timers.enabled() )
+    timers.report( std::cout, inputs_t::prefix + "_timers.json" );
+
+  // the throughput is measured in zone-cycles per second, counting only the
+  // steps taken by this run
+  if ( is_benchmark ) {
+    auto local_future_num_cells = 
+      flecsi_execute_task( count_owned_cells, apps::hydro, single, mesh );
+    apps::common::reduction_bundle__<double, 0, 1> num_cells;
+    num_cells.reduce_sum( 0, local_future_num_cells.get() );
+    num_cells.start();
+    apps::common::report_throughput( 
+      std::cout, benchmark_filename, num_cells.sum(0), time_cnt - first_step, 
+      tdelta
+    );
+  }
+
 
   // success if you reached here
   return 0;
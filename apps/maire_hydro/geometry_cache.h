@@ -0,0 +1,430 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief The geometry used by the lagrangian hydro solver, updated only
+///        where the mesh moved.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// hydro includes
+#include "types.h"
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace apps {
+namespace hydro {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The cell and wedge geometry that the lagrangian solver uses.
+//!
+//! Updating the whole mesh geometry after every move recomputes many
+//! quantities the solver never looks at.  This keeps only the cell volumes
+//! and minimum lengths, and the wedge facet normals, areas and centroids,
+//! and recomputes them in one threaded sweep over the cells.  Cells whose
+//! vertices did not move since the last update, like regions at rest, are
+//! skipped.
+//!
+//! The facet of a wedge is the part of its face it touches: the half edge
+//! from the vertex to the edge midpoint in 2d, or the triangle between the
+//! vertex, the edge midpoint and the face midpoint in 3d.  The facets tile
+//! the cell boundary, so the volume follows from them by the divergence
+//! theorem.  The normals point out of the cell.
+//!
+//! The geometry of the mesh entities themselves, like the cell centroids, is
+//! left alone when the mesh moves, and only marked as stale.  Anything that
+//! reads it must first bring it up to date with update_mesh_geometry().
+//!
+//! Entities are indexed by their mesh ids.
+////////////////////////////////////////////////////////////////////////////////
+class geometry_cache_t {
+
+public:
+
+  //! the number of dimensions
+  static constexpr auto num_dimensions = mesh_t::num_dimensions;
+
+  //============================================================================
+  //! \brief Extract the connectivity from the mesh, and compute the
+  //!        geometry.
+  //! \param [in] mesh  The mesh to extract the connectivity from.
+  //============================================================================
+  template< typename MESH >
+  void build( MESH & mesh )
+  {
+    clear();
+
+    // no vertex has been seen yet, so every cell is computed on the first
+    // update
+    coordinates_.assign(
+      mesh.num_vertices(), vector_t( std::numeric_limits<real_t>::quiet_NaN() )
+    );
+    is_moved_.assign( mesh.num_vertices(), true );
+
+    // the vertices and wedges of each cell
+    cell_vertex_offsets_.emplace_back( 0 );
+    cell_wedge_offsets_.emplace_back( 0 );
+
+    for ( auto c : mesh.cells() ) {
+      cell_id_.emplace_back( c.id() );
+      for ( auto vt : mesh.vertices(c) ) cell_vertices_.emplace_back( vt.id() );
+      for ( auto w : mesh.wedges(c) ) cell_wedges_.emplace_back( w.id() );
+      cell_vertex_offsets_.emplace_back( cell_vertices_.size() );
+      cell_wedge_offsets_.emplace_back( cell_wedges_.size() );
+    }
+
+    cell_volume_.assign( mesh.num_cells(), 0 );
+    cell_min_length_.assign( mesh.num_cells(), 0 );
+
+    // the points that make up the facet of each wedge
+    auto num_wedges = mesh.num_wedges();
+    wedge_vertex_.assign( num_wedges, 0 );
+    wedge_edge_vertex_.assign( num_wedges, 0 );
+    wedge_face_.assign( num_wedges, 0 );
+
+    for ( auto w : mesh.wedges() ) {
+      auto vt = mesh.vertices(w).front();
+      auto f = mesh.faces(w).front();
+      wedge_vertex_[ w.id() ] = vt.id();
+      wedge_face_[ w.id() ] = f.id();
+      auto set_edge_vertex = [&]( const auto & edge_vertices ) {
+        for ( auto ev : edge_vertices )
+          if ( ev.id() != vt.id() ) wedge_edge_vertex_[ w.id() ] = ev.id();
+      };
+      // in 2d, the face is the edge
+      if constexpr ( num_dimensions == 2 )
+        set_edge_vertex( mesh.vertices(f) );
+      else
+        set_edge_vertex( mesh.vertices( mesh.edges(w).front() ) );
+    }
+
+    wedge_facet_normal_.assign( num_wedges, 0 );
+    wedge_facet_area_.assign( num_wedges, 0 );
+    wedge_facet_centroid_.assign( num_wedges, 0 );
+
+    // the vertices of each face, for the face midpoints in 3d
+    if constexpr ( num_dimensions == 3 ) {
+      face_vertex_offsets_.emplace_back( 0 );
+      for ( auto f : mesh.faces() ) {
+        face_id_.emplace_back( f.id() );
+        for ( auto vt : mesh.vertices(f) )
+          face_vertices_.emplace_back( vt.id() );
+        face_vertex_offsets_.emplace_back( face_vertices_.size() );
+      }
+      face_midpoint_.assign( mesh.num_faces(), 0 );
+    }
+
+    update( mesh );
+
+    // the mesh entities already have the geometry of the unmoved mesh
+    is_mesh_geometry_stale_ = false;
+  }
+
+  //============================================================================
+  //! \brief Update the geometry of the cells that moved.
+  //! \param [in] mesh  The mesh, with its vertices moved.
+  //! \return the number of cells that were updated
+  //============================================================================
+  template< typename MESH >
+  counter_t update( MESH & mesh )
+  {
+
+    //--------------------------------------------------------------------------
+    // find the vertices that moved since the last update
+
+    auto vs = mesh.vertices();
+    counter_t num_verts = vs.size();
+
+    #pragma omp parallel for
+    for ( counter_t i=0; i<num_verts; ++i ) {
+      auto vt = vs[i];
+      const auto & x = vt->coordinates();
+      auto & x0 = coordinates_[ vt.id() ];
+      bool is_moved = false;
+      for ( int d=0; d<num_dimensions; ++d ) {
+        // a nan never compares equal, so unseen vertices always move
+        if ( !( x[d] == x0[d] ) ) is_moved = true;
+        x0[d] = x[d];
+      }
+      is_moved_[ vt.id() ] = is_moved;
+    }
+
+    auto any_moved = [&](
+      const std::vector<counter_t> & offsets,
+      const std::vector<counter_t> & vertices,
+      counter_t i
+    ) {
+      for ( auto j=offsets[i]; j<offsets[i+1]; ++j )
+        if ( is_moved_[ vertices[j] ] ) return true;
+      return false;
+    };
+
+    //--------------------------------------------------------------------------
+    // the face midpoints come first, since the 3d facets need them
+
+    counter_t num_faces = face_id_.size();
+
+    #pragma omp parallel for
+    for ( counter_t i=0; i<num_faces; ++i ) {
+      if ( !any_moved( face_vertex_offsets_, face_vertices_, i ) ) continue;
+      auto & xf = face_midpoint_[ face_id_[i] ];
+      average( face_vertex_offsets_, face_vertices_, i, xf );
+    }
+
+    //--------------------------------------------------------------------------
+    // now the cells, and their wedges which no other cell touches
+
+    counter_t num_cells = cell_id_.size();
+    counter_t num_updated = 0;
+
+    #pragma omp parallel for reduction(+:num_updated)
+    for ( counter_t i=0; i<num_cells; ++i ) {
+      if ( !any_moved( cell_vertex_offsets_, cell_vertices_, i ) ) continue;
+      update_cell( i );
+      ++num_updated;
+    }
+
+    if ( num_updated > 0 ) is_mesh_geometry_stale_ = true;
+
+    return num_updated;
+  }
+
+  //============================================================================
+  //! \brief Bring the geometry of the mesh entities up to date, if the mesh 
+  //!        moved since it was last computed.
+  //! \param [in] mesh  The mesh.
+  //============================================================================
+  template< typename MESH >
+  void update_mesh_geometry( MESH & mesh )
+  {
+    if ( !is_mesh_geometry_stale_ ) return;
+    // DEFECT we are modifying the mesh, but its read-only.
+    mesh.update_geometry();
+    is_mesh_geometry_stale_ = false;
+  }
+
+  //============================================================================
+  //! \brief Compare the cell geometry against that of the mesh entities.
+  //!
+  //! The geometry of the mesh entities is brought up to date first.
+  //!
+  //! \param [in] mesh  The mesh.
+  //! \return the largest relative difference of the cell volumes and of the
+  //!         cell minimum lengths
+  //============================================================================
+  template< typename MESH >
+  std::pair<real_t, real_t> compare_with_mesh( MESH & mesh )
+  {
+    update_mesh_geometry( mesh );
+
+    real_t volume_diff(0), length_diff(0);
+    for ( auto c : mesh.cells() ) {
+      auto vol = c->volume();
+      auto len = c->min_length();
+      volume_diff = std::max( 
+        std::abs( cell_volume_[c.id()] - vol ) / std::abs(vol), volume_diff
+      );
+      length_diff = std::max( 
+        std::abs( cell_min_length_[c.id()] - len ) / len, length_diff 
+      );
+    }
+    return { volume_diff, length_diff };
+  }
+
+  //============================================================================
+  //! \brief Clear all the storage.
+  //============================================================================
+  void clear()
+  {
+    coordinates_.clear();
+    is_moved_.clear();
+    cell_id_.clear();
+    cell_vertex_offsets_.clear();
+    cell_vertices_.clear();
+    cell_wedge_offsets_.clear();
+    cell_wedges_.clear();
+    cell_volume_.clear();
+    cell_min_length_.clear();
+    wedge_vertex_.clear();
+    wedge_edge_vertex_.clear();
+    wedge_face_.clear();
+    wedge_facet_normal_.clear();
+    wedge_facet_area_.clear();
+    wedge_facet_centroid_.clear();
+    face_id_.clear();
+    face_vertex_offsets_.clear();
+    face_vertices_.clear();
+    face_midpoint_.clear();
+  }
+
+  //============================================================================
+  // Accessors
+  //============================================================================
+
+  //! \brief the volume of a cell
+  real_t cell_volume( counter_t c ) const { return cell_volume_[c]; }
+  //! \brief the smallest distance between two vertices of a cell
+  real_t cell_min_length( counter_t c ) const { return cell_min_length_[c]; }
+
+  //! \brief the unit outward normal of the facet of a wedge
+  const vector_t & facet_normal( counter_t w ) const
+  { return wedge_facet_normal_[w]; }
+  //! \brief the area of the facet of a wedge
+  real_t facet_area( counter_t w ) const { return wedge_facet_area_[w]; }
+  //! \brief the centroid of the facet of a wedge
+  const vector_t & facet_centroid( counter_t w ) const
+  { return wedge_facet_centroid_[w]; }
+
+private:
+
+  //============================================================================
+  //! \brief Average the coordinates of a list of vertices.
+  //============================================================================
+  void average(
+    const std::vector<counter_t> & offsets,
+    const std::vector<counter_t> & vertices,
+    counter_t i,
+    vector_t & x
+  ) const {
+    x = 0;
+    for ( auto j=offsets[i]; j<offsets[i+1]; ++j ) {
+      const auto & xv = coordinates_[ vertices[j] ];
+      for ( int d=0; d<num_dimensions; ++d ) x[d] += xv[d];
+    }
+    auto n = offsets[i+1] - offsets[i];
+    for ( int d=0; d<num_dimensions; ++d ) x[d] /= n;
+  }
+
+  //============================================================================
+  //! \brief Recompute the geometry of one cell and its wedges.
+  //! \param [in] i  the position of the cell in the cell lists
+  //============================================================================
+  void update_cell( counter_t i )
+  {
+    auto c = cell_id_[i];
+
+    // the facets are oriented away from the vertex average, which holds for
+    // any star shaped cell
+    vector_t xc;
+    average( cell_vertex_offsets_, cell_vertices_, i, xc );
+
+    // the minimum length over every pair of vertices, so the diagonals count
+    auto min_length_sqr = std::numeric_limits<real_t>::max();
+    auto vbegin = cell_vertex_offsets_[i];
+    auto vend = cell_vertex_offsets_[i+1];
+    for ( auto j=vbegin; j<vend; ++j ) {
+      const auto & xj = coordinates_[ cell_vertices_[j] ];
+      for ( auto k=j+1; k<vend; ++k ) {
+        const auto & xk = coordinates_[ cell_vertices_[k] ];
+        real_t len_sqr = 0;
+        for ( int d=0; d<num_dimensions; ++d )
+          len_sqr += (xk[d]-xj[d]) * (xk[d]-xj[d]);
+        min_length_sqr = std::min( min_length_sqr, len_sqr );
+      }
+    }
+    cell_min_length_[c] = std::sqrt( min_length_sqr );
+
+    // the facets, and the volume from the divergence theorem
+    real_t volume = 0;
+
+    for ( auto j=cell_wedge_offsets_[i]; j<cell_wedge_offsets_[i+1]; ++j ) {
+
+      auto w = cell_wedges_[j];
+      const auto & xv = coordinates_[ wedge_vertex_[w] ];
+      const auto & xo = coordinates_[ wedge_edge_vertex_[w] ];
+
+      vector_t xe;
+      for ( int d=0; d<num_dimensions; ++d ) xe[d] = 0.5 * ( xv[d] + xo[d] );
+
+      auto & n = wedge_facet_normal_[w];
+      auto & xw = wedge_facet_centroid_[w];
+
+      if constexpr ( num_dimensions == 2 ) {
+        // the half edge from the vertex to the edge midpoint
+        n[0] =   xe[1] - xv[1];
+        n[1] = -(xe[0] - xv[0]);
+        for ( int d=0; d<num_dimensions; ++d )
+          xw[d] = 0.5 * ( xv[d] + xe[d] );
+      }
+      else {
+        // the triangle between the vertex, edge midpoint and face midpoint
+        const auto & xf = face_midpoint_[ wedge_face_[w] ];
+        vector_t a, b;
+        for ( int d=0; d<num_dimensions; ++d ) {
+          a[d] = xe[d] - xv[d];
+          b[d] = xf[d] - xv[d];
+        }
+        n[0] = a[1]*b[2] - a[2]*b[1];
+        n[1] = a[2]*b[0] - a[0]*b[2];
+        n[2] = a[0]*b[1] - a[1]*b[0];
+        for ( int d=0; d<num_dimensions; ++d )
+          xw[d] = ( xv[d] + xe[d] + xf[d] ) / 3;
+      }
+
+      // the length of the normal is the length of the half edge in 2d, and
+      // twice the triangle area in 3d
+      real_t mag = 0;
+      for ( int d=0; d<num_dimensions; ++d ) mag += n[d] * n[d];
+      mag = std::sqrt( mag );
+      auto area = ( num_dimensions == 2 ) ? mag : 0.5 * mag;
+      wedge_facet_area_[w] = area;
+
+      // normalize, and point it out of the cell
+      real_t dot = 0;
+      for ( int d=0; d<num_dimensions; ++d ) dot += n[d] * ( xw[d] - xc[d] );
+      if ( dot < 0 ) mag = -mag;
+      for ( int d=0; d<num_dimensions; ++d ) n[d] /= mag;
+
+      volume += area * dot / mag;
+
+    } // wedge
+
+    cell_volume_[c] = volume / num_dimensions;
+  }
+
+  //! true if the mesh moved since the geometry of its entities was computed
+  bool is_mesh_geometry_stale_ = false;
+
+  //! the coordinates at the last update, and whether they changed
+  std::vector<vector_t> coordinates_;
+  std::vector<unsigned char> is_moved_;
+
+  //! the cells, with their vertices and wedges in compressed rows
+  std::vector<counter_t> cell_id_;
+  std::vector<counter_t> cell_vertex_offsets_;
+  std::vector<counter_t> cell_vertices_;
+  std::vector<counter_t> cell_wedge_offsets_;
+  std::vector<counter_t> cell_wedges_;
+
+  //! the cell geometry
+  std::vector<real_t> cell_volume_;
+  std::vector<real_t> cell_min_length_;
+
+  //! the vertex, the other vertex of the edge, and the face of each wedge
+  std::vector<counter_t> wedge_vertex_;
+  std::vector<counter_t> wedge_edge_vertex_;
+  std::vector<counter_t> wedge_face_;
+
+  //! the wedge geometry
+  std::vector<vector_t> wedge_facet_normal_;
+  std::vector<real_t> wedge_facet_area_;
+  std::vector<vector_t> wedge_facet_centroid_;
+
+  //! the faces, with their vertices in compressed rows, only in 3d
+  std::vector<counter_t> face_id_;
+  std::vector<counter_t> face_vertex_offsets_;
+  std::vector<counter_t> face_vertices_;
+  std::vector<vector_t> face_midpoint_;
+
+};
+
+} // namespace
+} // namespace
@@ -10,7 +10,17 @@
 #pragma once
 
 // user includes
+#include "geometry_cache.h"
+#include "nodal_workspace.h"
 #include "types.h"
+#include "../common/materials.h"
+#include "../common/output.h"
+#include "../common/probes.h"
+
+#include <flecsale/io/io_exodus.h>
+
+// system includes
+#include <vector>
 
 
 namespace apps {
@@ -21,6 +31,34 @@ namespace globals {
 // the boundary mapper
 boundary_map_t boundaries;
 
+// the overlapping vertices that do not, and do, need ghost cell data
+std::vector<counter_t> interior_vertices;
+std::vector<counter_t> boundary_vertices;
+
+// the geometry the solver uses, updated where the mesh moves
+geometry_cache_t geometry;
+
+// the vertex and cell of each corner
+std::vector<counter_t> corner_vertex;
+std::vector<counter_t> corner_cell;
+
+// the corners of each owned cell, in compressed rows
+std::vector<counter_t> cell_corner_offsets;
+std::vector<counter_t> cell_corners;
+
+// the scratch storage for the nodal solve, one per thread
+std::vector<nodal_workspace_t> nodal_workspaces;
+
+// the solution output, which stays open for the whole run
+apps::common::aggregated_output__< flecsale::io::exodus_writer__<mesh_t> >
+  solution_output;
+
+// the probes, which sample the solution at a few points every so often
+apps::common::probes__<mesh_t> probes;
+
+// the material of each cell, and the equation of state of each material
+apps::common::materials__<eos_t> materials;
+
 
 } // namespace
 
@@ -0,0 +1,134 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Scratch storage for solving the nodal velocities.
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// hydro includes
+#include "types.h"
+
+// system includes
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace apps {
+namespace hydro {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The scratch storage used to solve for the velocity of one vertex.
+//!
+//! The storage is sized once for the largest vertex of the mesh, and then
+//! reused for every vertex and every step, so the nodal solve does not touch
+//! the heap.  There is one workspace per thread.  A vertex bigger than the
+//! sizes given still works, it just grows the storage.
+////////////////////////////////////////////////////////////////////////////////
+class nodal_workspace_t {
+
+public:
+
+  //! the number of dimensions
+  static constexpr auto num_dimensions = mesh_t::num_dimensions;
+
+  //! the corner matrix type
+  using matrix_t = matrix__<num_dimensions>;
+
+  //! the symmetry normals, sorted by boundary tag
+  using symmetry_normals_t = std::vector< std::pair<tag_t, vector_t> >;
+
+  //============================================================================
+  //! \brief Size the storage.
+  //! \param [in] max_corners  the most corners of any vertex
+  //! \param [in] max_symmetry  the most symmetry constraints of any vertex
+  //============================================================================
+  void reserve( std::size_t max_corners, std::size_t max_symmetry )
+  {
+    auto max_rows = num_dimensions + max_symmetry;
+    corner_matrices_.resize( max_corners );
+    symmetry_normals_.reserve( max_symmetry );
+    A_.reserve( max_rows * max_rows );
+    b_.reserve( max_rows );
+  }
+
+  //============================================================================
+  //! \brief Get zeroed storage for the corner matrices of a vertex.
+  //! \param [in] num_corners  the number of corners of the vertex
+  //! \return a pointer to the first matrix
+  //============================================================================
+  matrix_t * corner_matrices( std::size_t num_corners )
+  {
+    if ( corner_matrices_.size() < num_corners )
+      corner_matrices_.resize( num_corners );
+    std::fill_n( corner_matrices_.begin(), num_corners, matrix_t(0) );
+    return corner_matrices_.data();
+  }
+
+  //============================================================================
+  //! \brief Get the emptied symmetry normals of a vertex.
+  //============================================================================
+  symmetry_normals_t & symmetry_normals()
+  {
+    symmetry_normals_.clear();
+    return symmetry_normals_;
+  }
+
+  //============================================================================
+  //! \brief Get the zeroed storage for the augmented symmetry system.
+  //! \param [in] num_rows  the number of rows of the system
+  //! \return the matrix and right hand side
+  //============================================================================
+  std::pair< std::vector<real_t> &, std::vector<real_t> & >
+  augmented_system( std::size_t num_rows )
+  {
+    A_.assign( num_rows * num_rows, 0 );
+    b_.assign( num_rows, 0 );
+    return { A_, b_ };
+  }
+
+private:
+
+  //! the matrices of the corners
+  std::vector<matrix_t> corner_matrices_;
+  //! the symmetry normals
+  symmetry_normals_t symmetry_normals_;
+  //! the augmented system, stored by row
+  std::vector<real_t> A_;
+  std::vector<real_t> b_;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Add to the normal of a symmetry boundary.
+//!
+//! The normals are kept sorted by tag, so the constraints are always added
+//! to the system in the same order.
+//!
+//! \param [in,out] normals  the symmetry normals
+//! \param [in] tag  the boundary tag
+//! \param [in] n  the normal to add
+////////////////////////////////////////////////////////////////////////////////
+inline void add_symmetry_normal(
+  nodal_workspace_t::symmetry_normals_t & normals,
+  tag_t tag,
+  const vector_t & n
+) {
+  auto it = std::lower_bound(
+    normals.begin(), normals.end(), tag,
+    []( const auto & entry, tag_t t ) { return entry.first < t; }
+  );
+  if ( it != normals.end() && it->first == tag ) {
+    for ( int d=0; d<nodal_workspace_t::num_dimensions; ++d )
+      it->second[d] += n[d];
+  }
+  else {
+    normals.emplace( it, tag, n );
+  }
+}
+
+} // namespace
+} // namespace
@@ -12,6 +12,9 @@
 // hydro includes
 #include "globals.h"
 #include "types.h"
+#include "../common/checkpoint.h"
+#include "../common/eos_block.h"
+#include "../common/mesh_bundle.h"
 
 #include <flecsale/io/io_exodus.h>
 #include <flecsale/linalg/qr.h>
@@ -23,7 +26,14 @@
 #include <flecsi/execution/execution.h>
 
 // system includes
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include <iomanip>
+#include <map>
+#include <tuple>
+#include <vector>
 
 namespace apps {
 namespace hydro {
@@ -78,7 +88,6 @@ void validate_mesh(
 void initial_conditions( 
   client_handle_r__<mesh_t>  mesh,
   inputs_t::ics_function_t ics, 
-  eos_t eos,
   real_t soln_time,
   dense_handle_w__<real_t> V,
   dense_handle_w__<real_t> M,
@@ -90,6 +99,8 @@ void initial_conditions(
   dense_handle_w__<real_t> a
 ) {
 
+  globals::geometry.update_mesh_geometry( mesh );
+
   // This doesn't work with lua input
   // #pragma omp parallel for
   for ( auto c : mesh.cells( flecsi::owned ) ) {
@@ -103,7 +114,7 @@ void initial_conditions(
     // now update the rest of the state
     eqns_t::update_state_from_pressure( 
       pack( c, V, M, v, p, d, e, T, a ),
-      eos
+      globals::materials.eos_of( c.id() )
     );
   }
 
@@ -111,14 +122,34 @@ void initial_conditions(
 
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task for setting initial conditions
+//! \brief Assign the materials to the cells.
 //!
-//! \param [in,out] mesh the mesh object
-//! \return 0 for success
+//! \param [in] mesh the mesh object
+//! \param [in] eos  the default equation of state
+//! \param [in] region_eos  the equations of state of some regions
 ////////////////////////////////////////////////////////////////////////////////
-void update_state_from_energy( 
+void setup_materials( 
   client_handle_r__<mesh_t>  mesh,
   eos_t eos,
+  eos_map_t region_eos
+) {
+  globals::materials.setup( mesh, eos, region_eos );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The main task for updating the derived state quantities
+//!
+//! The accoustic time step limit is computed while the state is at hand, so
+//! that the next step can skip evaluate_time_step.
+//!
+//! \param [in,out] mesh the mesh object
+//! \param [in] cfl  the time step constants
+//! \return the local accoustic time step limit
+////////////////////////////////////////////////////////////////////////////////
+real_t update_state_from_energy( 
+  client_handle_r__<mesh_t>  mesh,
+  time_constants_t cfl,
   dense_handle_r__<real_t> V,
   dense_handle_r__<real_t> M,
   dense_handle_r__<vector_t> v,
@@ -130,15 +161,52 @@ void update_state_from_energy(
 ) {
 
   auto cs = mesh.cells( flecsi::owned );
-  auto num_cells = cs.size();
+  counter_t num_cells = cs.size();
+  const auto & materials = globals::materials;
+  const auto & geom = globals::geometry;
+
+  // the cells are gathered into blocks so the eos evaluates them in batches
+  using block_t = apps::common::eos_block__<real_t, eos_t::hint_t>;
+  constexpr counter_t block_size = block_t::capacity;
+
+  real_t dt_acc_inv(0);
+
+  #pragma omp parallel for reduction(max:dt_acc_inv)
+  for ( counter_t begin=0; begin<num_cells; begin+=block_size ) {
+
+    auto end = std::min( begin + block_size, num_cells );
+
+    block_t block;
+    for ( auto i=begin; i<end; ++i ) {
+      auto c = cs[i];
+      assert( d(c) > 0 );
+      assert( e(c) > 0 );
+      if ( materials.has_hints() )
+        block.push_back( 
+          d(c), e(c), materials.material( c.id() ), materials.hint( c.id() )
+        );
+      else
+        block.push_back( d(c), e(c), materials.material( c.id() ) );
+    }
+
+    block.compute_state_de( materials.eos(), eqns_t::min_sound_speed );
+
+    for ( auto i=begin; i<end; ++i ) {
+      auto c = cs[i];
+      auto j = i - begin;
+      p(c) = block.pressure[j];
+      T(c) = block.temperature[j];
+      a(c) = block.sound_speed[j];
+      if ( block.has_hints ) materials.hint( c.id() ) = block.hint[j];
+      // compute the inverse of the time scale
+      auto dti =  a(c) / geom.cell_min_length( c.id() );
+      dt_acc_inv = std::max( dti, dt_acc_inv );
+    }
 
-  #pragma omp parallel for
-  for ( counter_t i=0; i<num_cells; ++i ) {
-    auto c = cs[i];
-    auto u = pack(c, V, M, v, p, d, e, T, a);
-    eqns_t::update_state_from_energy( u, eos );
   }
 
+  return cfl.accoustic / dt_acc_inv;
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -163,18 +231,20 @@ double evaluate_time_step(
 
   auto cs = mesh.cells( flecsi::owned );
   auto num_cells = cs.size();
+  const auto & geom = globals::geometry;
 
+  #pragma omp parallel for reduction(max:dt_acc_inv,dt_vol_inv)
   for ( counter_t i=0; i<num_cells; ++i ) {
     auto c = cs[i];
 
     // compute the inverse of the time scale
-    auto dti =  sound_speed(c) / c->min_length();
+    auto dti =  sound_speed(c) / geom.cell_min_length( c.id() );
     // check for the maximum value
     dt_acc_inv = std::max( dti, dt_acc_inv );
 
     // now check the volume change
     auto dVdt = eqns_t::volumetric_rate_of_change( dudt(c) );
-    dti = std::abs(dVdt) / c->volume();
+    dti = std::abs(dVdt) / geom.cell_volume( c.id() );
     // check for the maximum value
     dt_vol_inv = std::max( dti, dt_vol_inv );
 
@@ -199,20 +269,137 @@ double evaluate_time_step(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to compute nodal quantities
+//! \brief Split the vertices into ones that need ghost data and ones that 
+//!        do not.
 //!
-//! \param [in,out] mesh the mesh object
-//! \return 0 for success
+//! The scratch storage for the nodal solve is also sized here, for the
+//! largest vertex.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void build_vertex_partition( 
+  client_handle_r__<mesh_t>  mesh
+) {
+
+  using subset_t = mesh_t::subset_t;
+
+  // flag the owned entities
+  std::vector<bool> owned_cell( mesh.num_cells(), false );
+  for ( auto c : mesh.cells( flecsi::owned ) ) owned_cell[ c.id() ] = true;
+
+  std::vector<bool> owned_vertex( mesh.num_vertices(), false );
+  for ( auto v : mesh.vertices( flecsi::owned ) ) owned_vertex[ v.id() ] = true;
+
+  // an interior vertex is owned and only touches owned cells
+  auto & interior = globals::interior_vertices;
+  auto & boundary = globals::boundary_vertices;
+  interior.clear();
+  boundary.clear();
+
+  auto vs = mesh.vertices( subset_t::overlapping );
+  auto num_verts = vs.size();
+
+  std::size_t max_corners = 0;
+  std::size_t max_symmetry = 0;
+
+  for ( counter_t i=0; i<num_verts; ++i ) {
+    auto vt = vs[i];
+    auto is_interior = owned_vertex[ vt.id() ];
+    for ( auto c : mesh.cells(vt) ) 
+      is_interior = is_interior && owned_cell[ c.id() ];
+    if ( is_interior ) interior.emplace_back( i );
+    else               boundary.emplace_back( i );
+    // size the scratch storage, with at most one symmetry constraint per
+    // boundary tag
+    max_corners = std::max( max_corners, mesh.corners(vt).size() );
+    if ( vt->is_boundary() )
+      max_symmetry = std::max( max_symmetry, vt->tags().size() );
+  }
+
+  int num_threads = 1;
+#ifdef _OPENMP
+  num_threads = omp_get_max_threads();
+#endif
+  auto & workspaces = globals::nodal_workspaces;
+  workspaces.assign( num_threads, nodal_workspace_t() );
+  for ( auto & ws : workspaces ) ws.reserve( max_corners, max_symmetry );
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Build the geometry used by the solver.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void build_geometry_cache( 
+  client_handle_r__<mesh_t>  mesh
+) {
+  globals::geometry.build( mesh );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Flatten the corner connectivity.
+//!
+//! The threaded loops look up the vertex and cell of a corner, and the 
+//! corners of an owned cell, in these arrays instead of going through the 
+//! mesh.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void build_corner_connectivity( 
+  client_handle_r__<mesh_t>  mesh
+) {
+
+  auto num_corners = mesh.num_corners();
+
+  auto & corner_vertex = globals::corner_vertex;
+  auto & corner_cell = globals::corner_cell;
+  corner_vertex.assign( num_corners, 0 );
+  corner_cell.assign( num_corners, 0 );
+
+  for ( auto cn : mesh.corners() ) {
+    // a corner attaches to one vertex and one cell
+    corner_vertex[ cn.id() ] = mesh.vertices(cn).front().id();
+    corner_cell[ cn.id() ] = mesh.cells(cn).front().id();
+  }
+
+  // the corners of the owned cells, in the order of the owned cells
+  auto & offsets = globals::cell_corner_offsets;
+  auto & corners = globals::cell_corners;
+  offsets.clear();
+  corners.clear();
+  offsets.emplace_back( 0 );
+
+  for ( auto cl : mesh.cells( flecsi::owned ) ) {
+    for ( auto cn : mesh.corners(cl) ) corners.emplace_back( cn.id() );
+    offsets.emplace_back( corners.size() );
+  }
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////
+//! \brief Estimate the nodal velocity for a list of vertices.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] vertex_list  indices into the overlapping vertices
+////////////////////////////////////////////////////////////////////////////////
+template< typename C, typename V >
 void estimate_nodal_state( 
-  client_handle_r__<mesh_t>  mesh,
-  dense_handle_r__<vector_t> cell_vel,
-  dense_handle_w__<vector_t> vertex_vel // Hack to avoid communication
+  client_handle_r__<mesh_t> & mesh,
+  const std::vector<counter_t> & vertex_list,
+  C & cell_vel,
+  V & vertex_vel
 ) {
 
   using subset_t = mesh_t::subset_t;
-  for ( auto v : mesh.vertices(subset_t::overlapping) )
+  auto vs = mesh.vertices(subset_t::overlapping);
+  counter_t num_verts = vertex_list.size();
+
+  // each vertex only writes its own velocity
+  #pragma omp parallel for
+  for ( counter_t k=0; k<num_verts; ++k )
   {
+    auto v = vs[ vertex_list[k] ];
     vertex_vel(v) = 0.;
     const auto & cells = mesh.cells(v);
     for ( auto c : cells ) vertex_vel(v) += cell_vel(c);
@@ -222,25 +409,62 @@ void estimate_nodal_state(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to compute nodal quantities
+//! \brief The main task to estimate nodal quantities at the vertices that 
+//!        do not need ghost data.
 //!
 //! \param [in,out] mesh the mesh object
 //! \return 0 for success
 ////////////////////////////////////////////////////////////////////////////////
-void evaluate_nodal_state( 
+void estimate_nodal_state_interior( 
+  client_handle_r__<mesh_t>  mesh,
+  dense_handle_interior_r__<vector_t> cell_vel,
+  dense_handle_w__<vector_t> vertex_vel // Hack to avoid communication
+) {
+  estimate_nodal_state( 
+    mesh, globals::interior_vertices, cell_vel, vertex_vel
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The main task to estimate nodal quantities at the vertices that 
+//!        need ghost data.
+//!
+//! \param [in,out] mesh the mesh object
+//! \return 0 for success
+////////////////////////////////////////////////////////////////////////////////
+void estimate_nodal_state_boundary( 
   client_handle_r__<mesh_t>  mesh,
+  dense_handle_r__<vector_t> cell_vel,
+  dense_handle_w__<vector_t> vertex_vel // Hack to avoid communication
+) {
+  estimate_nodal_state( 
+    mesh, globals::boundary_vertices, cell_vel, vertex_vel
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the nodal velocity and corner forces for a list of 
+//!        vertices.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] vertex_list  indices into the overlapping vertices
+////////////////////////////////////////////////////////////////////////////////
+template< typename R, typename V, typename W >
+void evaluate_nodal_state( 
+  client_handle_r__<mesh_t> & mesh,
+  const std::vector<counter_t> & vertex_list,
   real_t soln_time,
-  dense_handle_r__<real_t> Vc,
-  dense_handle_r__<real_t> Mc,
-  dense_handle_r__<vector_t> uc,
-  dense_handle_r__<real_t> pc,
-  dense_handle_r__<real_t> dc,
-  dense_handle_r__<real_t> ec,
-  dense_handle_r__<real_t> Tc,
-  dense_handle_r__<real_t> ac,
-  dense_handle_w__<vector_t> un,
-  dense_handle_w__<vector_t> npc,
-  dense_handle_w__<vector_t> Fpc
+  R & Vc,
+  R & Mc,
+  V & uc,
+  R & pc,
+  R & dc,
+  R & ec,
+  R & Tc,
+  R & ac,
+  W & un,
+  W & npc,
+  W & Fpc
 ) {
 
   // get the number of dimensions and create a matrix
@@ -255,7 +479,27 @@ void evaluate_nodal_state(
   //----------------------------------------------------------------------------
   // Loop over each vertex
   //----------------------------------------------------------------------------
-  for ( auto vt : mesh.vertices( subset_t::overlapping ) ) {
+  auto vs = mesh.vertices( subset_t::overlapping );
+  counter_t num_verts = vertex_list.size();
+  const auto & corner_cell = globals::corner_cell;
+  const auto & geom = globals::geometry;
+
+  // each vertex only writes its own velocity and the forces of its own 
+  // corners, so the vertices are independent
+  #pragma omp parallel for
+  for ( counter_t k=0; k<num_verts; ++k ) {
+
+    auto vt = vs[ vertex_list[k] ];
+
+    // the scratch storage of this thread
+    int thread = 0;
+#ifdef _OPENMP
+    thread = omp_get_thread_num();
+#endif
+    assert( 
+      static_cast<std::size_t>(thread) < globals::nodal_workspaces.size() 
+    );
+    auto & workspace = globals::nodal_workspaces[thread];
 
     // create the final matrix the point
     matrix_t Mp(0);
@@ -265,8 +509,8 @@ void evaluate_nodal_state(
     auto cnrs = mesh.corners(vt);
     auto num_corners = cnrs.size();
 
-    // create some corner storage
-    std::vector< matrix_t > Mpc(num_corners, 0);
+    // get some zeroed corner storage
+    auto Mpc = workspace.corner_matrices( num_corners );
 
     //--------------------------------------------------------------------------
     // build point matrix
@@ -280,7 +524,7 @@ void evaluate_nodal_state(
       npc(cn) = 0;
 
       // corner attaches to one cell and one point
-      auto cl = mesh.cells(cn).front();
+      auto cl = corner_cell[ cn.id() ];
       // get the cell state (there is only one)
       auto state = pack(cl, Vc, Mc, uc, pc, dc, ec, Tc, ac);
 
@@ -297,8 +541,8 @@ void evaluate_nodal_state(
       for ( auto w : ws ) 
       {
         // get the first wedge normal
-        const auto & n = w->facet_normal();
-        const auto & l = w->facet_area();
+        const auto & n = geom.facet_normal( w.id() );
+        const auto & l = geom.facet_area( w.id() );
         // the final matrix
         // Mpc = zc * ( lpc^- npc^-.npc^-  + lpc^+ npc^+.npc^+ );
         ristra::math::outer_product( n, n, Mpc[j], zc*l );
@@ -326,7 +570,7 @@ void evaluate_nodal_state(
     if ( vt->is_boundary() ) {
 
       // this is used to keep track of the symmetry normals
-      std::map< tag_t, vector_t > symmetry_normals;
+      auto & symmetry_normals = workspace.symmetry_normals();
 
       // get the boundary tags
       const auto & point_tags =  vt->tags();
@@ -355,27 +599,21 @@ void evaluate_nodal_state(
           auto b = globals::boundaries.at( tag );
           // PRESSURE CONDITION
           if ( b->has_prescribed_pressure() ) {
-            const auto & n = w->facet_normal();
-            const auto & l = w->facet_area();
-            const auto & x = w->facet_centroid();
+            const auto & n = geom.facet_normal( w.id() );
+            const auto & l = geom.facet_area( w.id() );
+            const auto & x = geom.facet_centroid( w.id() );
             auto fact = l * b->pressure( x, soln_time );
             for ( int d=0; d<num_dims; ++d )
               rhs[d] -= fact * n[d];
           }
           // SYMMETRY CONDITION
           else if ( b->has_symmetry() ) {
-            const auto & n = w->facet_normal();
-            const auto & l = w->facet_area();
-            if ( symmetry_normals.count(tag) ) {
-              auto & tmp = symmetry_normals[tag];
-              for ( int d=0; d<num_dims; ++d )
-                tmp[d] += l * n[d];
-            }
-            else {
-              auto & tmp = symmetry_normals[tag];
-              for ( int d=0; d<num_dims; ++d )              
-                tmp[d] = l * n[d];
-            }
+            const auto & n = geom.facet_normal( w.id() );
+            const auto & l = geom.facet_area( w.id() );
+            vector_t tmp;
+            for ( int d=0; d<num_dims; ++d )
+              tmp[d] = l * n[d];
+            add_symmetry_normal( symmetry_normals, tag, tmp );
           } // END CONDITIONS
         } // for each tag
       } // for each wedge
@@ -393,9 +631,10 @@ void evaluate_nodal_state(
         auto num_symmetry = symmetry_normals.size();
         // the matrix size
         auto num_rows = num_dims+num_symmetry;
-        // create storage for the new system in a 1d array
-        std::vector< real_t > A( num_rows * num_rows, 0 ); // zerod
-        std::vector< real_t > b( num_rows ); // zerod
+        // get storage for the new system in a 1d array
+        auto system = workspace.augmented_system( num_rows ); // zerod
+        auto & A = system.first;
+        auto & b = system.second;
         // create the views
         auto A_view = ristra::utils::make_array_view( A, num_rows, num_rows );
         auto M_view = ristra::utils::make_array_view( Mp.data(), num_dims, num_dims );
@@ -444,8 +683,6 @@ void evaluate_nodal_state(
 
       // get the corner
       auto cn = cnrs[j];
-      // corner attaches to one cell and one point
-      auto cl = mesh.cells(cn).front();
     
       // now add the vertex component to the force
       matrix_vector( 
@@ -461,13 +698,79 @@ void evaluate_nodal_state(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to sum the forces and comput the cell changes
+//! \brief The main task to compute nodal quantities at the vertices that do
+//!        not need ghost data.
+//!
+//! The cell state is accessed without ghosts, so launching this task does 
+//! not wait on the ghost copy.  Whether the copy actually runs alongside it
+//! is up to the runtime: Legion defers it, the MPI runtime does it, blocking,
+//! when the boundary task is launched.
+//!
+//! \param [in,out] mesh the mesh object
+//! \return 0 for success
+////////////////////////////////////////////////////////////////////////////////
+void evaluate_nodal_state_interior( 
+  client_handle_r__<mesh_t>  mesh,
+  real_t soln_time,
+  dense_handle_interior_r__<real_t> Vc,
+  dense_handle_interior_r__<real_t> Mc,
+  dense_handle_interior_r__<vector_t> uc,
+  dense_handle_interior_r__<real_t> pc,
+  dense_handle_interior_r__<real_t> dc,
+  dense_handle_interior_r__<real_t> ec,
+  dense_handle_interior_r__<real_t> Tc,
+  dense_handle_interior_r__<real_t> ac,
+  dense_handle_w__<vector_t> un,
+  dense_handle_w__<vector_t> npc,
+  dense_handle_w__<vector_t> Fpc
+) {
+  evaluate_nodal_state( 
+    mesh, globals::interior_vertices, soln_time, 
+    Vc, Mc, uc, pc, dc, ec, Tc, ac, un, npc, Fpc
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The main task to compute nodal quantities at the vertices that 
+//!        need ghost data.
 //!
 //! \param [in,out] mesh the mesh object
 //! \return 0 for success
 ////////////////////////////////////////////////////////////////////////////////
-void evaluate_residual( 
+void evaluate_nodal_state_boundary( 
+  client_handle_r__<mesh_t>  mesh,
+  real_t soln_time,
+  dense_handle_r__<real_t> Vc,
+  dense_handle_r__<real_t> Mc,
+  dense_handle_r__<vector_t> uc,
+  dense_handle_r__<real_t> pc,
+  dense_handle_r__<real_t> dc,
+  dense_handle_r__<real_t> ec,
+  dense_handle_r__<real_t> Tc,
+  dense_handle_r__<real_t> ac,
+  dense_handle_w__<vector_t> un,
+  dense_handle_w__<vector_t> npc,
+  dense_handle_w__<vector_t> Fpc
+) {
+  evaluate_nodal_state( 
+    mesh, globals::boundary_vertices, soln_time, 
+    Vc, Mc, uc, pc, dc, ec, Tc, ac, un, npc, Fpc
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The main task to sum the forces and comput the cell changes
+//!
+//! The volume time step limit is computed while the residual is at hand, so
+//! that the step can skip evaluate_time_step.
+//!
+//! \param [in,out] mesh the mesh object
+//! \param [in] cfl  the time step constants
+//! \return the local volume time step limit
+////////////////////////////////////////////////////////////////////////////////
+real_t evaluate_residual( 
   client_handle_r__<mesh_t>  mesh,
+  time_constants_t cfl,
   dense_handle_r__<vector_t> uv,
   dense_handle_r__<vector_t> npc,
   dense_handle_r__<vector_t> Fpc,
@@ -477,7 +780,22 @@ void evaluate_residual(
 
   // TASK: loop over each cell and compute the residual
 
-  for ( auto cl : mesh.cells(flecsi::owned) ) {
+  // the maximum 1/dt due to the volume change
+  real_t dt_vol_inv(0);
+
+  auto cs = mesh.cells(flecsi::owned);
+  counter_t num_cells = cs.size();
+
+  const auto & geom = globals::geometry;
+  const auto & corner_vertex = globals::corner_vertex;
+  const auto & offsets = globals::cell_corner_offsets;
+  const auto & corners = globals::cell_corners;
+
+  // each cell only gathers from its own corners
+  #pragma omp parallel for reduction(max:dt_vol_inv)
+  for ( counter_t i=0; i<num_cells; ++i ) {
+
+    auto cl = cs[i];
     
     // Gather corner forces to compute the cell residual
 
@@ -485,27 +803,43 @@ void evaluate_residual(
     dudt(cl) = 0;
 
     // compute subcell forces
-    for ( auto cn : mesh.corners(cl) ) {
+    for ( auto j=offsets[i]; j<offsets[i+1]; ++j ) {
+      auto cn = corners[j];
       // corner attaches to one point and zone
-      auto pt = mesh.vertices(cn).front();
+      auto pt = corner_vertex[cn];
       // add contribution
       eqns_t::compute_update( uv(pt), Fpc(cn), npc(cn), dudt(cl) );
     }// corners    
+
+    // now check the volume change
+    auto dVdt = eqns_t::volumetric_rate_of_change( dudt(cl) );
+    auto dti = std::abs(dVdt) / geom.cell_volume( cl.id() );
+    // check for the maximum value
+    dt_vol_inv = std::max( dti, dt_vol_inv );
     
   } // cell
+
+  return cfl.volume / dt_vol_inv;
     
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief The main task to update the solution
 //!
+//! The state at n is read from its own buffers and left untouched, so the
+//! predictor and corrector can both start from it without saving and
+//! restoring it.
+//!
 //! \param [in,out] mesh the mesh object
+//! \param [in] uc_n,ec_n  the velocity and energy at n
 //!   \return 0 for success
 ////////////////////////////////////////////////////////////////////////////////
 void apply_update(
   client_handle_r__<mesh_t>  mesh,
 	real_t delta_t,
   dense_handle_r__<flux_data_t> dudt,
+  dense_handle_r__<vector_t> uc_n,
+  dense_handle_r__<real_t> ec_n,
   dense_handle_w__<real_t> Vc,
   dense_handle_r__<real_t> Mc,
   dense_handle_w__<vector_t> uc,
@@ -516,15 +850,26 @@ void apply_update(
   dense_handle_r__<real_t> ac
 ) {
 
+  auto cs = mesh.cells(flecsi::owned);
+  counter_t num_cells = cs.size();
+  const auto & geom = globals::geometry;
+
   // Using the cell residual, update the state
-  for ( auto cl : mesh.cells(flecsi::owned) ) {
+  #pragma omp parallel for
+  for ( counter_t i=0; i<num_cells; ++i ) {
+
+    auto cl = cs[i];
+
+    // start from the state at n
+    uc(cl) = uc_n(cl);
+    ec(cl) = ec_n(cl);
 
     // get the cell state
     auto u = pack(cl, Vc, Mc, uc, pc, dc, ec, Tc, ac);
 
     // apply the update
     eqns_t::update_state_from_flux( u, dudt(cl), delta_t );
-    eqns_t::update_volume( u, cl->volume() );
+    eqns_t::update_volume( u, geom.cell_volume( cl.id() ) );
 
   } // for
 
@@ -533,166 +878,421 @@ void apply_update(
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief The main task to move the mesh
 //!
+//! Only the geometry the solver uses is updated, and only for the cells
+//! that moved.  The rest of the mesh geometry goes stale.
+//!
+//! The coordinates at n are either set aside in \a coord0 on the way, or,
+//! for the corrector, read back from it, so they never need their own pass.
+//!
 //! \param [in,out] mesh the mesh object
+//! \param [in] save  if true, save the coordinates to \a coord0 and move
+//!   from them, otherwise move from the ones already in \a coord0
 //! \return 0 for success
 ////////////////////////////////////////////////////////////////////////////////
 void move_mesh(
 	 client_handle_r__<mesh_t> mesh,
 	 dense_handle_r__<vector_t> vel,
-	 real_t delta_t
+	 dense_handle_r__<vector_t> coord0, // Hack to avoid communication
+	 real_t delta_t,
+	 bool save
 ) {
 
   // Update ALL vertices, including ghost so that we dont need to communicate.
 	// DEFECT we are modifying the mesh, but its read-only.
 
-  for ( auto vt : mesh.vertices() ) {
+  auto vs = mesh.vertices();
+  counter_t num_verts = vs.size();
+
+  #pragma omp parallel for
+  for ( counter_t i=0; i<num_verts; ++i ) {
+    auto vt = vs[i];
+    auto & x = vt->coordinates();
+    if ( save )
+      coord0(vt) = x;
+    else
+      x = coord0(vt);
     for ( int d=0; d<mesh_t::num_dimensions; ++d )
-      vt->coordinates()[d] += delta_t * vel(vt)[d];
+      x[d] += delta_t * vel(vt)[d];
   }
 
-	// now update the geometry
-	mesh.update_geometry();
+	// now update the geometry the solver uses, which leaves that of the mesh 
+	// entities stale until something asks for it
+	globals::geometry.update( mesh );
 
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to save the coordinates
+//! \brief Check the geometry the solver uses against that of the mesh.
 //!
-//! \param [in,out] mesh the mesh object
-//! \return 0 for success
+//! \param [in] mesh the mesh object
+//! \param [in] tolerance  the largest relative difference allowed
 ////////////////////////////////////////////////////////////////////////////////
-void save_coordinates( 
-  client_handle_r__<mesh_t>  mesh,
-  dense_handle_r__<vector_t> coord0 // Hack to avoid communication
-)
-{
+void check_geometry_cache( 
+  client_handle_r__<mesh_t> mesh,
+  real_t tolerance
+) {
+  real_t volume_diff, length_diff;
+  std::tie( volume_diff, length_diff ) = 
+    globals::geometry.compare_with_mesh( mesh );
+
+  if ( volume_diff > tolerance || length_diff > tolerance )
+    throw_runtime_error( "The cached geometry differs from the mesh by " << 
+      volume_diff << " in the cell volumes and " << length_diff << 
+      " in the cell minimum lengths" );
+}
 
-  // Loop over vertices
-  auto vs = mesh.vertices();
-  auto num_verts = vs.size();
+////////////////////////////////////////////////////////////////////////////////
+/// \brief output the solution
+////////////////////////////////////////////////////////////////////////////////
+void output( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix,
+	char_array_t postfix,
+	size_t iteration,
+	real_t time,
+  size_t output_buffers,
+  size_t ranks_per_file,
+  char_array_t output_fields,
+  int output_compression,
+  char_array_t output_tolerances,
+  dense_handle_r__<real_t> d,
+  dense_handle_r__<vector_t> v,
+  dense_handle_r__<real_t> e,
+  dense_handle_r__<real_t> p,
+  dense_handle_r__<real_t> T,
+  dense_handle_r__<real_t> a,
+  dense_handle_r__<vector_t> vn
+) {
+  clog(info) << "OUTPUT MESH TASK" << std::endl;
+ 
+  // the writer reads the geometry of the mesh entities
+  globals::geometry.update_mesh_geometry( mesh );
+
+  // get the context
+  auto & context = flecsi::execution::context_t::instance();
+
+  // the fields that can be written, of which only the selected ones are
+  using flecsale::io::cell_field;
+  using flecsale::io::vertex_field;
+  auto fields = std::make_tuple(
+    cell_field( "density", d ),
+    cell_field( "velocity", v ),
+    cell_field( "internal_energy", e ),
+    cell_field( "pressure", p ),
+    cell_field( "temperature", T ),
+    cell_field( "sound_speed", a ),
+    vertex_field( "node_velocity", vn )
+  );
+
+  // the files are created on the first output, and named after that 
+  // iteration so a restarted run never overwrites the earlier output
+  auto & writer = globals::solution_output;
+  if ( !writer.is_open() ) {
+
+    auto selection = apps::common::split_names( output_fields.str() );
+    writer.set_compression( 
+      output_compression, 
+      apps::common::parse_tolerances( output_tolerances.str() )
+    );
+    // the mesh moves, so the vertex displacements are appended too
+    std::apply( 
+      [&]( const auto &... f ) { writer.select( true, selection, f... ); },
+      fields
+    );
+
+    // the ranks only write the cells they own, and their global ids tie 
+    // the parts of the files together
+    std::vector<bool> is_owned( mesh.num_cells(), false );
+    for ( auto c : mesh.cells( flecsi::owned ) ) is_owned[c.id()] = true;
+    const auto & cell_ids = 
+      context.index_map( mesh_t::index_spaces_t::cells );
+    const auto & vertex_ids = 
+      context.index_map( mesh_t::index_spaces_t::vertices );
+
+    auto suffix = "_" + apps::common::zero_padded(iteration);
+    auto file_name = [&]( size_t id ) {
+      return prefix.str() + "_part" + apps::common::zero_padded(id) + 
+        suffix + "." + postfix.str();
+    };
+
+    writer.open( 
+      mesh, ranks_per_file, output_buffers, file_name, 
+      prefix.str() + suffix + ".index",
+      [&]( auto c ) { return is_owned[c]; },
+      [&]( auto c ) { return cell_ids.at(c); },
+      [&]( auto v ) { return vertex_ids.at(v); }
+    );
 
-  #pragma omp parallel for
-  for ( counter_t i=0; i<num_verts; i++ ) {
-    auto vt = vs[i];
-    coord0(vt) = vt->coordinates();
   }
 
+  // the writers append the solution in the background while it advances
+  std::apply( 
+    [&]( const auto &... f ) { writer.write( mesh, time, f... ); },
+    fields
+  );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to restore the coordinates
-//!
-//! \param [in,out] mesh the mesh object
-//! \return 0 for success
+/// \brief Finish writing the output and close it.
 ////////////////////////////////////////////////////////////////////////////////
-void restore_coordinates( 
-  client_handle_r__<mesh_t>  mesh,
-  dense_handle_r__<vector_t> coord0
-)
+void finish_output()
 {
+  globals::solution_output.close();
+}
 
-  // Loop over vertices
-  auto vs = mesh.vertices();
-  auto num_verts = vs.size();
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Append the solution at the probes to their time history.
+////////////////////////////////////////////////////////////////////////////////
+void sample_probes( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix,
+  size_t iteration,
+  real_t time,
+  char_array_t probes,
+  char_array_t probe_fields,
+  dense_handle_r__<real_t> d,
+  dense_handle_r__<vector_t> v,
+  dense_handle_r__<real_t> e,
+  dense_handle_r__<real_t> p,
+  dense_handle_r__<real_t> T,
+  dense_handle_r__<real_t> a,
+  dense_handle_r__<vector_t> vn
+) {
+  // the probes are located with the geometry of the mesh entities
+  globals::geometry.update_mesh_geometry( mesh );
+
+  // the fields that can be sampled
+  using flecsale::io::cell_field;
+  using flecsale::io::vertex_field;
+  auto fields = std::make_tuple(
+    cell_field( "density", d ),
+    cell_field( "velocity", v ),
+    cell_field( "internal_energy", e ),
+    cell_field( "pressure", p ),
+    cell_field( "temperature", T ),
+    cell_field( "sound_speed", a ),
+    vertex_field( "node_velocity", vn )
+  );
 
-  #pragma omp parallel for
-  for ( counter_t i=0; i<num_verts; i++ ) {
-    auto vt = vs[i];
-    vt->coordinates() = coord0(vt);
+  // the probes are located on the first sample, and the history is named 
+  // after that iteration like the output is
+  auto & history = globals::probes;
+  if ( !history.is_open() ) {
+    auto selection = apps::common::split_names( probe_fields.str() );
+    auto filename = prefix.str() + "_probes." + 
+      apps::common::zero_padded(iteration) + ".csv";
+    // the mesh moves, so the probes are found again before each sample
+    std::apply( 
+      [&]( const auto &... f ) { 
+        history.open( 
+          mesh, mesh.cells( flecsi::owned ), probes.str(), selection, 
+          true, filename, f... 
+        );
+      },
+      fields
+    );
   }
 
+  std::apply( 
+    [&]( const auto &... f ) { history.sample( mesh, iteration, time, f... ); },
+    fields
+  );
 }
 
-
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to save the coordinates
+//! \brief Write the checkpoint of this rank.
 //!
-//! \param [in,out] mesh the mesh object
-//! \return 0 for success
+//! The ghosts are included, since the vertex coordinates and the saved 
+//! solution are updated without communication.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] prefix  the case prefix
+//! \param [in] info  the solution state that is not stored in fields
 ////////////////////////////////////////////////////////////////////////////////
-void save_solution( 
-  client_handle_r__<mesh_t>  mesh,
-  dense_handle_r__<vector_t> cell_vel,
-	dense_handle_r__<real_t> cell_ener,
-	dense_handle_r__<vector_t> cell_vel_0, // "r" permissions hack to avoid communication
-	dense_handle_r__<real_t> cell_ener_0   // "r" permissions hack to avoid communication
-)
-{
+void write_checkpoint( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix,
+  apps::common::checkpoint_info_t info,
+  bool compress,
+  dense_handle_r__<real_t> V,
+  dense_handle_r__<real_t> M,
+  dense_handle_r__<vector_t> v,
+  dense_handle_r__<real_t> p,
+  dense_handle_r__<real_t> d,
+  dense_handle_r__<real_t> e,
+  dense_handle_r__<real_t> T,
+  dense_handle_r__<real_t> a,
+  dense_handle_r__<vector_t> v0,
+  dense_handle_r__<real_t> e0,
+  dense_handle_r__<vector_t> coord0
+) {
+
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  apps::common::checkpoint_writer_t file( 
+    apps::common::checkpoint_filename( prefix.str(), rank, info.step ), info,
+    compress
+  );
 
-  // Loop over cells
   auto cs = mesh.cells();
-  auto num_cells = cs.size();
+  file.write_field( "cell_volume", cs, V );
+  file.write_field( "cell_mass", cs, M );
+  file.write_field( "cell_velocity", cs, v );
+  file.write_field( "cell_pressure", cs, p );
+  file.write_field( "cell_density", cs, d );
+  file.write_field( "cell_internal_energy", cs, e );
+  file.write_field( "cell_temperature", cs, T );
+  file.write_field( "cell_sound_speed", cs, a );
+  file.write_field( "cell_velocity_0", cs, v0 );
+  file.write_field( "cell_internal_energy_0", cs, e0 );
 
-  #pragma omp parallel for
-  for ( counter_t i=0; i<num_cells; i++ ) {
-    auto c = cs[i];
-    cell_vel_0(c) = cell_vel(c);
-    cell_ener_0(c) = cell_ener(c);
-  }
+  auto vs = mesh.vertices();
+  file.write_field( "node_coordinates", vs, coord0 );
+  file.write_field( 
+    "coordinates", vs, []( auto vt ) -> auto & { return vt->coordinates(); }
+  );
 
+  file.close();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to restore the coordinates
+//! \brief Read the checkpoint of this rank.
 //!
-//! \param [in,out] mesh the mesh object
-//! \return 0 for success
+//! \param [in] mesh the mesh object
+//! \param [in] prefix  the case prefix
+//! \param [in] step  the step the checkpoint was taken at
+//! \return the solution state that is not stored in fields
 ////////////////////////////////////////////////////////////////////////////////
-void restore_solution( 
-  client_handle_r__<mesh_t>  mesh,
-	dense_handle_r__<vector_t> cell_vel_0,
-  dense_handle_w__<vector_t> cell_vel,
-	dense_handle_r__<real_t> cell_ener_0,
-	dense_handle_w__<real_t> cell_ener
-)
-{
+apps::common::checkpoint_info_t read_checkpoint( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix,
+  size_t step,
+  dense_handle_w__<real_t> V,
+  dense_handle_w__<real_t> M,
+  dense_handle_w__<vector_t> v,
+  dense_handle_w__<real_t> p,
+  dense_handle_w__<real_t> d,
+  dense_handle_w__<real_t> e,
+  dense_handle_w__<real_t> T,
+  dense_handle_w__<real_t> a,
+  dense_handle_w__<vector_t> v0,
+  dense_handle_w__<real_t> e0,
+  dense_handle_w__<vector_t> coord0
+) {
+
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  apps::common::checkpoint_reader_t file( 
+    apps::common::checkpoint_filename( prefix.str(), rank, step )
+  );
 
-  // Loop over cells
   auto cs = mesh.cells();
-  auto num_cells = cs.size();
+  file.read_field( "cell_volume", cs, V );
+  file.read_field( "cell_mass", cs, M );
+  file.read_field( "cell_velocity", cs, v );
+  file.read_field( "cell_pressure", cs, p );
+  file.read_field( "cell_density", cs, d );
+  file.read_field( "cell_internal_energy", cs, e );
+  file.read_field( "cell_temperature", cs, T );
+  file.read_field( "cell_sound_speed", cs, a );
+  file.read_field( "cell_velocity_0", cs, v0 );
+  file.read_field( "cell_internal_energy_0", cs, e0 );
 
-  #pragma omp parallel for
-  for ( counter_t i=0; i<num_cells; i++ ) {
-    auto c = cs[i];
-    cell_vel(c) = cell_vel_0(c);
-    cell_ener(c) = cell_ener_0(c);
-  }
+  auto vs = mesh.vertices();
+  file.read_field( "node_coordinates", vs, coord0 );
+  file.read_field( 
+    "coordinates", vs, []( auto vt ) -> auto & { return vt->coordinates(); }
+  );
+
+  globals::geometry.update( mesh );
+  globals::geometry.update_mesh_geometry( mesh );
 
+  return file.info();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Write the mesh bundle of this rank.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] prefix  the bundle prefix
+////////////////////////////////////////////////////////////////////////////////
+void write_mesh_bundle( 
+  client_handle_r__<mesh_t> mesh, 
+  char_array_t prefix
+) {
+
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  apps::common::mesh_bundle_writer_t bundle( 
+    mesh_t::num_dimensions, rank, context.colors()
+  );
+  apps::common::add_mesh_sections( bundle, mesh );
+
+  // the partition, with the owners of the ghosts from the coloring
+  auto add_partition = [&]( 
+    const std::string & name, auto index_space, auto && exclusive, 
+    auto && shared, auto && ghost, std::size_t num_entities 
+  ) {
+    const auto & ids = context.index_map( index_space );
+    std::map<std::size_t, std::size_t> owners;
+    for ( const auto & entity : context.coloring( index_space ).ghost )
+      owners[ entity.id ] = entity.rank;
+    apps::common::add_partition_sections( 
+      bundle, name, num_entities, exclusive, shared, ghost,
+      [&]( auto i ) { return ids.at(i); },
+      [&]( auto id ) { return owners.at(id); }
+    );
+  };
+  add_partition( 
+    "cell", mesh_t::index_spaces_t::cells, mesh.cells( flecsi::exclusive ),
+    mesh.cells( flecsi::shared ), mesh.cells( flecsi::ghost ),
+    mesh.num_cells()
+  );
+  add_partition( 
+    "vertex", mesh_t::index_spaces_t::vertices, 
+    mesh.vertices( flecsi::exclusive ), mesh.vertices( flecsi::shared ), 
+    mesh.vertices( flecsi::ghost ), mesh.num_vertices()
+  );
 
+  bundle.write( apps::common::mesh_bundle_filename( prefix.str(), rank ) );
+}
 
 ////////////////////////////////////////////////////////////////////////////////
-/// \brief output the solution
+//! \brief Check that the mesh bundle of this rank matches the mesh.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] prefix  the bundle prefix
 ////////////////////////////////////////////////////////////////////////////////
-void output( 
+void check_mesh_bundle( 
   client_handle_r__<mesh_t> mesh, 
-  char_array_t prefix,
-	char_array_t postfix,
-	size_t iteration,
-	real_t time,
-  dense_handle_r__<real_t> d,
-  dense_handle_r__<vector_t> v,
-  dense_handle_r__<real_t> e,
-  dense_handle_r__<real_t> p,
-  dense_handle_r__<real_t> T,
-  dense_handle_r__<real_t> a
+  char_array_t prefix
 ) {
-  clog(info) << "OUTPUT MESH TASK" << std::endl;
- 
-  // get the context
+
   auto & context = flecsi::execution::context_t::instance();
   auto rank = context.color();
 
-  // figure out this ranks file name
-  auto output_filename = 
-    prefix.str() + "_rank" + apps::common::zero_padded(rank) +
-    "_" + apps::common::zero_padded(iteration) + "." + postfix.str();
+  auto filename = apps::common::mesh_bundle_filename( prefix.str(), rank );
+  apps::common::mesh_bundle_t bundle( filename, /* verify */ true );
+  if ( bundle.rank() != rank || bundle.num_ranks() != context.colors() )
+    throw_runtime_error( "Mesh bundle \"" << filename << 
+      "\" is for another rank" );
 
-  // now outut the mesh
-  flecsale::io::io_exodus__<mesh_t>::write(
-    output_filename, mesh, iteration, time, &d //, v, e, p, T, a
-  );
+  auto differs = apps::common::compare_mesh_sections( bundle, mesh );
+  if ( !differs.empty() )
+    throw_runtime_error( "Mesh bundle \"" << filename << 
+      "\" does not match the mesh in " << differs );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Count the cells owned by this rank.
+////////////////////////////////////////////////////////////////////////////////
+counter_t count_owned_cells( 
+  client_handle_r__<mesh_t> mesh
+) {
+  return mesh.cells( flecsi::owned ).size();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -732,19 +1332,29 @@ void print(
 
 flecsi_register_task(validate_mesh, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(initial_conditions, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(setup_materials, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(install_boundary, apps::hydro, loc, single|flecsi::leaf);
-flecsi_register_task(estimate_nodal_state, apps::hydro, loc, single|flecsi::leaf);
-flecsi_register_task(evaluate_nodal_state, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(build_vertex_partition, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(build_corner_connectivity, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(build_geometry_cache, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(estimate_nodal_state_interior, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(estimate_nodal_state_boundary, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(evaluate_nodal_state_interior, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(evaluate_nodal_state_boundary, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(evaluate_residual, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(evaluate_time_step, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(move_mesh, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(check_geometry_cache, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(apply_update, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(update_state_from_energy, apps::hydro, loc, single|flecsi::leaf);
-flecsi_register_task(save_coordinates, apps::hydro, loc, single|flecsi::leaf);
-flecsi_register_task(restore_coordinates, apps::hydro, loc, single|flecsi::leaf);
-flecsi_register_task(save_solution, apps::hydro, loc, single|flecsi::leaf);
-flecsi_register_task(restore_solution, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(output, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(finish_output, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(sample_probes, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(write_checkpoint, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(read_checkpoint, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(write_mesh_bundle, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(check_mesh_bundle, apps::hydro, loc, single|flecsi::leaf);
+flecsi_register_task(count_owned_cells, apps::hydro, loc, single|flecsi::leaf);
 flecsi_register_task(print, apps::hydro, loc, single|flecsi::leaf);
 
 } // namespace hydro
@@ -13,7 +13,10 @@
 #include <flecsale-config.h>
 #include <flecsale/eqns/lagrange_eqns.h>
 #include <flecsale/eqns/flux.h>
+#include <flecsale/eos/eos_variant.h>
 #include <flecsale/eos/ideal_gas.h>
+#include <flecsale/eos/stiffened_gas.h>
+#include <flecsale/eos/tabular_eos.h>
 #include <ristra/math/general.h>
 #include <ristra/math/matrix.h>
 
@@ -21,8 +24,15 @@
 #include <flecsi-sp/utils/types.h>
 #include <flecsi-sp/burton/burton_mesh.h>
 
+#include <flecsi/data/dense_accessor.h>
+
 #include "../common/utils.h"
 
+// system includes
+#include <cstdlib>
+#include <map>
+#include <string>
+
 namespace apps {
 namespace hydro {
 
@@ -32,7 +42,16 @@ using real_t = mesh_t::real_t;
 using vector_t = mesh_t::vector_t;
 using counter_t = mesh_t::counter_t;
 
-using eos_t = flecsale::eos::ideal_gas_t<real_t>;
+//! \brief the equations of state a material can have
+using eos_t = flecsale::eos::eos_variant__<
+  real_t,
+  flecsale::eos::ideal_gas_t,
+  flecsale::eos::stiffened_gas_t,
+  flecsale::eos::tabular_eos_t
+>;
+
+//! \brief a map for the equations of state of regions, by region number
+using eos_map_t = std::map< std::size_t, eos_t >;
 
 using eqns_t = typename flecsale::eqns::lagrange_eqns_t<real_t, mesh_t::num_dimensions>;
 
@@ -58,6 +77,13 @@ using dense_handle_rw__ = flecsi_sp::utils::dense_handle_rw__<T>;
 template<typename T>
 using dense_handle_r__ = flecsi_sp::utils::dense_handle_r__<T>;
 
+// the access permission types that leave out the ghost entities.  Launching 
+// a task with these does not wait on a ghost update, though only a runtime
+// that defers the update, like Legion, runs it alongside the task.
+template<typename T>
+using dense_handle_interior_r__ = 
+  flecsi::dense_accessor__<T, flecsi::ro, flecsi::ro, flecsi::na>;
+
 template<typename DC>
 using client_handle_w__ = flecsi_sp::utils::client_handle_w__<DC>;
 
@@ -146,14 +172,44 @@ inline boundary_condition_t * make_boundary_condition( const std::string & str )
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Find out if the geometry the solver keeps should be checked.
+//!
+//! It is requested with "--check-geometry [<tolerance>]" on the command 
+//! line, and compared against the geometry of the moved mesh at the end of 
+//! the run.
+//!
+//! \param [in] argc,argv  the command line arguments
+//! \param [in,out] tolerance  the largest relative difference allowed, only
+//!                            changed if one is given
+//! \return true if the check was requested
+////////////////////////////////////////////////////////////////////////////////
+inline bool check_geometry_requested( 
+  int argc, char ** argv, real_t & tolerance 
+) {
+  bool requested = false;
+  for ( int i=1; i<argc; ++i ) {
+    if ( std::string( argv[i] ) != "--check-geometry" ) continue;
+    requested = true;
+    if ( i+1 < argc && argv[i+1][0] != '-' ) {
+      char * end;
+      tolerance = std::strtod( argv[i+1], &end );
+      if ( *end != '\0' || !( tolerance >= 0 ) )
+        throw_runtime_error( "Bad geometry tolerance \"" << argv[i+1] << 
+          "\"" );
+      ++i;
+    }
+  }
+  return requested;
+}
+
+
 //! \brief a type for storing boundary tags
 using tag_t = mesh_t::tag_t;
 
 //! \brief a map for storing links between boundary conditions and tags
 using boundary_map_t = std::map< tag_t, boundary_condition_t * >;
 
-//! \breif a map for equations of state
-using eos_map_t = std::map< tag_t, eos_t * >;
 
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief Pack data into a tuple
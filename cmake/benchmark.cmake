@@ -0,0 +1,84 @@
+#~----------------------------------------------------------------------------~#
+# Copyright (c) 2016 Los Alamos National Security, LLC
+# All rights reserved.
+#~----------------------------------------------------------------------------~#
+
+# get the scripts directory
+set(BENCHMARK_CMAKE_DIR ${CMAKE_CURRENT_LIST_DIR} )
+
+#-------------------------------------------------------------------------------
+# This macro creates a scaling benchmark.
+#
+# The COMMAND is run for every combination of RANKS and THREADS on each of
+# the MESHES.  Strong scaling uses the given meshes plus boxes generated
+# with the sizes in GENERATE, e.g. 64x64.  Weak scaling uses generated boxes
+# with the per-rank sizes in WEAK, stretched in x by the number of ranks.
+# The results are written to <NAME>.csv and <NAME>.json.
+
+function(create_scaling_benchmark)
+  if (FLECSALE_ENABLE_BENCHMARKS)
+
+    # parse the arguments
+    set(options)
+    set(oneValueArgs NAME COMMAND)
+    set(multiValueArgs MESHES GENERATE WEAK RANKS THREADS)
+    cmake_parse_arguments(args "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN} )
+  
+    # check the preconditions
+    if( NOT args_NAME )
+      message( FATAL_ERROR "You must specify a benchmark name using NAME." )
+    endif()
+  
+    if( NOT args_COMMAND )
+      message( FATAL_ERROR "You must specify a command using COMMAND." )
+    endif()
+
+    if( (args_GENERATE OR args_WEAK) AND NOT TARGET box_mesh )
+      message( STATUS "Exodus is needed to generate meshes for ${args_NAME}" )
+      set( args_GENERATE )
+      set( args_WEAK )
+    endif()
+
+    if( NOT args_MESHES AND NOT args_GENERATE AND NOT args_WEAK )
+      message( FATAL_ERROR "You must specify at least one mesh using MESHES, "
+        "GENERATE or WEAK." )
+    endif()
+  
+    # default to serial runs
+    if( NOT args_RANKS )
+      set( args_RANKS 1 )
+    endif()
+    if( NOT args_THREADS )
+      set( args_THREADS 1 )
+    endif()
+
+    # lists can not be passed through add_test, so use commas
+    foreach( _var MESHES GENERATE WEAK RANKS THREADS )
+      string( REPLACE ";" "," args_${_var} "${args_${_var}}" )
+    endforeach()
+
+    if ( TARGET box_mesh )
+      set( _generator $<TARGET_FILE:box_mesh> )
+    endif()
+  
+    # add the test
+    add_test( 
+      NAME ${args_NAME}
+      COMMAND ${CMAKE_COMMAND}
+        -Dbenchmark_name=${args_NAME}
+        -Dbenchmark_cmd=${args_COMMAND}
+        -Dmeshes=${args_MESHES}
+        -Dgenerate=${args_GENERATE}
+        -Dweak=${args_WEAK}
+        -Dranks=${args_RANKS}
+        -Dthreads=${args_THREADS}
+        -Dmesh_generator=${_generator}
+        -P ${BENCHMARK_CMAKE_DIR}/run_scaling.cmake
+    )
+
+    # the runs should not compete with anything else
+    set_tests_properties( ${args_NAME} 
+      PROPERTIES LABELS benchmark RUN_SERIAL ON )
+  
+  endif(FLECSALE_ENABLE_BENCHMARKS)
+endfunction()
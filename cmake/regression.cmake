@@ -76,3 +76,109 @@ function(create_regression_test)
   endif(ENABLE_REGRESSION_TESTS)
 endfunction()
  
+
+#-------------------------------------------------------------------------------
+# This macro creates a test that the threads do not change the answer.
+#
+# The COMMAND is run once with one thread and once with each of the THREADS,
+# each in a directory of its own, and every output matching COMPARE must be
+# identical to the one thread output, byte for byte.
+
+function(create_thread_comparison_test)
+  if (ENABLE_REGRESSION_TESTS AND ENABLE_OPENMP)
+
+    # parse the arguments
+    set(options)
+    set(oneValueArgs NAME COMPARE)
+    set(multiValueArgs COMMAND THREADS)
+    cmake_parse_arguments(args "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN} )
+  
+    # check the preconditions
+    if( NOT args_NAME )
+      message( FATAL_ERROR "You must specify a test name using NAME." )
+    endif()
+  
+    if( NOT args_COMMAND )
+      message( FATAL_ERROR "You must specify a test command using COMMAND." )
+    endif()
+  
+    if( NOT args_COMPARE )
+      message( FATAL_ERROR "You must specify the outputs to compare using "
+        "COMPARE.")
+    endif()
+  
+    if( NOT args_THREADS )
+      set( args_THREADS 2 4 )
+    endif()
+
+    # lists can not be passed through add_test, so use commas
+    string( REPLACE ";" "," args_THREADS "${args_THREADS}" )
+
+    # add the test
+    add_test( 
+      NAME ${args_NAME}
+      COMMAND ${CMAKE_COMMAND}
+        "-Dtest_cmd=${args_COMMAND}"
+        -Dtest_name=${args_NAME}
+        -Doutput_pattern=${args_COMPARE}
+        -Dthreads=${args_THREADS}
+        -P ${REGRESSION_CMAKE_DIR}/run_thread_comparison.cmake
+    )
+  
+  endif()
+endfunction()
+
+#-------------------------------------------------------------------------------
+# This macro creates a test that some command line options do not change the
+# answer.
+#
+# The COMMAND is run once with each of the OPTIONS appended, each in a 
+# directory of its own, and every output matching COMPARE must be identical
+# to the one from the first option, byte for byte.  An option with several
+# arguments joins them with colons, like "--update-mode:fused".
+
+function(create_option_comparison_test)
+  if (ENABLE_REGRESSION_TESTS)
+
+    # parse the arguments
+    set(options)
+    set(oneValueArgs NAME COMPARE)
+    set(multiValueArgs COMMAND OPTIONS)
+    cmake_parse_arguments(args "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN} )
+  
+    # check the preconditions
+    if( NOT args_NAME )
+      message( FATAL_ERROR "You must specify a test name using NAME." )
+    endif()
+  
+    if( NOT args_COMMAND )
+      message( FATAL_ERROR "You must specify a test command using COMMAND." )
+    endif()
+  
+    if( NOT args_COMPARE )
+      message( FATAL_ERROR "You must specify the outputs to compare using "
+        "COMPARE.")
+    endif()
+  
+    list( LENGTH args_OPTIONS _num_options )
+    if( _num_options LESS 2 )
+      message( FATAL_ERROR "You must specify at least two sets of options "
+        "to compare using OPTIONS.")
+    endif()
+
+    # lists can not be passed through add_test, so use commas
+    string( REPLACE ";" "," args_OPTIONS "${args_OPTIONS}" )
+
+    # add the test
+    add_test( 
+      NAME ${args_NAME}
+      COMMAND ${CMAKE_COMMAND}
+        "-Dtest_cmd=${args_COMMAND}"
+        -Dtest_name=${args_NAME}
+        -Doutput_pattern=${args_COMPARE}
+        -Doptions=${args_OPTIONS}
+        -P ${REGRESSION_CMAKE_DIR}/run_option_comparison.cmake
+    )
+  
+  endif()
+endfunction()
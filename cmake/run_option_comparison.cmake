@@ -0,0 +1,95 @@
+#~----------------------------------------------------------------------------~#
+# Copyright (c) 2016 Los Alamos National Security, LLC
+# All rights reserved.
+#~----------------------------------------------------------------------------~#
+
+# some argument checking:
+
+# test_cmd is the command to run with all its arguments
+if( NOT test_cmd )
+   message( FATAL_ERROR "Variable test_cmd not defined" )
+endif()
+
+# test_name is the prefix of the run directories
+if( NOT test_name )
+   message( FATAL_ERROR "Variable test_name not defined" )
+endif()
+
+# output_pattern matches the outputs to compare
+if( NOT output_pattern )
+   message( FATAL_ERROR "Variable output_pattern not defined" )
+endif()
+
+# the options are passed as a comma separated list
+if( NOT options )
+   message( FATAL_ERROR "Variable options not defined" )
+endif()
+string( REPLACE "," ";" options "${options}" )
+
+separate_arguments( test_cmd ) 
+
+#-------------------------------------------------------------------------------
+# Run the command with some options, in a directory of its own
+
+function( run_with_options index option )
+
+  # the arguments of one option are joined with colons
+  string( REPLACE ":" ";" _args "${option}" )
+  set( _cmd ${test_cmd} ${_args} )
+  string(REPLACE ";" " " _cmd_string "${_cmd}")
+
+  set( _dir ${CMAKE_CURRENT_BINARY_DIR}/${test_name}_${index} )
+  file( REMOVE_RECURSE ${_dir} )
+  file( MAKE_DIRECTORY ${_dir} )
+
+  message(STATUS "Executing '${_cmd_string}'")
+
+  execute_process(
+    COMMAND ${_cmd}
+    WORKING_DIRECTORY ${_dir}
+    OUTPUT_FILE ${_dir}/log
+    RESULT_VARIABLE _failed
+  )
+
+  if( _failed )
+    message( FATAL_ERROR "Error running ${_cmd_string}" )
+  endif()
+
+endfunction()
+
+#-------------------------------------------------------------------------------
+# The run with the first options is the standard
+
+list( GET options 0 _first )
+list( REMOVE_AT options 0 )
+
+run_with_options( 0 "${_first}" )
+
+set( _first_dir ${CMAKE_CURRENT_BINARY_DIR}/${test_name}_0 )
+file( GLOB _outputs RELATIVE ${_first_dir} ${_first_dir}/${output_pattern} )
+
+if( NOT _outputs )
+  message( FATAL_ERROR "The first run wrote nothing matching "
+    "${output_pattern}" )
+endif()
+
+set( _index 0 )
+foreach( _option ${options} )
+
+  math( EXPR _index "${_index} + 1" )
+  run_with_options( ${_index} "${_option}" )
+  set( _dir ${CMAKE_CURRENT_BINARY_DIR}/${test_name}_${_index} )
+
+  foreach( _output ${_outputs} )
+    execute_process(
+      COMMAND ${CMAKE_COMMAND} -E compare_files 
+        ${_first_dir}/${_output} ${_dir}/${_output}
+      RESULT_VARIABLE _differ
+    )
+    if( _differ )
+      message( SEND_ERROR "${_output} with \"${_option}\" does not match "
+        "the one with \"${_first}\"!" )
+    endif()
+  endforeach()
+
+endforeach()
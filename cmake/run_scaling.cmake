@@ -0,0 +1,137 @@
+#~----------------------------------------------------------------------------~#
+# Copyright (c) 2016 Los Alamos National Security, LLC
+# All rights reserved.
+#~----------------------------------------------------------------------------~#
+
+# the json reports are parsed with string(JSON)
+cmake_minimum_required(VERSION 3.19)
+
+# some argument checking:
+
+# benchmark_name is the prefix of the output tables
+if( NOT benchmark_name )
+   message( FATAL_ERROR "Variable benchmark_name not defined" )
+endif()
+
+# benchmark_cmd is the executable to run
+if( NOT benchmark_cmd )
+   message( FATAL_ERROR "Variable benchmark_cmd not defined" )
+endif()
+
+# the sweeps are passed as comma separated lists
+foreach( _var meshes generate weak ranks threads )
+  string( REPLACE "," ";" ${_var} "${${_var}}" )
+endforeach()
+
+# the columns of the table
+set( columns 
+  zones steps seconds 
+  zone_cycles_per_second
+  zone_cycles_per_second_per_rank
+  zone_cycles_per_second_per_thread
+)
+
+string( REPLACE ";" "," header "scaling,mesh,ranks,threads;${columns}" )
+set( csv "${header}\n" )
+set( json_runs )
+
+#-------------------------------------------------------------------------------
+# Generate a box mesh
+
+function( generate_mesh size output )
+  if ( NOT mesh_generator )
+    message( FATAL_ERROR "No mesh generator available for ${size}" )
+  endif()
+  string( REPLACE "x" ";" _dims ${size} )
+  execute_process(
+    COMMAND ${mesh_generator} ${output} ${_dims}
+    RESULT_VARIABLE _failed
+  )
+  if( _failed )
+    message( FATAL_ERROR "Error generating ${output}" )
+  endif()
+endfunction()
+
+#-------------------------------------------------------------------------------
+# Run one case and record the results
+
+macro( run_case scaling mesh nranks nthreads )
+
+  get_filename_component( _mesh_name ${mesh} NAME_WE )
+  set( _report 
+    "${benchmark_name}_${_mesh_name}_${nranks}ranks_${nthreads}threads.json" )
+  file( REMOVE ${_report} )
+
+  message( STATUS 
+    "Running ${_mesh_name} on ${nranks} ranks with ${nthreads} threads" )
+
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} -E env 
+      OMP_NUM_THREADS=${nthreads} FLECSALE_BENCHMARK=${_report}
+      mpirun -n ${nranks} ${benchmark_cmd} -m ${mesh}
+    OUTPUT_FILE ${benchmark_name}_${_mesh_name}_${nranks}ranks_${nthreads}threads.log
+    RESULT_VARIABLE _failed
+  )
+
+  if( _failed OR NOT EXISTS ${_report} )
+    message( SEND_ERROR "Error running ${_mesh_name} on ${nranks} ranks" )
+  else()
+    file( READ ${_report} _run )
+    set( _line "${scaling},${_mesh_name},${nranks},${nthreads}" )
+    foreach( _col ${columns} )
+      string( JSON _value GET "${_run}" ${_col} )
+      string( APPEND _line ",${_value}" )
+    endforeach()
+    string( APPEND csv "${_line}\n" )
+    string( JSON _run SET "${_run}" scaling "\"${scaling}\"" )
+    string( JSON _run SET "${_run}" mesh "\"${_mesh_name}\"" )
+    list( APPEND json_runs "${_run}" )
+  endif()
+
+endmacro()
+
+#-------------------------------------------------------------------------------
+# Strong scaling: the mesh stays fixed as resources are added
+
+foreach( _size ${generate} )
+  set( _mesh ${CMAKE_CURRENT_BINARY_DIR}/box_${_size}.g )
+  generate_mesh( ${_size} ${_mesh} )
+  list( APPEND meshes ${_mesh} )
+endforeach()
+
+foreach( _mesh ${meshes} )
+  foreach( _ranks ${ranks} )
+    foreach( _threads ${threads} )
+      run_case( strong ${_mesh} ${_ranks} ${_threads} )
+    endforeach()
+  endforeach()
+endforeach()
+
+#-------------------------------------------------------------------------------
+# Weak scaling: the mesh grows with the number of ranks
+
+foreach( _size ${weak} )
+  string( REPLACE "x" ";" _dims ${_size} )
+  list( GET _dims 0 _nx )
+  list( REMOVE_AT _dims 0 )
+  foreach( _ranks ${ranks} )
+    math( EXPR _nx_total "${_nx} * ${_ranks}" )
+    string( REPLACE ";" "x" _rest "${_dims}" )
+    set( _total_size ${_nx_total}x${_rest} )
+    set( _mesh ${CMAKE_CURRENT_BINARY_DIR}/box_${_total_size}.g )
+    generate_mesh( ${_total_size} ${_mesh} )
+    foreach( _threads ${threads} )
+      run_case( weak ${_mesh} ${_ranks} ${_threads} )
+    endforeach()
+  endforeach()
+endforeach()
+
+#-------------------------------------------------------------------------------
+# Write the tables
+
+file( WRITE ${benchmark_name}.csv "${csv}" )
+
+string( REPLACE ";" ",\n" json_runs "${json_runs}" )
+file( WRITE ${benchmark_name}.json "[\n${json_runs}\n]\n" )
+
+message( STATUS "Wrote ${benchmark_name}.csv and ${benchmark_name}.json" )
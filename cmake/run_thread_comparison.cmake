@@ -0,0 +1,87 @@
+#~----------------------------------------------------------------------------~#
+# Copyright (c) 2016 Los Alamos National Security, LLC
+# All rights reserved.
+#~----------------------------------------------------------------------------~#
+
+# some argument checking:
+
+# test_cmd is the command to run with all its arguments
+if( NOT test_cmd )
+   message( FATAL_ERROR "Variable test_cmd not defined" )
+endif()
+
+# test_name is the prefix of the run directories
+if( NOT test_name )
+   message( FATAL_ERROR "Variable test_name not defined" )
+endif()
+
+# output_pattern matches the outputs to compare
+if( NOT output_pattern )
+   message( FATAL_ERROR "Variable output_pattern not defined" )
+endif()
+
+# the thread counts are passed as a comma separated list
+if( NOT threads )
+   message( FATAL_ERROR "Variable threads not defined" )
+endif()
+string( REPLACE "," ";" threads "${threads}" )
+
+separate_arguments( test_cmd ) 
+string(REPLACE ";" " " test_cmd_string "${test_cmd}")
+
+#-------------------------------------------------------------------------------
+# Run the command with some number of threads, in a directory of its own
+
+function( run_with_threads nthreads )
+
+  set( _dir ${CMAKE_CURRENT_BINARY_DIR}/${test_name}_${nthreads}threads )
+  file( REMOVE_RECURSE ${_dir} )
+  file( MAKE_DIRECTORY ${_dir} )
+
+  message(STATUS "Executing '${test_cmd_string}' with ${nthreads} threads")
+
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} -E env OMP_NUM_THREADS=${nthreads} ${test_cmd}
+    WORKING_DIRECTORY ${_dir}
+    OUTPUT_FILE ${_dir}/log
+    RESULT_VARIABLE _failed
+  )
+
+  if( _failed )
+    message( FATAL_ERROR "Error running ${test_cmd_string} with "
+      "${nthreads} threads" )
+  endif()
+
+endfunction()
+
+#-------------------------------------------------------------------------------
+# The serial run is the standard
+
+run_with_threads( 1 )
+
+set( _serial_dir ${CMAKE_CURRENT_BINARY_DIR}/${test_name}_1threads )
+file( GLOB _outputs RELATIVE ${_serial_dir} ${_serial_dir}/${output_pattern} )
+
+if( NOT _outputs )
+  message( FATAL_ERROR "The serial run wrote nothing matching "
+    "${output_pattern}" )
+endif()
+
+foreach( _nthreads ${threads} )
+
+  run_with_threads( ${_nthreads} )
+  set( _dir ${CMAKE_CURRENT_BINARY_DIR}/${test_name}_${_nthreads}threads )
+
+  foreach( _output ${_outputs} )
+    execute_process(
+      COMMAND ${CMAKE_COMMAND} -E compare_files 
+        ${_serial_dir}/${_output} ${_dir}/${_output}
+      RESULT_VARIABLE _differ
+    )
+    if( _differ )
+      message( SEND_ERROR "${_output} with ${_nthreads} threads does not "
+        "match the serial one!" )
+    endif()
+  endforeach()
+
+endforeach()
@@ -81,6 +81,7 @@ set( FLECSALE_RUNTIME_MODEL ${FLECSI_RUNTIME_MODEL} )
 if ( FLECSALE_RUNTIME_MODEL STREQUAL "mpi" )
   set( ENABLE_MPI ON CACHE BOOL "" FORCE)
   set( FLECSALE_UNIT_POLICY MPI )
+  set( FLECSALE_USE_MPI ON )
 elseif ( FLECSALE_RUNTIME_MODEL STREQUAL "legion" )
   set( FLECSALE_UNIT_POLICY LEGION )
 else()
@@ -180,6 +181,14 @@ if (ENABLE_REGRESSION_TESTS)
   message (STATUS "Found PythonInterp: ${PYTHON_EXECUTABLE}")
 endif ()
 
+#------------------------------------------------------------------------------#
+# Enable Benchmarks
+#------------------------------------------------------------------------------#
+
+# the scaling benchmarks are tests labeled "benchmark", run them with
+# "ctest -L benchmark"
+option(FLECSALE_ENABLE_BENCHMARKS "Enable the benchmarks" OFF)
+
 #------------------------------------------------------------------------------#
 # Enable Embedded Interpreters
 #------------------------------------------------------------------------------#
@@ -315,6 +324,13 @@ if(FLECSALE_ENABLE_EXODUS)
   message( STATUS "IO with exodus enabled" )
 endif()
 
+#------------------------------------------------------------------------------#
+# Threads - the apps write their output in the background
+#------------------------------------------------------------------------------#
+
+find_package(Threads REQUIRED)
+list(APPEND FLECSALE_LIBRARIES ${CMAKE_THREAD_LIBS_INIT} )
+
 #------------------------------------------------------------------------------#
 # Boost - Right now, only used by portage
 #------------------------------------------------------------------------------#
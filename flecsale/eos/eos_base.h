@@ -13,6 +13,7 @@
 
 // system includes
 #include <cmath>
+#include <cstddef>
 
 namespace flecsale {
 namespace eos {
@@ -136,6 +137,40 @@ public:
     real_t internal_energy 
   ) const = 0;
 
+  //! \brief compute the pressure, temperature and sound speed of many states
+  //!
+  //! This gives the same values as the single state calls, but lets the
+  //! work be vectorized, and lets an expensive equation of state share work
+  //! between the values.
+  //!
+  //! \param[in] n  the number of states
+  //! \param[in] density  the densities
+  //! \param[in] internal_energy  the internal energies
+  //! \param[out] pressure  the pressures
+  //! \param[out] temperature  the temperatures
+  //! \param[out] sound_speed  the sound speeds
+  virtual void compute_state_de(
+    std::size_t n,
+    const real_t * density,
+    const real_t * internal_energy,
+    real_t * pressure,
+    real_t * temperature,
+    real_t * sound_speed
+  ) const = 0;
+
+  //! \brief compute the internal energies of many states
+  //!
+  //! \param[in] n  the number of states
+  //! \param[in] density  the densities
+  //! \param[in] pressure  the pressures
+  //! \param[out] internal_energy  the internal energies
+  virtual void compute_internal_energy_dp(
+    std::size_t n,
+    const real_t * density,
+    const real_t * pressure,
+    real_t * internal_energy
+  ) const = 0;
+
 #endif
 };
 
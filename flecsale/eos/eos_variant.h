@@ -0,0 +1,274 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief A closed set of equations of state.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace flecsale {
+namespace eos {
+
+namespace detail {
+
+//! \brief The lookup hint of an equation of state, or void if it takes none.
+template< typename EOS, typename = void >
+struct hint_of { using type = void; };
+
+template< typename EOS >
+struct hint_of< EOS, std::void_t<typename EOS::hint_t> >
+{ using type = typename EOS::hint_t; };
+
+//! \brief The first of the hints that is not void.
+template< typename... H >
+struct first_hint { struct type {}; };
+
+template< typename H, typename... Hs >
+struct first_hint< H, Hs... > { using type = H; };
+
+template< typename... Hs >
+struct first_hint< void, Hs... > : first_hint< Hs... > {};
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Holds any one of a closed set of equations of state.
+//!
+//! It has the common interface of the equations of state, and forwards each
+//! call to the one it holds.  There are no virtual calls, and a batch call
+//! dispatches once for the whole batch, so the loop over the states runs on
+//! the concrete type and can be inlined and vectorized.
+//!
+//! The batch calls take the lookup hints of the equation of state that has
+//! them, like the tabular one, and the others ignore the hints.
+//!
+//! \tparam T  the real type
+//! \tparam EOS  the equation of state templates
+////////////////////////////////////////////////////////////////////////////////
+template< typename T, template<typename> class... EOS >
+class eos_variant__ : public std::variant< EOS<T>... > {
+
+  using base_t = std::variant< EOS<T>... >;
+
+
+public:
+
+  //============================================================================
+  // Typedefs
+  //============================================================================
+
+  //! \brief the real type
+  using real_t = T;
+
+  //! \brief the lookup hint of a state, for the equation of state that takes
+  //!        one
+  using hint_t = typename detail::first_hint<
+    typename detail::hint_of< EOS<T> >::type...
+  >::type;
+
+  //============================================================================
+  // Constructors / Destructors
+  //============================================================================
+
+  //! \brief construct or assign from any of the equations of state
+  using base_t::base_t;
+  using base_t::operator=;
+
+  //! \brief default constructor, which holds the first equation of state
+  eos_variant__() = default;
+
+  //============================================================================
+  // Public member functions that are special for this class
+  //============================================================================
+
+  //! \brief Does the equation of state that is held take lookup hints.
+  bool takes_hints() const
+  {
+    return visit( [&]( const auto & eos ) {
+      return takes_hints__< std::decay_t<decltype(eos)> >;
+    } );
+  }
+
+  //! \brief Call a function with the equation of state that is held.
+  //! \param [in] f  the function
+  //! \return what the function returns
+  template< typename F >
+  decltype(auto) visit( F && f ) const
+  { return std::visit( std::forward<F>(f), static_cast<const base_t &>(*this) ); }
+
+  //! \brief Call a function with the equation of state that is held.
+  //! \param [in] f  the function
+  //! \return what the function returns
+  template< typename F >
+  decltype(auto) visit( F && f )
+  { return std::visit( std::forward<F>(f), static_cast<base_t &>(*this) ); }
+
+  //============================================================================
+  // Public member functions that are part of the common interface
+  //============================================================================
+
+  //! \brief return the density
+  real_t get_ref_density( void ) const
+  { return visit( [&]( const auto & eos ) { return eos.get_ref_density(); } ); }
+
+  //! \brief return the internal energy
+  real_t get_ref_internal_energy( void ) const
+  {
+    return visit(
+      [&]( const auto & eos ) { return eos.get_ref_internal_energy(); }
+    );
+  }
+
+  //! \brief return the reference temperature
+  real_t get_ref_temperature( void ) const
+  {
+    return visit(
+      [&]( const auto & eos ) { return eos.get_ref_temperature(); }
+    );
+  }
+
+  //! \brief return the reference pressure
+  real_t get_ref_pressure( void ) const
+  { return visit( [&]( const auto & eos ) { return eos.get_ref_pressure(); } ); }
+
+  //! \brief set the reference state via density and energy
+  void set_ref_state_de( real_t density, real_t internal_energy )
+  {
+    visit( [&]( auto & eos ) {
+      eos.set_ref_state_de( density, internal_energy );
+    } );
+  }
+
+  //! \brief set the reference state via density and temperature
+  void set_ref_state_dt( real_t density, real_t temperature )
+  {
+    visit( [&]( auto & eos ) { eos.set_ref_state_dt( density, temperature ); } );
+  }
+
+  //! \brief set the reference state via density and pressure
+  void set_ref_state_dp( real_t density, real_t pressure )
+  {
+    visit( [&]( auto & eos ) { eos.set_ref_state_dp( density, pressure ); } );
+  }
+
+  //! \brief set the reference state via pressure and temperature
+  void set_ref_state_tp( real_t pressure, real_t temperature )
+  {
+    visit( [&]( auto & eos ) { eos.set_ref_state_tp( pressure, temperature ); } );
+  }
+
+  //! \brief compute the internal energy
+  real_t compute_internal_energy_dp( real_t density, real_t pressure ) const
+  {
+    return visit( [&]( const auto & eos ) {
+      return eos.compute_internal_energy_dp( density, pressure );
+    } );
+  }
+
+  //! \brief compute the pressure
+  real_t compute_pressure_de( real_t density, real_t internal_energy ) const
+  {
+    return visit( [&]( const auto & eos ) {
+      return eos.compute_pressure_de( density, internal_energy );
+    } );
+  }
+
+  //! \brief compute the sound speed
+  real_t compute_sound_speed_de( real_t density, real_t internal_energy ) const
+  {
+    return visit( [&]( const auto & eos ) {
+      return eos.compute_sound_speed_de( density, internal_energy );
+    } );
+  }
+
+  //! \brief compute the temperature
+  real_t compute_temperature_de( real_t density, real_t internal_energy ) const
+  {
+    return visit( [&]( const auto & eos ) {
+      return eos.compute_temperature_de( density, internal_energy );
+    } );
+  }
+
+  //! \brief Return the gas constant or an effective one.
+  real_t compute_gamma_dp( real_t density, real_t pressure ) const
+  {
+    return visit( [&]( const auto & eos ) {
+      return eos.compute_gamma_dp( density, pressure );
+    } );
+  }
+
+  //! \brief Return the gas constant or an effective one.
+  real_t compute_gamma_de( real_t density, real_t internal_energy ) const
+  {
+    return visit( [&]( const auto & eos ) {
+      return eos.compute_gamma_de( density, internal_energy );
+    } );
+  }
+
+  //! \brief compute the pressure, temperature and sound speed of many states
+  //! \param[in,out] hints  the lookup hints, one per state, or null
+  void compute_state_de(
+    std::size_t n,
+    const real_t * density,
+    const real_t * internal_energy,
+    real_t * pressure,
+    real_t * temperature,
+    real_t * sound_speed,
+    hint_t * hints = nullptr
+  ) const
+  {
+    visit( [&]( const auto & eos ) {
+      if constexpr ( takes_hints__< std::decay_t<decltype(eos)> > )
+        eos.compute_state_de(
+          n, density, internal_energy, pressure, temperature, sound_speed,
+          hints
+        );
+      else
+        eos.compute_state_de(
+          n, density, internal_energy, pressure, temperature, sound_speed
+        );
+    } );
+  }
+
+  //! \brief compute the internal energies of many states
+  //! \param[in,out] hints  the lookup hints, one per state, or null
+  void compute_internal_energy_dp(
+    std::size_t n,
+    const real_t * density,
+    const real_t * pressure,
+    real_t * internal_energy,
+    hint_t * hints = nullptr
+  ) const
+  {
+    visit( [&]( const auto & eos ) {
+      if constexpr ( takes_hints__< std::decay_t<decltype(eos)> > )
+        eos.compute_internal_energy_dp(
+          n, density, pressure, internal_energy, hints
+        );
+      else
+        eos.compute_internal_energy_dp( n, density, pressure, internal_energy );
+    } );
+  }
+
+private:
+
+  //! \brief true if an equation of state takes the hints of the variant
+  template< typename E >
+  static constexpr bool takes_hints__ =
+    std::is_same_v< typename detail::hint_of<E>::type, hint_t >;
+
+};
+
+} // namespace
+} // namespace
@@ -17,6 +17,7 @@
 // system includes
 #include <cassert>
 #include <cmath>
+#include <cstddef>
 
 namespace flecsale {
 namespace eos {
@@ -226,6 +227,54 @@ public:
   }
 
 
+  //! \brief compute the pressure, temperature and sound speed of many states
+  //!
+  //! \param[in] n  the number of states
+  //! \param[in] density  the densities
+  //! \param[in] internal_energy  the internal energies
+  //! \param[out] pressure  the pressures
+  //! \param[out] temperature  the temperatures
+  //! \param[out] sound_speed  the sound speeds
+  void compute_state_de(
+    std::size_t n,
+    const real_t * density,
+    const real_t * internal_energy,
+    real_t * pressure,
+    real_t * temperature,
+    real_t * sound_speed
+  ) const // override
+  {
+    auto gm1 = gamma_ - 1.0;
+    auto ggm1 = gamma_ * gm1;
+    #pragma omp simd
+    for ( std::size_t i=0; i<n; ++i ) {
+      auto ie = internal_energy[i];
+      pressure[i] = gm1 * density[i] * ie;
+      temperature[i] = ie / specific_heat_v_;
+      sound_speed[i] = std::sqrt( ggm1 * ie );
+    }
+  }
+
+  //! \brief compute the internal energies of many states
+  //!
+  //! \param[in] n  the number of states
+  //! \param[in] density  the densities
+  //! \param[in] pressure  the pressures
+  //! \param[out] internal_energy  the internal energies
+  void compute_internal_energy_dp(
+    std::size_t n,
+    const real_t * density,
+    const real_t * pressure,
+    real_t * internal_energy
+  ) const // override
+  {
+    auto gm1 = gamma_ - 1.0;
+    #pragma omp simd
+    for ( std::size_t i=0; i<n; ++i )
+      internal_energy[i] = pressure[i] / ( density[i]*gm1 );
+  }
+
+
   //! \brief Return the gas constant or an effective one. 
   //!
   //! \param[in] density the density
@@ -0,0 +1,321 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Stiffened gas equation of state implementation.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include "eos_base.h"
+
+// system includes
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+namespace flecsale {
+namespace eos {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Stiffened gas specialization of the equation of state
+//!
+//! The pressure is \f$ p = (\gamma-1) \rho e - \gamma p_\infty \f$, which
+//! models liquids and solids under strong compression.  With a zero
+//! stiffening pressure it is an ideal gas.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+class stiffened_gas_t : public eos_base_t<T> {
+
+  using base_t = eos_base_t<T>;
+  using real_t = typename base_t::real_t;
+
+
+public:
+
+  //============================================================================
+  // Constructors / Destructors
+  //============================================================================
+
+
+  //! \brief default constructor
+  stiffened_gas_t() : gamma_(2.0), specific_heat_v_(1.0), pressure_inf_(0.0),
+                      density_(1.0), internal_energy_(1.0)
+  {}
+
+  //! \brief constructor with values constructor
+  stiffened_gas_t( real_t gamma, real_t cv, real_t pressure_inf ) :
+    gamma_(gamma), specific_heat_v_(cv), pressure_inf_(pressure_inf),
+    density_(1.0), internal_energy_(1.0)
+  {
+    assert( gamma > 1 );
+    assert( cv > 0 );
+    assert( pressure_inf >= 0 );
+  }
+
+  //============================================================================
+  // Public member functions that are special for this class
+  //============================================================================
+
+  //! \brief return the specific heat at constant volume
+  //! \return the specific heat
+  real_t get_specific_heat_v( void ) const
+  { return specific_heat_v_; }
+
+  //! \brief return the specific heat ratio
+  //! \return the specific heat ratio
+  real_t get_gamma( void ) const
+  { return gamma_; }
+
+  //! \brief return the stiffening pressure
+  //! \return the stiffening pressure
+  real_t get_pressure_inf( void ) const
+  { return pressure_inf_; }
+
+
+  //============================================================================
+  // Public member functions that are part of the common interface
+  //============================================================================
+
+  //! \brief return the density
+  //! \return the density
+  real_t get_ref_density( void ) const // override
+  {
+    return density_;
+  }
+
+  //! \brief return the internal energy
+  //! \return the internal energy
+  real_t get_ref_internal_energy( void ) const // override
+  {
+    return internal_energy_;
+  }
+
+  //! \brief return the reference temperature
+  //! \return the reference temperature
+  real_t get_ref_temperature( void ) const // override
+  {
+    return compute_temperature_de( density_, internal_energy_ );
+  }
+
+  //! \brief return the reference pressure
+  //! \return the reference pressure
+  real_t get_ref_pressure( void ) const // override
+  {
+    return compute_pressure_de( density_, internal_energy_ );
+  }
+
+
+  //! \brief set the reference state via density and energy
+  //! \param[in] density the density to set
+  //! \param[in] internal_energy the internal energy to set
+  void set_ref_state_de( real_t density, real_t internal_energy ) // override
+  {
+    assert( density > 0 );
+
+    density_ = density;
+    internal_energy_ = internal_energy;
+  }
+
+  //! \brief set the reference state via density and temperature
+  //! \param[in] density the density to set
+  //! \param[in] temperature the temperature to set
+  void set_ref_state_dt( real_t density, real_t temperature ) // override
+  {
+    assert( density > 0 );
+    assert( temperature > 0 );
+
+    density_ = density;
+    internal_energy_ = specific_heat_v_ * temperature + pressure_inf_ / density;
+  }
+
+  //! \brief set the reference state via density and pressure
+  //! \param[in] density the density to set
+  //! \param[in] pressure the pressure to set
+  void set_ref_state_dp( real_t density, real_t pressure ) // override
+  {
+    assert( density > 0 );
+
+    density_ = density;
+    internal_energy_ = compute_internal_energy_dp( density, pressure );
+  }
+
+
+  //! \brief set the reference state via pressure and temperature
+  //! \param[in] pressure the pressure to set
+  //! \param[in] temperature the temperature to set
+  void set_ref_state_tp( real_t pressure, real_t temperature ) // override
+  {
+    assert( temperature > 0 );
+
+    auto R = (gamma_-1.0) * specific_heat_v_;
+
+    density_ = ( pressure + pressure_inf_ ) / ( R * temperature );
+    internal_energy_ = compute_internal_energy_dp( density_, pressure );
+  }
+
+
+  //! \brief compute the internal energy
+  //!
+  //! \param[in] density the density
+  //! \param[in] pressure the pressure
+  //! \return the internal energy
+  real_t compute_internal_energy_dp(
+    real_t density,
+    real_t pressure
+  ) const // override
+  {
+    return ( pressure + gamma_*pressure_inf_ ) / ( density*(gamma_-1.0) );
+  }
+
+
+
+  //! \brief compute the pressure
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \return the pressure
+  real_t compute_pressure_de(
+    real_t density,
+    real_t internal_energy
+  ) const // override
+  {
+    return (gamma_-1.0) * density * internal_energy - gamma_ * pressure_inf_;
+  }
+
+  //! \brief comput the sound speed
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \return the sound speed
+  real_t compute_sound_speed_de(
+    real_t density,
+    real_t internal_energy
+  ) const // override
+  {
+    auto e = internal_energy - pressure_inf_ / density;
+    assert( e>0.0 );
+    return std::sqrt( gamma_ * (gamma_-1.0) * e );
+  }
+
+  //! \brief comput the temperature
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \return the temperature
+  real_t compute_temperature_de(
+    real_t density,
+    real_t internal_energy
+  ) const // override
+  {
+    return ( internal_energy - pressure_inf_ / density ) / specific_heat_v_;
+  }
+
+
+  //! \brief compute the pressure, temperature and sound speed of many states
+  //!
+  //! \param[in] n  the number of states
+  //! \param[in] density  the densities
+  //! \param[in] internal_energy  the internal energies
+  //! \param[out] pressure  the pressures
+  //! \param[out] temperature  the temperatures
+  //! \param[out] sound_speed  the sound speeds
+  void compute_state_de(
+    std::size_t n,
+    const real_t * density,
+    const real_t * internal_energy,
+    real_t * pressure,
+    real_t * temperature,
+    real_t * sound_speed
+  ) const // override
+  {
+    auto gm1 = gamma_ - 1.0;
+    auto ggm1 = gamma_ * gm1;
+    auto gpinf = gamma_ * pressure_inf_;
+    #pragma omp simd
+    for ( std::size_t i=0; i<n; ++i ) {
+      auto d = density[i];
+      auto ie = internal_energy[i];
+      auto e = ie - pressure_inf_ / d;
+      pressure[i] = gm1 * d * ie - gpinf;
+      temperature[i] = e / specific_heat_v_;
+      sound_speed[i] = std::sqrt( ggm1 * e );
+    }
+  }
+
+  //! \brief compute the internal energies of many states
+  //!
+  //! \param[in] n  the number of states
+  //! \param[in] density  the densities
+  //! \param[in] pressure  the pressures
+  //! \param[out] internal_energy  the internal energies
+  void compute_internal_energy_dp(
+    std::size_t n,
+    const real_t * density,
+    const real_t * pressure,
+    real_t * internal_energy
+  ) const // override
+  {
+    auto gm1 = gamma_ - 1.0;
+    auto gpinf = gamma_ * pressure_inf_;
+    #pragma omp simd
+    for ( std::size_t i=0; i<n; ++i )
+      internal_energy[i] = ( pressure[i] + gpinf ) / ( density[i]*gm1 );
+  }
+
+
+  //! \brief Return the gas constant or an effective one.
+  //!
+  //! \param[in] density the density
+  //! \param[in] pressure the pressure
+  //! \return the effective gamma
+  real_t compute_gamma_dp( real_t density, real_t pressure ) const // override
+  {
+    return gamma_;
+  }
+
+  //! \brief Return the gas constant or an effective one.
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \return the effective gamma
+  real_t compute_gamma_de(
+    real_t density,
+    real_t internal_energy
+  ) const // override
+  {
+    return gamma_;
+  }
+
+
+protected:
+
+  //===============================================================
+  // Member variables
+  //===============================================================
+
+  //! the specific heat ratio
+  real_t gamma_;
+
+  //! the specific heat
+  real_t specific_heat_v_;
+
+  //! the stiffening pressure
+  real_t pressure_inf_;
+
+  //! the reference density
+  real_t density_;
+
+  //! the reference internal energy
+  real_t internal_energy_;
+
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,830 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tabular equation of state implementation.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include "eos_base.h"
+
+#include <ristra/assertions/errors.h>
+
+// system includes
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace flecsale {
+namespace eos {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Tabular specialization of the equation of state
+//!
+//! The pressure, temperature and sound speed are tabulated against density
+//! and internal energy, and the internal energy against density and
+//! temperature.  Both tables share the density axis, and the axes need not
+//! be evenly spaced.  Values are interpolated bilinearly, or with cubic
+//! Hermite polynomials whose slopes are limited so they stay monotone along
+//! each axis.  States off the table are held at its edges.
+//!
+//! Finding the table cell of a state is the expensive part of a lookup, so
+//! every lookup can take a hint, which remembers the cell of the last
+//! lookup.  When a hint is kept per cell of the mesh, a state that moved at
+//! most one table cell since the last step is found without a search.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+class tabular_eos_t : public eos_base_t<T> {
+
+  using base_t = eos_base_t<T>;
+  using real_t = typename base_t::real_t;
+
+
+public:
+
+  //============================================================================
+  // Typedefs
+  //============================================================================
+
+  //! \brief The ways to interpolate between the table values.
+  enum class interpolation_t {
+    bilinear,
+    monotone_cubic
+  };
+
+  //! \brief The tables.
+  //!
+  //! The values are stored by density, then by energy or temperature.
+  struct tables_t {
+    //! the density axis, shared by both tables
+    std::vector<real_t> density_axis;
+    //! the internal energy axis of the (density, energy) table
+    std::vector<real_t> energy_axis;
+    //! the temperature axis of the (density, temperature) table
+    std::vector<real_t> temperature_axis;
+    //! the values on the (density, energy) table
+    std::vector<real_t> pressure, temperature, sound_speed;
+    //! the values on the (density, temperature) table
+    std::vector<real_t> internal_energy;
+  };
+
+  //! \brief The table cells of the last lookup.
+  struct hint_t {
+    std::uint32_t density = 0;
+    std::uint32_t energy = 0;
+    std::uint32_t temperature = 0;
+  };
+
+  //============================================================================
+  // Constructors / Destructors
+  //============================================================================
+
+  //! \brief default constructor
+  tabular_eos_t() = default;
+
+  //! \brief constructor with tables
+  //! \param[in] tables  the tables
+  //! \param[in] interpolation  the interpolation to use
+  tabular_eos_t(
+    tables_t tables,
+    interpolation_t interpolation = interpolation_t::bilinear
+  ) : tables_( std::move(tables) ), interpolation_( interpolation )
+  {
+    setup();
+  }
+
+  //! \brief constructor from a table file
+  //!
+  //! The file lists each table as its name, the number of values, and the
+  //! values, all separated by white space.  The names are those of the
+  //! members of tables_t, and anything after a '#' on a line is ignored.
+  //!
+  //! \param[in] filename  the name of the file
+  //! \param[in] interpolation  the interpolation to use
+  tabular_eos_t(
+    const std::string & filename,
+    interpolation_t interpolation = interpolation_t::bilinear
+  ) : tabular_eos_t( read_tables(filename), interpolation )
+  {}
+
+  //============================================================================
+  // Public member functions that are special for this class
+  //============================================================================
+
+  //! \brief return the tables
+  const tables_t & get_tables( void ) const
+  { return tables_; }
+
+  //! \brief return the interpolation
+  interpolation_t get_interpolation( void ) const
+  { return interpolation_; }
+
+  //! \brief compute the internal energy
+  //!
+  //! \param[in] density the density
+  //! \param[in] temperature the temperature
+  //! \param[in,out] hint  the table cells of the last lookup
+  //! \return the internal energy
+  real_t compute_internal_energy_dt(
+    real_t density,
+    real_t temperature,
+    hint_t & hint
+  ) const
+  {
+    auto x = locate( tables_.density_axis, density, hint.density );
+    auto y = locate( tables_.temperature_axis, temperature, hint.temperature );
+    return interpolate(
+      energy_dt_, tables_.density_axis, tables_.temperature_axis, x, y
+    );
+  }
+
+  //! \brief compute the internal energy
+  //!
+  //! \param[in] density the density
+  //! \param[in] temperature the temperature
+  //! \return the internal energy
+  real_t compute_internal_energy_dt( real_t density, real_t temperature ) const
+  {
+    hint_t hint;
+    return compute_internal_energy_dt( density, temperature, hint );
+  }
+
+  //! \brief compute the internal energy
+  //!
+  //! \param[in] density the density
+  //! \param[in] pressure the pressure
+  //! \param[in,out] hint  the table cells of the last lookup
+  //! \return the internal energy
+  real_t compute_internal_energy_dp(
+    real_t density,
+    real_t pressure,
+    hint_t & hint
+  ) const
+  {
+    auto x = locate( tables_.density_axis, density, hint.density );
+    return invert( pressure_, x, pressure, hint.energy );
+  }
+
+  //! \brief compute the pressure
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \param[in,out] hint  the table cells of the last lookup
+  //! \return the pressure
+  real_t compute_pressure_de(
+    real_t density,
+    real_t internal_energy,
+    hint_t & hint
+  ) const
+  { return lookup_de( pressure_, density, internal_energy, hint ); }
+
+  //! \brief compute the sound speed
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \param[in,out] hint  the table cells of the last lookup
+  //! \return the sound speed
+  real_t compute_sound_speed_de(
+    real_t density,
+    real_t internal_energy,
+    hint_t & hint
+  ) const
+  { return lookup_de( sound_speed_, density, internal_energy, hint ); }
+
+  //! \brief compute the temperature
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \param[in,out] hint  the table cells of the last lookup
+  //! \return the temperature
+  real_t compute_temperature_de(
+    real_t density,
+    real_t internal_energy,
+    hint_t & hint
+  ) const
+  { return lookup_de( temperature_, density, internal_energy, hint ); }
+
+  //! \brief compute the pressure, temperature and sound speed of many states
+  //!
+  //! The table cell of each state is only found once for all three values.
+  //!
+  //! \param[in] n  the number of states
+  //! \param[in] density  the densities
+  //! \param[in] internal_energy  the internal energies
+  //! \param[out] pressure  the pressures
+  //! \param[out] temperature  the temperatures
+  //! \param[out] sound_speed  the sound speeds
+  //! \param[in,out] hints  the table cells of the last lookups, one per
+  //!                       state, or null to search for every state
+  void compute_state_de(
+    std::size_t n,
+    const real_t * density,
+    const real_t * internal_energy,
+    real_t * pressure,
+    real_t * temperature,
+    real_t * sound_speed,
+    hint_t * hints = nullptr
+  ) const
+  {
+    const auto & xs = tables_.density_axis;
+    const auto & ys = tables_.energy_axis;
+    for ( std::size_t i=0; i<n; ++i ) {
+      hint_t local;
+      auto & hint = hints ? hints[i] : local;
+      auto x = locate( xs, density[i], hint.density );
+      auto y = locate( ys, internal_energy[i], hint.energy );
+      pressure[i] = interpolate( pressure_, xs, ys, x, y );
+      temperature[i] = interpolate( temperature_, xs, ys, x, y );
+      sound_speed[i] = interpolate( sound_speed_, xs, ys, x, y );
+    }
+  }
+
+  //! \brief compute the internal energies of many states
+  //!
+  //! \param[in] n  the number of states
+  //! \param[in] density  the densities
+  //! \param[in] pressure  the pressures
+  //! \param[out] internal_energy  the internal energies
+  //! \param[in,out] hints  the table cells of the last lookups, one per
+  //!                       state, or null to search for every state
+  void compute_internal_energy_dp(
+    std::size_t n,
+    const real_t * density,
+    const real_t * pressure,
+    real_t * internal_energy,
+    hint_t * hints = nullptr
+  ) const
+  {
+    for ( std::size_t i=0; i<n; ++i ) {
+      hint_t local;
+      auto & hint = hints ? hints[i] : local;
+      internal_energy[i] =
+        compute_internal_energy_dp( density[i], pressure[i], hint );
+    }
+  }
+
+  //============================================================================
+  // Public member functions that are part of the common interface
+  //============================================================================
+
+  //! \brief return the density
+  //! \return the density
+  real_t get_ref_density( void ) const // override
+  {
+    return density_;
+  }
+
+  //! \brief return the internal energy
+  //! \return the internal energy
+  real_t get_ref_internal_energy( void ) const // override
+  {
+    return internal_energy_;
+  }
+
+  //! \brief return the reference temperature
+  //! \return the reference temperature
+  real_t get_ref_temperature( void ) const // override
+  {
+    return compute_temperature_de( density_, internal_energy_ );
+  }
+
+  //! \brief return the reference pressure
+  //! \return the reference pressure
+  real_t get_ref_pressure( void ) const // override
+  {
+    return compute_pressure_de( density_, internal_energy_ );
+  }
+
+
+  //! \brief set the reference state via density and energy
+  //! \param[in] density the density to set
+  //! \param[in] internal_energy the internal energy to set
+  void set_ref_state_de( real_t density, real_t internal_energy ) // override
+  {
+    assert( density > 0 );
+
+    density_ = density;
+    internal_energy_ = internal_energy;
+  }
+
+  //! \brief set the reference state via density and temperature
+  //! \param[in] density the density to set
+  //! \param[in] temperature the temperature to set
+  void set_ref_state_dt( real_t density, real_t temperature ) // override
+  {
+    assert( density > 0 );
+
+    density_ = density;
+    internal_energy_ = compute_internal_energy_dt( density, temperature );
+  }
+
+  //! \brief set the reference state via density and pressure
+  //! \param[in] density the density to set
+  //! \param[in] pressure the pressure to set
+  void set_ref_state_dp( real_t density, real_t pressure ) // override
+  {
+    assert( density > 0 );
+
+    density_ = density;
+    internal_energy_ = compute_internal_energy_dp( density, pressure );
+  }
+
+
+  //! \brief set the reference state via pressure and temperature
+  //!
+  //! The density is found by bisection over the density axis, assuming the
+  //! pressure grows with density along the isotherm.
+  //!
+  //! \param[in] pressure the pressure to set
+  //! \param[in] temperature the temperature to set
+  void set_ref_state_tp( real_t pressure, real_t temperature ) // override
+  {
+    hint_t hint;
+    auto pressure_dt = [&]( real_t d ) {
+      auto e = compute_internal_energy_dt( d, temperature, hint );
+      return compute_pressure_de( d, e, hint );
+    };
+
+    auto lo = tables_.density_axis.front();
+    auto hi = tables_.density_axis.back();
+    for ( int it=0; it<100 && hi-lo > epsilon * hi; ++it ) {
+      auto mid = ( lo + hi ) / 2;
+      if ( pressure_dt( mid ) < pressure ) lo = mid;
+      else hi = mid;
+    }
+
+    density_ = ( lo + hi ) / 2;
+    internal_energy_ = compute_internal_energy_dt( density_, temperature );
+  }
+
+
+  //! \brief compute the internal energy
+  //!
+  //! \param[in] density the density
+  //! \param[in] pressure the pressure
+  //! \return the internal energy
+  real_t compute_internal_energy_dp(
+    real_t density,
+    real_t pressure
+  ) const // override
+  {
+    hint_t hint;
+    return compute_internal_energy_dp( density, pressure, hint );
+  }
+
+
+
+  //! \brief compute the pressure
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \return the pressure
+  real_t compute_pressure_de(
+    real_t density,
+    real_t internal_energy
+  ) const // override
+  {
+    hint_t hint;
+    return compute_pressure_de( density, internal_energy, hint );
+  }
+
+  //! \brief comput the sound speed
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \return the sound speed
+  real_t compute_sound_speed_de(
+    real_t density,
+    real_t internal_energy
+  ) const // override
+  {
+    hint_t hint;
+    return compute_sound_speed_de( density, internal_energy, hint );
+  }
+
+  //! \brief comput the temperature
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \return the temperature
+  real_t compute_temperature_de(
+    real_t density,
+    real_t internal_energy
+  ) const // override
+  {
+    hint_t hint;
+    return compute_temperature_de( density, internal_energy, hint );
+  }
+
+
+  //! \brief Return the gas constant or an effective one.
+  //!
+  //! The effective gamma is the one an ideal gas would need to have the same
+  //! pressure at this density and energy.
+  //!
+  //! \param[in] density the density
+  //! \param[in] pressure the pressure
+  //! \return the effective gamma
+  real_t compute_gamma_dp( real_t density, real_t pressure ) const // override
+  {
+    auto ie = compute_internal_energy_dp( density, pressure );
+    return 1 + pressure / ( density * ie );
+  }
+
+  //! \brief Return the gas constant or an effective one.
+  //!
+  //! \param[in] density the density
+  //! \param[in] internal_energy the internal energy
+  //! \return the effective gamma
+  real_t compute_gamma_de(
+    real_t density,
+    real_t internal_energy
+  ) const // override
+  {
+    auto p = compute_pressure_de( density, internal_energy );
+    return 1 + p / ( density * internal_energy );
+  }
+
+
+protected:
+
+  //============================================================================
+  // Protected types and member functions
+  //============================================================================
+
+  //! \brief A tabulated value, with its slopes along each axis for the
+  //!        cubic interpolation.
+  struct field_t {
+    std::vector<real_t> tables_t::* values = nullptr;
+    std::vector<real_t> dx, dy;
+  };
+
+  //! \brief Where a state falls on an axis: the table cell, and the
+  //!        fraction of the way across it.
+  struct position_t {
+    std::size_t i;
+    real_t u;
+  };
+
+  //! the relative precision of the bisections
+  static constexpr real_t epsilon = 1.e-14;
+
+  //! \brief Read the tables from a file.
+  //! \param[in] filename  the name of the file
+  static tables_t read_tables( const std::string & filename )
+  {
+    std::ifstream file( filename );
+    if ( !file )
+      throw_runtime_error( "Unable to open eos table \"" << filename << "\"" );
+
+    tables_t tables;
+    std::map< std::string, std::vector<real_t> * > names = {
+      { "density_axis", &tables.density_axis },
+      { "energy_axis", &tables.energy_axis },
+      { "temperature_axis", &tables.temperature_axis },
+      { "pressure", &tables.pressure },
+      { "temperature", &tables.temperature },
+      { "sound_speed", &tables.sound_speed },
+      { "internal_energy", &tables.internal_energy }
+    };
+
+    // skip the white space and the comments
+    auto skip = [&]() {
+      while ( file >> std::ws && file.peek() == '#' )
+        file.ignore( std::numeric_limits<std::streamsize>::max(), '\n' );
+    };
+
+    std::string name;
+    while ( skip(), file >> name ) {
+      auto it = names.find( name );
+      if ( it == names.end() )
+        throw_runtime_error( "Unknown table \"" << name << "\" in \"" <<
+          filename << "\"" );
+      std::size_t n;
+      skip();
+      if ( !(file >> n) )
+        throw_runtime_error( "Missing size of table \"" << name << "\" in \""
+          << filename << "\"" );
+      auto & values = *it->second;
+      values.resize( n );
+      for ( auto & x : values ) {
+        skip();
+        if ( !(file >> x) )
+          throw_runtime_error( "Table \"" << name << "\" in \"" << filename
+            << "\" is short" );
+      }
+    }
+
+    return tables;
+  }
+
+  //! \brief Check the tables, and work out the slopes.
+  void setup()
+  {
+    const auto & xs = tables_.density_axis;
+    const auto & es = tables_.energy_axis;
+    const auto & ts = tables_.temperature_axis;
+
+    auto check_axis = [&]( const auto & axis, const char * name ) {
+      if ( axis.size() < 2 )
+        throw_runtime_error( "The eos " << name << " axis needs at least "
+          "two values" );
+      for ( std::size_t i=1; i<axis.size(); ++i )
+        if ( !( axis[i] > axis[i-1] ) )
+          throw_runtime_error( "The eos " << name << " axis is not "
+            "increasing" );
+    };
+    check_axis( xs, "density" );
+    check_axis( es, "energy" );
+    check_axis( ts, "temperature" );
+
+    // the inverse lookups need values that grow along the second axis
+    auto check_table = [&]( const auto & values, const auto & ys,
+      const char * name, bool increasing )
+    {
+      if ( values.size() != xs.size() * ys.size() )
+        throw_runtime_error( "The eos " << name << " table has " <<
+          values.size() << " values, expected " << xs.size() * ys.size() );
+      if ( !increasing ) return;
+      for ( std::size_t i=0; i<xs.size(); ++i )
+        for ( std::size_t j=1; j<ys.size(); ++j )
+          if ( values[i*ys.size() + j] < values[i*ys.size() + j-1] )
+            throw_runtime_error( "The eos " << name << " table does not "
+              "grow with the " << (&ys == &es ? "energy" : "temperature") );
+    };
+    check_table( tables_.pressure, es, "pressure", true );
+    check_table( tables_.temperature, es, "temperature", true );
+    check_table( tables_.sound_speed, es, "sound speed", false );
+    check_table( tables_.internal_energy, ts, "internal energy", true );
+
+    pressure_ = make_field( &tables_t::pressure, xs, es );
+    temperature_ = make_field( &tables_t::temperature, xs, es );
+    sound_speed_ = make_field( &tables_t::sound_speed, xs, es );
+    energy_dt_ = make_field( &tables_t::internal_energy, xs, ts );
+
+    density_ = xs.front();
+    internal_energy_ = es.front();
+  }
+
+  //! \brief Set up a field, with monotone slopes for the cubic
+  //!        interpolation.
+  //!
+  //! The field refers to its values by member, so it stays valid when the
+  //! equation of state is copied.
+  field_t make_field(
+    std::vector<real_t> tables_t::* values,
+    const std::vector<real_t> & xs,
+    const std::vector<real_t> & ys
+  ) const
+  {
+    field_t field;
+    field.values = values;
+    if ( interpolation_ != interpolation_t::monotone_cubic ) return field;
+
+    auto nx = xs.size();
+    auto ny = ys.size();
+    const auto & f = tables_.*values;
+    field.dx.resize( f.size() );
+    field.dy.resize( f.size() );
+    for ( std::size_t j=0; j<ny; ++j )
+      slopes( xs, &f[j], ny, &field.dx[j] );
+    for ( std::size_t i=0; i<nx; ++i )
+      slopes( ys, &f[i*ny], 1, &field.dy[i*ny] );
+    return field;
+  }
+
+  //! \brief Compute the slopes along one line of a table, which keep the
+  //!        cubic interpolant monotone between values.
+  //!
+  //! The interior slopes are the weighted harmonic means of the secants of
+  //! Fritsch and Butland, or zero at an extremum, and the end slopes are
+  //! the end secants.
+  static void slopes(
+    const std::vector<real_t> & xs,
+    const real_t * ys,
+    std::size_t stride,
+    real_t * ms
+  ) {
+    auto n = xs.size();
+    auto secant = [&]( std::size_t k ) {
+      return ( ys[(k+1)*stride] - ys[k*stride] ) / ( xs[k+1] - xs[k] );
+    };
+    ms[0] = secant(0);
+    ms[(n-1)*stride] = secant(n-2);
+    for ( std::size_t k=1; k+1<n; ++k ) {
+      auto d0 = secant(k-1);
+      auto d1 = secant(k);
+      auto h0 = xs[k] - xs[k-1];
+      auto h1 = xs[k+1] - xs[k];
+      ms[k*stride] = d0 * d1 <= 0 ? 0 :
+        3 * ( h0 + h1 ) / ( ( 2*h1 + h0 ) / d0 + ( h1 + 2*h0 ) / d1 );
+    }
+  }
+
+  //! \brief Find where a value falls on an axis.
+  //!
+  //! The cell of the hint and its neighbors are tried before searching the
+  //! whole axis, and the hint is updated.  Values off the axis are clamped
+  //! to its ends.
+  static position_t locate(
+    const std::vector<real_t> & axis,
+    real_t x,
+    std::uint32_t & hint
+  ) {
+    auto n = axis.size();
+    std::size_t i = std::min<std::size_t>( hint, n-2 );
+
+    auto inside = [&]( std::size_t k ) {
+      return ( k == 0 || axis[k] <= x ) && ( k == n-2 || x < axis[k+1] );
+    };
+
+    if ( !inside(i) ) {
+      if ( i+1 < n-1 && inside(i+1) ) i = i+1;
+      else if ( i > 0 && inside(i-1) ) i = i-1;
+      else {
+        auto it = std::upper_bound( axis.begin()+1, axis.end()-1, x );
+        i = it - axis.begin() - 1;
+      }
+      hint = i;
+    }
+
+    auto u = ( x - axis[i] ) / ( axis[i+1] - axis[i] );
+    return { i, std::min<real_t>( std::max<real_t>( u, 0 ), 1 ) };
+  }
+
+  //! \brief The cubic Hermite basis functions.
+  static real_t h00( real_t t ) { return ( 2*t - 3 ) * t * t + 1; }
+  static real_t h01( real_t t ) { return ( 3 - 2*t ) * t * t; }
+  static real_t h10( real_t t ) { return ( ( t - 2 ) * t + 1 ) * t; }
+  static real_t h11( real_t t ) { return ( t - 1 ) * t * t; }
+
+  //! \brief Interpolate a field along the first axis, at a value of the
+  //!        second axis.
+  real_t interpolate_row(
+    const field_t & field,
+    const std::vector<real_t> & xs,
+    std::size_t ny,
+    position_t x,
+    std::size_t j
+  ) const
+  {
+    const auto & f = tables_.*field.values;
+    auto k0 = x.i*ny + j;
+    auto k1 = k0 + ny;
+    if ( interpolation_ == interpolation_t::bilinear )
+      return ( 1 - x.u ) * f[k0] + x.u * f[k1];
+    auto hx = xs[x.i+1] - xs[x.i];
+    return h00(x.u) * f[k0] + h01(x.u) * f[k1] +
+      hx * ( h10(x.u) * field.dx[k0] + h11(x.u) * field.dx[k1] );
+  }
+
+  //! \brief Interpolate a field.
+  real_t interpolate(
+    const field_t & field,
+    const std::vector<real_t> & xs,
+    const std::vector<real_t> & ys,
+    position_t x,
+    position_t y
+  ) const
+  {
+    auto ny = ys.size();
+    auto f0 = interpolate_row( field, xs, ny, x, y.i );
+    auto f1 = interpolate_row( field, xs, ny, x, y.i+1 );
+    if ( interpolation_ == interpolation_t::bilinear )
+      return ( 1 - y.u ) * f0 + y.u * f1;
+
+    // the slopes along the second axis, interpolated like the values
+    auto slope = [&]( std::size_t j ) {
+      auto k0 = x.i*ny + j;
+      auto k1 = k0 + ny;
+      return ( 1 - x.u ) * field.dy[k0] + x.u * field.dy[k1];
+    };
+    auto hy = ys[y.i+1] - ys[y.i];
+    return h00(y.u) * f0 + h01(y.u) * f1 +
+      hy * ( h10(y.u) * slope(y.i) + h11(y.u) * slope(y.i+1) );
+  }
+
+  //! \brief Look up a field of the (density, energy) table.
+  real_t lookup_de(
+    const field_t & field,
+    real_t density,
+    real_t internal_energy,
+    hint_t & hint
+  ) const
+  {
+    auto x = locate( tables_.density_axis, density, hint.density );
+    auto y = locate( tables_.energy_axis, internal_energy, hint.energy );
+    return interpolate( field, tables_.density_axis, tables_.energy_axis, x, y );
+  }
+
+  //! \brief Find the energy where a field of the (density, energy) table
+  //!        takes a value.
+  //!
+  //! The field grows with the energy, so the table cell is found by
+  //! searching the values at the energies of the table, starting from the
+  //! cell of the hint, and the energy within the cell by inverting the
+  //! interpolant.  Values off the table give the energy at its edge.
+  real_t invert(
+    const field_t & field,
+    position_t x,
+    real_t value,
+    std::uint32_t & hint
+  ) const
+  {
+    const auto & xs = tables_.density_axis;
+    const auto & ys = tables_.energy_axis;
+    auto ny = ys.size();
+
+    auto row = [&]( std::size_t j ) {
+      return interpolate_row( field, xs, ny, x, j );
+    };
+    auto inside = [&]( std::size_t k ) {
+      return ( k == 0 || row(k) <= value ) && ( k == ny-2 || value < row(k+1) );
+    };
+
+    std::size_t j = std::min<std::size_t>( hint, ny-2 );
+    if ( !inside(j) ) {
+      if ( j+1 < ny-1 && inside(j+1) ) j = j+1;
+      else if ( j > 0 && inside(j-1) ) j = j-1;
+      else {
+        // binary search for the last value at or below
+        std::size_t lo = 0, hi = ny-1;
+        while ( hi - lo > 1 ) {
+          auto mid = ( lo + hi ) / 2;
+          if ( row(mid) <= value ) lo = mid;
+          else hi = mid;
+        }
+        j = std::min( lo, ny-2 );
+      }
+      hint = j;
+    }
+
+    auto f0 = row(j);
+    auto f1 = row(j+1);
+    auto y0 = ys[j];
+    auto y1 = ys[j+1];
+    if ( value <= f0 ) return y0;
+    if ( value >= f1 ) return y1;
+
+    if ( interpolation_ == interpolation_t::bilinear )
+      return y0 + ( value - f0 ) / ( f1 - f0 ) * ( y1 - y0 );
+
+    // the cubic is bracketed, so use the secant method, halving the weight
+    // of an end that is kept twice in a row so it cannot stall
+    real_t a = 0, b = 1, c = 0, fa = f0 - value, fb = f1 - value;
+    auto tolerance = epsilon * std::max( std::abs(f0), std::abs(f1) );
+    int side = 0;
+    for ( int it=0; it<100; ++it ) {
+      c = ( a*fb - b*fa ) / ( fb - fa );
+      auto fc = interpolate( field, xs, ys, x, {j, c} ) - value;
+      if ( std::abs(fc) <= tolerance || b - a < epsilon ) break;
+      if ( fc * fb > 0 ) {
+        b = c; fb = fc;
+        if ( side == -1 ) fa /= 2;
+        side = -1;
+      }
+      else {
+        a = c; fa = fc;
+        if ( side == 1 ) fb /= 2;
+        side = 1;
+      }
+    }
+    return y0 + c * ( y1 - y0 );
+  }
+
+  //===============================================================
+  // Member variables
+  //===============================================================
+
+  //! the tables
+  tables_t tables_;
+
+  //! the interpolation
+  interpolation_t interpolation_ = interpolation_t::bilinear;
+
+  //! the tabulated values
+  field_t pressure_, temperature_, sound_speed_, energy_dt_;
+
+  //! the reference density
+  real_t density_ = 1;
+
+  //! the reference internal energy
+  real_t internal_energy_ = 1;
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,126 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+/// 
+/// \brief Tests related to the stiffened gas and the variant of equations of
+///        state.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <iostream>
+#include <vector>
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/eos/eos_variant.h>
+#include <flecsale/eos/ideal_gas.h>
+#include <flecsale/eos/stiffened_gas.h>
+
+
+// explicitly use some stuff
+using std::vector;
+
+using namespace flecsale;
+using namespace flecsale::eos;
+
+using real_t = config::real_t;
+
+using config::test_tolerance;
+
+//! the variant under test
+using eos_t = eos_variant__< real_t, ideal_gas_t, stiffened_gas_t >;
+
+    
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test of the stiffened gas
+///////////////////////////////////////////////////////////////////////////////
+TEST(eos, stiffened_gas) {
+
+  stiffened_gas_t<real_t> eos( 4.4, 1.0, 6.e2 );
+
+  vector<real_t> d{1000.0, 1100.0};
+  vector<real_t> p{1.0e5, 2.0e5};
+
+  for ( size_t i = 0; i<d.size(); i++ ) {
+    auto e = eos.compute_internal_energy_dp( d[i], p[i] );
+    ASSERT_NEAR( p[i], eos.compute_pressure_de( d[i], e ), 1.e-8*p[i] )
+      << "Pressure test failed";
+    auto ec = e - eos.get_pressure_inf() / d[i];
+    ASSERT_NEAR( ec, eos.compute_temperature_de( d[i], e ), test_tolerance )
+      << "Temperature test failed";
+    ASSERT_NEAR( std::sqrt( 4.4*3.4*ec ), eos.compute_sound_speed_de( d[i], e ),
+      test_tolerance ) << "Sound speed test failed";
+  }
+
+  // without the stiffening pressure it is an ideal gas
+  stiffened_gas_t<real_t> stiff( 1.4, 2.5, 0.0 );
+  ideal_gas_t<real_t> ideal( 1.4, 2.5 );
+  for ( size_t i = 0; i<d.size(); i++ ) {
+    auto e = ideal.compute_internal_energy_dp( d[i], p[i] );
+    ASSERT_NEAR( e, stiff.compute_internal_energy_dp( d[i], p[i] ), 
+      test_tolerance*e );
+    ASSERT_NEAR( ideal.compute_sound_speed_de( d[i], e ), 
+      stiff.compute_sound_speed_de( d[i], e ), test_tolerance );
+    ASSERT_NEAR( ideal.compute_temperature_de( d[i], e ), 
+      stiff.compute_temperature_de( d[i], e ), test_tolerance );
+  }
+    
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the variant gives the same states as what it holds
+///////////////////////////////////////////////////////////////////////////////
+TEST(eos, eos_variant) {
+
+  ideal_gas_t<real_t> ideal( 1.4, 2.5 );
+  stiffened_gas_t<real_t> stiff( 4.4, 1.0, 6.e2 );
+
+  vector<eos_t> eos{ ideal, stiff };
+  ASSERT_EQ( 0, eos[0].index() );
+  ASSERT_EQ( 1, eos[1].index() );
+
+  constexpr size_t n = 37;
+  vector<real_t> d(n), e(n), p(n), t(n), ss(n), ie(n);
+  for ( size_t i = 0; i<n; i++ ) {
+    d[i] = 1000.0 + i;
+    e[i] = 2.0 + 0.5*i;
+  }
+
+  for ( size_t i = 0; i<n; i++ ) {
+    ASSERT_EQ( ideal.compute_pressure_de( d[i], e[i] ), 
+      eos[0].compute_pressure_de( d[i], e[i] ) );
+    ASSERT_EQ( stiff.compute_pressure_de( d[i], e[i] ), 
+      eos[1].compute_pressure_de( d[i], e[i] ) );
+    ASSERT_EQ( stiff.compute_sound_speed_de( d[i], e[i] ), 
+      eos[1].compute_sound_speed_de( d[i], e[i] ) );
+  }
+
+  // the batches match the single calls
+  for ( const auto & eos_i : eos ) {
+    eos_i.compute_state_de( 
+      n, d.data(), e.data(), p.data(), t.data(), ss.data() 
+    );
+    eos_i.compute_internal_energy_dp( n, d.data(), p.data(), ie.data() );
+    for ( size_t i = 0; i<n; i++ ) {
+      auto pi = eos_i.compute_pressure_de( d[i], e[i] );
+      ASSERT_NEAR( pi, p[i], test_tolerance*std::abs(pi) );
+      ASSERT_NEAR( eos_i.compute_temperature_de( d[i], e[i] ), t[i], 
+        test_tolerance );
+      ASSERT_NEAR( eos_i.compute_sound_speed_de( d[i], e[i] ), ss[i],
+        test_tolerance );
+      ASSERT_NEAR( e[i], ie[i], test_tolerance*e[i] );
+    }
+  }
+
+  // the held equation of state can be changed
+  eos[0] = stiff;
+  ASSERT_EQ( 1, eos[0].index() );
+  ASSERT_EQ( stiff.get_ref_pressure(), eos[0].get_ref_pressure() );
+
+} // TEST
@@ -79,3 +79,28 @@ TEST(eos, ideal_gas) {
 } // TEST_F
 
 
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the batches give the same states as single calls
+///////////////////////////////////////////////////////////////////////////////
+TEST(eos, ideal_gas_batch) {
+
+  ideal_gas_t<real_t> eos( 1.4, 2.5 );
+
+  constexpr size_t n = 37;
+  vector<real_t> d(n), e(n), p(n), t(n), ss(n), ie(n);
+  for ( size_t i = 0; i<n; i++ ) {
+    d[i] = 0.1 + i;
+    e[i] = 2.0 + 0.5*i;
+  }
+
+  eos.compute_state_de( n, d.data(), e.data(), p.data(), t.data(), ss.data() );
+  eos.compute_internal_energy_dp( n, d.data(), p.data(), ie.data() );
+
+  for ( size_t i = 0; i<n; i++ ) {
+    ASSERT_EQ( eos.compute_pressure_de( d[i], e[i] ), p[i] );
+    ASSERT_EQ( eos.compute_temperature_de( d[i], e[i] ), t[i] );
+    ASSERT_EQ( eos.compute_sound_speed_de( d[i], e[i] ), ss[i] );
+    ASSERT_EQ( eos.compute_internal_energy_dp( d[i], p[i] ), ie[i] );
+  }
+
+} // TEST
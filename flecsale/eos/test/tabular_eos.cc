@@ -0,0 +1,262 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the tabular equation of state.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <type_traits>
+#include <vector>
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/eos/eos_variant.h>
+#include <flecsale/eos/ideal_gas.h>
+#include <flecsale/eos/tabular_eos.h>
+
+
+// explicitly use some stuff
+using std::vector;
+
+using namespace flecsale;
+using namespace flecsale::eos;
+
+using real_t = config::real_t;
+using tabular_t = tabular_eos_t<real_t>;
+
+using config::test_tolerance;
+
+//! \brief Tabulate an ideal gas on logarithmically spaced axes.
+tabular_t::tables_t ideal_gas_tables(
+  const ideal_gas_t<real_t> & gas, std::size_t n
+) {
+  auto log_axis = [n]( real_t lo, real_t hi ) {
+    vector<real_t> axis( n );
+    for ( std::size_t i=0; i<n; ++i )
+      axis[i] = lo * std::pow( hi/lo, real_t(i) / (n-1) );
+    return axis;
+  };
+
+  tabular_t::tables_t tables;
+  tables.density_axis = log_axis( 0.01, 100 );
+  tables.energy_axis = log_axis( 0.01, 100 );
+  tables.temperature_axis = log_axis( 0.01, 100 );
+  for ( auto d : tables.density_axis ) {
+    for ( auto e : tables.energy_axis ) {
+      tables.pressure.emplace_back( gas.compute_pressure_de( d, e ) );
+      tables.temperature.emplace_back( gas.compute_temperature_de( d, e ) );
+      tables.sound_speed.emplace_back( gas.compute_sound_speed_de( d, e ) );
+    }
+    for ( auto t : tables.temperature_axis )
+      tables.internal_energy.emplace_back( t * gas.get_specific_heat_v() );
+  }
+  return tables;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the bilinear tables reproduce a bilinear state exactly
+///////////////////////////////////////////////////////////////////////////////
+TEST(eos, tabular_bilinear) {
+
+  // the pressure of an ideal gas is bilinear in density and energy
+  ideal_gas_t<real_t> gas( 1.4, 2.0 );
+  tabular_t eos( ideal_gas_tables( gas, 33 ) );
+
+  for ( real_t d : { 0.013, 0.5, 1.0, 7.3, 99.0 } ) {
+    for ( real_t e : { 0.011, 0.3, 1.0, 42.0 } ) {
+      auto p = gas.compute_pressure_de( d, e );
+      ASSERT_NEAR( p, eos.compute_pressure_de( d, e ), test_tolerance * p );
+      ASSERT_NEAR(
+        gas.compute_temperature_de( d, e ), eos.compute_temperature_de( d, e ),
+        test_tolerance * e
+      );
+      ASSERT_NEAR( e, eos.compute_internal_energy_dp( d, p ),
+        1.e-10 * e );
+      ASSERT_NEAR( 1.4, eos.compute_gamma_de( d, e ), 1.e-10 );
+      ASSERT_NEAR( 2*e, eos.compute_internal_energy_dt( d, e ), 1.e-10 * e );
+      // the sound speed is not bilinear, but close on a fine table
+      auto a = gas.compute_sound_speed_de( d, e );
+      ASSERT_NEAR( a, eos.compute_sound_speed_de( d, e ), 1.e-2 * a );
+    }
+  }
+
+  // states off the table are held at its edges
+  ASSERT_NEAR(
+    eos.compute_pressure_de( 1.e3, 1.e3 ), eos.compute_pressure_de( 100, 100 ),
+    test_tolerance
+  );
+  ASSERT_NEAR( 100, eos.compute_internal_energy_dp( 1, 1.e6 ), test_tolerance );
+
+  // the reference states
+  eos.set_ref_state_tp( gas.compute_pressure_de( 2, 3 ), 1.5 );
+  ASSERT_NEAR( 2, eos.get_ref_density(), 1.e-8 );
+  ASSERT_NEAR( 3, eos.get_ref_internal_energy(), 1.e-8 );
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the monotone cubic interpolation
+///////////////////////////////////////////////////////////////////////////////
+TEST(eos, tabular_cubic) {
+
+  ideal_gas_t<real_t> gas( 1.4, 1.0 );
+  auto tables = ideal_gas_tables( gas, 33 );
+  tabular_t linear( tables );
+  tabular_t cubic( tables, tabular_t::interpolation_t::monotone_cubic );
+
+  // the cubic is closer where the bilinear interpolant is not exact
+  real_t linear_error = 0, cubic_error = 0;
+  for ( real_t d : { 0.02, 0.7, 3.3, 50.0 } ) {
+    for ( real_t e : { 0.017, 0.25, 1.7, 60.0 } ) {
+      auto a = gas.compute_sound_speed_de( d, e );
+      linear_error = std::max( linear_error,
+        std::abs( linear.compute_sound_speed_de( d, e ) - a ) / a );
+      cubic_error = std::max( cubic_error,
+        std::abs( cubic.compute_sound_speed_de( d, e ) - a ) / a );
+
+      // the inverse undoes the lookup
+      auto p = cubic.compute_pressure_de( d, e );
+      auto ie = cubic.compute_internal_energy_dp( d, p );
+      ASSERT_NEAR( e, ie, 1.e-10 * e );
+    }
+  }
+  ASSERT_LT( cubic_error, linear_error );
+
+  // the interpolant stays monotone along the energy
+  real_t last = 0;
+  for ( real_t e = 0.01; e < 100; e *= 1.01 ) {
+    auto p = cubic.compute_pressure_de( 0.5, e );
+    ASSERT_GE( p, last );
+    last = p;
+  }
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the hints and the batches give the same states
+///////////////////////////////////////////////////////////////////////////////
+TEST(eos, tabular_hints) {
+
+  ideal_gas_t<real_t> gas( 1.4, 1.0 );
+  tabular_t eos( ideal_gas_tables( gas, 65 ) );
+
+  constexpr std::size_t n = 100;
+  vector<real_t> d(n), e(n), p(n), t(n), a(n), ie(n);
+  vector<tabular_t::hint_t> hints(n);
+
+  // the states drift a little each step, so the hints are mostly right
+  for ( int step=0; step<20; ++step ) {
+    for ( std::size_t i=0; i<n; ++i ) {
+      d[i] = 0.1 + i * ( 1 + 0.01 * step );
+      e[i] = 0.5 + 0.2 * i / ( 1 + 0.02 * step );
+    }
+    eos.compute_state_de( n, d.data(), e.data(), p.data(), t.data(),
+      a.data(), hints.data() );
+    for ( std::size_t i=0; i<n; ++i ) {
+      ASSERT_EQ( p[i], eos.compute_pressure_de( d[i], e[i] ) );
+      ASSERT_EQ( t[i], eos.compute_temperature_de( d[i], e[i] ) );
+      ASSERT_EQ( a[i], eos.compute_sound_speed_de( d[i], e[i] ) );
+      // the hint is the table cell of the state
+      const auto & axis = eos.get_tables().density_axis;
+      auto j = std::min<std::size_t>( hints[i].density, axis.size()-2 );
+      ASSERT_TRUE( d[i] >= axis[j] || j == 0 );
+      ASSERT_TRUE( d[i] < axis[j+1] || j == axis.size()-2 );
+    }
+    eos.compute_internal_energy_dp( n, d.data(), p.data(), ie.data(),
+      hints.data() );
+    for ( std::size_t i=0; i<n; ++i )
+      ASSERT_NEAR( e[i], ie[i], 1.e-10 * e[i] );
+  }
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the variant passes the hints to the tables only
+///////////////////////////////////////////////////////////////////////////////
+TEST(eos, tabular_variant_hints) {
+
+  using eos_t = eos_variant__< real_t, ideal_gas_t, tabular_eos_t >;
+  static_assert( std::is_same< eos_t::hint_t, tabular_t::hint_t >::value,
+    "the variant hint is the tabular one" );
+
+  ideal_gas_t<real_t> gas( 1.4, 1.0 );
+  tabular_t table( ideal_gas_tables( gas, 65 ) );
+  eos_t ideal( gas ), tabular( table );
+  ASSERT_FALSE( ideal.takes_hints() );
+  ASSERT_TRUE( tabular.takes_hints() );
+
+  constexpr std::size_t n = 50;
+  vector<real_t> d(n), e(n), p(n), t(n), a(n), p0(n), t0(n), a0(n);
+  vector<tabular_t::hint_t> hints(n), hints0(n);
+  for ( std::size_t i=0; i<n; ++i ) {
+    d[i] = 0.1 + 1.5 * i;
+    e[i] = 0.5 + 0.3 * i;
+  }
+
+  // the held tables update the hints just like a direct call
+  tabular.compute_state_de( n, d.data(), e.data(), p.data(), t.data(),
+    a.data(), hints.data() );
+  table.compute_state_de( n, d.data(), e.data(), p0.data(), t0.data(),
+    a0.data(), hints0.data() );
+  for ( std::size_t i=0; i<n; ++i ) {
+    ASSERT_EQ( p0[i], p[i] );
+    ASSERT_EQ( t0[i], t[i] );
+    ASSERT_EQ( a0[i], a[i] );
+    ASSERT_EQ( hints0[i].density, hints[i].density );
+    ASSERT_EQ( hints0[i].energy, hints[i].energy );
+  }
+
+  // the ideal gas leaves them alone
+  vector<tabular_t::hint_t> unused(n);
+  ideal.compute_state_de( n, d.data(), e.data(), p.data(), t.data(),
+    a.data(), unused.data() );
+  for ( std::size_t i=0; i<n; ++i ) {
+    ASSERT_EQ( gas.compute_pressure_de( d[i], e[i] ), p[i] );
+    ASSERT_EQ( 0u, unused[i].density );
+    ASSERT_EQ( 0u, unused[i].energy );
+  }
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test reading the tables from a file, and bad tables
+///////////////////////////////////////////////////////////////////////////////
+TEST(eos, tabular_file) {
+
+  auto filename = "tabular_eos_test.dat";
+  {
+    std::ofstream file( filename );
+    file << "# a gamma = 2 gas with cv = 1\n"
+         << "density_axis 2 1 2\n"
+         << "energy_axis 2 1 2\n"
+         << "temperature_axis 2 1 2  # matches the energy\n"
+         << "pressure 4\n 1 2\n 2 4\n"
+         << "temperature 4 1 2 1 2\n"
+         << "sound_speed 4 1.4 2 1.4 2\n"
+         << "internal_energy 4 1 2 1 2\n";
+  }
+  tabular_t eos( filename );
+  ASSERT_NEAR( 2.25, eos.compute_pressure_de( 1.5, 1.5 ), test_tolerance );
+  ASSERT_NEAR( 1.5, eos.compute_internal_energy_dp( 1.5, 2.25 ),
+    test_tolerance );
+  std::remove( filename );
+
+  ASSERT_THROW( tabular_t( "no_such_table.dat" ), std::runtime_error );
+
+  // the pressure must grow with the energy to be inverted
+  ideal_gas_t<real_t> gas;
+  auto tables = ideal_gas_tables( gas, 4 );
+  std::swap( tables.pressure[0], tables.pressure[1] );
+  ASSERT_THROW( tabular_t( std::move(tables) ), std::runtime_error );
+
+}
@@ -16,6 +16,10 @@
 #include <ristra/math/general.h>
 #include <ristra/math/array.h>
 
+// system includes
+#include <array>
+#include <utility>
+
 namespace flecsale {
 namespace eqns {
 
@@ -324,6 +328,124 @@ public:
   };
 
 
+  //============================================================================
+  //! \brief A batch of states, one per simd lane.
+  //!
+  //! Only the quantities needed to evaluate fluxes are stored.
+  //! \tparam V  The simd vector type.
+  //============================================================================
+  template< typename V >
+  struct batch_state__ {
+    V density;
+    std::array<V, N> velocity;
+    V pressure;
+    V internal_energy;
+    V sound_speed;
+  };
+
+  //! \brief A batch of vectors, stored by component.
+  template< typename V >
+  using batch_vector__ = std::array<V, N>;
+
+  //! \brief A batch of fluxes, stored by equation.
+  template< typename V >
+  using batch_flux__ = std::array<V, equations::index::total>;
+
+  //============================================================================
+  //! \brief Compute the fastest moving wavespeed for a batch of states.
+  //! \param [in] u     The solution states.
+  //! \param [in] norm  The normal vectors.
+  //! \tparam V  The simd vector type.
+  //! \return The fastest moving wave speeds.
+  //============================================================================
+  template< typename V >
+  static V batch_fastest_wavespeed( 
+    const batch_state__<V> & u, const batch_vector__<V> & norm 
+  ) {
+    auto vn = u.velocity[0] * norm[0];
+    for ( int i=1; i<N; ++i ) vn += u.velocity[i] * norm[i];
+    return u.sound_speed + abs(vn);
+  }
+
+  //============================================================================
+  //! \brief Compute the fastest moving eigenvalues for a batch of states.
+  //! \param [in] u     The solution states.
+  //! \param [in] norm  The normal vectors.
+  //! \tparam V  The simd vector type.
+  //! \return The minimum and maximum eigenvalues.
+  //============================================================================
+  template< typename V >
+  static std::pair<V, V> batch_minmax_eigenvalues( 
+    const batch_state__<V> & u, const batch_vector__<V> & norm 
+  ) {
+    auto vn = u.velocity[0] * norm[0];
+    for ( int i=1; i<N; ++i ) vn += u.velocity[i] * norm[i];
+    return std::make_pair( vn - u.sound_speed, vn + u.sound_speed );
+  }
+
+  //============================================================================
+  //! \brief Computes the change in conserved quantities for a batch of 
+  //!        states.
+  //! \param [in]  ul   The left states.
+  //! \param [in]  ur   The right states.
+  //! \tparam V  The simd vector type.
+  //! \return ur - ul
+  //============================================================================
+  template< typename V >
+  static batch_flux__<V> batch_solution_delta( 
+    const batch_state__<V> & ul, const batch_state__<V> & ur 
+  ) {
+    auto ke_l = ul.velocity[0] * ul.velocity[0];
+    auto ke_r = ur.velocity[0] * ur.velocity[0];
+    for ( int i=1; i<N; ++i ) {
+      ke_l += ul.velocity[i] * ul.velocity[i];
+      ke_r += ur.velocity[i] * ur.velocity[i];
+    }
+    auto ener_l = ul.density * ( ul.internal_energy + V(0.5) * ke_l );
+    auto ener_r = ur.density * ( ur.internal_energy + V(0.5) * ke_r );
+
+    batch_flux__<V> du;
+    du[equations::index::mass] = ur.density - ul.density;
+    for ( int i=0; i<N; ++i )  
+      du[equations::index::momentum+i] = 
+        ur.density*ur.velocity[i] - ul.density*ul.velocity[i];
+    du[equations::index::energy] = ener_r - ener_l;
+    return du;
+  }
+
+  //============================================================================
+  //! \brief Compute the flux in the normal direction for a batch of states.
+  //! \param [in] u     The solution states.
+  //! \param [in] norm  The normal vectors.
+  //! \tparam V  The simd vector type.
+  //! \return The fluxes alligned with the normal directions.
+  //============================================================================
+  template< typename V >
+  static batch_flux__<V> batch_flux( 
+    const batch_state__<V> & u, const batch_vector__<V> & norm 
+  ) {
+    const auto & rho = u.density;
+    const auto & vel = u.velocity;
+    const auto & p = u.pressure;
+
+    auto v_dot_n = vel[0] * norm[0];
+    auto ke = vel[0] * vel[0];
+    for ( int i=1; i<N; ++i ) {
+      v_dot_n += vel[i] * norm[i];
+      ke += vel[i] * vel[i];
+    }
+    auto et = u.internal_energy + V(0.5) * ke;
+
+    batch_flux__<V> f;
+    auto mass_flux = rho * v_dot_n;
+    f[equations::index::mass] = mass_flux;     
+    for ( int i=0; i<N; i++ ) 
+      f[equations::index::momentum+i] = mass_flux * vel[i] + p*norm[i];
+    f[equations::index::energy] = mass_flux * (et + p/rho);
+    return f;
+  }
+
+
   //============================================================================
   //! \brief Update the state from the pressure.
   //! \param [in,out] u   The state to update.
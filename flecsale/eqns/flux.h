@@ -14,6 +14,10 @@
 // user includes
 #include <ristra/math/general.h>
 
+// system includes
+#include <tuple>
+#include <type_traits>
+
 namespace flecsale {
 namespace eqns {
 
@@ -106,6 +110,90 @@ auto hlle_flux( const U & wl, const U & wr, const V & n) {
 };
 
 
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the rusanov flux function for a batch of faces.
+//!
+//! Each simd lane holds a different face.
+//!
+//! \tparam E  the equations type
+//! \tparam S  the batch state type
+//! \tparam V  the batch vector type
+//!
+//! \param [in] wl,wr  the left and right states
+//! \param [in] n      the normal directions
+//! \return the fluxes
+////////////////////////////////////////////////////////////////////////////////
+template< typename E, typename S, typename V >
+auto rusanov_flux_batch( const S & wl, const S & wr, const V & n) { 
+  // get the centered flux 
+  auto fl = E::batch_flux( wl, n );
+  auto fr = E::batch_flux( wr, n );
+  // compute some things for the dissipation term
+  auto sl = E::batch_fastest_wavespeed( wl, n );
+  auto sr = E::batch_fastest_wavespeed( wr, n );
+  auto s = max( sl, sr );
+  auto du = E::batch_solution_delta( wl, wr );
+  // compute final flux
+  // f = 0.5*(fl+fr) - s_max/2 * (ur-ul)
+  using simd_t = std::decay_t<decltype(s)>;
+  auto s_half = s / simd_t(2);
+  decltype(du) f;
+  constexpr auto num_var = std::tuple_size< decltype(f) >::value;
+  for ( int i=0; i<num_var; ++i )
+    f[i] = ( fl[i] + fr[i] ) / simd_t(2) - du[i] * s_half;
+  return f;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the HLLE flux function for a batch of faces.
+//!
+//! Each simd lane holds a different face.  The upwind cases are handled
+//! with masked selects instead of branches.
+//!
+//! \tparam E  the equations type
+//! \tparam S  the batch state type
+//! \tparam V  the batch vector type
+//!
+//! \param [in] wl,wr  the left and right states
+//! \param [in] n      the normal directions
+//! \return the fluxes
+////////////////////////////////////////////////////////////////////////////////
+template< typename E, typename S, typename V >
+auto hlle_flux_batch( const S & wl, const S & wr, const V & n) { 
+  // compute some things for the dissipation term
+  auto sl = E::batch_minmax_eigenvalues( wl, n );
+  auto sr = E::batch_minmax_eigenvalues( wr, n );
+
+  auto lambda_l = min( sl.first, sr.first );
+  auto lambda_r = max( sl.second, sr.second );
+
+  using simd_t = std::decay_t<decltype(lambda_l)>;
+  auto zero = simd_t(0);
+  auto use_left = ( lambda_l >= zero );
+  auto use_right = ( lambda_r <= zero );
+
+  auto fl = E::batch_flux( wl, n );
+  auto fr = E::batch_flux( wr, n );
+  auto du = E::batch_solution_delta( wl, wr );
+  
+  // upwinded lanes may have lambda_r == lambda_l, so keep them finite
+  auto c1 = lambda_l * lambda_r;
+  auto c2 = select( use_left || use_right, simd_t(1), lambda_r - lambda_l );
+  auto c2inv = simd_t(1) / c2;
+
+  //f = ( lambda_r*fl - lambda_l*fr + c1*(ur - ul) ) / c2
+  decltype(du) f;
+  constexpr auto num_var = std::tuple_size< decltype(f) >::value;
+  for ( int i=0; i<num_var; ++i ) {
+    auto fhlle = c2inv * ( lambda_r*fl[i] - lambda_l*fr[i] + c1*du[i] );
+    f[i] = select( use_left, fl[i], select( use_right, fr[i], fhlle ) );
+  }
+  return f;
+};
+
+
 } // namespace
 } // namespace
 
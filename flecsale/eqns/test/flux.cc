@@ -0,0 +1,134 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the flux functions.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/eqns/euler_eqns.h>
+#include <flecsale/eqns/flux.h>
+#include <flecsale/utils/simd.h>
+
+
+// explicitly use some stuff
+using namespace flecsale;
+using namespace flecsale::eqns;
+
+using real_t = config::real_t;
+using eqns_t = euler_eqns_t<real_t,3>;
+using simd_t = utils::simd_t<real_t>;
+using config::test_tolerance;
+
+using state_t = eqns_t::state_data_t;
+using vector_t = eqns_t::vector_t;
+using batch_state_t = eqns_t::batch_state__<simd_t>;
+using batch_vector_t = eqns_t::batch_vector__<simd_t>;
+
+constexpr auto width = simd_t::width;
+constexpr auto num_dims = eqns_t::num_dimensions;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Make a random ideal gas state.
+///////////////////////////////////////////////////////////////////////////////
+template< typename G >
+state_t make_state( G & gen, real_t max_vel )
+{
+  std::uniform_real_distribution<real_t> dist(-1, 1);
+  constexpr real_t gamma = 1.4;
+
+  real_t d = 1 + dist(gen)/2;
+  real_t p = 1 + dist(gen)/2;
+  vector_t v;
+  for ( std::size_t i=0; i<num_dims; ++i ) v[i] = max_vel*dist(gen);
+
+  return state_t{ d, v, p, p / ((gamma-1)*d), 0, std::sqrt(gamma*p/d) };
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the states of each lane into a batch.
+///////////////////////////////////////////////////////////////////////////////
+batch_state_t load_batch( const state_t * w )
+{
+  real_t tmp[width];
+
+  auto load = [&]( auto && f ) {
+    for ( std::size_t l=0; l<width; ++l ) tmp[l] = f( w[l] );
+    return simd_t::load( tmp );
+  };
+
+  batch_state_t b;
+  b.density = load( [](auto & u) { return eqns_t::density(u); } );
+  for ( std::size_t i=0; i<num_dims; ++i )
+    b.velocity[i] = load( [i](auto & u) { return eqns_t::velocity(u)[i]; } );
+  b.pressure = load( [](auto & u) { return eqns_t::pressure(u); } );
+  b.internal_energy =
+    load( [](auto & u) { return eqns_t::internal_energy(u); } );
+  b.sound_speed = load( [](auto & u) { return eqns_t::sound_speed(u); } );
+  return b;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the batched fluxes match the scalar ones
+///////////////////////////////////////////////////////////////////////////////
+TEST(eqns, flux_batch) {
+
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<real_t> dist(-1, 1);
+
+  // use a range of velocities so that both upwind and mixed hlle lanes
+  // are exercised
+  for ( auto max_vel : {0.1, 1.0, 4.0} ) {
+    for ( int trial=0; trial<10; ++trial ) {
+
+      state_t wl[width], wr[width];
+      vector_t n[width];
+
+      for ( std::size_t l=0; l<width; ++l ) {
+        wl[l] = make_state( gen, max_vel );
+        wr[l] = make_state( gen, max_vel );
+        real_t len = 0;
+        for ( std::size_t i=0; i<num_dims; ++i ) {
+          n[l][i] = dist(gen);
+          len += n[l][i]*n[l][i];
+        }
+        for ( std::size_t i=0; i<num_dims; ++i ) n[l][i] /= std::sqrt(len);
+      }
+
+      auto bl = load_batch( wl );
+      auto br = load_batch( wr );
+      batch_vector_t bn;
+      for ( std::size_t i=0; i<num_dims; ++i ) {
+        real_t tmp[width];
+        for ( std::size_t l=0; l<width; ++l ) tmp[l] = n[l][i];
+        bn[i] = simd_t::load( tmp );
+      }
+
+      auto hlle = hlle_flux_batch<eqns_t>( bl, br, bn );
+      auto rusanov = rusanov_flux_batch<eqns_t>( bl, br, bn );
+
+      for ( std::size_t l=0; l<width; ++l ) {
+        auto hlle_l = hlle_flux<eqns_t>( wl[l], wr[l], n[l] );
+        auto rusanov_l = rusanov_flux<eqns_t>( wl[l], wr[l], n[l] );
+        for ( std::size_t i=0; i<hlle_l.size(); ++i ) {
+          ASSERT_NEAR( hlle[i][l], hlle_l[i], test_tolerance );
+          ASSERT_NEAR( rusanov[i][l], rusanov_l[i], test_tolerance );
+        }
+      }
+
+    } // trial
+  } // max_vel
+
+} // TEST
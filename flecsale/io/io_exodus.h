@@ -10,6 +10,7 @@
 #pragma once
 
 #include <flecsale-config.h>
+#include <flecsale/utils/compression.h>
 
 #include <ristra/assertions/errors.h>
 
@@ -23,10 +24,89 @@
 // files with only one region.
 // #define PARAVIEW_EXODUS_3D_REGION_BUGFIX
 
+// system includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <utility>
+
 
 namespace flecsale {
 namespace io {
 
+////////////////////////////////////////////////////////////////////////////////
+/// \brief The entities a field lives on.
+////////////////////////////////////////////////////////////////////////////////
+enum class field_location_t {
+  cells, vertices
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief A named field to write.
+///
+/// Scalar fields are written as one variable, and vector fields as one 
+/// variable per dimension with "_x", "_y" and "_z" tacked on to the name.
+///
+/// \tparam F  The field accessor type, called with an entity id.
+////////////////////////////////////////////////////////////////////////////////
+template< typename F >
+struct output_field__ {
+  //! the name of the field
+  const char * name;
+  //! the entities the field lives on
+  field_location_t location;
+  //! the field accessor
+  const F & field;
+};
+
+//! \brief Name a field that lives on the cells.
+template< typename F >
+output_field__<F> cell_field( const char * name, const F & field )
+{ return { name, field_location_t::cells, field }; }
+
+//! \brief Name a field that lives on the vertices.
+template< typename F >
+output_field__<F> vertex_field( const char * name, const F & field )
+{ return { name, field_location_t::vertices, field }; }
+
+
+namespace detail {
+
+//! \brief Append a vector to a byte buffer.
+template< typename T >
+void pack( std::vector<char> & buffer, const std::vector<T> & values )
+{
+  std::uint64_t n = values.size();
+  auto pos = buffer.size();
+  buffer.resize( pos + sizeof(n) + n*sizeof(T) );
+  std::memcpy( buffer.data() + pos, &n, sizeof(n) );
+  if ( n ) std::memcpy( buffer.data() + pos + sizeof(n), values.data(), n*sizeof(T) );
+}
+
+//! \brief Read a vector back from a byte buffer, advancing the position.
+template< typename T >
+void unpack( const char * & pos, std::vector<T> & values )
+{
+  std::uint64_t n;
+  std::memcpy( &n, pos, sizeof(n) );
+  pos += sizeof(n);
+  values.resize( n );
+  if ( n ) std::memcpy( values.data(), pos, n*sizeof(T) );
+  pos += n*sizeof(T);
+}
+
+} // namespace detail
+
+
+// the multi-step writer is used for single step writes too
+template< typename MESH_TYPE >
+class exodus_writer__;
+
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief provides base functionality for exodus writer
@@ -58,439 +138,959 @@ public:
   using  ex_index_t = int;
 
 
+  //============================================================================
+  //! \brief Group the cells into element blocks, one per region.
+  //!
+  //! \param [in] m  the mesh
+  //! \param [out] cells  the cell ids, one block after the other
+  //! \param [out] offsets  where each block starts in \e cells, with one 
+  //!                       extra entry at the end
+  //============================================================================
+  static void make_blocks( 
+    mesh_t & m, 
+    std::vector<counter_t> & cells, 
+    std::vector<size_t> & offsets 
+  ) {
+    cells.clear();
+    cells.reserve( m.num_cells() );
+    offsets.assign( 1, 0 );
+
+#ifdef PARAVIEW_EXODUS_3D_REGION_BUGFIX
+    if ( mesh_t::num_dimensions == 3 ) {
+      for ( auto c : m.cells() ) cells.emplace_back( c.id() );
+      offsets.emplace_back( cells.size() );
+      return;
+    }
+#endif
+
+    for ( const auto & region : m.regions() ) {
+      for ( auto c : region ) cells.emplace_back( c.id() );
+      offsets.emplace_back( cells.size() );
+    }
+  }
+
+
 #ifdef FLECSALE_ENABLE_EXODUS
 
   //! use flecsi's base functionality
   using base_t =
     flecsi_sp::io::exodus_base__< MESH_TYPE::num_dimensions, real_t >;
 
+#endif
+
   //============================================================================
-  //! \brief write field data to the file
-  //! \param [in] m  The mesh to extract field data from.
-  //! \return the status of the file
+  //!  \brief Implementation of exodus mesh write for burton specialization.
+  //!
+  //!  This writes a whole new file with a single time step.  Use 
+  //!  exodus_writer__ to append many time steps to one file instead.
+  //!
+  //!  \param[in] name Write burton mesh \e m to \e name.
+  //!  \param[in] m Burton mesh to write to \e name.
+  //!
+  //!  \return Exodus error code. 0 on success.
   //============================================================================
+
   template< typename T >
-  static
-  void write_fields( int exoid, mesh_t & m, size_t time_step, const T & f ) 
-  { 
+  static void write(
+    const std::string &name,
+    mesh_t &m,
+    size_t iteration = 0,
+    ex_real_t time = 0.0,
+    T * const d = nullptr
+  ) {
 
-    int status;
+    // - ignore input iteration because we are always only outputting one solution
+    exodus_writer__<mesh_t> writer;
+    if ( d ) {
+      writer.open( name, m, false, {"density"}, cell_field("density", *d) );
+      writer.write( m, time, cell_field("density", *d) );
+    }
+    else {
+      writer.open( name, m, false, {} );
+      writer.write( m, time );
+    }
+    writer.close();
 
-    // mesh statistics
-    constexpr auto num_dims  = mesh_t::num_dimensions;
-    auto num_nodes = m.num_vertices();
-    auto num_elem = m.num_cells();
-    auto num_elem_blk = m.num_regions();
+  } // io_exodus_t::write
 
-    //--------------------------------------------------------------------------
-    // initial setup
 
-    // a lambda function for validating strings
-    auto validate_string = []( auto && str ) {
-      return std::forward<decltype(str)>(str);
-    };
+}; // struct io_exodus_t
 
-    //--------------------------------------------------------------------------
-    // hard coded data
-    //--------------------------------------------------------------------------
 
-    int num_var = 1;
-    int var_id = 1;
-    int elem_blk_id = 1;
+////////////////////////////////////////////////////////////////////////////////
+/// \brief An exodus file that stays open and has time steps appended to it.
+///
+/// The topology and the coordinates are written once, when the file is 
+/// opened, and each call to write() only adds the field data of a new time
+/// step.  The cells are written as one element block per region.  If the 
+/// mesh moves, the vertex displacements from the original coordinates are 
+/// written with each step, which is how exodus readers expect moving meshes
+/// to be stored.
+///
+/// A file holds one or more pieces, each one the cells of a rank along with
+/// the vertices and faces they use.  The pieces and the snapshots of their
+/// data can be packed into bytes and sent to the rank that writes them, so
+/// one file can hold the pieces of many ranks.  The global ids of the 
+/// cells and vertices are written as the exodus number maps, which ties 
+/// the pieces together again.
+///
+/// The fields are passed to select() and to every snapshot() in the same 
+/// order, and only the selected ones are written.
+///
+/// \tparam MESH_TYPE  The mesh type.
+////////////////////////////////////////////////////////////////////////////////
+template< typename MESH_TYPE >
+class exodus_writer__ {
 
-    // put the number of element fields
-    status = ex_put_var_param(exoid, "e", num_var);
-    if (status)
-      throw_runtime_error(
-        "Problem writing variable number, " <<
-        " ex_put_var_param() returned " << status 
-      );
+public:
 
-    // fill element variable names array
-    //doesnt work
-    //auto label = validate_string( f.label() );
-    auto label = std::string( "output_variable" );
-    status = ex_put_var_name(exoid, "e", var_id, "density");
-    if (status)
-      throw_runtime_error(
-        "Problem writing variable name, " <<
-        " ex_put_var_name() returned " << status 
-      );
+  //! the mesh type
+  using mesh_t = MESH_TYPE;
+  //! the functionality shared with the single step writer
+  using io_t = io_exodus__<mesh_t>;
 
-    size_t cid = 0;
-    std::vector<ex_real_t> tmp(m.num_cells()); 
-    for(auto c: m.cells()) tmp[cid++] = f(c);
-    status = ex_put_elem_var(
-      exoid, time_step, var_id, elem_blk_id, tmp.size(), tmp.data()
-    );
-    if (status)
-      throw_runtime_error(
-        "Problem writing variable data, " <<
-        " ex_put_elem_var() returned " << status 
-      );
+  // other useful types
+  using     size_t = typename io_t::size_t;
+  using  counter_t = typename io_t::counter_t;
+  using     real_t = typename io_t::real_t;
+  using  ex_real_t = typename io_t::ex_real_t;
+  using ex_index_t = typename io_t::ex_index_t;
+  using global_id_t = std::int64_t;
 
-#if 0
+  //============================================================================
+  //! \brief The part of the mesh written by one rank.
+  //!
+  //! The cells are stored one element block after the other, and the 
+  //! connectivity refers to the vertices and faces of this piece.
+  //============================================================================
+  struct piece_t {
+
+    //! the vertex coordinates, one vertex after the other
+    std::vector<ex_real_t> coordinates;
+    //! the global ids of the vertices and the cells, starting at one
+    std::vector<global_id_t> vertex_ids, cell_ids;
+    //! where each element block starts, with one extra entry at the end
+    std::vector<std::uint64_t> block_offsets;
+    //! the vertices of each cell in 2d, or the faces of each cell in 3d
+    std::vector<std::uint64_t> cell_offsets;
+    std::vector<ex_index_t> cell_connectivity;
+    //! the vertices of each face, only used in 3d
+    std::vector<std::uint64_t> face_offsets;
+    std::vector<ex_index_t> face_connectivity;
+
+    //! \brief The number of entities.
+    size_t num_cells() const { return cell_ids.size(); }
+    size_t num_vertices() const { return vertex_ids.size(); }
+    size_t num_faces() const 
+    { return face_offsets.empty() ? 0 : face_offsets.size() - 1; }
+    size_t num_blocks() const { return block_offsets.size() - 1; }
+
+    //! \brief Append to a byte buffer.
+    void pack( std::vector<char> & buffer ) const
+    {
+      detail::pack( buffer, coordinates );
+      detail::pack( buffer, vertex_ids );
+      detail::pack( buffer, cell_ids );
+      detail::pack( buffer, block_offsets );
+      detail::pack( buffer, cell_offsets );
+      detail::pack( buffer, cell_connectivity );
+      detail::pack( buffer, face_offsets );
+      detail::pack( buffer, face_connectivity );
+    }
 
-    //--------------------------------------------------------------------------
-    // nodal data
-    //--------------------------------------------------------------------------
+    //! \brief Read back from a byte buffer.
+    void unpack( const char * & pos )
+    {
+      detail::unpack( pos, coordinates );
+      detail::unpack( pos, vertex_ids );
+      detail::unpack( pos, cell_ids );
+      detail::unpack( pos, block_offsets );
+      detail::unpack( pos, cell_offsets );
+      detail::unpack( pos, cell_connectivity );
+      detail::unpack( pos, face_offsets );
+      detail::unpack( pos, face_connectivity );
+    }
 
+  };
 
-    //--------------------------------------------------------------------------
-    // nodal field data header        
+  //============================================================================
+  //! \brief The data of one time step, copied out of the mesh.
+  //!
+  //! A snapshot does not refer back to the mesh, so it can be written while
+  //! the solution is advanced.
+  //============================================================================
+  struct snapshot_t {
+
+    //! the solution time
+    ex_real_t time = 0;
+    //! the cell values, one variable after the other, and within a 
+    //! variable one block after the other
+    std::vector<ex_real_t> cell_values;
+    //! the vertex values, one variable after the other
+    std::vector<ex_real_t> vertex_values;
+
+    //! \brief Append to a byte buffer.
+    void pack( std::vector<char> & buffer ) const
+    {
+      detail::pack( buffer, std::vector<ex_real_t>{ time } );
+      detail::pack( buffer, cell_values );
+      detail::pack( buffer, vertex_values );
+    }
 
-    // number of nodal fields
-    int num_nf = 0;
+    //! \brief Read back from a byte buffer.
+    void unpack( const char * & pos )
+    {
+      std::vector<ex_real_t> t;
+      detail::unpack( pos, t );
+      time = t.at(0);
+      detail::unpack( pos, cell_values );
+      detail::unpack( pos, vertex_values );
+    }
 
-    // real scalars persistent at vertices
-    auto rspav = flecsi_get_accessors_all(
-      m, real_t, dense, 0, flecsi_has_attribute_at(persistent,vertices)
-    );
-    num_nf += rspav.size();
-    // int scalars persistent at vertices
-    auto ispav = flecsi_get_accessors_all(
-      m, integer_t, dense, 0, flecsi_has_attribute_at(persistent,vertices)
-    );
-    num_nf += ispav.size();
-    // real vectors persistent at vertices
-    auto rvpav = flecsi_get_accessors_all(
-      m, vector_t, dense, 0, flecsi_has_attribute_at(persistent,vertices)
-    );
-    num_nf += num_dims*rvpav.size();
+  };
+
+  //! \brief Constructor.
+  exodus_writer__() = default;
 
-    // variable extension for vectors
-    std::string var_ext[3];
-    var_ext[0] = "_x"; var_ext[1] = "_y";  var_ext[2] = "_z";
+  //! \brief Destructor, closes the file.
+  ~exodus_writer__() { close(); }
 
-    // put the number of nodal fields
-    if (num_nf > 0) {
-      status = ex_put_var_param(exoid_, "n", num_nf);
-      assert(status == 0);
+  //! writers own a file, so they are not copyable
+  exodus_writer__( const exodus_writer__ & ) = delete;
+  exodus_writer__ & operator=( const exodus_writer__ & ) = delete;
+
+  //============================================================================
+  //! \brief Compress the file.
+  //!
+  //! The file is made a netCDF-4 file, which deflates the shuffled bytes of
+  //! each variable.  On top of that, the values of a field can be rounded
+  //! to an error tolerance, on the thread that writes them, which leaves
+  //! far less for the deflate stage to store.  This must be called before
+  //! select() and open().
+  //!
+  //! \param [in] level  the deflate level, from one to nine, or zero to
+  //!                    write an uncompressed file
+  //! \param [in] tolerances  the error allowed, by field name
+  //============================================================================
+  void set_compression( 
+    int level, 
+    const std::map< std::string, utils::tolerance_t > & tolerances 
+  ) {
+    compression_level_ = level;
+    tolerances_ = tolerances;
+  }
+
+  //============================================================================
+  //! \brief Pick the fields to write.
+  //!
+  //! \param [in] moving  if true, the vertex displacements are written with
+  //!                     each time step
+  //! \param [in] selection  the names of the fields to write
+  //! \param [in] fields  the fields that can be written
+  //============================================================================
+  template< typename... FIELDS >
+  void select( 
+    bool moving, 
+    const std::vector<std::string> & selection,
+    const FIELDS &... fields
+  ) {
+    moving_ = moving;
+    selection_ = selection;
+    cell_vars_.clear();
+    vertex_vars_.clear();
+    cell_tolerances_.clear();
+    vertex_tolerances_.clear();
+
+    // the displacements come first
+    if ( moving_ ) {
+      const char * names[] = { "displ_x", "displ_y", "displ_z" };
+      vertex_vars_.assign( names, names + mesh_t::num_dimensions );
+      vertex_tolerances_.resize( mesh_t::num_dimensions );
     }
 
-    // fill node variable names array
-    int inum = 1;
-
-    for(auto sf: rspav) {
-      auto label = validate_string( sf.label() );      
-      status = ex_put_var_name(exoid_, "n", inum++, label.c_str());
-      assert(status == 0);
-    } // for
-    for(auto sf: ispav) {
-      auto label = validate_string( sf.label() );
-      status = ex_put_var_name(exoid_, "n", inum++, label.c_str());
-    } // for
-    for(auto vf: rvpav) {
-      auto label = validate_string( vf.label() );
-      for(int d=0; d < num_dims; ++d) {
-        auto dim_label = label + var_ext[d];
-        status = ex_put_var_name(exoid_, "n", inum++, dim_label.c_str());
-      } // for
-    } // for
+    ( add_variables( fields ), ... );
 
+    for ( const auto & t : tolerances_ )
+      if ( !is_selected( t.first.c_str() ) )
+        throw_runtime_error( 
+          "Output tolerance given for \"" << t.first << 
+          "\", which is not written"
+        );
 
-    //--------------------------------------------------------------------------
-    // nodal field data
-
-    std::vector<ex_real_t> tmp(num_nodes);
-
-    // write nodal fields
-    inum = 1;
-
-    // node field buffer
-    for(auto sf: rspav) {
-      for(auto v: m.vertices()) tmp[v.id()] = sf[v];
-      status = ex_put_nodal_var(exoid_, time_step, inum++, num_nodes, tmp.data());
-      assert(status == 0);
-    } // for
-    for(auto sf: ispav) {
-      // cast int fields to real_t
-      for(auto v: m.vertices()) tmp[v.id()] = (real_t)sf[v];
-      status = ex_put_nodal_var(exoid_, time_step, inum++, num_nodes, tmp.data());
-      assert(status == 0);
-    } // for
-    for(auto vf: rvpav) {
-      for(int d=0; d < num_dims; ++d) {
-        for(auto v: m.vertices()) tmp[v.id()] = vf[v][d];
-        status = ex_put_nodal_var(exoid_, time_step, inum++, num_nodes, tmp.data());
-        assert(status == 0);
-      } // for
-    } // for
+    for ( const auto & selected : selection_ ) {
+      auto found = false;
+      ( (found = found || selected == fields.name), ... );
+      if ( !found )
+        throw_runtime_error( "Unknown output field \"" << selected << "\"" );
+    }
+  }
 
+  //============================================================================
+  //! \brief Make the piece of the mesh this rank writes.
+  //!
+  //! The snapshots taken afterwards hold the data of this piece.
+  //!
+  //! \param [in] m  the mesh
+  //! \param [in] is_written  tells if a cell id is part of the piece
+  //! \param [in] cell_id,vertex_id  map the local ids of the cells and 
+  //!                                vertices to global ids starting at zero
+  //! \return the piece
+  //============================================================================
+  template< typename P, typename C, typename V >
+  piece_t make_piece( 
+    mesh_t & m, P && is_written, C && cell_id, V && vertex_id 
+  ) {
+    constexpr auto num_dims = mesh_t::num_dimensions;
 
-    //--------------------------------------------------------------------------
-    // element fields
-    //--------------------------------------------------------------------------
+    piece_t piece;
 
-    // get the regions
-    auto region_cells = m.regions();
+    // the cells, by block
+    std::vector<counter_t> all_cells;
+    std::vector<size_t> all_offsets;
+    io_t::make_blocks( m, all_cells, all_offsets );
 
-    //--------------------------------------------------------------------------
-    // element field data headers
+    cells_.clear();
+    piece.block_offsets.assign( 1, 0 );
+    for ( size_t b=0; b+1<all_offsets.size(); ++b ) {
+      for ( auto i=all_offsets[b]; i<all_offsets[b+1]; ++i )
+        if ( is_written( all_cells[i] ) ) cells_.emplace_back( all_cells[i] );
+      piece.block_offsets.emplace_back( cells_.size() );
+    }
 
-    // number of element fields
-    int num_ef = 0;
+    // number the vertices and faces in the order they are first used
+    const auto & cs = m.cells();
+    std::vector<ex_index_t> vertex_index( m.num_vertices(), -1 );
+    vertices_.clear();
+    auto add_vertex = [&]( auto v ) {
+      auto & id = vertex_index[v.id()];
+      if ( id < 0 ) {
+        id = vertices_.size();
+        vertices_.emplace_back( v.id() );
+      }
+      return id;
+    };
 
-    // real scalars persistent at cells
-    auto rspac = flecsi_get_accessors_all(
-      m, real_t, dense, 0, flecsi_has_attribute_at(persistent,cells)
-    );
-    num_ef += rspac.size();
-    // int scalars persistent at cells
-    auto ispac = flecsi_get_accessors_all(
-      m, integer_t, dense, 0, flecsi_has_attribute_at(persistent,cells)
-    );
-    num_ef += ispac.size();
-    // real vectors persistent at cells
-    auto rvpac = flecsi_get_accessors_all(
-      m, vector_t, dense, 0, flecsi_has_attribute_at(persistent,cells)
-    );
-    num_ef += num_dims*rvpac.size();
-
-    // put the number of element fields
-    if(num_ef > 0) {
-      status = ex_put_var_param(exoid_, "e", num_ef);
-      assert(status == 0);
-    } // if
-
-    // fill element variable names array
-    inum = 1;
-
-    for(auto sf: rspac) {
-      auto label = validate_string( sf.label() );
-      status = ex_put_var_name(exoid_, "e", inum++, label.c_str());
-      assert(status == 0);
-    } // for
-    for(auto sf: ispac) {
-      auto label = validate_string( sf.label() );
-      status = ex_put_var_name(exoid_, "e", inum++, label.c_str());
-      assert(status == 0);
-    } // for
-    for(auto vf: rvpac) {
-      auto label = validate_string( vf.label() );
-      for(int d=0; d < num_dims; ++d) {
-        auto dim_label = label + var_ext[d];
-        status = ex_put_var_name(exoid_, "e", inum++, dim_label.c_str());
-      } // for
-    } // for
+    piece.cell_offsets.assign( 1, 0 );
+    piece.cell_ids.reserve( cells_.size() );
 
+    if ( num_dims == 2 ) {
+      for ( auto c : cells_ ) {
+        for ( auto v : m.vertices( cs[c] ) )
+          piece.cell_connectivity.emplace_back( add_vertex(v) );
+        piece.cell_offsets.emplace_back( piece.cell_connectivity.size() );
+        piece.cell_ids.emplace_back( cell_id(c) + 1 );
+      }
+    }
+    else {
+      std::vector<ex_index_t> face_index( 
+        num_dims == 3 ? m.num_faces() : 0, -1 
+      );
+      piece.face_offsets.assign( 1, 0 );
+      for ( auto c : cells_ ) {
+        for ( auto f : m.faces( cs[c] ) ) {
+          auto & id = face_index[f.id()];
+          if ( id < 0 ) {
+            id = piece.num_faces();
+            for ( auto v : m.vertices( f ) )
+              piece.face_connectivity.emplace_back( add_vertex(v) );
+            piece.face_offsets.emplace_back( piece.face_connectivity.size() );
+          }
+          piece.cell_connectivity.emplace_back( id );
+        }
+        piece.cell_offsets.emplace_back( piece.cell_connectivity.size() );
+        piece.cell_ids.emplace_back( cell_id(c) + 1 );
+      }
+    }
 
-    //--------------------------------------------------------------------------
-    // element field data
-
-    // loop over element blocks, writing the filtered element data
-    for ( int iblk=0; iblk<num_elem_blk; iblk++ ) {
-
-      // stats for this block
-      auto elem_blk_id = iblk+1;
-
-      // get the elements in this block
-      const auto & elem_this_blk = region_cells[iblk];
-      auto num_elem_this_blk = elem_this_blk.size();
-  
-      // resize temp data
-      tmp.clear();
-      tmp.resize( num_elem_this_blk );
-
-      // write element fields
-      inum = 1;
-
-      // element field buffer
-      for(auto sf: rspac) {
-        size_t cid = 0;
-        for(auto c: elem_this_blk) tmp[cid++] = sf[c];
-        status = ex_put_elem_var(exoid_, time_step, inum++, elem_blk_id, num_elem_this_blk, tmp.data());
-        assert(status == 0);
-      } // for
-      for(auto sf: ispac) {
-        // cast int fields to real_t
-        size_t cid = 0;
-        for(auto c: elem_this_blk) tmp[cid++] = (real_t)sf[c];
-        status = ex_put_elem_var(exoid_, time_step, inum++, elem_blk_id, num_elem_this_blk, tmp.data());
-        assert(status == 0);
-      } // for
-      for(auto vf: rvpac) {
-        for(int d=0; d < num_dims; ++d) {
-          size_t cid = 0;
-          for(auto c: elem_this_blk) tmp[cid++] = vf[c][d];
-          status = ex_put_elem_var(exoid_, time_step, inum++, elem_blk_id, num_elem_this_blk, tmp.data());
-          assert(status == 0);
-        } // for
-      } // for
-
-    } // block
+    // the vertices
+    const auto & vs = m.vertices();
+    piece.vertex_ids.reserve( vertices_.size() );
+    piece.coordinates.reserve( vertices_.size() * num_dims );
+    for ( auto v : vertices_ ) {
+      auto & coords = vs[v]->coordinates();
+      for ( int i=0; i<num_dims; ++i ) 
+        piece.coordinates.emplace_back( coords[i] );
+      piece.vertex_ids.emplace_back( vertex_id(v) + 1 );
+    }
+
+    // the displacements are measured from the initial coordinates
+    initial_coords_ = piece.coordinates;
+
+    return piece;
+  }
+
+  //============================================================================
+  //! \brief Create the file and write the mesh to it.
+  //!
+  //! The pieces are merged into one mesh, with the cells of each element 
+  //! block in the order of the pieces.
+  //!
+  //! \param [in] name  the file name
+  //! \param [in] pieces  the pieces of the mesh to write
+  //============================================================================
+  void open( const std::string & name, const std::vector<piece_t> & pieces )
+  {
+    close();
+
+    // remember the layout of the pieces, to merge their snapshots
+    piece_blocks_.clear();
+    piece_vertices_.clear();
+    for ( const auto & p : pieces ) {
+      piece_blocks_.emplace_back( p.block_offsets );
+      piece_vertices_.emplace_back( p.num_vertices() );
+    }
+    
+    merge( pieces, merged_ );
+
+#ifdef FLECSALE_ENABLE_EXODUS
+
+    std::cout << "Opening mesh output: " << name << std::endl;
+
+    exoid_ = create( name );
+    if ( exoid_ < 0 )
+      throw_runtime_error( "Unable to open \"" << name << "\"" );
+      
+    write_piece( merged_ );
+    num_steps_ = 0;
 
     //--------------------------------------------------------------------------
-    // final setup
+    // the variables are defined once for the whole file
 
-    // set the time
-    ex_real_t soln_time = m.time();
-    status = ex_put_time(exoid_, time_step, &soln_time );
-    assert(status == 0);
+    put_names( "e", cell_vars_ );
+    put_names( "n", vertex_vars_ );
 
-#endif 
+#else
 
-  }
+    std::cerr << "FLECSI not build with exodus support." << std::endl;
 
 #endif
 
+  }
 
   //============================================================================
-  //!  \brief Implementation of exodus mesh write for burton specialization.
+  //! \brief Create the file and write the whole local mesh to it.
   //!
-  //!  \param[in] name Write burton mesh \e m to \e name.
-  //!  \param[in] m Burton mesh to write to \e name.
+  //! \param [in] name  the file name
+  //! \param [in] m  the mesh
+  //! \param [in] moving  if true, the vertex displacements are written with
+  //!                     each time step
+  //! \param [in] selection  the names of the fields to write
+  //! \param [in] fields  the fields that can be written
+  //============================================================================
+  template< typename... FIELDS >
+  void open( 
+    const std::string & name, 
+    mesh_t & m, 
+    bool moving, 
+    const std::vector<std::string> & selection,
+    const FIELDS &... fields
+  ) {
+    select( moving, selection, fields... );
+    auto identity = []( auto id ) { return id; };
+    auto piece = make_piece( m, []( auto ) { return true; }, identity, identity );
+    open( name, { piece } );
+  }
+
+  //============================================================================
+  //! \brief Check if the file is open.
+  //============================================================================
+  bool is_open() const { return exoid_ >= 0; }
+
+  //============================================================================
+  //! \brief Copy a time step of this rank's piece out of the mesh.
   //!
-  //!  \return Exodus error code. 0 on success.
+  //! The storage of the snapshot is reused, so this does not allocate once 
+  //! the snapshot has been filled before.
+  //!
+  //! \param [in] m  the mesh
+  //! \param [in] time  the solution time
+  //! \param [out] snapshot  the snapshot to fill
+  //! \param [in] fields  the fields passed to select()
   //============================================================================
+  template< typename... FIELDS >
+  void snapshot( 
+    mesh_t & m, ex_real_t time, snapshot_t & snapshot, 
+    const FIELDS &... fields 
+  ) const
+  {
+    constexpr auto num_dims = mesh_t::num_dimensions;
+    auto num_cells = cells_.size();
+    auto num_nodes = vertices_.size();
+
+    snapshot.time = time;
+    snapshot.cell_values.resize( cell_vars_.size() * num_cells );
+    snapshot.vertex_values.resize( vertex_vars_.size() * num_nodes );
+
+    // the displacements
+    [[maybe_unused]] size_t ivar = 0;
+    if ( moving_ ) {
+      const auto & vs = m.vertices();
+      auto displ = snapshot.vertex_values.data();
+      for ( size_t j=0; j<num_nodes; ++j ) {
+        auto & coords = vs[ vertices_[j] ]->coordinates();
+        for ( int i=0; i<num_dims; ++i )
+          displ[i*num_nodes + j] = coords[i] - initial_coords_[j*num_dims + i];
+      }
+      ivar = num_dims;
+    }
 
-  template< typename T >
-  static void write(
-    const std::string &name,
-    mesh_t &m,
-    size_t iteration = 0,
-    ex_real_t time = 0.0,
-    T * const d = nullptr
-  ) {
+    // the fields
+    [[maybe_unused]] size_t icell_var = 0;
+    ( gather( fields, snapshot, icell_var, ivar ), ... );
+  }
 
-#ifdef FLECSALE_ENABLE_EXODUS
+  //============================================================================
+  //! \brief Merge the snapshots of the pieces passed to open().
+  //!
+  //! \param [in] snapshots  the snapshots, one per piece
+  //! \param [out] merged  the snapshot of the whole file
+  //============================================================================
+  void merge( 
+    const std::vector<snapshot_t> & snapshots, snapshot_t & merged 
+  ) const
+  {
+    auto num_pieces = piece_blocks_.size();
+    if ( snapshots.size() != num_pieces )
+      throw_runtime_error( 
+        "Got " << snapshots.size() << " snapshots for " << num_pieces << 
+        " pieces"
+      );
 
-    std::cout << "Writing mesh to: " << name << std::endl;
+    auto num_cell_vars = cell_vars_.size();
+    auto num_vertex_vars = vertex_vars_.size();
+    auto num_blocks = merged_.num_blocks();
+
+    merged.time = num_pieces ? snapshots[0].time : 0;
+    merged.cell_values.clear();
+    merged.cell_values.reserve( num_cell_vars * merged_.num_cells() );
+    merged.vertex_values.clear();
+    merged.vertex_values.reserve( num_vertex_vars * merged_.num_vertices() );
+
+    for ( size_t ivar=0; ivar<num_cell_vars; ++ivar )
+      for ( size_t b=0; b<num_blocks; ++b )
+        for ( size_t p=0; p<num_pieces; ++p ) {
+          const auto & offsets = piece_blocks_[p];
+          if ( b+1 >= offsets.size() ) continue;
+          auto values = snapshots[p].cell_values.begin() + 
+            ivar*offsets.back();
+          merged.cell_values.insert( merged.cell_values.end(),
+            values + offsets[b], values + offsets[b+1] );
+        }
 
-    // alias some types
-    using std::vector;
-    using std::array;
+    for ( size_t ivar=0; ivar<num_vertex_vars; ++ivar )
+      for ( size_t p=0; p<num_pieces; ++p ) {
+        auto n = piece_vertices_[p];
+        auto values = snapshots[p].vertex_values.begin() + ivar*n;
+        merged.vertex_values.insert( merged.vertex_values.end(), 
+          values, values + n );
+      }
+  }
 
+  //============================================================================
+  //! \brief Append a time step.
+  //!
+  //! \param [in] m  the mesh
+  //! \param [in] time  the solution time
+  //! \param [in] fields  the fields passed to select()
+  //============================================================================
+  template< typename... FIELDS >
+  void write( mesh_t & m, ex_real_t time, const FIELDS &... fields )
+  {
+    snapshot( m, time, buffer_, fields... );
+    write( buffer_ );
+  }
 
-    //--------------------------------------------------------------------------
-    // initial setup
-    //--------------------------------------------------------------------------
-    
-    // get the iteration number
-    // - first step starts at 1
-    // - ignore input iteration because we are always only outputting one solution
-    iteration = 1;
+  //============================================================================
+  //! \brief Append a time step from a snapshot of the whole file.
+  //!
+  //! Apart from opening and closing the file, this is the only call that 
+  //! touches the file, so it may run on another thread than the one that
+  //! took the snapshot.
+  //!
+  //! \param [in] snapshot  the data of the time step
+  //============================================================================
+  void write( const snapshot_t & snapshot )
+  {
 
-    auto exoid = base_t::open( name, std::ios_base::out );
-    assert(exoid >= 0);
+#ifdef FLECSALE_ENABLE_EXODUS
 
-    // get the general statistics
-    constexpr auto num_dims = mesh_t::num_dimensions;
-    auto num_nodes = m.num_vertices();
-    auto num_faces = num_dims==3 ? m.num_faces() : 0;
-    auto num_elems = m.num_cells();
-    auto num_elem_blk = 1;
-    auto num_node_sets = 0;
-    auto num_side_sets = 0;
-
-    auto exo_params = base_t::make_params();
-    exo_params.num_nodes = num_nodes;
-    exo_params.num_face = num_faces;
-    exo_params.num_face_blk = num_dims==3 ? 1 : 0;;
-    exo_params.num_elem = num_elems;
-    exo_params.num_elem_blk = 1;
-    exo_params.num_node_sets = 0;
+    if ( !is_open() )
+      throw_runtime_error( "The exodus output was never opened" );
 
-    base_t::write_params(exoid, exo_params);
+    // exodus time steps start at one
+    auto step = ++num_steps_;
 
-    // check the integer type used in the exodus file
-    auto int64 = base_t::is_int64(exoid);
+    auto time = snapshot.time;
+    auto status = ex_put_time( exoid_, step, &time );
+    if ( status )
+      throw_runtime_error(
+        "Problem writing the time, ex_put_time() returned " << status
+      );
 
     //--------------------------------------------------------------------------
-    // Point Coordinates
-    //--------------------------------------------------------------------------
-    
-    std::vector<real_t> vertex_coord( num_nodes * num_dims );
-    
-    for (auto v : m.vertices()) {
-      auto & coords = v->coordinates();
-      for ( int i=0; i<num_dims; i++ )
-        vertex_coord[ i*num_nodes + v.id() ] = coords[i];
-    } // for
+    // element data, block by block
 
-    base_t::write_point_coords( exoid, vertex_coord );
+    const auto & offsets = merged_.block_offsets;
+    auto num_cells = merged_.num_cells();
 
-  
-    //--------------------------------------------------------------------------
-    // Face connectivity
-    //--------------------------------------------------------------------------
+    for ( size_t ivar=0; ivar<cell_vars_.size(); ++ivar ) {
+      const auto * values = round_values( 
+        snapshot.cell_values.data() + ivar*num_cells, num_cells,
+        cell_tolerances_[ivar]
+      );
+      for ( size_t iblk=0; iblk<merged_.num_blocks(); ++iblk ) {
+        auto start = offsets[iblk];
+        auto num_elem_this_blk = offsets[iblk+1] - start;
+        status = ex_put_elem_var(
+          exoid_, step, ivar+1, iblk+1, num_elem_this_blk, values + start
+        );
+        if ( status )
+          throw_runtime_error(
+            "Problem writing variable data, " <<
+            " ex_put_elem_var() returned " << status 
+          );
+      }
+    }
 
-    if ( num_dims == 2 ) {
+    //--------------------------------------------------------------------------
+    // nodal data
 
-      // get the master entity lists
-      const auto & cs = m.cells();
+    auto num_nodes = merged_.num_vertices();
 
-      // create the element blocks
-      base_t::template write_element_block<ex_index_t>( 
-        exoid, 1, "cells", num_elems,
-        [&]( auto c, auto & face_list ) {
-          for ( auto v : m.vertices(cs[c]) ) 
-            face_list.emplace_back( v.id() );
-        }
+    for ( size_t ivar=0; ivar<vertex_vars_.size(); ++ivar ) {
+      const auto * values = round_values(
+        snapshot.vertex_values.data() + ivar*num_nodes, num_nodes,
+        vertex_tolerances_[ivar]
       );
+      status = ex_put_nodal_var( exoid_, step, ivar+1, num_nodes, values );
+      if ( status )
+        throw_runtime_error(
+          "Problem writing variable data, " <<
+          " ex_put_nodal_var() returned " << status 
+        );
+    }
 
+    // flush, so the file can be looked at while the run goes on
+    ex_update( exoid_ );
+
+#endif
+
+  }
+
+  //============================================================================
+  //! \brief Close the file.
+  //============================================================================
+  void close()
+  {
+#ifdef FLECSALE_ENABLE_EXODUS
+    if ( is_open() ) io_t::base_t::close( exoid_ );
+#endif
+    exoid_ = -1;
+  }
+
+  //============================================================================
+  //! \brief The names of the element and nodal variables written.
+  //============================================================================
+  const auto & cell_variables() const { return cell_vars_; }
+  const auto & vertex_variables() const { return vertex_vars_; }
+
+  //============================================================================
+  //! \brief Merge pieces into one.
+  //!
+  //! \param [in] pieces  the pieces to merge
+  //! \param [out] merged  the merged piece
+  //============================================================================
+  static void merge( const std::vector<piece_t> & pieces, piece_t & merged )
+  {
+    merged = piece_t();
+
+    size_t num_blocks = 0;
+    for ( const auto & p : pieces ) 
+      num_blocks = std::max( num_blocks, p.num_blocks() );
+
+    // the vertices and faces are simply stacked
+    std::vector<size_t> vertex_start, face_start;
+    for ( const auto & p : pieces ) {
+      vertex_start.emplace_back( merged.num_vertices() );
+      face_start.emplace_back( merged.num_faces() );
+      merged.coordinates.insert( merged.coordinates.end(), 
+        p.coordinates.begin(), p.coordinates.end() );
+      merged.vertex_ids.insert( merged.vertex_ids.end(), 
+        p.vertex_ids.begin(), p.vertex_ids.end() );
+      if ( p.num_faces() == 0 ) continue;
+      if ( merged.face_offsets.empty() ) merged.face_offsets.assign( 1, 0 );
+      for ( size_t f=0; f<p.num_faces(); ++f ) {
+        for ( auto i=p.face_offsets[f]; i<p.face_offsets[f+1]; ++i )
+          merged.face_connectivity.emplace_back( 
+            p.face_connectivity[i] + vertex_start.back() );
+        merged.face_offsets.emplace_back( merged.face_connectivity.size() );
+      }
     }
 
-    else if ( num_dims == 3 ) {
-      
-      // get the master entity lists
-      const auto & fs = m.faces();
-      const auto & cs = m.cells();
-
-      // create the face blocks
-      base_t::template write_face_block<ex_index_t>( 
-        exoid, 1, "faces", num_faces,
-        [&]( auto f, auto & face_conn ) 
-        {
-          for ( auto v : m.vertices(fs[f]) )
-            face_conn.emplace_back( v.id() );
+    // the cells of each block come from each piece in turn
+    auto is_3d = !merged.face_offsets.empty();
+    merged.block_offsets.assign( 1, 0 );
+    merged.cell_offsets.assign( 1, 0 );
+    for ( size_t b=0; b<num_blocks; ++b ) {
+      for ( size_t ip=0; ip<pieces.size(); ++ip ) {
+        const auto & p = pieces[ip];
+        if ( b >= p.num_blocks() ) continue;
+        auto shift = is_3d ? face_start[ip] : vertex_start[ip];
+        for ( auto c=p.block_offsets[b]; c<p.block_offsets[b+1]; ++c ) {
+          for ( auto i=p.cell_offsets[c]; i<p.cell_offsets[c+1]; ++i )
+            merged.cell_connectivity.emplace_back( 
+              p.cell_connectivity[i] + shift );
+          merged.cell_offsets.emplace_back( merged.cell_connectivity.size() );
+          merged.cell_ids.emplace_back( p.cell_ids[c] );
         }
-      );
+      }
+      merged.block_offsets.emplace_back( merged.num_cells() );
+    }
+  }
 
+private:
+
+  //! \brief The number of variables a field is written as.
+  template< typename F >
+  static constexpr int num_components()
+  {
+    using value_t = std::decay_t< 
+      decltype( std::declval<const F &>()( std::declval<counter_t>() ) ) 
+    >;
+    if constexpr ( std::is_arithmetic<value_t>::value ) return 1;
+    else return mesh_t::num_dimensions;
+  }
 
-      // create the element blocks
-      base_t::template write_element_block<ex_index_t>( 
-        exoid, 1, "cells", num_elems,
-        [&]( auto c, auto & face_list ) {
-          for ( auto f : m.faces(cs[c]) ) 
-            face_list.emplace_back( f.id() );
-        }
-      );
+  //! \brief Check if a field was selected.
+  bool is_selected( const char * name ) const
+  {
+    for ( const auto & s : selection_ ) if ( s == name ) return true;
+    return false;
+  }
 
+  //! \brief Add the variables of a field, if it was selected.
+  template< typename F >
+  void add_variables( const output_field__<F> & f )
+  {
+    if ( !is_selected( f.name ) ) return;
+    auto & vars = 
+      f.location == field_location_t::cells ? cell_vars_ : vertex_vars_;
+    auto & tolerances = f.location == field_location_t::cells ? 
+      cell_tolerances_ : vertex_tolerances_;
+    constexpr auto ncomp = num_components<F>();
+    auto it = tolerances_.find( f.name );
+    tolerances.resize( tolerances.size() + ncomp, 
+      it == tolerances_.end() ? utils::tolerance_t{} : it->second );
+    if ( ncomp == 1 ) {
+      vars.emplace_back( f.name );
+      return;
     }
+    const char * ext[] = { "_x", "_y", "_z" };
+    for ( int i=0; i<ncomp; ++i )
+      vars.emplace_back( std::string( f.name ) + ext[i] );
+  }
 
-    //--------------------------------------------------------------------------
-    // write field data
-    //--------------------------------------------------------------------------
-    if ( d ) 
-      write_fields( exoid, m, iteration, *d );
+  //! \brief Copy a field into a snapshot, if it was selected.
+  //!
+  //! Each entity is visited once, filling all the components of a vector
+  //! field in the same pass.
+  template< typename F >
+  void gather( 
+    const output_field__<F> & f, 
+    snapshot_t & snapshot, 
+    size_t & icell_var,
+    size_t & ivertex_var
+  ) const
+  {
+    if ( !is_selected( f.name ) ) return;
+
+    constexpr auto ncomp = num_components<F>();
+    const auto & field = f.field;
+
+    auto copy = [&]( auto i, auto id, auto * values, auto stride ) {
+      const auto & value = field( id );
+      if constexpr ( ncomp == 1 ) 
+        values[i] = value;
+      else
+        for ( int d=0; d<ncomp; ++d ) values[i + d*stride] = value[d];
+    };
 
+    const auto & ids = 
+      f.location == field_location_t::cells ? cells_ : vertices_;
+    auto & ivar = 
+      f.location == field_location_t::cells ? icell_var : ivertex_var;
+    auto & all_values = f.location == field_location_t::cells ? 
+      snapshot.cell_values : snapshot.vertex_values;
+
+    auto n = ids.size();
+    auto values = all_values.data() + ivar*n;
+    #pragma omp parallel for
+    for ( size_t i=0; i<n; ++i ) copy( i, ids[i], values, n );
+    ivar += ncomp;
+  }
 
-    //--------------------------------------------------------------------------
-    // final setup
-    //--------------------------------------------------------------------------
+#ifdef FLECSALE_ENABLE_EXODUS
 
-    // set the time
-    auto status = ex_put_time(exoid, iteration, &time );
-    assert(status == 0);
+  //! \brief Create the file, compressed if asked to.
+  int create( const std::string & name )
+  {
+    if ( compression_level_ <= 0 ) 
+      return io_t::base_t::open( name, std::ios_base::out );
+
+    // only netCDF-4 files can be compressed
+    int cpu_word_size = sizeof(ex_real_t);
+    int io_word_size = sizeof(ex_real_t);
+    auto exoid = ex_create( 
+      name.c_str(), EX_CLOBBER | EX_NETCDF4 | EX_NOCLASSIC,
+      &cpu_word_size, &io_word_size
+    );
+    if ( exoid < 0 ) return exoid;
+
+    ex_set_option( exoid, EX_OPT_COMPRESSION_LEVEL, compression_level_ );
+    ex_set_option( exoid, EX_OPT_COMPRESSION_SHUFFLE, 1 );
+    return exoid;
+  }
+
+  //! \brief Round the values of a variable to its tolerance.
+  //! \return the values to write, which are only copied if rounded
+  const ex_real_t * round_values( 
+    const ex_real_t * values, 
+    size_t n, 
+    const utils::tolerance_t & tolerance
+  ) {
+    if ( tolerance.is_lossless() ) return values;
+    rounded_.assign( values, values + n );
+    utils::round_to_tolerance( rounded_.data(), n, tolerance );
+    return rounded_.data();
+  }
+
+  //! \brief Write the topology, the coordinates and the number maps.
+  void write_piece( const piece_t & piece )
+  {
+    constexpr auto num_dims = mesh_t::num_dimensions;
+    auto num_nodes = piece.num_vertices();
+    auto num_faces = piece.num_faces();
+    auto num_elem_blk = piece.num_blocks();
+
+    auto exo_params = io_t::base_t::make_params();
+    exo_params.num_nodes = num_nodes;
+    exo_params.num_face = num_faces;
+    exo_params.num_face_blk = num_dims==3 ? 1 : 0;;
+    exo_params.num_elem = piece.num_cells();
+    exo_params.num_elem_blk = num_elem_blk;
+    exo_params.num_node_sets = 0;
+
+    io_t::base_t::write_params(exoid_, exo_params);
 
     //--------------------------------------------------------------------------
-    // final step
+    // Point Coordinates
+
+    std::vector<real_t> vertex_coord( num_nodes * num_dims );
+    for ( size_t v=0; v<num_nodes; ++v )
+      for ( int i=0; i<num_dims; i++ )
+        vertex_coord[ i*num_nodes + v ] = piece.coordinates[ v*num_dims + i ];
+
+    io_t::base_t::write_point_coords( exoid_, vertex_coord );
+
     //--------------------------------------------------------------------------
-    base_t::close( exoid );
+    // Global ids
+
+    auto put_map = [&]( auto put, const auto & ids ) {
+      std::vector<ex_index_t> map( ids.begin(), ids.end() );
+      auto status = put( exoid_, map.data() );
+      if ( status )
+        throw_runtime_error(
+          "Problem writing the number maps, exodus returned " << status 
+        );
+    };
+    put_map( ex_put_node_num_map, piece.vertex_ids );
+    put_map( ex_put_elem_num_map, piece.cell_ids );
 
+    //--------------------------------------------------------------------------
+    // Face connectivity
 
-#else
+    if ( num_dims == 3 ) {
+      io_t::base_t::template write_face_block<ex_index_t>( 
+        exoid_, 1, "faces", num_faces,
+        [&]( auto f, auto & face_conn ) {
+          for ( auto i=piece.face_offsets[f]; i<piece.face_offsets[f+1]; ++i )
+            face_conn.emplace_back( piece.face_connectivity[i] );
+        }
+      );
+    }
 
-    std::cerr << "FLECSI not build with exodus support." << std::endl;
+    //--------------------------------------------------------------------------
+    // Element blocks, made of vertices in 2d and of faces in 3d
+
+    for ( size_t iblk=0; iblk<num_elem_blk; ++iblk ) {
+      auto start = piece.block_offsets[iblk];
+      io_t::base_t::template write_element_block<ex_index_t>( 
+        exoid_, iblk+1, "region_" + std::to_string(iblk+1), 
+        piece.block_offsets[iblk+1] - start,
+        [&]( auto c, auto & list ) {
+          auto ic = start + c;
+          for ( auto i=piece.cell_offsets[ic]; i<piece.cell_offsets[ic+1]; ++i )
+            list.emplace_back( piece.cell_connectivity[i] );
+        }
+      );
+    }
+  }
 
-#endif
+  //! \brief Define the names of a type of variable.
+  void put_names( const char * type, const std::vector<std::string> & names )
+  {
+    if ( names.empty() ) return;
 
-  } // io_exodus_t::write
+    auto status = ex_put_var_param( exoid_, type, names.size() );
+    if ( status )
+      throw_runtime_error(
+        "Problem writing variable number, " <<
+        " ex_put_var_param() returned " << status 
+      );
 
+    for ( size_t i=0; i<names.size(); ++i ) {
+      status = ex_put_var_name( exoid_, type, i+1, names[i].c_str() );
+      if ( status )
+        throw_runtime_error(
+          "Problem writing variable name, " <<
+          " ex_put_var_name() returned " << status 
+        );
+    }
+  }
 
-}; // struct io_exodus_t
+#endif
 
+  //! the exodus file id, negative if closed
+  int exoid_ = -1;
+  //! the number of time steps written
+  int num_steps_ = 0;
+  //! true if the displacements are written
+  bool moving_ = false;
+  //! the names of the fields to write
+  std::vector<std::string> selection_;
+  //! the names of the element and nodal variables
+  std::vector<std::string> cell_vars_, vertex_vars_;
+  //! the deflate level, zero for none
+  int compression_level_ = 0;
+  //! the error allowed, by field name
+  std::map< std::string, utils::tolerance_t > tolerances_;
+  //! the error allowed in the element and nodal variables
+  std::vector<utils::tolerance_t> cell_tolerances_, vertex_tolerances_;
+  //! the rounded values of a variable
+  std::vector<ex_real_t> rounded_;
+  //! the local ids of the cells and vertices in this rank's piece
+  std::vector<counter_t> cells_, vertices_;
+  //! the coordinates the displacements are measured from
+  std::vector<ex_real_t> initial_coords_;
+  //! the block offsets and the vertex counts of the pieces in the file
+  std::vector< std::vector<std::uint64_t> > piece_blocks_;
+  std::vector<size_t> piece_vertices_;
+  //! all the pieces in the file merged together
+  piece_t merged_;
+  //! the reused snapshot for synchronous writes
+  snapshot_t buffer_;
+
+};
 
 } // namespace io
 } // namespace flecsale
@@ -0,0 +1,477 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Compression of raw field data.
+///
+/// Two stages are provided.  The lossless one shuffles the bytes of the
+/// values, so that the slowly varying sign and exponent bytes end up next
+/// to each other, and then runs a small LZ77 codec over the result.  The
+/// data is split into chunks that are compressed on separate threads.
+///
+/// The lossy one rounds away the mantissa bits that are below a given
+/// error tolerance.  The values stay plain floating point numbers, but
+/// their trailing zero bits make any lossless stage that follows, ours or
+/// the one built into a file format, far more effective.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <ristra/assertions/errors.h>
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace flecsale {
+namespace utils {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The error allowed when values are compressed with loss.
+//!
+//! When both bounds are set, both hold.  When neither is, the values are
+//! kept exactly.
+////////////////////////////////////////////////////////////////////////////////
+struct tolerance_t {
+  //! the largest absolute error
+  double absolute = 0;
+  //! the largest error relative to the magnitude of a value
+  double relative = 0;
+
+  //! \brief Check if the values are kept exactly.
+  bool is_lossless() const { return absolute <= 0 && relative <= 0; }
+};
+
+namespace detail {
+
+//! the shortest match the codec encodes
+constexpr std::size_t lz_min_match = 4;
+//! the farthest back a match can be
+constexpr std::size_t lz_max_offset = 65535;
+//! the size of the match finder hash table, as a power of two
+constexpr int lz_hash_bits = 14;
+//! the bytes compressed independently, and so in parallel
+constexpr std::size_t chunk_bytes = 1 << 20;
+
+//! \brief Hash the four bytes at a position.
+inline std::uint32_t lz_hash( const unsigned char * p )
+{
+  std::uint32_t v;
+  std::memcpy( &v, p, 4 );
+  return ( v * 2654435761u ) >> ( 32 - lz_hash_bits );
+}
+
+//! \brief Write the part of a length that does not fit in a token.
+inline unsigned char * lz_put_length( unsigned char * op, std::size_t n )
+{
+  for ( ; n >= 255; n -= 255 ) *op++ = 255;
+  *op++ = static_cast<unsigned char>( n );
+  return op;
+}
+
+//! \brief Read back the part of a length that did not fit in a token.
+inline std::size_t lz_get_length(
+  const unsigned char * & ip, const unsigned char * end
+) {
+  std::size_t n = 0;
+  unsigned char b;
+  do {
+    if ( ip >= end ) throw_runtime_error( "Corrupt compressed data" );
+    b = *ip++;
+    n += b;
+  } while ( b == 255 );
+  return n;
+}
+
+//! \brief Write a run of literals followed by a match.
+//!
+//! A match length of zero ends the data, and leaves out the match.
+inline unsigned char * lz_put_sequence(
+  unsigned char * op,
+  const unsigned char * literals,
+  std::size_t num_literals,
+  std::size_t offset,
+  std::size_t match_length
+) {
+  auto extra = match_length ? match_length - lz_min_match : 0;
+  *op++ = static_cast<unsigned char>(
+    ( std::min<std::size_t>( num_literals, 15 ) << 4 ) |
+    std::min<std::size_t>( extra, 15 )
+  );
+  if ( num_literals >= 15 ) op = lz_put_length( op, num_literals - 15 );
+  std::memcpy( op, literals, num_literals );
+  op += num_literals;
+  if ( match_length ) {
+    *op++ = static_cast<unsigned char>( offset & 255 );
+    *op++ = static_cast<unsigned char>( offset >> 8 );
+    if ( extra >= 15 ) op = lz_put_length( op, extra - 15 );
+  }
+  return op;
+}
+
+//! \brief The unsigned integer with the bits of a floating point type.
+template< typename T >
+using float_bits_t = std::conditional_t<
+  sizeof(T) == 8, std::uint64_t, std::uint32_t
+>;
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The most bytes lz_compress() can produce.
+//! \param [in] bytes  the number of bytes to compress
+////////////////////////////////////////////////////////////////////////////////
+inline std::size_t lz_bound( std::size_t bytes )
+{ return bytes + bytes / 255 + 16; }
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compress bytes with a greedy LZ77 codec.
+//!
+//! The data is a series of sequences, each a run of literal bytes followed
+//! by a copy of earlier output.  A token byte holds both lengths, and
+//! lengths that do not fit are continued in extra bytes.
+//!
+//! \param [in] src  the bytes to compress
+//! \param [in] bytes  the number of bytes
+//! \param [out] dst  the compressed bytes, with room for lz_bound(bytes)
+//! \return the number of compressed bytes
+////////////////////////////////////////////////////////////////////////////////
+inline std::size_t lz_compress(
+  const void * src, std::size_t bytes, void * dst
+) {
+  using namespace detail;
+
+  auto begin = static_cast<const unsigned char *>( src );
+  auto end = begin + bytes;
+  auto op = static_cast<unsigned char *>( dst );
+  auto anchor = begin;
+
+  if ( bytes >= lz_min_match ) {
+    // the last position each hash was seen at
+    std::vector<std::uint32_t> table( 1 << lz_hash_bits, 0 );
+    auto ip = begin;
+    auto limit = end - lz_min_match;
+    while ( ip <= limit ) {
+      auto & last = table[ lz_hash(ip) ];
+      auto ref = begin + last;
+      last = ip - begin;
+      if (
+        ref < ip &&
+        static_cast<std::size_t>( ip - ref ) <= lz_max_offset &&
+        std::memcmp( ref, ip, lz_min_match ) == 0
+      ) {
+        auto length = lz_min_match;
+        while ( ip + length < end && ref[length] == ip[length] ) ++length;
+        op = lz_put_sequence( op, anchor, ip - anchor, ip - ref, length );
+        ip += length;
+        anchor = ip;
+      }
+      else {
+        ++ip;
+      }
+    }
+  }
+
+  // the rest is literals
+  op = lz_put_sequence( op, anchor, end - anchor, 0, 0 );
+  return op - static_cast<unsigned char *>( dst );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Decompress the bytes from lz_compress().
+//!
+//! Every read and write is bounds checked, so corrupt data raises an error
+//! rather than overrunning a buffer.
+//!
+//! \param [in] src  the compressed bytes
+//! \param [in] src_bytes  the number of compressed bytes
+//! \param [out] dst  the decompressed bytes
+//! \param [in] bytes  the expected number of decompressed bytes
+////////////////////////////////////////////////////////////////////////////////
+inline void lz_decompress(
+  const void * src, std::size_t src_bytes, void * dst, std::size_t bytes
+) {
+  using namespace detail;
+
+  auto ip = static_cast<const unsigned char *>( src );
+  auto in_end = ip + src_bytes;
+  auto begin = static_cast<unsigned char *>( dst );
+  auto op = begin;
+  auto out_end = begin + bytes;
+
+  while ( true ) {
+
+    if ( ip >= in_end ) throw_runtime_error( "Corrupt compressed data" );
+    auto token = *ip++;
+
+    // the literals
+    std::size_t num_literals = token >> 4;
+    if ( num_literals == 15 ) num_literals += lz_get_length( ip, in_end );
+    if (
+      num_literals > static_cast<std::size_t>( in_end - ip ) ||
+      num_literals > static_cast<std::size_t>( out_end - op )
+    )
+      throw_runtime_error( "Corrupt compressed data" );
+    std::memcpy( op, ip, num_literals );
+    ip += num_literals;
+    op += num_literals;
+
+    // the last sequence has no match
+    if ( ip == in_end ) break;
+
+    // the match, which may overlap the bytes it produces
+    if ( in_end - ip < 2 ) throw_runtime_error( "Corrupt compressed data" );
+    std::size_t offset = ip[0] | ( ip[1] << 8 );
+    ip += 2;
+    std::size_t length = token & 15;
+    if ( length == 15 ) length += lz_get_length( ip, in_end );
+    length += lz_min_match;
+    if (
+      offset == 0 ||
+      offset > static_cast<std::size_t>( op - begin ) ||
+      length > static_cast<std::size_t>( out_end - op )
+    )
+      throw_runtime_error( "Corrupt compressed data" );
+    auto ref = op - offset;
+    for ( std::size_t i=0; i<length; ++i ) *op++ = *ref++;
+
+  }
+
+  if ( op != out_end )
+    throw_runtime_error(
+      "Compressed data holds " << (op - begin) << " bytes, expected " << bytes
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The width of the words the bytes of a value type are shuffled by.
+//!
+//! Vectors and tuples of doubles are shuffled as doubles, and so on.
+//! \param [in] value_bytes  the size of a value
+////////////////////////////////////////////////////////////////////////////////
+inline std::size_t shuffle_word_bytes( std::size_t value_bytes )
+{
+  for ( std::size_t w : { 8, 4, 2 } )
+    if ( value_bytes % w == 0 ) return w;
+  return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Group the bytes of a series of words by their position in a word.
+//!
+//! Bytes past the last whole word are copied as they are.
+//!
+//! \param [in] src  the words
+//! \param [in] bytes  the number of bytes
+//! \param [in] word_bytes  the width of a word
+//! \param [out] dst  the shuffled bytes
+////////////////////////////////////////////////////////////////////////////////
+inline void shuffle(
+  const void * src, std::size_t bytes, std::size_t word_bytes, void * dst
+) {
+  auto in = static_cast<const unsigned char *>( src );
+  auto out = static_cast<unsigned char *>( dst );
+  auto n = bytes / word_bytes;
+  for ( std::size_t i=0; i<n; ++i )
+    for ( std::size_t k=0; k<word_bytes; ++k )
+      out[ k*n + i ] = in[ i*word_bytes + k ];
+  std::memcpy( out + n*word_bytes, in + n*word_bytes, bytes % word_bytes );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Undo shuffle().
+////////////////////////////////////////////////////////////////////////////////
+inline void unshuffle(
+  const void * src, std::size_t bytes, std::size_t word_bytes, void * dst
+) {
+  auto in = static_cast<const unsigned char *>( src );
+  auto out = static_cast<unsigned char *>( dst );
+  auto n = bytes / word_bytes;
+  for ( std::size_t i=0; i<n; ++i )
+    for ( std::size_t k=0; k<word_bytes; ++k )
+      out[ i*word_bytes + k ] = in[ k*n + i ];
+  std::memcpy( out + n*word_bytes, in + n*word_bytes, bytes % word_bytes );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compress an array of values without loss.
+//!
+//! The array is split into chunks that are shuffled and compressed in
+//! parallel.  The output starts with the number of chunks and the
+//! compressed size of each, and a chunk that does not shrink is stored
+//! shuffled but uncompressed.
+//!
+//! \param [in] data  the values
+//! \param [in] bytes  the number of bytes
+//! \param [in] value_bytes  the size of a value
+//! \param [out] out  the compressed bytes
+////////////////////////////////////////////////////////////////////////////////
+inline void compress(
+  const void * data,
+  std::size_t bytes,
+  std::size_t value_bytes,
+  std::vector<char> & out
+) {
+  auto word_bytes = shuffle_word_bytes( value_bytes );
+  auto in = static_cast<const char *>( data );
+  std::uint64_t num_chunks =
+    ( bytes + detail::chunk_bytes - 1 ) / detail::chunk_bytes;
+
+  std::vector< std::vector<char> > chunks( num_chunks );
+
+  #pragma omp parallel
+  {
+    std::vector<char> shuffled( detail::chunk_bytes );
+    #pragma omp for schedule(dynamic)
+    for ( std::uint64_t i=0; i<num_chunks; ++i ) {
+      auto start = i * detail::chunk_bytes;
+      auto n = std::min( detail::chunk_bytes, bytes - start );
+      shuffle( in + start, n, word_bytes, shuffled.data() );
+      auto & chunk = chunks[i];
+      chunk.resize( lz_bound(n) );
+      auto m = lz_compress( shuffled.data(), n, chunk.data() );
+      if ( m < n ) chunk.resize( m );
+      else chunk.assign( shuffled.begin(), shuffled.begin() + n );
+    }
+  }
+
+  // the table of contents, then the chunks
+  std::vector<std::uint64_t> sizes( 1, num_chunks );
+  for ( const auto & chunk : chunks ) sizes.emplace_back( chunk.size() );
+
+  out.clear();
+  auto toc = reinterpret_cast<const char *>( sizes.data() );
+  out.insert( out.end(), toc, toc + sizes.size()*sizeof(std::uint64_t) );
+  for ( const auto & chunk : chunks )
+    out.insert( out.end(), chunk.begin(), chunk.end() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Undo compress().
+//!
+//! \param [in] in  the compressed bytes
+//! \param [in] in_bytes  the number of compressed bytes
+//! \param [in] value_bytes  the size of a value
+//! \param [out] data  the values
+//! \param [in] bytes  the expected number of bytes
+////////////////////////////////////////////////////////////////////////////////
+inline void decompress(
+  const char * in,
+  std::size_t in_bytes,
+  std::size_t value_bytes,
+  void * data,
+  std::size_t bytes
+) {
+  auto word_bytes = shuffle_word_bytes( value_bytes );
+  auto out = static_cast<char *>( data );
+  std::uint64_t num_chunks =
+    ( bytes + detail::chunk_bytes - 1 ) / detail::chunk_bytes;
+
+  // read the table of contents
+  auto toc_bytes = ( num_chunks + 1 ) * sizeof(std::uint64_t);
+  if ( in_bytes < toc_bytes ) throw_runtime_error( "Corrupt compressed data" );
+  std::vector<std::uint64_t> sizes( num_chunks + 1 );
+  std::memcpy( sizes.data(), in, toc_bytes );
+  if ( sizes[0] != num_chunks ) throw_runtime_error( "Corrupt compressed data" );
+
+  std::vector<std::uint64_t> offsets( num_chunks + 1, toc_bytes );
+  for ( std::uint64_t i=0; i<num_chunks; ++i )
+    offsets[i+1] = offsets[i] + sizes[i+1];
+  if ( offsets.back() != in_bytes )
+    throw_runtime_error( "Corrupt compressed data" );
+
+  // errors cannot leave a parallel region, so they are raised after it
+  std::vector<char> failed( num_chunks, false );
+
+  #pragma omp parallel
+  {
+    std::vector<char> shuffled( detail::chunk_bytes );
+    #pragma omp for schedule(dynamic)
+    for ( std::uint64_t i=0; i<num_chunks; ++i ) {
+      auto start = i * detail::chunk_bytes;
+      auto n = std::min( detail::chunk_bytes, bytes - start );
+      auto chunk = in + offsets[i];
+      auto m = sizes[i+1];
+      try {
+        if ( m == n ) std::memcpy( shuffled.data(), chunk, n );
+        else lz_decompress( chunk, m, shuffled.data(), n );
+        unshuffle( shuffled.data(), n, word_bytes, out + start );
+      }
+      catch (...) {
+        failed[i] = true;
+      }
+    }
+  }
+
+  if ( std::find( failed.begin(), failed.end(), true ) != failed.end() )
+    throw_runtime_error( "Corrupt compressed data" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Round away the mantissa bits of values below a tolerance.
+//!
+//! A value keeps just enough bits so the rounding error stays within the
+//! tolerance, and the bits dropped are zeroed.  Zeros, subnormals,
+//! infinities and NaNs are left alone.  This runs in parallel.
+//!
+//! \tparam T  the floating point type
+//! \param [in,out] values  the values to round
+//! \param [in] n  the number of values
+//! \param [in] tolerance  the error allowed
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void round_to_tolerance( T * values, std::size_t n, const tolerance_t & tolerance )
+{
+  static_assert( std::is_floating_point<T>::value, "Only rounds floats" );
+
+  using bits_t = detail::float_bits_t<T>;
+  constexpr int digits = std::numeric_limits<T>::digits;
+  constexpr int max_drop = digits - 1;
+
+  if ( tolerance.is_lossless() ) return;
+
+  // A value in [2^(e-1), 2^e) is spaced by 2^(e-digits), so dropping z
+  // bits errs by at most 2^(e-digits-1+z).  The relative bound does not
+  // depend on the value.
+  auto has_absolute = tolerance.absolute > 0;
+  auto absolute_drop = has_absolute ?
+    static_cast<int>( std::floor( std::log2( tolerance.absolute ) ) ) +
+    digits + 1 : 0;
+  auto relative_drop = tolerance.relative > 0 ?
+    static_cast<int>( std::floor( std::log2( tolerance.relative ) ) ) +
+    digits :
+    max_drop;
+  relative_drop = std::clamp( relative_drop, 0, max_drop );
+
+  #pragma omp parallel for
+  for ( std::size_t i=0; i<n; ++i ) {
+    auto value = values[i];
+    if ( !std::isnormal( value ) ) continue;
+    auto drop = relative_drop;
+    if ( has_absolute )
+      drop = std::min( drop, absolute_drop - std::ilogb( value ) - 1 );
+    if ( drop <= 0 ) continue;
+    bits_t bits;
+    std::memcpy( &bits, &value, sizeof(T) );
+    bits += bits_t(1) << (drop - 1);
+    bits &= ~( ( bits_t(1) << drop ) - 1 );
+    T rounded;
+    std::memcpy( &rounded, &bits, sizeof(T) );
+    // rounding up the largest values could overflow
+    if ( std::isfinite( rounded ) ) values[i] = rounded;
+  }
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,443 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief A thin, portable wrapper around short simd vectors.
+///
+/// The wrapper maps onto AVX-512 or AVX/AVX2 intrinsics when the compiler
+/// targets them, and falls back on a plain array of lanes otherwise.  Only
+/// the operations needed by the batched flux kernels are provided.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX512F__) || defined(__AVX__)
+#  include <immintrin.h>
+#endif
+
+namespace flecsale {
+namespace utils {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The native simd width, in lanes, for the value type.
+//! \tparam T  The value type.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+constexpr std::size_t simd_width()
+{
+#if defined(__AVX512F__)
+  return 64 / sizeof(T);
+#elif defined(__AVX__)
+  return 32 / sizeof(T);
+#else
+  return 1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief A lane mask for the generic simd type.
+//! \tparam T  The value type.
+//! \tparam W  The number of lanes.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T, std::size_t W >
+class simd_mask__ {
+
+public:
+
+  //! \brief lane access
+  bool & operator[]( std::size_t i ) { return m_[i]; }
+  //! \copydoc operator[]
+  bool operator[]( std::size_t i ) const { return m_[i]; }
+
+  //! \brief logical operators
+  //! \{
+  friend simd_mask__ operator&&( const simd_mask__ & a, const simd_mask__ & b )
+  {
+    simd_mask__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.m_[i] = a.m_[i] && b.m_[i];
+    return r;
+  }
+  friend simd_mask__ operator||( const simd_mask__ & a, const simd_mask__ & b )
+  {
+    simd_mask__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.m_[i] = a.m_[i] || b.m_[i];
+    return r;
+  }
+  friend simd_mask__ operator!( const simd_mask__ & a )
+  {
+    simd_mask__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.m_[i] = !a.m_[i];
+    return r;
+  }
+  //! \}
+
+  //! \brief true if any lane is set
+  friend bool any( const simd_mask__ & a )
+  {
+    bool r = false;
+    for ( std::size_t i=0; i<W; ++i ) r = r || a.m_[i];
+    return r;
+  }
+
+private:
+
+  //! the lanes
+  bool m_[W];
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief A short vector of \e W lanes of type \e T.
+//!
+//! This generic version stores the lanes in an array and loops over them,
+//! which leaves the vectorization to the compiler.
+//!
+//! \tparam T  The value type.
+//! \tparam W  The number of lanes.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T, std::size_t W = simd_width<T>() >
+class simd__ {
+
+public:
+
+  //============================================================================
+  // Typedefs
+  //============================================================================
+
+  //! the value type
+  using value_type = T;
+  //! the mask type
+  using mask_t = simd_mask__<T, W>;
+  //! the number of lanes
+  static constexpr std::size_t width = W;
+
+  //============================================================================
+  // Constructors
+  //============================================================================
+
+  //! \brief default constructor, the lanes are uninitialized
+  simd__() = default;
+
+  //! \brief broadcast constructor
+  simd__( T x ) { for ( std::size_t i=0; i<W; ++i ) v_[i] = x; }
+
+  //! \brief load the lanes from memory
+  static simd__ load( const T * p )
+  {
+    simd__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.v_[i] = p[i];
+    return r;
+  }
+
+  //! \brief store the lanes to memory
+  void store( T * p ) const
+  { for ( std::size_t i=0; i<W; ++i ) p[i] = v_[i]; }
+
+  //! \brief lane access
+  T operator[]( std::size_t i ) const { return v_[i]; }
+
+  //============================================================================
+  // Arithmetic
+  //============================================================================
+
+#define FLECSALE_SIMD_GENERIC_OP(op)                                          \
+  friend simd__ operator op( const simd__ & a, const simd__ & b )             \
+  {                                                                           \
+    simd__ r;                                                                 \
+    for ( std::size_t i=0; i<W; ++i ) r.v_[i] = a.v_[i] op b.v_[i];           \
+    return r;                                                                 \
+  }                                                                           \
+  simd__ & operator op##=( const simd__ & b )                                 \
+  { return *this = *this op b; }
+
+  FLECSALE_SIMD_GENERIC_OP(+)
+  FLECSALE_SIMD_GENERIC_OP(-)
+  FLECSALE_SIMD_GENERIC_OP(*)
+  FLECSALE_SIMD_GENERIC_OP(/)
+
+#undef FLECSALE_SIMD_GENERIC_OP
+
+  //! \brief negation
+  friend simd__ operator-( const simd__ & a )
+  {
+    simd__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.v_[i] = -a.v_[i];
+    return r;
+  }
+
+  //============================================================================
+  // Comparisons
+  //============================================================================
+
+#define FLECSALE_SIMD_GENERIC_CMP(op)                                         \
+  friend mask_t operator op( const simd__ & a, const simd__ & b )             \
+  {                                                                           \
+    mask_t r;                                                                 \
+    for ( std::size_t i=0; i<W; ++i ) r[i] = a.v_[i] op b.v_[i];              \
+    return r;                                                                 \
+  }
+
+  FLECSALE_SIMD_GENERIC_CMP(<)
+  FLECSALE_SIMD_GENERIC_CMP(<=)
+  FLECSALE_SIMD_GENERIC_CMP(>)
+  FLECSALE_SIMD_GENERIC_CMP(>=)
+
+#undef FLECSALE_SIMD_GENERIC_CMP
+
+  //============================================================================
+  // Math functions
+  //============================================================================
+
+  //! \brief lane-wise minimum
+  friend simd__ min( const simd__ & a, const simd__ & b )
+  {
+    simd__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.v_[i] = std::min( a.v_[i], b.v_[i] );
+    return r;
+  }
+
+  //! \brief lane-wise maximum
+  friend simd__ max( const simd__ & a, const simd__ & b )
+  {
+    simd__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.v_[i] = std::max( a.v_[i], b.v_[i] );
+    return r;
+  }
+
+  //! \brief lane-wise absolute value
+  friend simd__ abs( const simd__ & a )
+  {
+    simd__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.v_[i] = std::abs( a.v_[i] );
+    return r;
+  }
+
+  //! \brief lane-wise square root
+  friend simd__ sqrt( const simd__ & a )
+  {
+    simd__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.v_[i] = std::sqrt( a.v_[i] );
+    return r;
+  }
+
+  //! \brief pick lanes from \e a where the mask is set, \e b otherwise
+  friend simd__ select( const mask_t & m, const simd__ & a, const simd__ & b )
+  {
+    simd__ r;
+    for ( std::size_t i=0; i<W; ++i ) r.v_[i] = m[i] ? a.v_[i] : b.v_[i];
+    return r;
+  }
+
+private:
+
+  //! the lanes
+  T v_[W];
+
+};
+
+
+#if defined(__AVX512F__) || defined(__AVX__)
+
+////////////////////////////////////////////////////////////////////////////////
+// The intrinsic specializations all share the same layout, so they are
+// stamped out with a macro.
+//
+//  TYPE   : the value type
+//  W      : the number of lanes
+//  REG    : the register type
+//  MASK   : the native mask type
+//  P      : the intrinsic prefix
+//  S      : the intrinsic suffix
+//  MSK_*  : mask operations
+//  CMP    : the comparison expression, given a, b and a predicate
+//  SEL    : the blend expression, given m, a and b
+//  ABS    : the absolute value expression, given a
+////////////////////////////////////////////////////////////////////////////////
+#define FLECSALE_SIMD_SPECIALIZATION(                                         \
+  TYPE, W, REG, MASK, P, S, MSK_AND, MSK_OR, MSK_NOT, MSK_ANY, CMP, SEL, ABS  \
+)                                                                             \
+template<>                                                                    \
+class simd_mask__<TYPE, W> {                                                        \
+public:                                                                       \
+  simd_mask__() = default;                                                    \
+  simd_mask__( MASK m ) : m_(m) {}                                            \
+  MASK native() const { return m_; }                                          \
+  friend simd_mask__ operator&&( const simd_mask__ & a, const simd_mask__ & b)\
+  { return MSK_AND( a.m_, b.m_ ); }                                           \
+  friend simd_mask__ operator||( const simd_mask__ & a, const simd_mask__ & b)\
+  { return MSK_OR( a.m_, b.m_ ); }                                            \
+  friend simd_mask__ operator!( const simd_mask__ & a )                       \
+  { return MSK_NOT( a.m_ ); }                                                 \
+  friend bool any( const simd_mask__ & a )                                    \
+  { return MSK_ANY( a.m_ ); }                                                 \
+private:                                                                      \
+  MASK m_;                                                                    \
+};                                                                            \
+                                                                              \
+template<>                                                                    \
+class simd__<TYPE, W> {                                                       \
+public:                                                                       \
+  using value_type = TYPE;                                                    \
+  using mask_t = simd_mask__<TYPE, W>;                                        \
+  static constexpr std::size_t width = W;                                     \
+  simd__() = default;                                                         \
+  simd__( REG v ) : v_(v) {}                                                  \
+  simd__( TYPE x ) : v_( P##_set1_##S(x) ) {}                                 \
+  static simd__ load( const TYPE * p ) { return P##_loadu_##S(p); }           \
+  void store( TYPE * p ) const { P##_storeu_##S( p, v_ ); }                   \
+  TYPE operator[]( std::size_t i ) const                                      \
+  { alignas(64) TYPE tmp[W]; store(tmp); return tmp[i]; }                     \
+  REG native() const { return v_; }                                           \
+  friend simd__ operator+( const simd__ & a, const simd__ & b )               \
+  { return P##_add_##S( a.v_, b.v_ ); }                                       \
+  friend simd__ operator-( const simd__ & a, const simd__ & b )               \
+  { return P##_sub_##S( a.v_, b.v_ ); }                                       \
+  friend simd__ operator*( const simd__ & a, const simd__ & b )               \
+  { return P##_mul_##S( a.v_, b.v_ ); }                                       \
+  friend simd__ operator/( const simd__ & a, const simd__ & b )               \
+  { return P##_div_##S( a.v_, b.v_ ); }                                       \
+  simd__ & operator+=( const simd__ & b ) { return *this = *this + b; }       \
+  simd__ & operator-=( const simd__ & b ) { return *this = *this - b; }       \
+  simd__ & operator*=( const simd__ & b ) { return *this = *this * b; }       \
+  simd__ & operator/=( const simd__ & b ) { return *this = *this / b; }       \
+  friend simd__ operator-( const simd__ & a )                                 \
+  { return P##_sub_##S( P##_setzero_##S(), a.v_ ); }                          \
+  friend mask_t operator<( const simd__ & a, const simd__ & b )               \
+  { return CMP( a.v_, b.v_, _CMP_LT_OQ ); }                                   \
+  friend mask_t operator<=( const simd__ & a, const simd__ & b )              \
+  { return CMP( a.v_, b.v_, _CMP_LE_OQ ); }                                   \
+  friend mask_t operator>( const simd__ & a, const simd__ & b )               \
+  { return CMP( a.v_, b.v_, _CMP_GT_OQ ); }                                   \
+  friend mask_t operator>=( const simd__ & a, const simd__ & b )              \
+  { return CMP( a.v_, b.v_, _CMP_GE_OQ ); }                                   \
+  friend simd__ min( const simd__ & a, const simd__ & b )                     \
+  { return P##_min_##S( a.v_, b.v_ ); }                                       \
+  friend simd__ max( const simd__ & a, const simd__ & b )                     \
+  { return P##_max_##S( a.v_, b.v_ ); }                                       \
+  friend simd__ abs( const simd__ & a )                                       \
+  { return ABS( a.v_ ); }                                                     \
+  friend simd__ sqrt( const simd__ & a )                                      \
+  { return P##_sqrt_##S( a.v_ ); }                                            \
+  friend simd__ select( const mask_t & m, const simd__ & a, const simd__ & b )\
+  { return SEL( m.native(), a.v_, b.v_ ); }                                   \
+private:                                                                      \
+  REG v_;                                                                     \
+};
+
+#endif
+
+
+#if defined(__AVX512F__)
+
+// AVX-512 masks are bit masks
+#define FLECSALE_SIMD_KAND(a,b) static_cast<decltype(a)>( (a) & (b) )
+#define FLECSALE_SIMD_KOR(a,b)  static_cast<decltype(a)>( (a) | (b) )
+#define FLECSALE_SIMD_KNOT8(a)  static_cast<__mmask8>( ~(a) )
+#define FLECSALE_SIMD_KNOT16(a) static_cast<__mmask16>( ~(a) )
+#define FLECSALE_SIMD_KANY(a)   ( (a) != 0 )
+
+#define FLECSALE_SIMD_CMP512_PD(a,b,p) _mm512_cmp_pd_mask( a, b, p )
+#define FLECSALE_SIMD_CMP512_PS(a,b,p) _mm512_cmp_ps_mask( a, b, p )
+#define FLECSALE_SIMD_SEL512_PD(m,a,b) _mm512_mask_blend_pd( m, b, a )
+#define FLECSALE_SIMD_SEL512_PS(m,a,b) _mm512_mask_blend_ps( m, b, a )
+#define FLECSALE_SIMD_ABS512_PD(a) _mm512_abs_pd( a )
+#define FLECSALE_SIMD_ABS512_PS(a) _mm512_abs_ps( a )
+
+FLECSALE_SIMD_SPECIALIZATION(
+  double, 8, __m512d, __mmask8, _mm512, pd,
+  FLECSALE_SIMD_KAND, FLECSALE_SIMD_KOR, FLECSALE_SIMD_KNOT8,
+  FLECSALE_SIMD_KANY, FLECSALE_SIMD_CMP512_PD, FLECSALE_SIMD_SEL512_PD,
+  FLECSALE_SIMD_ABS512_PD
+)
+
+FLECSALE_SIMD_SPECIALIZATION(
+  float, 16, __m512, __mmask16, _mm512, ps,
+  FLECSALE_SIMD_KAND, FLECSALE_SIMD_KOR, FLECSALE_SIMD_KNOT16,
+  FLECSALE_SIMD_KANY, FLECSALE_SIMD_CMP512_PS, FLECSALE_SIMD_SEL512_PS,
+  FLECSALE_SIMD_ABS512_PS
+)
+
+#undef FLECSALE_SIMD_KAND
+#undef FLECSALE_SIMD_KOR
+#undef FLECSALE_SIMD_KNOT8
+#undef FLECSALE_SIMD_KNOT16
+#undef FLECSALE_SIMD_KANY
+#undef FLECSALE_SIMD_CMP512_PD
+#undef FLECSALE_SIMD_CMP512_PS
+#undef FLECSALE_SIMD_SEL512_PD
+#undef FLECSALE_SIMD_SEL512_PS
+#undef FLECSALE_SIMD_ABS512_PD
+#undef FLECSALE_SIMD_ABS512_PS
+
+#elif defined(__AVX__)
+
+// AVX masks are full-width registers
+#define FLECSALE_SIMD_AND_PD(a,b) _mm256_and_pd( a, b )
+#define FLECSALE_SIMD_AND_PS(a,b) _mm256_and_ps( a, b )
+#define FLECSALE_SIMD_OR_PD(a,b)  _mm256_or_pd( a, b )
+#define FLECSALE_SIMD_OR_PS(a,b)  _mm256_or_ps( a, b )
+#define FLECSALE_SIMD_NOT_PD(a)   \
+  _mm256_xor_pd( a, _mm256_castsi256_pd( _mm256_set1_epi64x(-1) ) )
+#define FLECSALE_SIMD_NOT_PS(a)   \
+  _mm256_xor_ps( a, _mm256_castsi256_ps( _mm256_set1_epi32(-1) ) )
+#define FLECSALE_SIMD_ANY_PD(a)   ( _mm256_movemask_pd( a ) != 0 )
+#define FLECSALE_SIMD_ANY_PS(a)   ( _mm256_movemask_ps( a ) != 0 )
+
+#define FLECSALE_SIMD_CMP256_PD(a,b,p) _mm256_cmp_pd( a, b, p )
+#define FLECSALE_SIMD_CMP256_PS(a,b,p) _mm256_cmp_ps( a, b, p )
+#define FLECSALE_SIMD_SEL256_PD(m,a,b) _mm256_blendv_pd( b, a, m )
+#define FLECSALE_SIMD_SEL256_PS(m,a,b) _mm256_blendv_ps( b, a, m )
+#define FLECSALE_SIMD_ABS256_PD(a) _mm256_andnot_pd( _mm256_set1_pd(-0.0), a )
+#define FLECSALE_SIMD_ABS256_PS(a) _mm256_andnot_ps( _mm256_set1_ps(-0.0f), a )
+
+FLECSALE_SIMD_SPECIALIZATION(
+  double, 4, __m256d, __m256d, _mm256, pd,
+  FLECSALE_SIMD_AND_PD, FLECSALE_SIMD_OR_PD, FLECSALE_SIMD_NOT_PD,
+  FLECSALE_SIMD_ANY_PD, FLECSALE_SIMD_CMP256_PD, FLECSALE_SIMD_SEL256_PD,
+  FLECSALE_SIMD_ABS256_PD
+)
+
+FLECSALE_SIMD_SPECIALIZATION(
+  float, 8, __m256, __m256, _mm256, ps,
+  FLECSALE_SIMD_AND_PS, FLECSALE_SIMD_OR_PS, FLECSALE_SIMD_NOT_PS,
+  FLECSALE_SIMD_ANY_PS, FLECSALE_SIMD_CMP256_PS, FLECSALE_SIMD_SEL256_PS,
+  FLECSALE_SIMD_ABS256_PS
+)
+
+#undef FLECSALE_SIMD_AND_PD
+#undef FLECSALE_SIMD_AND_PS
+#undef FLECSALE_SIMD_OR_PD
+#undef FLECSALE_SIMD_OR_PS
+#undef FLECSALE_SIMD_NOT_PD
+#undef FLECSALE_SIMD_NOT_PS
+#undef FLECSALE_SIMD_ANY_PD
+#undef FLECSALE_SIMD_ANY_PS
+#undef FLECSALE_SIMD_CMP256_PD
+#undef FLECSALE_SIMD_CMP256_PS
+#undef FLECSALE_SIMD_SEL256_PD
+#undef FLECSALE_SIMD_SEL256_PS
+#undef FLECSALE_SIMD_ABS256_PD
+#undef FLECSALE_SIMD_ABS256_PS
+
+#endif
+
+#undef FLECSALE_SIMD_SPECIALIZATION
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The native simd type for a value type.
+//! \tparam T  The value type.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+using simd_t = simd__< T, simd_width<T>() >;
+
+} // namespace
+} // namespace
@@ -0,0 +1,148 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the compression of field data.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// user includes
+#include <flecsale/utils/compression.h>
+
+
+// explicitly use some stuff
+using std::vector;
+
+using namespace flecsale::utils;
+
+//! \brief Compress and decompress, checking the values come back exactly.
+template< typename T >
+std::size_t round_trip( const vector<T> & values )
+{
+  auto bytes = values.size() * sizeof(T);
+  vector<char> packed;
+  compress( values.data(), bytes, sizeof(T), packed );
+  vector<T> unpacked( values.size() );
+  decompress( packed.data(), packed.size(), sizeof(T), unpacked.data(), bytes );
+  EXPECT_EQ( values, unpacked );
+  return packed.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the lossless stage on smooth and on random data
+///////////////////////////////////////////////////////////////////////////////
+TEST(compression, lossless) {
+
+  // a smooth field, large enough for several chunks
+  vector<double> smooth( 400000 );
+  for ( std::size_t i=0; i<smooth.size(); ++i )
+    smooth[i] = 1.0 + ( i < smooth.size()/2 ? 0.0 : 0.125 ) +
+      1.e-3 * std::floor( i / 1000.0 );
+  auto bytes = smooth.size() * sizeof(double);
+  ASSERT_LT( round_trip( smooth ), bytes / 4 );
+
+  // random bytes do not compress, but still come back
+  std::mt19937 gen( 42 );
+  std::uniform_real_distribution<double> dist( -1, 1 );
+  vector<double> noise( 10000 );
+  for ( auto & x : noise ) x = dist( gen );
+  round_trip( noise );
+
+  // odd sizes, including data shorter than a match
+  for ( std::size_t n : { 0, 1, 3, 17, 1001 } ) {
+    vector<char> text( n );
+    for ( std::size_t i=0; i<n; ++i ) text[i] = "abcabcab"[i % 8];
+    round_trip( text );
+  }
+
+  // values wider than a word are shuffled by words
+  ASSERT_EQ( shuffle_word_bytes( 24 ), 8 );
+  ASSERT_EQ( shuffle_word_bytes( 12 ), 4 );
+  ASSERT_EQ( shuffle_word_bytes( 3 ), 1 );
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that corrupt data is caught
+///////////////////////////////////////////////////////////////////////////////
+TEST(compression, corrupt) {
+
+  vector<double> values( 5000, 3.5 );
+  auto bytes = values.size() * sizeof(double);
+  vector<char> packed;
+  compress( values.data(), bytes, sizeof(double), packed );
+
+  vector<double> unpacked( values.size() );
+  auto truncated = packed;
+  truncated.pop_back();
+  ASSERT_THROW(
+    decompress( truncated.data(), truncated.size(), sizeof(double),
+      unpacked.data(), bytes ),
+    std::runtime_error
+  );
+
+  // a bad match offset
+  vector<unsigned char> bad = { 0x10, 'a', 0xff, 0x00, 0x00 };
+  vector<char> out( 32 );
+  ASSERT_THROW(
+    lz_decompress( bad.data(), bad.size(), out.data(), out.size() ),
+    std::runtime_error
+  );
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the error bounds of the lossy stage
+///////////////////////////////////////////////////////////////////////////////
+TEST(compression, tolerance) {
+
+  std::mt19937 gen( 7 );
+  std::uniform_real_distribution<double> dist( -3, 3 );
+  vector<double> values( 10000 );
+  for ( auto & x : values ) x = std::pow( 10.0, 2*dist( gen ) );
+  values[0] = 0;
+  values[1] = -values[2];
+
+  // absolute
+  tolerance_t absolute;
+  absolute.absolute = 1.e-4;
+  auto rounded = values;
+  round_to_tolerance( rounded.data(), rounded.size(), absolute );
+  for ( std::size_t i=0; i<values.size(); ++i )
+    ASSERT_LE( std::abs( rounded[i] - values[i] ), absolute.absolute );
+  ASSERT_EQ( rounded[0], 0 );
+
+  // relative
+  tolerance_t relative;
+  relative.relative = 1.e-6;
+  rounded = values;
+  round_to_tolerance( rounded.data(), rounded.size(), relative );
+  for ( std::size_t i=0; i<values.size(); ++i )
+    ASSERT_LE(
+      std::abs( rounded[i] - values[i] ),
+      relative.relative * std::abs( values[i] )
+    );
+
+  // the rounded values compress better
+  auto bytes = values.size() * sizeof(double);
+  vector<char> exact, lossy;
+  compress( values.data(), bytes, sizeof(double), exact );
+  compress( rounded.data(), bytes, sizeof(double), lossy );
+  ASSERT_LT( lossy.size(), exact.size() );
+
+  // no tolerance keeps the values
+  rounded = values;
+  round_to_tolerance( rounded.data(), rounded.size(), tolerance_t{} );
+  ASSERT_EQ( rounded, values );
+
+}